@@ -0,0 +1,124 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+// TextBuffer::SaveSnapshot() writes a binary copy of the buffer contents that TextBuffer::LoadSnapshot()
+// can restore without having to parse VT sequences like the output of TextBuffer::Serialize(). The format is:
+//
+//   SnapshotHeader
+//   attributes   attributeCount x { u16 attrs, u16 hyperlinkId, 3x { u8 type, u8 r/index, u8 g, u8 b }, u16 markKind }
+//   hyperlinks   hyperlinkCount x { u16 id, u32 length, wchar_t[length] uri }
+//   custom ids   customIdCount x { u16 id, u32 length, wchar_t[length] customId }
+//   rows         rowCount x FrozenRow::Encode()
+//
+// All values are stored in native (little-endian) byte order without any padding.
+// Anything that changes the layout of the above requires incrementing SnapshotHeader::CurrentVersion.
+struct SnapshotHeader
+{
+    static constexpr uint32_t Magic = 0x53425457; // "WTBS"
+    static constexpr uint16_t CurrentVersion = 1;
+
+    uint32_t magic;
+    uint16_t version;
+    uint16_t width;
+    uint16_t height;
+    uint16_t currentHyperlinkId;
+    int32_t cursorX;
+    int32_t cursorY;
+    uint32_t rowCount;
+    uint32_t attributeCount;
+    uint32_t hyperlinkCount;
+    uint32_t customIdCount;
+};
+
+class SnapshotWriter
+{
+public:
+    template<typename T>
+    void Write(const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+#pragma warning(suppress : 26490) // Don't use reinterpret_cast (type.1).
+        Write({ reinterpret_cast<const std::byte*>(&value), sizeof(T) });
+    }
+
+    void Write(const std::span<const std::byte>& bytes)
+    {
+        _data.insert(_data.end(), bytes.begin(), bytes.end());
+    }
+
+    void WriteString(const std::wstring_view& str)
+    {
+        Write(gsl::narrow<uint32_t>(str.size()));
+        Write(std::as_bytes(std::span{ str }));
+    }
+
+    std::vector<std::byte>& Data() noexcept
+    {
+        return _data;
+    }
+
+private:
+    std::vector<std::byte> _data;
+};
+
+// Reads values from a snapshot. Instead of throwing on truncated input, reads return zeroed values and
+// mark the reader as failed, which callers check with Failed() once they're done reading a section.
+// Snapshots are loaded from disk and so any value read from them must be validated before use.
+class SnapshotReader
+{
+public:
+    explicit SnapshotReader(const std::span<const std::byte>& data) noexcept :
+        _data{ data }
+    {
+    }
+
+    template<typename T>
+    T Read() noexcept
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T value{};
+        if (const auto bytes = Read(sizeof(T)); !bytes.empty())
+        {
+            memcpy(&value, bytes.data(), sizeof(T));
+        }
+        return value;
+    }
+
+    std::span<const std::byte> Read(size_t size) noexcept
+    {
+        if (_failed || size > _data.size() - _offset)
+        {
+            _failed = true;
+            return {};
+        }
+        const auto bytes = _data.subspan(_offset, size);
+        _offset += size;
+        return bytes;
+    }
+
+    std::wstring ReadString()
+    {
+        const auto length = Read<uint32_t>();
+        const auto bytes = Read(size_t{ length } * sizeof(wchar_t));
+        std::wstring str(bytes.size() / sizeof(wchar_t), L'\0');
+        memcpy(str.data(), bytes.data(), bytes.size());
+        return str;
+    }
+
+    bool Failed() const noexcept
+    {
+        return _failed;
+    }
+
+    bool AtEnd() const noexcept
+    {
+        return _offset == _data.size();
+    }
+
+private:
+    std::span<const std::byte> _data;
+    size_t _offset = 0;
+    bool _failed = false;
+};
@@ -0,0 +1,141 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "ImageSlice.hpp"
+
+ImageSlice::ImageSlice(const til::size cellSize) noexcept :
+    _cellSize{ cellSize }
+{
+}
+
+til::size ImageSlice::CellSize() const noexcept
+{
+    return _cellSize;
+}
+
+til::CoordType ImageSlice::ColumnBegin() const noexcept
+{
+    return _columnBegin;
+}
+
+til::CoordType ImageSlice::ColumnEnd() const noexcept
+{
+    return _columnEnd;
+}
+
+til::CoordType ImageSlice::PixelWidth() const noexcept
+{
+    return (_columnEnd - _columnBegin) * _cellSize.width;
+}
+
+std::span<const til::color> ImageSlice::Pixels() const noexcept
+{
+    return _pixels;
+}
+
+// Returns the pixels of line y (0 <= y < CellSize().height) of the slice.
+std::span<const til::color> ImageSlice::PixelLine(const til::CoordType y) const noexcept
+{
+    const auto width = gsl::narrow_cast<size_t>(PixelWidth());
+    return std::span{ _pixels }.subspan(gsl::narrow_cast<size_t>(y) * width, width);
+}
+
+// Returns the pixels of line y for the given column range, extending the slice if needed.
+// Extending the slice to the left or right is linear in the size of the slice, but since
+// images write each of their rows in one go, this happens at most once per image and row.
+std::span<til::color> ImageSlice::MutablePixelLine(const til::CoordType y, const til::CoordType columnBegin, const til::CoordType columnEnd)
+{
+    if (_columnBegin == _columnEnd)
+    {
+        _columnBegin = columnBegin;
+        _columnEnd = columnEnd;
+        _pixels.assign(gsl::narrow_cast<size_t>(PixelWidth() * _cellSize.height), til::color{});
+    }
+    else if (columnBegin < _columnBegin || columnEnd > _columnEnd)
+    {
+        const auto newBegin = std::min(columnBegin, _columnBegin);
+        const auto newEnd = std::max(columnEnd, _columnEnd);
+        const auto oldWidth = gsl::narrow_cast<size_t>(PixelWidth());
+        const auto newWidth = gsl::narrow_cast<size_t>((newEnd - newBegin) * _cellSize.width);
+        const auto offset = gsl::narrow_cast<size_t>((_columnBegin - newBegin) * _cellSize.width);
+
+        std::vector<til::color> pixels(newWidth * _cellSize.height);
+        for (size_t line = 0; line < gsl::narrow_cast<size_t>(_cellSize.height); ++line)
+        {
+            const auto src = _pixels.begin() + line * oldWidth;
+            std::copy(src, src + oldWidth, pixels.begin() + line * newWidth + offset);
+        }
+
+        _pixels = std::move(pixels);
+        _columnBegin = newBegin;
+        _columnEnd = newEnd;
+    }
+
+    const auto width = gsl::narrow_cast<size_t>(PixelWidth());
+    const auto offset = gsl::narrow_cast<size_t>(y) * width + gsl::narrow_cast<size_t>((columnBegin - _columnBegin) * _cellSize.width);
+    const auto count = gsl::narrow_cast<size_t>((columnEnd - columnBegin) * _cellSize.width);
+    return std::span{ _pixels }.subspan(offset, count);
+}
+
+// Makes the pixels of the given columns transparent. Returns true if the slice is empty afterwards.
+bool ImageSlice::EraseColumns(const til::CoordType columnBegin, const til::CoordType columnEnd) noexcept
+{
+    const auto begin = std::max(columnBegin, _columnBegin);
+    const auto end = std::min(columnEnd, _columnEnd);
+
+    if (begin < end)
+    {
+        const auto width = gsl::narrow_cast<size_t>(PixelWidth());
+        const auto offset = gsl::narrow_cast<size_t>((begin - _columnBegin) * _cellSize.width);
+        const auto count = gsl::narrow_cast<size_t>((end - begin) * _cellSize.width);
+
+        for (size_t line = 0; line < gsl::narrow_cast<size_t>(_cellSize.height); ++line)
+        {
+            const auto it = _pixels.begin() + line * width + offset;
+            std::fill(it, it + count, til::color{});
+        }
+    }
+
+    return std::all_of(_pixels.begin(), _pixels.end(), [](const auto& px) { return px.a == 0; });
+}
+
+// Alpha-blends the slice onto a canvas that holds the pixels of the row's cells, starting at column 0.
+// The canvas is canvasWidth pixels wide and CellSize().height lines tall. This is the CPU-side
+// compositing path, which doesn't depend on any renderer and is used by headless consumers.
+void ImageSlice::CompositeOnto(std::span<til::color> canvas, const til::CoordType canvasWidth) const noexcept
+{
+    const auto left = _columnBegin * _cellSize.width;
+    const auto width = std::min(PixelWidth(), canvasWidth - left);
+    if (width <= 0)
+    {
+        return;
+    }
+
+    const auto srcStride = gsl::narrow_cast<size_t>(PixelWidth());
+    const auto dstStride = gsl::narrow_cast<size_t>(canvasWidth);
+    const auto lines = std::min(gsl::narrow_cast<size_t>(_cellSize.height), canvas.size() / dstStride);
+
+    for (size_t line = 0; line < lines; ++line)
+    {
+        const auto src = _pixels.data() + line * srcStride;
+        const auto dst = canvas.data() + line * dstStride + left;
+
+        for (til::CoordType x = 0; x < width; ++x)
+        {
+            const auto s = src[x];
+            if (s.a == 0xff)
+            {
+                dst[x] = s;
+            }
+            else if (s.a != 0)
+            {
+                auto& d = dst[x];
+                const auto blend = [&](const uint8_t sc, const uint8_t dc) {
+                    return gsl::narrow_cast<uint8_t>((sc * s.a + dc * (0xff - s.a) + 0x7f) / 0xff);
+                };
+                d = til::color{ blend(s.r, d.r), blend(s.g, d.g), blend(s.b, d.b), std::max(s.a, d.a) };
+            }
+        }
+    }
+}
@@ -0,0 +1,36 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+// An ImageSlice holds the pixels of an image (e.g. Sixel) that cover a single ROW.
+// Images are split up into one slice per row when they're written into the buffer,
+// which means they scroll, get copied and get evicted together with their ROW.
+//
+// A slice covers the columns [ColumnBegin(), ColumnEnd()) of its row. Its pixels are
+// stored line by line, with CellSize().width pixels per column and CellSize().height lines.
+// Pixels with an alpha of 0 are transparent and let the text layer show through.
+class ImageSlice
+{
+public:
+    using Pointer = std::unique_ptr<ImageSlice>;
+
+    explicit ImageSlice(til::size cellSize) noexcept;
+
+    til::size CellSize() const noexcept;
+    til::CoordType ColumnBegin() const noexcept;
+    til::CoordType ColumnEnd() const noexcept;
+    til::CoordType PixelWidth() const noexcept;
+    std::span<const til::color> Pixels() const noexcept;
+    std::span<const til::color> PixelLine(til::CoordType y) const noexcept;
+
+    std::span<til::color> MutablePixelLine(til::CoordType y, til::CoordType columnBegin, til::CoordType columnEnd);
+    bool EraseColumns(til::CoordType columnBegin, til::CoordType columnEnd) noexcept;
+    void CompositeOnto(std::span<til::color> canvas, til::CoordType canvasWidth) const noexcept;
+
+private:
+    til::size _cellSize;
+    til::CoordType _columnBegin = 0;
+    til::CoordType _columnEnd = 0;
+    std::vector<til::color> _pixels;
+};
@@ -8,6 +8,8 @@
 #include <til/unicode.h>
 
 #include "textBuffer.hpp"
+#include "BufferSnapshot.hpp"
+#include "TextAttributePalette.hpp"
 #include "../../types/inc/GlyphWidth.hpp"
 
 // It would be nice to add checked array access in the future, but it's a little annoying to do so without impacting
@@ -82,6 +84,131 @@ constexpr OutIt copy_n_small(InIt first, Diff count, OutIt dest)
     return dest;
 }
 
+#pragma warning(push)
+#pragma warning(disable : 26429) // Symbol '...' is never tested for nullness, it can be marked as not_null (f.23).
+#pragma warning(disable : 26490) // Don't use reinterpret_cast (type.1).
+
+// Returns a pointer to the first character in [beg,end) that isn't a whitespace, or `end` if there's none.
+[[msvc::forceinline]] static const wchar_t* findFirstNonSpacePlain(const wchar_t* beg, const wchar_t* end) noexcept
+{
+#pragma loop(no_vector)
+    for (; beg != end && *beg == L' '; ++beg)
+    {
+    }
+    return beg;
+}
+
+// Returns a pointer 1 past the last character in [beg,end) that isn't a whitespace, or `beg` if there's none.
+[[msvc::forceinline]] static const wchar_t* findLastNonSpacePlain(const wchar_t* beg, const wchar_t* end) noexcept
+{
+#pragma loop(no_vector)
+    for (; end != beg && end[-1] == L' '; --end)
+    {
+    }
+    return end;
+}
+
+// Vectorized version of findFirstNonSpacePlain(). It compares 8 or 16 chars at once against whitespace and
+// uses the resulting bitmask (1 bit per byte, or 2 bits per wchar_t) to find the first mismatch.
+// Row text is mostly whitespace, which makes the plain loop a bottleneck when scanning large buffers.
+static const wchar_t* findFirstNonSpace(const wchar_t* beg, const wchar_t* end) noexcept
+{
+#if defined(TIL_SSE_INTRINSICS)
+    unsigned long index;
+
+    if (__isa_available >= __ISA_AVAILABLE_AVX2)
+    {
+        const auto spaces = _mm256_set1_epi16(L' ');
+        for (; end - beg >= 16; beg += 16)
+        {
+            const auto wch = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(beg));
+            const auto mask = ~static_cast<unsigned long>(_mm256_movemask_epi8(_mm256_cmpeq_epi16(wch, spaces)));
+            if (_BitScanForward(&index, mask))
+            {
+                return beg + index / 2;
+            }
+        }
+    }
+
+    const auto spaces = _mm_set1_epi16(L' ');
+    for (; end - beg >= 8; beg += 8)
+    {
+        const auto wch = _mm_loadu_si128(reinterpret_cast<const __m128i*>(beg));
+        const auto mask = ~static_cast<unsigned long>(_mm_movemask_epi8(_mm_cmpeq_epi16(wch, spaces))) & 0xffff;
+        if (_BitScanForward(&index, mask))
+        {
+            return beg + index / 2;
+        }
+    }
+#elif defined(TIL_ARM_NEON_INTRINSICS)
+    unsigned long index;
+
+    const auto spaces = vdupq_n_u16(L' ');
+    for (; end - beg >= 8; beg += 8)
+    {
+        const auto eq = vceqq_u16(vld1q_u16(reinterpret_cast<const uint16_t*>(beg)), spaces);
+        // NEON lacks movemask. Narrowing each 16-bit lane to 8 bits results in a 64-bit mask with 8 bits per wchar_t.
+        const auto mask = ~vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(eq, 4)), 0);
+        if (_BitScanForward64(&index, mask))
+        {
+            return beg + index / 8;
+        }
+    }
+#endif
+
+    return findFirstNonSpacePlain(beg, end);
+}
+
+// The backwards counterpart to findFirstNonSpace().
+static const wchar_t* findLastNonSpace(const wchar_t* beg, const wchar_t* end) noexcept
+{
+#if defined(TIL_SSE_INTRINSICS)
+    unsigned long index;
+
+    if (__isa_available >= __ISA_AVAILABLE_AVX2)
+    {
+        const auto spaces = _mm256_set1_epi16(L' ');
+        for (; end - beg >= 16; end -= 16)
+        {
+            const auto wch = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(end - 16));
+            const auto mask = ~static_cast<unsigned long>(_mm256_movemask_epi8(_mm256_cmpeq_epi16(wch, spaces)));
+            if (_BitScanReverse(&index, mask))
+            {
+                return end - 16 + index / 2 + 1;
+            }
+        }
+    }
+
+    const auto spaces = _mm_set1_epi16(L' ');
+    for (; end - beg >= 8; end -= 8)
+    {
+        const auto wch = _mm_loadu_si128(reinterpret_cast<const __m128i*>(end - 8));
+        const auto mask = ~static_cast<unsigned long>(_mm_movemask_epi8(_mm_cmpeq_epi16(wch, spaces))) & 0xffff;
+        if (_BitScanReverse(&index, mask))
+        {
+            return end - 8 + index / 2 + 1;
+        }
+    }
+#elif defined(TIL_ARM_NEON_INTRINSICS)
+    unsigned long index;
+
+    const auto spaces = vdupq_n_u16(L' ');
+    for (; end - beg >= 8; end -= 8)
+    {
+        const auto eq = vceqq_u16(vld1q_u16(reinterpret_cast<const uint16_t*>(end - 8)), spaces);
+        const auto mask = ~vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(eq, 4)), 0);
+        if (_BitScanReverse64(&index, mask))
+        {
+            return end - 8 + index / 8 + 1;
+        }
+    }
+#endif
+
+    return findLastNonSpacePlain(beg, end);
+}
+
+#pragma warning(pop)
+
 CharToColumnMapper::CharToColumnMapper(const wchar_t* chars, const uint16_t* charOffsets, ptrdiff_t lastCharOffset, til::CoordType currentColumn) noexcept :
     _chars{ chars },
     _charOffsets{ charOffsets },
@@ -161,11 +288,95 @@ til::CoordType CharToColumnMapper::GetTrailingColumnAt(const wchar_t* str) noexc
 // - fillAttribute - the default text attribute
 // Return Value:
 // - constructed object
-ROW::ROW(wchar_t* charsBuffer, uint16_t* charOffsetsBuffer, uint16_t rowWidth, const TextAttribute& fillAttribute) :
+RowSearchSignature RowSearchSignature::FromText(const std::wstring_view& text) noexcept
+{
+    RowSearchSignature sig;
+    if (text.empty())
+    {
+        return sig;
+    }
+
+    auto prev = til::at(text, 0);
+    sig.first = prev;
+    sig.nonAscii = prev >= 0x80;
+
+    for (size_t i = 1; i < text.size(); ++i)
+    {
+        const auto ch = til::at(text, i);
+        sig.nonAscii |= ch >= 0x80;
+        sig.Add(prev, ch);
+        prev = ch;
+    }
+
+    sig.last = prev;
+    return sig;
+}
+
+// Records the bigram "ab" if both are ASCII.
+void RowSearchSignature::Add(wchar_t a, wchar_t b) noexcept
+{
+    if ((a | b) >= 0x80)
+    {
+        return;
+    }
+
+    // ASCII case folding: A-Z --> a-z
+    const auto fold = [](uint32_t ch) { return ch - 'A' < 26 ? ch | 0x20 : ch; };
+    // Fibonacci hashing of the 14-bit bigram. The top 8 bits select 1 of the 256 bits in `bigrams`.
+    const auto hash = ((fold(a) << 7) | fold(b)) * 0x9E3779B1u >> 24;
+    til::at(bigrams, hash / 64) |= uint64_t{ 1 } << (hash % 64);
+}
+
+// Combines the signature of the text that immediately follows this one into this signature.
+void RowSearchSignature::Append(const RowSearchSignature& other) noexcept
+{
+    if (first == 0)
+    {
+        *this = other;
+        return;
+    }
+    if (other.first == 0)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < bigrams.size(); ++i)
+    {
+        til::at(bigrams, i) |= til::at(other.bigrams, i);
+    }
+    Add(last, other.first);
+    last = other.last;
+    nonAscii |= other.nonAscii;
+}
+
+// Returns true if no bigrams were recorded. MayContain() always returns true for such a needle.
+bool RowSearchSignature::Empty() const noexcept
+{
+    return (bigrams[0] | bigrams[1] | bigrams[2] | bigrams[3]) == 0;
+}
+
+// Returns false if the text this signature belongs to definitely doesn't contain the `needle`.
+bool RowSearchSignature::MayContain(const RowSearchSignature& needle, bool caseInsensitive) const noexcept
+{
+    if (caseInsensitive && nonAscii)
+    {
+        return true;
+    }
+
+    uint64_t missing = 0;
+    for (size_t i = 0; i < bigrams.size(); ++i)
+    {
+        missing |= til::at(needle.bigrams, i) & ~til::at(bigrams, i);
+    }
+    return missing == 0;
+}
+
+ROW::ROW(wchar_t* charsBuffer, uint16_t* charOffsetsBuffer, uint16_t rowWidth, TextAttributePalette& palette, const TextAttribute& fillAttribute) :
     _charsBuffer{ charsBuffer },
     _chars{ charsBuffer, rowWidth },
     _charOffsets{ charOffsetsBuffer, ::base::strict_cast<size_t>(rowWidth) + 1u },
-    _attr{ rowWidth, fillAttribute },
+    _attr{ rowWidth, palette.Index(fillAttribute) },
+    _palette{ &palette },
     _columnCount{ rowWidth }
 {
     _init();
@@ -184,6 +395,8 @@ bool ROW::WasWrapForced() const noexcept
 void ROW::SetDoubleBytePadded(const bool doubleBytePadded) noexcept
 {
     _doubleBytePadded = doubleBytePadded;
+    // GetText() depends on whether the ROW is padded.
+    _searchSignatureValid = false;
 }
 
 bool ROW::WasDoubleBytePadded() const noexcept
@@ -194,6 +407,8 @@ bool ROW::WasDoubleBytePadded() const noexcept
 void ROW::SetLineRendition(const LineRendition lineRendition) noexcept
 {
     _lineRendition = lineRendition;
+    // GetText() depends on the line rendition.
+    _searchSignatureValid = false;
 }
 
 LineRendition ROW::GetLineRendition() const noexcept
@@ -214,23 +429,81 @@ til::CoordType ROW::GetReadableColumnCount() const noexcept
     return (_columnCount - (_doubleBytePadded << 1)) >> 1;
 }
 
+// Returns the RowSearchSignature of GetText(). It gets cached until the next modification.
+const RowSearchSignature& ROW::GetSearchSignature() const noexcept
+{
+    if (!_searchSignatureValid)
+    {
+        _searchSignature = RowSearchSignature::FromText(GetText());
+        _searchSignatureValid = true;
+    }
+    return _searchSignature;
+}
+
+uint64_t ROW::GetMutationId() const noexcept
+{
+    return _mutationId;
+}
+
+void ROW::SetMutationId(const uint64_t mutationId) noexcept
+{
+    _mutationId = mutationId;
+}
+
+// Adds the given range of columns to the ones that need to be redrawn.
+void ROW::InvalidateColumns(const til::CoordType columnBegin, const til::CoordType columnEnd) noexcept
+{
+    const auto beg = _clampedColumnInclusive(columnBegin);
+    const auto end = _clampedColumnInclusive(columnEnd);
+    if (beg >= end)
+    {
+        return;
+    }
+
+    if (_invalidBegin >= _invalidEnd)
+    {
+        _invalidBegin = beg;
+        _invalidEnd = end;
+    }
+    else
+    {
+        _invalidBegin = std::min(_invalidBegin, beg);
+        _invalidEnd = std::max(_invalidEnd, end);
+    }
+}
+
+void ROW::ResetInvalidatedColumns() noexcept
+{
+    _invalidBegin = 0;
+    _invalidEnd = 0;
+}
+
+// Returns the range of columns [begin,end) passed to InvalidateColumns() since the last ResetInvalidatedColumns().
+// The range is empty if there's nothing to redraw.
+std::pair<til::CoordType, til::CoordType> ROW::GetInvalidatedColumns() const noexcept
+{
+    return { _invalidBegin, _invalidEnd };
+}
+
 // Routine Description:
 // - Sets all properties of the ROW to default values
 // Arguments:
 // - Attr - The default attribute (color) to fill
 // Return Value:
 // - <none>
-void ROW::Reset(const TextAttribute& attr) noexcept
+void ROW::Reset(const TextAttribute& attr)
 {
+    const auto index = _palette->Index(attr);
     _charsHeap.reset();
     _chars = { _charsBuffer, _columnCount };
     // Constructing and then moving objects into place isn't free.
     // Modifying the existing object is _much_ faster.
-    *_attr.runs().unsafe_shrink_to_size(1) = til::rle_pair{ attr, _columnCount };
+    *_attr.runs().unsafe_shrink_to_size(1) = til::rle_pair{ index, _columnCount };
     _lineRendition = LineRendition::SingleWidth;
     _wrapForced = false;
     _doubleBytePadded = false;
     _promptData = std::nullopt;
+    _imageSlice.reset();
     _init();
 }
 
@@ -243,6 +516,11 @@ void ROW::_init() noexcept
 
     // Fills _charsBuffer with whitespace and correspondingly _charOffsets
     // with successive numbers from 0 to _columnCount+1.
+    // If the ROW is trivial, _charOffsets already contains these numbers and we only need to fill _charsBuffer.
+    const auto writeOffsets = !_trivial;
+    _trivial = true;
+    _searchSignatureValid = false;
+
 #if defined(TIL_SSE_INTRINSICS)
     alignas(__m256i) static constexpr uint16_t whitespaceData[]{ 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20 };
     alignas(__m256i) static constexpr uint16_t offsetsData[]{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
@@ -288,7 +566,10 @@ void ROW::_init() noexcept
             do
             {
                 _mm256_storeu_si256(reinterpret_cast<__m256i*>(chars), whitespace);
-                _mm256_storeu_si256(reinterpret_cast<__m256i*>(charOffsets), offsetsLoop);
+                if (writeOffsets)
+                {
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(charOffsets), offsetsLoop);
+                }
                 offsetsLoop = _mm256_add_epi16(offsetsLoop, increment);
                 chars += 16;
                 charOffsets += 16;
@@ -296,7 +577,10 @@ void ROW::_init() noexcept
         }
 
         _mm256_storeu_si256(reinterpret_cast<__m256i*>(charsEndLoop), whitespace);
-        _mm256_storeu_si256(reinterpret_cast<__m256i*>(charOffsetsEndLoop), offsets);
+        if (writeOffsets)
+        {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(charOffsetsEndLoop), offsets);
+        }
     }
     else
     {
@@ -311,7 +595,10 @@ void ROW::_init() noexcept
         do
         {
             _mm_storeu_si128(reinterpret_cast<__m128i*>(chars), whitespace);
-            _mm_storeu_si128(reinterpret_cast<__m128i*>(charOffsets), offsets);
+            if (writeOffsets)
+            {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(charOffsets), offsets);
+            }
             offsets = _mm_add_epi16(offsets, increment);
             chars += 8;
             charOffsets += 8;
@@ -333,7 +620,10 @@ void ROW::_init() noexcept
     do
     {
         vst1q_u16(chars, whitespace);
-        vst1q_u16(charOffsets, offsets);
+        if (writeOffsets)
+        {
+            vst1q_u16(charOffsets, offsets);
+        }
         offsets = vaddq_u16(offsets, increment);
         chars += 8;
         charOffsets += 8;
@@ -343,7 +633,10 @@ void ROW::_init() noexcept
 #else
 #error "Vectorizing this function improves overall performance by up to 40%. Don't remove this warning, just add the vectorized code."
     std::fill_n(_charsBuffer, _columnCount, UNICODE_SPACE);
-    std::iota(_charOffsets.begin(), _charOffsets.end(), uint16_t{ 0 });
+    if (writeOffsets)
+    {
+        std::iota(_charOffsets.begin(), _charOffsets.end(), uint16_t{ 0 });
+    }
 #endif
 
 #pragma warning(push)
@@ -352,6 +645,7 @@ void ROW::_init() noexcept
 void ROW::CopyFrom(const ROW& source)
 {
     _lineRendition = source._lineRendition;
+    _searchSignatureValid = false;
     _wrapForced = source._wrapForced;
 
     RowCopyTextFromState state{
@@ -360,8 +654,551 @@ void ROW::CopyFrom(const ROW& source)
     };
     CopyTextFrom(state);
 
-    _attr = source.Attributes();
-    _attr.resize_trailing_extent(_columnCount);
+    CopyAttributesToEnd(source, 0, 0);
+
+    _imageSlice = source._imageSlice ? std::make_unique<ImageSlice>(*source._imageSlice) : nullptr;
+}
+
+FrozenRow::operator bool() const noexcept
+{
+    return _data != nullptr;
+}
+
+// Returns the number of bytes allocated by this FrozenRow.
+size_t FrozenRow::MemoryUsage() const noexcept
+{
+    if (!_data)
+    {
+        return 0;
+    }
+
+    Header header;
+    memcpy(&header, _data.get(), sizeof(header));
+    return header.size;
+}
+
+uint16_t FrozenRow::ColumnCount() const noexcept
+{
+    Header header;
+    memcpy(&header, _data.get(), sizeof(header));
+    return header.columnCount;
+}
+
+bool FrozenRow::WasWrapForced() const noexcept
+{
+    Header header;
+    memcpy(&header, _data.get(), sizeof(header));
+    return header.wrapForced;
+}
+
+LineRendition FrozenRow::GetLineRendition() const noexcept
+{
+    Header header;
+    memcpy(&header, _data.get(), sizeof(header));
+    return header.lineRendition;
+}
+
+bool FrozenRow::HasScrollbarData() const noexcept
+{
+    Header header;
+    memcpy(&header, _data.get(), sizeof(header));
+    return header.hasScrollbarData;
+}
+
+// Returns the same value as ROW::MeasureRight() would after thawing.
+// This allows TextBuffer to lay out frozen ROWs for a reflow without thawing them.
+til::CoordType FrozenRow::MeasureRight() const noexcept
+{
+    const auto data = _data.get();
+    Header header;
+    memcpy(&header, data, sizeof(header));
+
+    if (header.wrapForced)
+    {
+        return header.columnCount - header.doubleBytePadded;
+    }
+
+    const auto readableColumns = header.lineRendition == LineRendition::SingleWidth ?
+                                     header.columnCount - header.doubleBytePadded :
+                                     (header.columnCount - (header.doubleBytePadded << 1)) >> 1;
+
+    // The trimmed trailing whitespace consists of 1 wchar_t per column. See ROW::GetLastNonSpaceColumn().
+    const auto chars = reinterpret_cast<const wchar_t*>(data + _layout(header).chars);
+    const auto end = chars + header.charCount;
+    const auto it = findLastNonSpace(chars, end);
+    const auto trailingSpaces = (end - it) + (header.columnCount - header.trimmedColumns);
+    return gsl::narrow_cast<til::CoordType>(readableColumns - trailingSpaces);
+}
+
+// Returns true if the last column measured by MeasureRight() is a space. That's only
+// possible for wrapped rows, because MeasureRight() trims trailing whitespace otherwise.
+bool FrozenRow::EndsWithSpace() const noexcept
+{
+    Header header;
+    memcpy(&header, _data.get(), sizeof(header));
+    if (!header.wrapForced)
+    {
+        return false;
+    }
+    // Trailing whitespace past trimmedColumns isn't stored. See ROW::Freeze().
+    const auto end = header.columnCount - header.doubleBytePadded;
+    return end > 0 && header.trimmedColumns < end;
+}
+
+// Returns true if the given column is the trailing half of a wide glyph.
+bool FrozenRow::IsTrailer(til::CoordType column) const noexcept
+{
+    const auto data = _data.get();
+    Header header;
+    memcpy(&header, data, sizeof(header));
+
+    if (!header.hasCharOffsets || column < 0 || column >= header.trimmedColumns)
+    {
+        return false;
+    }
+
+    uint16_t offset;
+    memcpy(&offset, data + _layout(header).charOffsets + column * sizeof(uint16_t), sizeof(offset));
+    return WI_IsFlagSet(offset, ROW::CharOffsetsTrailer);
+}
+
+// Returns the column at which the last attribute run begins. Every column from there to the end has the same attributes.
+uint16_t FrozenRow::LastRunBegin() const noexcept
+{
+    const auto data = _data.get();
+    Header header;
+    memcpy(&header, data, sizeof(header));
+
+    const auto runs = reinterpret_cast<const rle_type*>(data + _layout(header).runs);
+    uint16_t begin = 0;
+    for (uint16_t i = 0; i + 1 < header.runCount; ++i)
+    {
+        begin += runs[i].length;
+    }
+    return begin;
+}
+
+// Returns the ROW::GetSearchSignature() of the frozen ROW. This allows
+// TextBuffer::SearchText() to skip frozen ROWs without thawing them.
+RowSearchSignature FrozenRow::GetSearchSignature() const noexcept
+{
+    Header header;
+    memcpy(&header, _data.get(), sizeof(header));
+    return header.searchSignature;
+}
+
+// Returns a copy of this FrozenRow whose attributes are interned in the palette `to` instead of `from`.
+// This lets TextBuffer copy frozen ROWs into another buffer without thawing them.
+FrozenRow FrozenRow::Clone(const TextAttributePalette& from, TextAttributePalette& to) const
+{
+    const auto data = _data.get();
+    Header header;
+    memcpy(&header, data, sizeof(header));
+    const auto layout = _layout(header);
+
+    FrozenRow clone;
+    clone._data = std::make_unique_for_overwrite<std::byte[]>(header.size);
+    memcpy(clone._data.get(), data, header.size);
+
+    const auto runs = reinterpret_cast<rle_type*>(clone._data.get() + layout.runs);
+    uint16_t interned = 0;
+    try
+    {
+        for (; interned < header.runCount; ++interned)
+        {
+            runs[interned].value = to.Intern(from.At(runs[interned].value));
+        }
+    }
+    catch (...)
+    {
+        for (uint16_t i = 0; i < interned; ++i)
+        {
+            to.Release(runs[i].value);
+        }
+        // The remaining runs still hold indices into `from`. They must not be released from `to`.
+        clone._data.reset();
+        throw;
+    }
+
+    return clone;
+}
+
+// Returns the palette references held by this FrozenRow and frees its memory.
+void FrozenRow::Release(TextAttributePalette& palette) noexcept
+{
+    if (!_data)
+    {
+        return;
+    }
+
+    const auto data = _data.get();
+    Header header;
+    memcpy(&header, data, sizeof(header));
+    const auto layout = _layout(header);
+
+    const auto runs = reinterpret_cast<const rle_type*>(data + layout.runs);
+    for (uint16_t i = 0; i < header.runCount; ++i)
+    {
+        palette.Release(runs[i].value);
+    }
+
+    _data.reset();
+}
+
+// Writes this FrozenRow in the format described in BufferSnapshot.hpp. Unlike the in-memory representation
+// it doesn't depend on struct layouts and so it can be read by any later version of this code.
+// The attribute indices it writes are those of the palette that was given to ROW::Freeze().
+void FrozenRow::Encode(SnapshotWriter& writer) const
+{
+    const auto data = _data.get();
+    Header header;
+    memcpy(&header, data, sizeof(header));
+    const auto layout = _layout(header);
+
+    uint8_t flags = 0;
+    flags |= header.wrapForced ? EncodedWrapForced : 0;
+    flags |= header.doubleBytePadded ? EncodedDoubleBytePadded : 0;
+    flags |= header.hasCharOffsets ? EncodedHasCharOffsets : 0;
+    flags |= header.hasScrollbarData ? EncodedHasScrollbarData : 0;
+
+    writer.Write(flags);
+    writer.Write(header.lineRendition);
+    writer.Write(header.trimmedColumns);
+    writer.Write(header.charCount);
+    writer.Write(header.runCount);
+
+    if (header.hasScrollbarData)
+    {
+        const auto& scrollbarData = *reinterpret_cast<const ScrollbarData*>(data + layout.scrollbarData);
+        writer.Write(scrollbarData.category);
+        writer.Write(scrollbarData.color.has_value());
+        writer.Write(scrollbarData.color.value_or(til::color{}).abgr);
+        writer.Write(scrollbarData.exitCode.has_value());
+        writer.Write(scrollbarData.exitCode.value_or(0));
+    }
+
+    writer.Write({ data + layout.runs, header.runCount * sizeof(rle_type) });
+    writer.Write({ data + layout.chars, header.charCount * sizeof(wchar_t) });
+    if (header.hasCharOffsets)
+    {
+        writer.Write({ data + layout.charOffsets, header.trimmedColumns * sizeof(uint16_t) });
+    }
+}
+
+// Reads a FrozenRow written by Encode() for a ROW that is `columnCount` wide. `attributes` maps the attribute
+// indices in the snapshot to those of the TextAttributePalette that will be passed to ROW::Thaw().
+// Since the data comes from disk, everything is validated to uphold the invariants that ROW relies on.
+// Returns an empty FrozenRow if the data is invalid.
+FrozenRow FrozenRow::Decode(SnapshotReader& reader, uint16_t columnCount, const std::span<const uint16_t>& attributes)
+{
+    const auto flags = reader.Read<uint8_t>();
+    const auto lineRendition = reader.Read<uint8_t>();
+
+    Header header{
+        .columnCount = columnCount,
+        .trimmedColumns = reader.Read<uint16_t>(),
+        .charCount = reader.Read<uint16_t>(),
+        .runCount = reader.Read<uint16_t>(),
+        .lineRendition = static_cast<LineRendition>(lineRendition),
+        .wrapForced = (flags & EncodedWrapForced) != 0,
+        .doubleBytePadded = (flags & EncodedDoubleBytePadded) != 0,
+        .hasCharOffsets = (flags & EncodedHasCharOffsets) != 0,
+        .hasScrollbarData = (flags & EncodedHasScrollbarData) != 0,
+    };
+
+    // The charOffsets of the trailing whitespace that Thaw() restores must fit into the 15 bits of CharOffsetsMask.
+    const size_t charSize = size_t{ header.charCount } + columnCount - header.trimmedColumns;
+    if (reader.Failed() ||
+        (flags & ~EncodedFlagsMask) != 0 ||
+        lineRendition > static_cast<uint8_t>(LineRendition::DoubleHeightBottom) ||
+        header.trimmedColumns > columnCount ||
+        header.runCount == 0 ||
+        charSize > ROW::CharOffsetsMask ||
+        (!header.hasCharOffsets && header.charCount != header.trimmedColumns))
+    {
+        return {};
+    }
+
+    ScrollbarData scrollbarData;
+    if (header.hasScrollbarData)
+    {
+        const auto category = reader.Read<uint8_t>();
+        const auto hasColor = reader.Read<uint8_t>();
+        const auto color = reader.Read<uint32_t>();
+        const auto hasExitCode = reader.Read<uint8_t>();
+        const auto exitCode = reader.Read<uint32_t>();
+
+        if (category > static_cast<uint8_t>(MarkCategory::Prompt) || hasColor > 1 || hasExitCode > 1)
+        {
+            return {};
+        }
+
+        scrollbarData.category = static_cast<MarkCategory>(category);
+        if (hasColor)
+        {
+            til::color c;
+            c.abgr = color;
+            scrollbarData.color = c;
+        }
+        if (hasExitCode)
+        {
+            scrollbarData.exitCode = exitCode;
+        }
+    }
+
+    const auto runBytes = reader.Read(header.runCount * sizeof(rle_type));
+    const auto charBytes = reader.Read(header.charCount * sizeof(wchar_t));
+    const auto charOffsetBytes = header.hasCharOffsets ? reader.Read(header.trimmedColumns * sizeof(uint16_t)) : std::span<const std::byte>{};
+    if (reader.Failed())
+    {
+        return {};
+    }
+
+    const auto layout = _layout(header);
+    header.size = gsl::narrow<uint32_t>(layout.size);
+
+    FrozenRow frozen;
+    frozen._data = std::make_unique_for_overwrite<std::byte[]>(layout.size);
+    const auto data = frozen._data.get();
+
+    if (header.hasScrollbarData)
+    {
+        std::construct_at(reinterpret_cast<ScrollbarData*>(data + layout.scrollbarData), scrollbarData);
+    }
+
+    // The runs must cover exactly columnCount columns and refer to existing attributes.
+    {
+        const auto runs = reinterpret_cast<rle_type*>(data + layout.runs);
+        memcpy(runs, runBytes.data(), runBytes.size());
+
+        size_t total = 0;
+        for (uint16_t i = 0; i < header.runCount; ++i)
+        {
+            auto& run = runs[i];
+            if (run.value >= attributes.size() || run.length == 0)
+            {
+                return {};
+            }
+            run.value = til::at(attributes, run.value);
+            total += run.length;
+        }
+        if (total != columnCount)
+        {
+            return {};
+        }
+    }
+
+    const auto chars = reinterpret_cast<wchar_t*>(data + layout.chars);
+    memcpy(chars, charBytes.data(), charBytes.size());
+
+    // Each column's offset must either start a new glyph past the previous one,
+    // or be a trailer that refers to the same glyph as the column before it.
+    if (header.hasCharOffsets)
+    {
+        const auto offsets = reinterpret_cast<uint16_t*>(data + layout.charOffsets);
+        memcpy(offsets, charOffsetBytes.data(), charOffsetBytes.size());
+
+        uint16_t prev = 0;
+        for (uint16_t col = 0; col < header.trimmedColumns; ++col)
+        {
+            const uint16_t off = offsets[col] & ROW::CharOffsetsMask;
+            const auto trailer = (offsets[col] & ROW::CharOffsetsTrailer) != 0;
+            const auto valid = col == 0 ? off == 0 && !trailer : trailer ? off == prev : off > prev;
+            if (!valid || off >= header.charCount)
+            {
+                return {};
+            }
+            prev = off;
+        }
+    }
+
+    // The signature covers the whole row including the trailing whitespace that Thaw() restores.
+    {
+        std::wstring text{ chars, header.charCount };
+        text.append(columnCount - header.trimmedColumns, L' ');
+        header.searchSignature = RowSearchSignature::FromText(text);
+    }
+
+    memcpy(data, &header, sizeof(header));
+    return frozen;
+}
+
+FrozenRow::Layout FrozenRow::_layout(const Header& header) noexcept
+{
+    static constexpr auto alignUp = [](size_t v, size_t a) { return (v + a - 1) & ~(a - 1); };
+
+    Layout layout{};
+    auto offset = sizeof(Header);
+
+    if (header.hasScrollbarData)
+    {
+        offset = alignUp(offset, alignof(ScrollbarData));
+        layout.scrollbarData = offset;
+        offset += sizeof(ScrollbarData);
+    }
+
+    offset = alignUp(offset, alignof(rle_type));
+    layout.runs = offset;
+    offset += header.runCount * sizeof(rle_type);
+
+    offset = alignUp(offset, alignof(wchar_t));
+    layout.chars = offset;
+    offset += header.charCount * sizeof(wchar_t);
+
+    layout.charOffsets = offset;
+    if (header.hasCharOffsets)
+    {
+        offset += header.trimmedColumns * sizeof(uint16_t);
+    }
+
+    layout.size = offset;
+    return layout;
+}
+
+// Creates a compact copy of this ROW for TextBuffer's cold scrollback tier. See FrozenRow.
+FrozenRow ROW::Freeze(TextAttributePalette& palette) const
+{
+    using rle_type = FrozenRow::rle_type;
+
+    // Find the column at which the trailing whitespace begins. We only trim whitespace that
+    // consists of narrow spaces which are exactly 1 wchar_t long, because that allows Thaw()
+    // to recreate them without having to store anything about them.
+    auto trimmedColumns = _columnCount;
+    for (; trimmedColumns > 0; --trimmedColumns)
+    {
+        const auto col = trimmedColumns - 1;
+        const auto off = _charOffsets[col];
+        if (WI_IsFlagSet(off, CharOffsetsTrailer) || _uncheckedChar(off) != L' ' || _uncheckedCharOffset(col + 1) != off + 1)
+        {
+            break;
+        }
+    }
+
+    const auto charCount = _uncheckedCharOffset(trimmedColumns);
+    // Trivial ROWs hold the identity mapping by definition. For all others we have to check.
+    auto hasCharOffsets = !_trivial && charCount != trimmedColumns;
+    for (uint16_t col = 0; !_trivial && !hasCharOffsets && col < trimmedColumns; ++col)
+    {
+        hasCharOffsets = _charOffsets[col] != col;
+    }
+
+    const auto& runs = _attr.runs();
+    FrozenRow::Header header{
+        .columnCount = _columnCount,
+        .trimmedColumns = trimmedColumns,
+        .charCount = charCount,
+        .runCount = gsl::narrow<uint16_t>(runs.size()),
+        .lineRendition = _lineRendition,
+        .wrapForced = _wrapForced,
+        .doubleBytePadded = _doubleBytePadded,
+        .hasCharOffsets = hasCharOffsets,
+        .hasScrollbarData = _promptData.has_value(),
+        .searchSignature = GetSearchSignature(),
+    };
+    const auto layout = FrozenRow::_layout(header);
+    header.size = gsl::narrow<uint32_t>(layout.size);
+
+    FrozenRow frozen;
+    frozen._data = std::make_unique_for_overwrite<std::byte[]>(layout.size);
+    const auto data = frozen._data.get();
+
+    memcpy(data, &header, sizeof(header));
+    if (_promptData)
+    {
+        std::construct_at(reinterpret_cast<ScrollbarData*>(data + layout.scrollbarData), *_promptData);
+    }
+
+    // Frozen ROWs usually share the palette of their TextBuffer, but SaveSnapshot() and others use one of their own.
+    const auto sharedPalette = &palette == _palette;
+    const auto frozenRuns = reinterpret_cast<rle_type*>(data + layout.runs);
+    uint16_t interned = 0;
+    try
+    {
+        for (; interned < header.runCount; ++interned)
+        {
+            const auto& run = til::at(runs, interned);
+            const auto index = sharedPalette ? palette.Intern(run.value) : palette.Intern(_palette->At(run.value));
+            std::construct_at(frozenRuns + interned, index, run.length);
+        }
+    }
+    catch (...)
+    {
+        for (uint16_t i = 0; i < interned; ++i)
+        {
+            palette.Release(frozenRuns[i].value);
+        }
+        throw;
+    }
+
+    memcpy(data + layout.chars, _chars.data(), charCount * sizeof(wchar_t));
+    if (hasCharOffsets)
+    {
+        memcpy(data + layout.charOffsets, _charOffsets.data(), trimmedColumns * sizeof(uint16_t));
+    }
+
+    return frozen;
+}
+
+// Restores the contents of a FrozenRow created by Freeze(). This ROW must be freshly constructed
+// (or Reset()) and be of the same width as the ROW that was frozen, which TextBuffer ensures.
+// This doesn't Release() the FrozenRow. That's up to the caller.
+void ROW::Thaw(const FrozenRow& frozen, const TextAttributePalette& palette)
+{
+    using rle_type = FrozenRow::rle_type;
+
+    const auto data = frozen._data.get();
+    FrozenRow::Header header;
+    memcpy(&header, data, sizeof(header));
+    const auto layout = FrozenRow::_layout(header);
+
+    assert(header.columnCount == _columnCount);
+
+    // Reset() filled _charsBuffer with whitespace, so the trailing
+    // whitespace is already in place, unless we need to go on the heap.
+    const size_t trailingSpaces = _columnCount - header.trimmedColumns;
+    const size_t charSize = header.charCount + trailingSpaces;
+    if (charSize > _chars.size())
+    {
+        auto charsHeap = std::make_unique_for_overwrite<wchar_t[]>(charSize);
+        const std::span chars{ charsHeap.get(), charSize };
+        std::fill_n(chars.begin() + header.charCount, trailingSpaces, L' ');
+        _charsHeap = std::move(charsHeap);
+        _chars = chars;
+    }
+    memcpy(_chars.data(), data + layout.chars, header.charCount * sizeof(wchar_t));
+
+    // Similarly, _charOffsets already contains the identity mapping, which is correct for
+    // all columns unless the row contained any wide glyphs, surrogate pairs, etc.
+    if (header.hasCharOffsets)
+    {
+        _trivial = false;
+        memcpy(_charOffsets.data(), data + layout.charOffsets, header.trimmedColumns * sizeof(uint16_t));
+        iota_n(_charOffsets.begin() + header.trimmedColumns, trailingSpaces + 1, header.charCount);
+    }
+
+    {
+        const auto sharedPalette = &palette == _palette;
+        const auto frozenRuns = reinterpret_cast<const rle_type*>(data + layout.runs);
+        decltype(_attr)::container runs;
+        runs.reserve(header.runCount);
+        for (uint16_t i = 0; i < header.runCount; ++i)
+        {
+            const auto& run = frozenRuns[i];
+            runs.emplace_back(sharedPalette ? run.value : _palette->Index(palette.At(run.value)), run.length);
+        }
+        _attr = decltype(_attr){ std::move(runs) };
+    }
+
+    if (header.hasScrollbarData)
+    {
+        _promptData = *reinterpret_cast<const ScrollbarData*>(data + layout.scrollbarData);
+    }
+
+    _lineRendition = header.lineRendition;
+    _wrapForced = header.wrapForced;
+    _doubleBytePadded = header.doubleBytePadded;
+    _searchSignature = header.searchSignature;
+    _searchSignatureValid = true;
 }
 
 // Returns the previous possible cursor position, preceding the given column.
@@ -449,7 +1286,7 @@ OutputCellIterator ROW::WriteCells(OutputCellIterator it, const til::CoordType c
             {
                 // Otherwise, commit this color into the run and save off the new one.
                 // Now commit the new color runs into the attr row.
-                _attr.replace(colorStarts, currentIndex, currentColor);
+                _attr.replace(colorStarts, currentIndex, _palette->Index(currentColor));
                 currentColor = it->TextAttr();
                 colorUses = 1;
                 colorStarts = currentIndex;
@@ -529,7 +1366,7 @@ OutputCellIterator ROW::WriteCells(OutputCellIterator it, const til::CoordType c
     // Now commit the final color into the attr row
     if (colorUses)
     {
-        _attr.replace(colorStarts, currentIndex, currentColor);
+        _attr.replace(colorStarts, currentIndex, _palette->Index(currentColor));
     }
 
     return it;
@@ -537,12 +1374,12 @@ OutputCellIterator ROW::WriteCells(OutputCellIterator it, const til::CoordType c
 
 void ROW::SetAttrToEnd(const til::CoordType columnBegin, const TextAttribute attr)
 {
-    _attr.replace(_clampedColumnInclusive(columnBegin), _attr.size(), attr);
+    _attr.replace(_clampedColumnInclusive(columnBegin), _attr.size(), _palette->Index(attr));
 }
 
 void ROW::ReplaceAttributes(const til::CoordType beginIndex, const til::CoordType endIndex, const TextAttribute& newAttr)
 {
-    _attr.replace(_clampedColumnInclusive(beginIndex), _clampedColumnInclusive(endIndex), newAttr);
+    _attr.replace(_clampedColumnInclusive(beginIndex), _clampedColumnInclusive(endIndex), _palette->Index(newAttr));
 }
 
 [[msvc::forceinline]] ROW::WriteHelper::WriteHelper(ROW& row, til::CoordType columnBegin, til::CoordType columnLimit, const std::wstring_view& chars) noexcept :
@@ -592,8 +1429,17 @@ catch (...)
     {
         colEndDirty = colLimit;
     }
+    else if (row._trivial && width == 1 && chars.size() == 1)
+    {
+        // A single narrow wchar_t keeps the identity mapping in _charOffsets intact. See ROW::_trivial.
+        colEnd++;
+        colEndDirty = colEnd;
+        charsConsumed = 1;
+    }
     else
     {
+        row._trivial = false;
+
         til::at(row._charOffsets, colEnd++) = chBeg;
         for (; colEnd < colEndNew; ++colEnd)
         {
@@ -616,7 +1462,7 @@ try
         state.columnEndDirty = h.colBeg;
         return;
     }
-    h.ReplaceText();
+    h.ReplaceText(state.ascii);
     h.Finish();
 
     state.text = state.text.substr(h.charsConsumed);
@@ -636,7 +1482,7 @@ catch (...)
     throw;
 }
 
-[[msvc::forceinline]] void ROW::WriteHelper::ReplaceText() noexcept
+[[msvc::forceinline]] void ROW::WriteHelper::ReplaceText(const bool ascii) noexcept
 {
     // This function starts with a fast-pass for ASCII. ASCII is still predominant in technical areas.
     //
@@ -646,9 +1492,33 @@ catch (...)
     const auto end = it + std::min<size_t>(chars.size(), colLimit - colBeg);
     size_t ch = chBeg;
 
+    if (row._trivial)
+    {
+        // In trivial ROWs chBeg == colBeg and _charOffsets already contains
+        // the identity mapping that the loop below would write. See ROW::_trivial.
+        // If the caller already knows that the text is ASCII, there's nothing left to check.
+        if (ascii)
+        {
+            it = end;
+        }
+        for (; it != end && *it < 0x80; ++it)
+        {
+        }
+
+        const auto count = gsl::narrow_cast<uint16_t>(it - chars.begin());
+        colEnd += count;
+        ch += count;
+
+        if (it != end) [[unlikely]]
+        {
+            _replaceTextUnicode(ch, it);
+            return;
+        }
+    }
+
     while (it != end)
     {
-        if (*it >= 0x80) [[unlikely]]
+        if (!ascii && *it >= 0x80) [[unlikely]]
         {
             _replaceTextUnicode(ch, it);
             return;
@@ -697,6 +1567,11 @@ catch (...)
             width = IsGlyphFullWidth({ ptr, advance }) + 1u;
         }
 
+        if (width != 1 || advance != 1)
+        {
+            row._trivial = false;
+        }
+
         const auto colEndNew = gsl::narrow_cast<uint16_t>(colEnd + width);
         if (colEndNew > colLimit)
         {
@@ -760,7 +1635,7 @@ try
         return;
     }
 
-    h.CopyTextFrom(charOffsets);
+    h.CopyTextFrom(charOffsets, source._trivial);
     h.Finish();
 
     // state.columnEnd is computed identical to ROW::ReplaceText. Check it out for more information.
@@ -775,7 +1650,101 @@ catch (...)
     throw;
 }
 
-[[msvc::forceinline]] void ROW::WriteHelper::CopyTextFrom(const std::span<const uint16_t>& charOffsets) noexcept
+// Copies the cells [sourceColumnBegin, sourceColumnLimit) of the given row to columnBegin, text, attributes and image alike.
+// Unlike writing the cells one by one, this copies the text and offsets with a single memcpy and
+// splices the attribute runs in one go, which makes it cheap even for very wide rows.
+// Wide glyphs that are cut in half by either end of the source range are replaced with whitespace.
+// The source must not be this row. Copy through the scratchpad row for that.
+void ROW::CopyCellsFrom(const ROW& source, const til::CoordType sourceColumnBegin, const til::CoordType sourceColumnLimit, const til::CoordType columnBegin)
+{
+    assert(this != &source);
+
+    const auto srcBeg = source._clampedColumnInclusive(sourceColumnBegin);
+    const auto srcLimit = source._clampedColumnInclusive(sourceColumnLimit);
+    const auto dstBeg = _clampedColumnInclusive(columnBegin);
+    if (srcBeg >= srcLimit || dstBeg >= _columnCount)
+    {
+        return;
+    }
+
+    const auto count = gsl::narrow_cast<uint16_t>(std::min(srcLimit - srcBeg, _columnCount - dstBeg));
+
+    // CopyTextFrom() refuses to start in the middle of a wide glyph,
+    // so the cut-off trailing half turns into a space instead.
+    uint16_t skip = 0;
+    if (source._uncheckedIsTrailer(srcBeg))
+    {
+        ClearCell(dstBeg);
+        skip = 1;
+    }
+
+    RowCopyTextFromState state{
+        .source = source,
+        .columnBegin = dstBeg + skip,
+        .columnLimit = dstBeg + count,
+        .sourceColumnBegin = srcBeg + skip,
+        .sourceColumnLimit = srcBeg + count,
+    };
+    CopyTextFrom(state);
+
+    CopyAttributesFrom(source, srcBeg, srcBeg + count, dstBeg);
+    CopyImageFrom(source, srcBeg, srcBeg + count, dstBeg);
+}
+
+// Copies the attributes of the columns [sourceColumnBegin, sourceColumnLimit) of the given row to columnBegin.
+// The source may belong to another TextBuffer, in which case the attributes get added to our palette.
+void ROW::CopyAttributesFrom(const ROW& source, const til::CoordType sourceColumnBegin, const til::CoordType sourceColumnLimit, const til::CoordType columnBegin)
+{
+    const auto srcBeg = source._clampedColumnInclusive(sourceColumnBegin);
+    const auto srcLimit = source._clampedColumnInclusive(sourceColumnLimit);
+    const auto dstBeg = _clampedColumnInclusive(columnBegin);
+    if (srcBeg >= srcLimit || dstBeg >= _columnCount)
+    {
+        return;
+    }
+
+    const auto count = gsl::narrow_cast<uint16_t>(std::min(srcLimit - srcBeg, _columnCount - dstBeg));
+    _attr.replace(dstBeg, gsl::narrow_cast<uint16_t>(dstBeg + count), _importAttributes(source, srcBeg, gsl::narrow_cast<uint16_t>(srcBeg + count)));
+}
+
+// Replaces the attributes from columnBegin to the end of this row with those of the given row from
+// sourceColumnBegin to its end. If they don't fill this row, the last one is extended to do so.
+// This is what CopyFrom() and TextBuffer's reflow do, which is why the source may belong to another TextBuffer.
+void ROW::CopyAttributesToEnd(const ROW& source, const til::CoordType sourceColumnBegin, const til::CoordType columnBegin)
+{
+    const auto srcBeg = source._clampedColumnInclusive(sourceColumnBegin);
+    const auto dstBeg = _clampedColumnInclusive(columnBegin);
+    _attr.replace(dstBeg, _attr.size(), _importAttributes(source, srcBeg, source._columnCount));
+    _attr.resize_trailing_extent(_columnCount);
+}
+
+// Returns the attribute runs of the given columns of `source`, translated into indices of our palette.
+til::small_rle<uint32_t, uint16_t, 1> ROW::_importAttributes(const ROW& source, const uint16_t columnBegin, const uint16_t columnEnd) const
+{
+    auto attr = source._attr.slice(columnBegin, columnEnd);
+    if (source._palette != _palette)
+    {
+        // The palette deduplicates attributes, so this can't turn two adjacent runs into identical ones.
+        for (auto& run : attr.runs())
+        {
+            run.value = _palette->Index(source._palette->At(run.value));
+        }
+    }
+    return attr;
+}
+
+// Sets the MarkKind of the attributes of all columns. See TextBuffer::ClearMarksInRange().
+void ROW::SetMarkAttributes(const MarkKind markKind)
+{
+    for (auto& run : _attr.runs())
+    {
+        auto attr = _palette->At(run.value);
+        attr.SetMarkAttributes(markKind);
+        run.value = _palette->Index(attr);
+    }
+}
+
+[[msvc::forceinline]] void ROW::WriteHelper::CopyTextFrom(const std::span<const uint16_t>& charOffsets, bool sourceTrivial) noexcept
 {
     // Since our `charOffsets` input is already in columns (just like the `ROW::_charOffsets`),
     // we can directly look up the end char-offset, but...
@@ -790,10 +1759,15 @@ catch (...)
     const auto baseOffset = til::at(charOffsets, 0);
     const auto endOffset = til::at(charOffsets, colEndInput);
     const auto inToOutOffset = gsl::narrow_cast<uint16_t>(chBeg - baseOffset);
-#pragma warning(suppress : 26481) // Don't use pointer arithmetic. Use span instead (bounds.1).
-    const auto dst = row._charOffsets.data() + colEnd;
 
-    _copyOffsets(dst, charOffsets.data(), colEndInput, inToOutOffset);
+    // Copying identity-mapped offsets into a trivial ROW results in an identity mapping. See ROW::_trivial.
+    if (!row._trivial || !sourceTrivial)
+    {
+        row._trivial = false;
+#pragma warning(suppress : 26481) // Don't use pointer arithmetic. Use span instead (bounds.1).
+        const auto dst = row._charOffsets.data() + colEnd;
+        _copyOffsets(dst, charOffsets.data(), colEndInput, inToOutOffset);
+    }
 
     colEnd += colEndInput;
     colEndDirty = gsl::narrow_cast<uint16_t>(colBeg + colEndDirtyInput);
@@ -822,6 +1796,8 @@ catch (...)
 
 [[msvc::forceinline]] void ROW::WriteHelper::Finish()
 {
+    row._searchSignatureValid = false;
+
     colEndDirty = row._adjustForward(colEndDirty);
 
     const uint16_t trailingSpaces = colEndDirty - colEnd;
@@ -902,19 +1878,34 @@ void ROW::_resizeChars(uint16_t colEndDirty, uint16_t chBegDirty, size_t chEndDi
     }
 }
 
-til::small_rle<TextAttribute, uint16_t, 1>& ROW::Attributes() noexcept
+// Returns the attribute runs of this row as indices into AttributePalette(). Iterating over these is cheaper than
+// Attributes(), because runs can be compared by their index and only need to be looked up when they change.
+// The indices are only valid for as long as the row isn't modified, because TextBuffer may free unused ones.
+const til::small_rle<uint32_t, uint16_t, 1>& ROW::AttributeIndices() const noexcept
 {
     return _attr;
 }
 
-const til::small_rle<TextAttribute, uint16_t, 1>& ROW::Attributes() const noexcept
+const TextAttributePalette& ROW::AttributePalette() const noexcept
 {
-    return _attr;
+    return *_palette;
+}
+
+// Returns a copy of the attribute runs of this row with the indices resolved.
+til::small_rle<TextAttribute, uint16_t, 1> ROW::Attributes() const
+{
+    til::small_rle<TextAttribute, uint16_t, 1>::container runs;
+    runs.reserve(_attr.runs().size());
+    for (const auto& run : _attr.runs())
+    {
+        runs.emplace_back(_palette->At(run.value), run.length);
+    }
+    return til::small_rle<TextAttribute, uint16_t, 1>{ std::move(runs) };
 }
 
 TextAttribute ROW::GetAttrByColumn(const til::CoordType column) const
 {
-    return _attr.at(_clampedColumn(column));
+    return _palette->At(_attr.at(_clampedColumn(column)));
 }
 
 std::vector<uint16_t> ROW::GetHyperlinks() const
@@ -922,9 +1913,10 @@ std::vector<uint16_t> ROW::GetHyperlinks() const
     std::vector<uint16_t> ids;
     for (const auto& run : _attr.runs())
     {
-        if (run.value.IsHyperlink())
+        const auto& attr = _palette->At(run.value);
+        if (attr.IsHyperlink())
         {
-            ids.emplace_back(run.value.GetHyperlinkId());
+            ids.emplace_back(attr.GetHyperlinkId());
         }
     }
     return ids;
@@ -940,18 +1932,9 @@ uint16_t ROW::size() const noexcept
 til::CoordType ROW::GetLastNonSpaceColumn() const noexcept
 {
     const auto text = GetText();
-    const auto beg = text.begin();
-    const auto end = text.end();
-    auto it = end;
-
-    for (; it != beg; --it)
-    {
-        // it[-1] is safe as `it` is always greater than `beg` (loop invariant).
-        if (til::at(it, -1) != L' ')
-        {
-            break;
-        }
-    }
+    const auto beg = text.data();
+    const auto end = beg + text.size();
+    const auto it = findLastNonSpace(beg, end);
 
     // We're supposed to return the measurement in cells and not characters
     // and therefore simply calculating `it - beg` would be wrong.
@@ -964,19 +1947,9 @@ til::CoordType ROW::GetLastNonSpaceColumn() const noexcept
 til::CoordType ROW::MeasureLeft() const noexcept
 {
     const auto text = GetText();
-    const auto beg = text.begin();
-    const auto end = text.end();
-    auto it = beg;
-
-    for (; it != end; ++it)
-    {
-        if (*it != L' ')
-        {
-            break;
-        }
-    }
-
-    return gsl::narrow_cast<til::CoordType>(it - beg);
+    const auto beg = text.data();
+    const auto end = beg + text.size();
+    return gsl::narrow_cast<til::CoordType>(findFirstNonSpace(beg, end) - beg);
 }
 
 // Routine Description:
@@ -999,25 +1972,20 @@ til::CoordType ROW::MeasureRight() const noexcept
 bool ROW::ContainsText() const noexcept
 {
     const auto text = GetText();
-    const auto beg = text.begin();
-    const auto end = text.end();
-    auto it = beg;
-
-    for (; it != end; ++it)
-    {
-        if (*it != L' ')
-        {
-            return true;
-        }
-    }
-
-    return false;
+    const auto beg = text.data();
+    const auto end = beg + text.size();
+    return findFirstNonSpace(beg, end) != end;
 }
 
 std::wstring_view ROW::GlyphAt(til::CoordType column) const noexcept
 {
     auto col = _clampedColumn(column);
 
+    if (_trivial)
+    {
+        return { _chars.begin() + col, _chars.begin() + col + 1 };
+    }
+
     // Safety: col is [0, _columnCount).
     const auto beg = _uncheckedCharOffset(col);
     // Safety: col cannot be incremented past _columnCount, because the last
@@ -1052,7 +2020,7 @@ DbcsAttribute ROW::DbcsAttrAt(til::CoordType column) const noexcept
 
 std::wstring_view ROW::GetText() const noexcept
 {
-    const auto width = size_t{ til::at(_charOffsets, GetReadableColumnCount()) } & CharOffsetsMask;
+    const size_t width = _uncheckedCharOffset(gsl::narrow_cast<size_t>(GetReadableColumnCount()));
     return { _chars.data(), width };
 }
 
@@ -1069,11 +2037,19 @@ std::wstring_view ROW::GetText(til::CoordType columnBegin, til::CoordType column
 
 til::CoordType ROW::GetLeadingColumnAtCharOffset(const ptrdiff_t offset) const noexcept
 {
+    if (_trivial)
+    {
+        return gsl::narrow_cast<til::CoordType>(clamp(offset, 0, _columnCount - 1));
+    }
     return _createCharToColumnMapper(offset).GetLeadingColumnAt(offset);
 }
 
 til::CoordType ROW::GetTrailingColumnAtCharOffset(const ptrdiff_t offset) const noexcept
 {
+    if (_trivial)
+    {
+        return gsl::narrow_cast<til::CoordType>(clamp(offset, 0, _columnCount - 1));
+    }
     return _createCharToColumnMapper(offset).GetTrailingColumnAt(offset);
 }
 
@@ -1111,6 +2087,10 @@ constexpr uint16_t ROW::_clampedColumnInclusive(T v) const noexcept
 
 uint16_t ROW::_charSize() const noexcept
 {
+    if (_trivial)
+    {
+        return _columnCount;
+    }
     // Safety: _charOffsets is an array of `_columnCount + 1` entries.
     return _charOffsets[_columnCount];
 }
@@ -1127,6 +2107,10 @@ template<typename T>
 uint16_t ROW::_uncheckedCharOffset(T col) const noexcept
 {
     assert(col < _charOffsets.size());
+    if (_trivial)
+    {
+        return gsl::narrow_cast<uint16_t>(col);
+    }
     return _charOffsets[col] & CharOffsetsMask;
 }
 
@@ -1135,7 +2119,7 @@ template<typename T>
 bool ROW::_uncheckedIsTrailer(T col) const noexcept
 {
     assert(col < _charOffsets.size());
-    return WI_IsFlagSet(_charOffsets[col], CharOffsetsTrailer);
+    return !_trivial && WI_IsFlagSet(_charOffsets[col], CharOffsetsTrailer);
 }
 
 template<typename T>
@@ -1213,3 +2197,64 @@ void ROW::EndOutput(std::optional<unsigned int> error) noexcept
         }
     }
 }
+
+const ImageSlice* ROW::GetImageSlice() const noexcept
+{
+    return _imageSlice.get();
+}
+
+// Returns the row's image slice, creating it if it doesn't exist yet.
+// An existing slice with a different cell size is replaced.
+ImageSlice& ROW::GetMutableImageSlice(const til::size cellSize)
+{
+    if (!_imageSlice || _imageSlice->CellSize() != cellSize)
+    {
+        _imageSlice = std::make_unique<ImageSlice>(cellSize);
+    }
+    return *_imageSlice;
+}
+
+// Erases the part of the image that covers the given columns.
+void ROW::EraseImage(const til::CoordType columnBegin, const til::CoordType columnEnd) noexcept
+{
+    if (_imageSlice && _imageSlice->EraseColumns(columnBegin, columnEnd))
+    {
+        _imageSlice.reset();
+    }
+}
+
+// Replaces the image in the columns starting at columnBegin with the image that covers the
+// columns [sourceColumnBegin, sourceColumnLimit) of the source row, so that images move along
+// with the cells they cover. Columns not covered by the source's image end up without one.
+// Like GetMutableImageSlice(), this replaces an existing slice with a different cell size.
+void ROW::CopyImageFrom(const ROW& source, const til::CoordType sourceColumnBegin, const til::CoordType sourceColumnLimit, const til::CoordType columnBegin)
+{
+    assert(this != &source);
+
+    const auto shift = columnBegin - sourceColumnBegin;
+    EraseImage(columnBegin, sourceColumnLimit + shift);
+
+    const auto sourceSlice = source.GetImageSlice();
+    if (!sourceSlice)
+    {
+        return;
+    }
+
+    const auto begin = std::max(sourceColumnBegin, sourceSlice->ColumnBegin());
+    const auto end = std::min({ sourceColumnLimit, sourceSlice->ColumnEnd(), _columnCount - shift });
+    if (begin >= end)
+    {
+        return;
+    }
+
+    const auto cellSize = sourceSlice->CellSize();
+    const auto offset = gsl::narrow_cast<size_t>((begin - sourceSlice->ColumnBegin()) * cellSize.width);
+    const auto width = gsl::narrow_cast<size_t>((end - begin) * cellSize.width);
+    auto& slice = GetMutableImageSlice(cellSize);
+
+    for (til::CoordType y = 0; y < cellSize.height; ++y)
+    {
+        const auto src = sourceSlice->PixelLine(y).subspan(offset, width);
+        std::copy(src.begin(), src.end(), slice.MutablePixelLine(y, begin + shift, end + shift).begin());
+    }
+}
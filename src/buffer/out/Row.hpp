@@ -9,9 +9,13 @@
 #include "OutputCell.hpp"
 #include "OutputCellIterator.hpp"
 #include "Marks.hpp"
+#include "ImageSlice.hpp"
+#include "TextAttributePalette.hpp"
 
 class ROW;
 class TextBuffer;
+class SnapshotReader;
+class SnapshotWriter;
 
 enum class DelimiterClass
 {
@@ -29,6 +33,8 @@ struct RowWriteState
     til::CoordType columnBegin = 0; // IN
     // The first column which should not be written to anymore.
     til::CoordType columnLimit = til::CoordTypeMax; // IN
+    // Set this if `text` is known to consist of printable ASCII characters only, which skips checking for it.
+    bool ascii = false; // IN
 
     // The column 1 past the last glyph that was successfully written into the row. If you need to call
     // ReplaceAttributes() to colorize the written range, etc., this is the columnEnd parameter you want.
@@ -88,6 +94,183 @@ private:
     til::CoordType _currentColumn;
 };
 
+// A bloom filter over the bigrams (pairs of adjacent characters) of a ROW's text. TextBuffer::SearchText() uses it
+// to skip rows that can't possibly contain a literal needle, without having to run a regex over them.
+//
+// Only bigrams consisting of 2 ASCII characters are recorded and they're case-folded, because ICU's case-insensitive
+// matching considers some non-ASCII characters equal to ASCII ones (e.g. U+212A KELVIN SIGN and "k").
+// That's also why MayContain() always returns true for case-insensitive searches if the text contains non-ASCII.
+struct RowSearchSignature
+{
+    static RowSearchSignature FromText(const std::wstring_view& text) noexcept;
+
+    void Add(wchar_t a, wchar_t b) noexcept;
+    void Append(const RowSearchSignature& other) noexcept;
+    bool Empty() const noexcept;
+    bool MayContain(const RowSearchSignature& needle, bool caseInsensitive) const noexcept;
+
+    std::array<uint64_t, 4> bigrams{};
+    // The first and last character of the text. Append() uses them to add the bigram
+    // that spans across two ROWs, which is needed for text that wraps across lines.
+    wchar_t first = 0;
+    wchar_t last = 0;
+    bool nonAscii = false;
+};
+
+// Iterates over the TextAttribute of each column of a ROW. ROWs store their attributes as
+// indices into a TextAttributePalette, which this looks up as it goes. See ROW::AttrBegin().
+class RowAttributeIterator
+{
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = TextAttribute;
+    using pointer = const TextAttribute*;
+    using reference = const TextAttribute&;
+    using difference_type = ptrdiff_t;
+    using index_iterator = til::small_rle<uint32_t, uint16_t, 1>::const_iterator;
+
+    RowAttributeIterator() = default;
+    RowAttributeIterator(index_iterator it, const TextAttributePalette* palette) noexcept :
+        _it{ it },
+        _palette{ palette }
+    {
+    }
+
+    [[nodiscard]] reference operator*() const noexcept
+    {
+        return _palette->At(*_it);
+    }
+
+    [[nodiscard]] pointer operator->() const noexcept
+    {
+        return &operator*();
+    }
+
+    RowAttributeIterator& operator++() noexcept
+    {
+        ++_it;
+        return *this;
+    }
+
+    RowAttributeIterator operator++(int) noexcept
+    {
+        auto tmp = *this;
+        ++*this;
+        return tmp;
+    }
+
+    RowAttributeIterator& operator+=(const difference_type move) noexcept
+    {
+        _it += move;
+        return *this;
+    }
+
+    [[nodiscard]] RowAttributeIterator operator+(const difference_type move) const noexcept
+    {
+        auto tmp = *this;
+        tmp += move;
+        return tmp;
+    }
+
+    [[nodiscard]] bool operator==(const RowAttributeIterator& right) const noexcept
+    {
+        return _it == right._it;
+    }
+
+    [[nodiscard]] bool operator!=(const RowAttributeIterator& right) const noexcept
+    {
+        return _it != right._it;
+    }
+
+private:
+    index_iterator _it;
+    const TextAttributePalette* _palette = nullptr;
+};
+
+// FrozenRow is the compact representation of a ROW used by TextBuffer's cold scrollback tier.
+// It's created with ROW::Freeze() and turned back into a regular ROW with ROW::Thaw().
+// Attributes are stored as indices into the TextBuffer's TextAttributePalette,
+// which is why a FrozenRow must be Release()d before it's destroyed.
+//
+// All of its data is stored in a single heap allocation, laid out like this:
+//   Header
+//   ScrollbarData                                    <-- only if Header::hasScrollbarData
+//   til::rle_pair<uint16_t, uint16_t>[runCount]      <-- palette index and run length
+//   wchar_t[charCount]
+//   uint16_t[trimmedColumns]                         <-- only if Header::hasCharOffsets
+//
+// Trailing whitespace (as far as it's made up of simple 1 column, 1 wchar_t spaces) isn't stored.
+// Similarly, if every column up to Header::trimmedColumns maps to exactly one wchar_t, ROW::_charOffsets
+// is an identity mapping and it isn't stored either. This is true for most rows (= ASCII text).
+class FrozenRow
+{
+public:
+    FrozenRow() = default;
+
+    FrozenRow(const FrozenRow& other) = delete;
+    FrozenRow& operator=(const FrozenRow& other) = delete;
+
+    FrozenRow(FrozenRow&& other) = default;
+    FrozenRow& operator=(FrozenRow&& other) = default;
+
+    explicit operator bool() const noexcept;
+    size_t MemoryUsage() const noexcept;
+    uint16_t ColumnCount() const noexcept;
+    bool WasWrapForced() const noexcept;
+    LineRendition GetLineRendition() const noexcept;
+    bool HasScrollbarData() const noexcept;
+    til::CoordType MeasureRight() const noexcept;
+    bool EndsWithSpace() const noexcept;
+    bool IsTrailer(til::CoordType column) const noexcept;
+    uint16_t LastRunBegin() const noexcept;
+    RowSearchSignature GetSearchSignature() const noexcept;
+    FrozenRow Clone(const TextAttributePalette& from, TextAttributePalette& to) const;
+    void Release(TextAttributePalette& palette) noexcept;
+
+    void Encode(SnapshotWriter& writer) const;
+    static FrozenRow Decode(SnapshotReader& reader, uint16_t columnCount, const std::span<const uint16_t>& attributes);
+
+private:
+    friend class ROW;
+
+    using rle_type = til::rle_pair<uint16_t, uint16_t>;
+
+    // The bits of the flags byte written by Encode().
+    static constexpr uint8_t EncodedWrapForced = 0x01;
+    static constexpr uint8_t EncodedDoubleBytePadded = 0x02;
+    static constexpr uint8_t EncodedHasCharOffsets = 0x04;
+    static constexpr uint8_t EncodedHasScrollbarData = 0x08;
+    static constexpr uint8_t EncodedFlagsMask = 0x0f;
+
+    struct Header
+    {
+        uint32_t size;
+        uint16_t columnCount;
+        uint16_t trimmedColumns;
+        uint16_t charCount;
+        uint16_t runCount;
+        LineRendition lineRendition;
+        bool wrapForced;
+        bool doubleBytePadded;
+        bool hasCharOffsets;
+        bool hasScrollbarData;
+        RowSearchSignature searchSignature;
+    };
+
+    struct Layout
+    {
+        size_t scrollbarData;
+        size_t runs;
+        size_t chars;
+        size_t charOffsets;
+        size_t size;
+    };
+
+    static Layout _layout(const Header& header) noexcept;
+
+    std::unique_ptr<std::byte[]> _data;
+};
+
 class ROW final
 {
 public:
@@ -115,7 +298,7 @@ public:
     }
 
     ROW() = default;
-    ROW(wchar_t* charsBuffer, uint16_t* charOffsetsBuffer, uint16_t rowWidth, const TextAttribute& fillAttribute);
+    ROW(wchar_t* charsBuffer, uint16_t* charOffsetsBuffer, uint16_t rowWidth, TextAttributePalette& palette, const TextAttribute& fillAttribute);
 
     ROW(const ROW& other) = delete;
     ROW& operator=(const ROW& other) = delete;
@@ -130,9 +313,17 @@ public:
     void SetLineRendition(const LineRendition lineRendition) noexcept;
     LineRendition GetLineRendition() const noexcept;
     til::CoordType GetReadableColumnCount() const noexcept;
-
-    void Reset(const TextAttribute& attr) noexcept;
+    const RowSearchSignature& GetSearchSignature() const noexcept;
+    uint64_t GetMutationId() const noexcept;
+    void SetMutationId(uint64_t mutationId) noexcept;
+    void InvalidateColumns(til::CoordType columnBegin, til::CoordType columnEnd) noexcept;
+    void ResetInvalidatedColumns() noexcept;
+    std::pair<til::CoordType, til::CoordType> GetInvalidatedColumns() const noexcept;
+
+    void Reset(const TextAttribute& attr);
     void CopyFrom(const ROW& source);
+    FrozenRow Freeze(TextAttributePalette& palette) const;
+    void Thaw(const FrozenRow& frozen, const TextAttributePalette& palette);
 
     til::CoordType NavigateToPrevious(til::CoordType column) const noexcept;
     til::CoordType NavigateToNext(til::CoordType column) const noexcept;
@@ -146,9 +337,14 @@ public:
     void ReplaceCharacters(til::CoordType columnBegin, til::CoordType width, const std::wstring_view& chars);
     void ReplaceText(RowWriteState& state);
     void CopyTextFrom(RowCopyTextFromState& state);
-
-    til::small_rle<TextAttribute, uint16_t, 1>& Attributes() noexcept;
-    const til::small_rle<TextAttribute, uint16_t, 1>& Attributes() const noexcept;
+    void CopyCellsFrom(const ROW& source, til::CoordType sourceColumnBegin, til::CoordType sourceColumnLimit, til::CoordType columnBegin);
+    void CopyAttributesFrom(const ROW& source, til::CoordType sourceColumnBegin, til::CoordType sourceColumnLimit, til::CoordType columnBegin);
+    void CopyAttributesToEnd(const ROW& source, til::CoordType sourceColumnBegin, til::CoordType columnBegin);
+    void SetMarkAttributes(MarkKind markKind);
+
+    const til::small_rle<uint32_t, uint16_t, 1>& AttributeIndices() const noexcept;
+    const TextAttributePalette& AttributePalette() const noexcept;
+    til::small_rle<TextAttribute, uint16_t, 1> Attributes() const;
     TextAttribute GetAttrByColumn(til::CoordType column) const;
     std::vector<uint16_t> GetHyperlinks() const;
     uint16_t size() const noexcept;
@@ -164,20 +360,27 @@ public:
     til::CoordType GetTrailingColumnAtCharOffset(ptrdiff_t offset) const noexcept;
     DelimiterClass DelimiterClassAt(til::CoordType column, const std::wstring_view& wordDelimiters) const noexcept;
 
-    auto AttrBegin() const noexcept { return _attr.begin(); }
-    auto AttrEnd() const noexcept { return _attr.end(); }
+    RowAttributeIterator AttrBegin() const noexcept { return { _attr.begin(), _palette }; }
+    RowAttributeIterator AttrEnd() const noexcept { return { _attr.end(), _palette }; }
 
     const std::optional<ScrollbarData>& GetScrollbarData() const noexcept;
     void SetScrollbarData(std::optional<ScrollbarData> data) noexcept;
     void StartPrompt() noexcept;
     void EndOutput(std::optional<unsigned int> error) noexcept;
 
+    const ImageSlice* GetImageSlice() const noexcept;
+    ImageSlice& GetMutableImageSlice(til::size cellSize);
+    void EraseImage(til::CoordType columnBegin, til::CoordType columnEnd) noexcept;
+    void CopyImageFrom(const ROW& source, til::CoordType sourceColumnBegin, til::CoordType sourceColumnLimit, til::CoordType columnBegin);
+
 #ifdef UNIT_TESTING
     friend constexpr bool operator==(const ROW& a, const ROW& b) noexcept;
     friend class RowTests;
 #endif
 
 private:
+    friend class FrozenRow;
+
     // WriteHelper exists because other forms of abstracting this functionality away (like templates with lambdas)
     // where only very poorly optimized by MSVC as it failed to inline the templates.
     struct WriteHelper
@@ -185,9 +388,9 @@ private:
         explicit WriteHelper(ROW& row, til::CoordType columnBegin, til::CoordType columnLimit, const std::wstring_view& chars) noexcept;
         bool IsValid() const noexcept;
         void ReplaceCharacters(til::CoordType width) noexcept;
-        void ReplaceText() noexcept;
+        void ReplaceText(bool ascii) noexcept;
         void _replaceTextUnicode(size_t ch, std::wstring_view::const_iterator it) noexcept;
-        void CopyTextFrom(const std::span<const uint16_t>& charOffsets) noexcept;
+        void CopyTextFrom(const std::span<const uint16_t>& charOffsets, bool sourceTrivial) noexcept;
         static void _copyOffsets(uint16_t* dst, const uint16_t* src, uint16_t size, uint16_t offset) noexcept;
         void Finish();
 
@@ -248,6 +451,7 @@ private:
     T _adjustForward(T column) const noexcept;
 
     void _init() noexcept;
+    til::small_rle<uint32_t, uint16_t, 1> _importAttributes(const ROW& source, uint16_t columnBegin, uint16_t columnEnd) const;
     void _resizeChars(uint16_t colEndDirty, uint16_t chBegDirty, size_t chEndDirty, uint16_t chEndDirtyOld);
     CharToColumnMapper _createCharToColumnMapper(ptrdiff_t offset) const noexcept;
 
@@ -291,19 +495,42 @@ private:
     // In other words, _charOffsets tells us both the width in chars and width in columns.
     // See CharOffsetsTrailer for more information.
     std::span<uint16_t> _charOffsets;
-    // _attr is a run-length-encoded vector of TextAttribute with a decompressed
-    // length equal to _columnCount (= 1 TextAttribute per column).
-    til::small_rle<TextAttribute, uint16_t, 1> _attr;
+    // _attr is a run-length-encoded vector of indices into _palette with a decompressed
+    // length equal to _columnCount (= 1 TextAttribute per column). Since the palette
+    // deduplicates its attributes, runs can be compared and merged by their index alone.
+    til::small_rle<uint32_t, uint16_t, 1> _attr;
+    // The palette of the TextBuffer this ROW belongs to. Copying attributes between ROWs
+    // of different TextBuffers has to translate the indices. See _importAttributes().
+    TextAttributePalette* _palette = nullptr;
     // The width of the row in visual columns.
     uint16_t _columnCount = 0;
+    // The range of columns [_invalidBegin,_invalidEnd) that got written to since the TextBuffer's last mutation
+    // snapshot and still need to be redrawn. See TextBuffer::GetMutableRowByOffset() and TextBuffer::TakeMutationSnapshot().
+    uint16_t _invalidBegin = 0;
+    uint16_t _invalidEnd = 0;
     // Stores double-width/height (DECSWL/DECDWL/DECDHL) attributes.
     LineRendition _lineRendition = LineRendition::SingleWidth;
     // Occurs when the user runs out of text in a given row and we're forced to wrap the cursor to the next line
     bool _wrapForced = false;
     // Occurs when the user runs out of text to support a double byte character and we're forced to the next line
     bool _doubleBytePadded = false;
+    // A ROW is "trivial" as long as every column holds exactly 1 narrow wchar_t, which is the overwhelmingly
+    // common case. While this is true, _charOffsets holds the identity mapping 0..._columnCount and _chars refers
+    // to _charsBuffer. This allows us to skip reading and writing _charOffsets entirely, because column == offset.
+    // It's reset to false the moment anything else gets written (wide glyphs, surrogate pairs, etc.). Since the
+    // identity mapping is still in place at that point, there's nothing to materialize. Only _init() sets it to true.
+    bool _trivial = false;
+    // A cache for GetSearchSignature(). It's computed on demand and invalidated whenever the text changes.
+    mutable bool _searchSignatureValid = false;
+    mutable RowSearchSignature _searchSignature;
+
+    // The TextBuffer's mutation id at the time this ROW was last handed out for modification.
+    // It belongs to the slot in the TextBuffer and not to the contents, so Reset() and CopyFrom() don't touch it.
+    uint64_t _mutationId = 0;
 
     std::optional<ScrollbarData> _promptData = std::nullopt;
+    // The part of an image that covers this row, if any. See ImageSlice.
+    ImageSlice::Pointer _imageSlice;
 };
 
 #ifdef UNIT_TESTING
@@ -0,0 +1,156 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "TextAttributePalette.hpp"
+
+#include <til/hash.h>
+
+size_t TextAttributePalette::AttributeHash::operator()(const TextAttribute& attr) const noexcept
+{
+    return til::hash(attr);
+}
+
+// Returns the index for the given attribute, adding it if it's not in the palette yet. This doesn't count
+// as a reference: The entry stays until a Sweep() finds it neither Mark()ed nor Intern()ed.
+// Finding an existing attribute doesn't modify the palette, which makes concurrent calls safe,
+// as long as all of them find their attribute. TextBuffer::_reflowParallel() relies on that.
+uint32_t TextAttributePalette::Index(const TextAttribute& attr)
+{
+    if (const auto it = _lookup.find(attr); it != _lookup.end())
+    {
+        return it->second;
+    }
+
+    uint32_t index;
+    if (!_freeList.empty())
+    {
+        index = _freeList.back();
+        _lookup.emplace(attr, index);
+        _freeList.pop_back();
+    }
+    else
+    {
+        index = gsl::narrow<uint32_t>(_entries.size());
+        _entries.emplace_back();
+        try
+        {
+            _lookup.emplace(attr, index);
+        }
+        catch (...)
+        {
+            _entries.pop_back();
+            throw;
+        }
+    }
+
+    auto& entry = til::at(_entries, index);
+    entry.attr = attr;
+    entry.refCount = 0;
+    entry.marked = false;
+    return index;
+}
+
+// Returns the index for the given attribute and increments its reference count.
+// Every call must be balanced by a call to Release().
+uint16_t TextAttributePalette::Intern(const TextAttribute& attr)
+{
+    return Intern(Index(attr));
+}
+
+// Same as Intern(At(index)), but without the lookup.
+uint16_t TextAttributePalette::Intern(const uint32_t index)
+{
+    THROW_HR_IF(E_OUTOFMEMORY, index >= MaxEntries);
+    til::at(_entries, index).refCount++;
+    return gsl::narrow_cast<uint16_t>(index);
+}
+
+// Decrements the reference count of the given index. Once it drops to 0,
+// the next Sweep() frees the entry, unless it finds it Mark()ed.
+void TextAttributePalette::Release(uint16_t index) noexcept
+{
+    auto& entry = til::at(_entries, index);
+    assert(entry.refCount != 0);
+    entry.refCount--;
+}
+
+const TextAttribute& TextAttributePalette::At(uint32_t index) const noexcept
+{
+    return til::at(_entries, index).attr;
+}
+
+// Adds all attributes of `other` to this palette, the same way Index() does.
+void TextAttributePalette::Merge(const TextAttributePalette& other)
+{
+    for (const auto& [attr, index] : other._lookup)
+    {
+        Index(attr);
+    }
+}
+
+// Marks the given index as being in use until the next Sweep().
+void TextAttributePalette::Mark(uint32_t index) noexcept
+{
+    til::at(_entries, index).marked = true;
+}
+
+// Frees all entries that are neither referenced nor marked and clears the marks.
+void TextAttributePalette::Sweep() noexcept
+{
+    // _freeList can never grow larger than _entries, so reserving its capacity upfront makes the
+    // push_back() below non-throwing. If that fails, we can still clear the marks and try again next time.
+    auto canFree = true;
+    try
+    {
+        _freeList.reserve(_entries.size());
+    }
+    catch (...)
+    {
+        LOG_CAUGHT_EXCEPTION();
+        canFree = false;
+    }
+
+    for (auto it = _lookup.begin(); it != _lookup.end();)
+    {
+        auto& entry = til::at(_entries, it->second);
+        if (canFree && !entry.marked && entry.refCount == 0)
+        {
+            _freeList.push_back(it->second);
+            it = _lookup.erase(it);
+        }
+        else
+        {
+            entry.marked = false;
+            ++it;
+        }
+    }
+
+    // Index() takes free slots from the back. Handing out the lowest ones first
+    // keeps the indices of the ROWs small enough to be frozen. See Intern().
+    std::sort(_freeList.begin(), _freeList.end(), std::greater<>{});
+}
+
+// Returns the number of distinct attributes currently in use.
+size_t TextAttributePalette::Size() const noexcept
+{
+    return _lookup.size();
+}
+
+// Returns the number of bytes the palette holds on the heap. For _lookup this assumes
+// the layout of MSVC's unordered_map: a vector of 2 iterators per bucket and a doubly
+// linked list node per entry. Allocator overhead isn't counted.
+size_t TextAttributePalette::MemoryUsage() const noexcept
+{
+    return _entries.capacity() * sizeof(Entry) +
+           _freeList.capacity() * sizeof(uint32_t) +
+           _lookup.bucket_count() * 2 * sizeof(void*) +
+           _lookup.size() * (2 * sizeof(void*) + sizeof(decltype(_lookup)::value_type));
+}
+
+void TextAttributePalette::Clear() noexcept
+{
+    _entries.clear();
+    _freeList.clear();
+    _lookup.clear();
+}
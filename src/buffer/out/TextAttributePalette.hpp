@@ -0,0 +1,56 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "TextAttribute.hpp"
+
+// TextAttributePalette interns TextAttributes, handing out small indices in return.
+// Each TextBuffer has one and all of its ROWs store their attribute runs as indices into it:
+// 8 byte (index, length) pairs instead of 20 byte (TextAttribute, length) pairs. Frozen ROWs in the
+// cold scrollback tier go further and store 4 byte pairs, which is why Intern() hands out 16 bit indices.
+//
+// There are two kinds of references:
+// * Index() doesn't count anything. TextBuffer finds the indices that are in use by
+//   Mark()ing those of all of its ROWs and then calls Sweep() to free all others.
+// * Intern() increments the reference count of the returned index and each Release() decrements it.
+//   FrozenRows use these, because TextBuffer can't mark them without decoding them.
+// Either way the table stays bounded by the number of distinct attributes that are
+// in use, instead of the number that were ever used.
+class TextAttributePalette
+{
+public:
+    // Intern() returns 16 bit indices. If the attribute's index is not below this, Intern() throws.
+    static constexpr size_t MaxEntries = 0xffff;
+
+    uint32_t Index(const TextAttribute& attr);
+    uint16_t Intern(const TextAttribute& attr);
+    uint16_t Intern(uint32_t index);
+    void Release(uint16_t index) noexcept;
+    const TextAttribute& At(uint32_t index) const noexcept;
+    void Merge(const TextAttributePalette& other);
+
+    void Mark(uint32_t index) noexcept;
+    void Sweep() noexcept;
+
+    size_t Size() const noexcept;
+    size_t MemoryUsage() const noexcept;
+    void Clear() noexcept;
+
+private:
+    struct AttributeHash
+    {
+        size_t operator()(const TextAttribute& attr) const noexcept;
+    };
+
+    struct Entry
+    {
+        TextAttribute attr;
+        uint32_t refCount = 0;
+        bool marked = false;
+    };
+
+    std::vector<Entry> _entries;
+    std::vector<uint32_t> _freeList;
+    std::unordered_map<TextAttribute, uint32_t, AttributeHash> _lookup;
+};
@@ -5,9 +5,12 @@
 
 #include "textBuffer.hpp"
 
+#include <isa_availability.h>
 #include <til/hash.h>
 #include <til/unicode.h>
 
+#include "BufferSnapshot.hpp"
+#include "TextAttributePalette.hpp"
 #include "UTextAdapter.h"
 #include "../../types/inc/GlyphWidth.hpp"
 #include "../renderer/base/renderer.hpp"
@@ -19,6 +22,8 @@ using namespace Microsoft::Console::Types;
 
 using PointTree = interval_tree::IntervalTree<til::point, size_t>;
 
+extern "C" int __isa_available;
+
 constexpr bool allWhitespace(const std::wstring_view& text) noexcept
 {
     for (const auto ch : text)
@@ -31,6 +36,126 @@ constexpr bool allWhitespace(const std::wstring_view& text) noexcept
     return true;
 }
 
+// Same as RowSearchSignature's ASCII case folding: A-Z --> a-z
+constexpr wchar_t foldAscii(wchar_t ch) noexcept
+{
+    return static_cast<wchar_t>(ch - L'A' < 26u ? ch | 0x20 : ch);
+}
+
+#pragma warning(push)
+#pragma warning(disable : 26429) // Symbol '...' is never tested for nullness, it can be marked as not_null (f.23).
+#pragma warning(disable : 26481) // Don't use pointer arithmetic. Use span instead (bounds.1).
+#pragma warning(disable : 26490) // Don't use reinterpret_cast (type.1).
+
+// Returns a pointer to the first character in [beg,end) that equals either `a` or `b`, or `end` if there's none.
+// This is the "memchr" of our literal search and so it compares 8 or 16 characters at once where possible.
+static const wchar_t* findEither(const wchar_t* beg, const wchar_t* end, wchar_t a, wchar_t b) noexcept
+{
+#if defined(TIL_SSE_INTRINSICS)
+    unsigned long index;
+
+    if (__isa_available >= __ISA_AVAILABLE_AVX2)
+    {
+        const auto needleA = _mm256_set1_epi16(static_cast<short>(a));
+        const auto needleB = _mm256_set1_epi16(static_cast<short>(b));
+        for (; end - beg >= 16; beg += 16)
+        {
+            const auto wch = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(beg));
+            const auto eq = _mm256_or_si256(_mm256_cmpeq_epi16(wch, needleA), _mm256_cmpeq_epi16(wch, needleB));
+            if (_BitScanForward(&index, static_cast<unsigned long>(_mm256_movemask_epi8(eq))))
+            {
+                return beg + index / 2;
+            }
+        }
+    }
+
+    const auto needleA = _mm_set1_epi16(static_cast<short>(a));
+    const auto needleB = _mm_set1_epi16(static_cast<short>(b));
+    for (; end - beg >= 8; beg += 8)
+    {
+        const auto wch = _mm_loadu_si128(reinterpret_cast<const __m128i*>(beg));
+        const auto eq = _mm_or_si128(_mm_cmpeq_epi16(wch, needleA), _mm_cmpeq_epi16(wch, needleB));
+        if (_BitScanForward(&index, static_cast<unsigned long>(_mm_movemask_epi8(eq))))
+        {
+            return beg + index / 2;
+        }
+    }
+#elif defined(TIL_ARM_NEON_INTRINSICS)
+    unsigned long index;
+
+    const auto needleA = vdupq_n_u16(a);
+    const auto needleB = vdupq_n_u16(b);
+    for (; end - beg >= 8; beg += 8)
+    {
+        const auto wch = vld1q_u16(reinterpret_cast<const uint16_t*>(beg));
+        const auto eq = vorrq_u16(vceqq_u16(wch, needleA), vceqq_u16(wch, needleB));
+        // NEON lacks movemask. Narrowing each 16-bit lane to 8 bits results in a 64-bit mask with 8 bits per wchar_t.
+        const auto mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(eq, 4)), 0);
+        if (_BitScanForward64(&index, mask))
+        {
+            return beg + index / 8;
+        }
+    }
+#endif
+
+#pragma loop(no_vector)
+    for (; beg != end && *beg != a && *beg != b; ++beg)
+    {
+    }
+    return beg;
+}
+
+#pragma warning(pop)
+
+// Calls `func(offset)` for every non-overlapping occurrence of `needle` in `haystack`, from left to right.
+// If `caseInsensitive` is true, ASCII letters are compared case-insensitively.
+template<typename Func>
+static void findLiteral(const std::wstring_view& haystack, const std::wstring_view& needle, bool caseInsensitive, Func&& func)
+{
+    if (needle.empty() || haystack.size() < needle.size())
+    {
+        return;
+    }
+
+    // We look for the first character of the needle with findEither() and then compare the rest.
+    auto first = needle.front();
+    auto firstAlt = first;
+    if (caseInsensitive && foldAscii(first) - L'a' < 26u)
+    {
+        first = foldAscii(first);
+        firstAlt = static_cast<wchar_t>(first & ~0x20);
+    }
+
+    const auto beg = haystack.data();
+    // The last position at which a match could start is haystack.size() - needle.size().
+    const auto last = beg + (haystack.size() - needle.size() + 1);
+    const auto rest = needle.substr(1);
+
+    for (auto it = beg; it < last; ++it)
+    {
+        it = findEither(it, last, first, firstAlt);
+        if (it == last)
+        {
+            break;
+        }
+
+        bool match = true;
+        for (size_t i = 0; i < rest.size() && match; ++i)
+        {
+            const auto h = til::at(it, i + 1);
+            const auto n = til::at(rest, i);
+            match = caseInsensitive ? foldAscii(h) == foldAscii(n) : h == n;
+        }
+
+        if (match)
+        {
+            func(gsl::narrow_cast<size_t>(it - beg));
+            // ICU continues searching after the end of the previous match. The ++it above accounts for the 1.
+            it += needle.size() - 1;
+        }
+    }
+}
+
 static std::atomic<uint64_t> s_lastMutationIdInitialValue;
 
 // Routine Description:
@@ -146,26 +271,43 @@ void TextBuffer::_decommit() noexcept
     _destroy();
     VirtualFree(_buffer.get(), 0, MEM_DECOMMIT);
     _commitWatermark = _buffer.get();
+    _frozenRows.clear();
+    _thawedRows.clear();
+    _deferredReflow.reset();
+    _attributePalette->Clear();
+    _attributeCollectThreshold = _attributeCollectMinimum;
+    _rowMap.clear();
+    _rowMapInverse.clear();
+    _lowestMutatedRow = 0;
 }
 
 // Constructs ROWs between [_commitWatermark,until).
-void TextBuffer::_construct(const std::byte* until) noexcept
+void TextBuffer::_construct(const std::byte* until)
 {
     for (; _commitWatermark < until; _commitWatermark += _bufferRowStride)
     {
-        const auto row = reinterpret_cast<ROW*>(_commitWatermark);
-        const auto chars = reinterpret_cast<wchar_t*>(_commitWatermark + _bufferOffsetChars);
-        const auto indices = reinterpret_cast<uint16_t*>(_commitWatermark + _bufferOffsetCharOffsets);
-        std::construct_at(row, chars, indices, _width, _initialAttributes);
+        _constructRow(_commitWatermark);
     }
 }
 
-// Destructs ROWs between [_buffer,_commitWatermark).
+// Constructs a single ROW at the given slot in the memory arena.
+ROW* TextBuffer::_constructRow(std::byte* row) const
+{
+    const auto chars = reinterpret_cast<wchar_t*>(row + _bufferOffsetChars);
+    const auto indices = reinterpret_cast<uint16_t*>(row + _bufferOffsetCharOffsets);
+    return std::construct_at(reinterpret_cast<ROW*>(row), chars, indices, _width, *_attributePalette, _initialAttributes);
+}
+
+// Destructs ROWs between [_buffer,_commitWatermark), skipping frozen ones.
 void TextBuffer::_destroy() const noexcept
 {
-    for (auto it = _buffer.get(); it < _commitWatermark; it += _bufferRowStride)
+    size_t offset = 0;
+    for (auto it = _buffer.get(); it < _commitWatermark; it += _bufferRowStride, ++offset)
     {
-        std::destroy_at(reinterpret_cast<ROW*>(it));
+        if (offset >= _frozenRows.size() || !_frozenRows[offset])
+        {
+            std::destroy_at(reinterpret_cast<ROW*>(it));
+        }
     }
 }
 
@@ -180,12 +322,21 @@ ROW& TextBuffer::_getRowByOffsetDirect(size_t offset)
     {
         _commit(row);
     }
+    else if (offset < _frozenRows.size() && _frozenRows[offset]) [[unlikely]]
+    {
+        _thaw(offset);
+    }
+
+    if (_isDeferred(offset)) [[unlikely]]
+    {
+        _materialize(offset);
+    }
 
     return *reinterpret_cast<ROW*>(row);
 }
 
-// See GetRowByOffset().
-ROW& TextBuffer::_getRow(til::CoordType y) const
+// Translates a "user-visible" row index into an offset for _getRowByOffsetDirect().
+size_t TextBuffer::_getRowOffset(til::CoordType y) const noexcept
 {
     // Rows are stored circularly, so the index you ask for is offset by the start position and mod the total of rows.
     auto offset = (_firstRow + y) % _height;
@@ -197,10 +348,225 @@ ROW& TextBuffer::_getRow(til::CoordType y) const
         offset += _height;
     }
 
+    // Rows that were moved by RotateRows() live in a different slot.
+    if (!_rowMap.empty()) [[unlikely]]
+    {
+        offset = til::at(_rowMap, gsl::narrow_cast<size_t>(offset));
+    }
+
     // We add 1 to the row offset, because row "0" is the one returned by GetScratchpadRow().
     // See GetScratchpadRow() for more explanation.
+    return gsl::narrow_cast<size_t>(offset) + 1;
+}
+
+// The inverse of _getRowOffset(). Returns the "user-visible" row index of the ROW at the given offset.
+til::CoordType TextBuffer::_getRowFromOffset(size_t offset) const noexcept
+{
+    auto index = gsl::narrow_cast<til::CoordType>(offset) - 1;
+    if (!_rowMapInverse.empty()) [[unlikely]]
+    {
+        index = til::at(_rowMapInverse, gsl::narrow_cast<size_t>(index));
+    }
+    return (index - _firstRow + _height) % _height;
+}
+
+// See GetRowByOffset().
+ROW& TextBuffer::_getRow(til::CoordType y) const
+{
 #pragma warning(suppress : 26492) // Don't use const_cast to cast away const or volatile (type.3).
-    return const_cast<TextBuffer*>(this)->_getRowByOffsetDirect(gsl::narrow_cast<size_t>(offset) + 1);
+    return const_cast<TextBuffer*>(this)->_getRowByOffsetDirect(_getRowOffset(y));
+}
+
+// Moves the (committed) ROW at the given offset into the cold tier. See _frozenRows.
+void TextBuffer::_freeze(size_t offset) noexcept
+try
+{
+    const auto row = _buffer.get() + _bufferRowStride * offset;
+    // ROWs past the watermark haven't been constructed yet. There's nothing to freeze.
+    // Deferred ROWs are blank until they're materialized, and their contents are already compact.
+    if (offset == 0 || row >= _commitWatermark || _isDeferred(offset))
+    {
+        return;
+    }
+
+    if (_frozenRows.empty())
+    {
+        _frozenRows.resize(::base::strict_cast<size_t>(_height) + 1);
+    }
+
+    auto& frozen = til::at(_frozenRows, offset);
+    if (frozen)
+    {
+        return;
+    }
+
+    const auto r = reinterpret_cast<ROW*>(row);
+    // FrozenRow has no room for images. Rows with an image stay hot until they're recycled.
+    if (r->GetImageSlice())
+    {
+        return;
+    }
+
+    frozen = r->Freeze(*_attributePalette);
+    std::destroy_at(r);
+    _decommitFrozenPages(row);
+}
+CATCH_LOG()
+
+// The counterpart to _freeze(). It reconstructs the ROW in its slot in the memory arena.
+// Just like _commit() this is marked as noinline to keep _getRowByOffsetDirect() small.
+__declspec(noinline) void TextBuffer::_thaw(size_t offset)
+{
+    auto& frozen = til::at(_frozenRows, offset);
+    const auto slot = _buffer.get() + _bufferRowStride * offset;
+
+    // If this throws we're still in a consistent state, because the ROW is still frozen.
+    _recommitFrozenPages(slot);
+    _thawedRows.emplace_back(offset);
+
+    const auto row = _constructRow(slot);
+    try
+    {
+        row->Thaw(frozen, *_attributePalette);
+    }
+    catch (...)
+    {
+        std::destroy_at(row);
+        _thawedRows.pop_back();
+        throw;
+    }
+
+    frozen.Release(*_attributePalette);
+}
+
+// Drops the contents of a frozen ROW and replaces it with a blank one. This is used for ROWs
+// that are about to be Reset() anyway, where thawing their contents would be wasted effort.
+void TextBuffer::_discardFrozen(size_t offset)
+{
+    if (offset < _frozenRows.size() && _frozenRows[offset])
+    {
+        const auto slot = _buffer.get() + _bufferRowStride * offset;
+        _recommitFrozenPages(slot);
+        _frozenRows[offset].Release(*_attributePalette);
+        _constructRow(slot);
+    }
+}
+
+// Returns true if the ROW at the given offset is still waiting for _materialize(). See _deferredReflow.
+bool TextBuffer::_isDeferred(size_t offset) const noexcept
+{
+    return _deferredReflow && offset < _deferredReflow->rows.size() && _deferredReflow->rows[offset].pending;
+}
+
+// Drops a deferred ROW without materializing it. Like _discardFrozen() this is used for ROWs that are about to
+// be Reset() anyway. The blank ROW in the slot becomes the actual ROW.
+void TextBuffer::_discardDeferred(size_t offset) noexcept
+{
+    if (_isDeferred(offset))
+    {
+        _deferredReflow->rows[offset].pending = false;
+        if (--_deferredReflow->pending == 0)
+        {
+            _releaseDeferred();
+        }
+    }
+}
+
+// Frees the source of a lazy reflow once no deferred ROWs are left.
+void TextBuffer::_releaseDeferred() noexcept
+{
+    for (auto& frozen : _deferredReflow->source)
+    {
+        frozen.Release(*_attributePalette);
+    }
+    _deferredReflow.reset();
+}
+
+// Returns true if the given page of the memory arena lies below _commitWatermark and is entirely covered by frozen ROWs.
+// _decommitFrozenPages() decommits a page the moment this becomes true, so it's also how we know that it's decommitted.
+bool TextBuffer::_isFrozenPage(const std::byte* page) const noexcept
+{
+    const auto base = _buffer.get();
+    if (page < base || page + _pageSize > _commitWatermark)
+    {
+        return false;
+    }
+
+    // Offset 0 is the scratchpad row, which never gets frozen.
+    const auto first = gsl::narrow_cast<size_t>(page - base) / _bufferRowStride;
+    const auto last = gsl::narrow_cast<size_t>(page + _pageSize - 1 - base) / _bufferRowStride;
+    if (first == 0)
+    {
+        return false;
+    }
+
+    for (auto i = first; i <= last; ++i)
+    {
+        if (i >= _frozenRows.size() || !_frozenRows[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// MEM_DECOMMITs the memory pages touched by the given (frozen) ROW, as long as they're entirely covered by frozen ROWs.
+// Unlike MEM_RESET this doesn't just drop them from our working set, but also returns them to the commit charge.
+void TextBuffer::_decommitFrozenPages(const std::byte* row) noexcept
+{
+    const auto end = reinterpret_cast<uintptr_t>(row + _bufferRowStride);
+    for (auto page = reinterpret_cast<uintptr_t>(row) & ~(_pageSize - 1); page < end; page += _pageSize)
+    {
+        const auto ptr = reinterpret_cast<std::byte*>(page);
+        if (_isFrozenPage(ptr))
+        {
+            VirtualFree(ptr, _pageSize, MEM_DECOMMIT);
+        }
+    }
+}
+
+// The counterpart to _decommitFrozenPages(). It MEM_COMMITs the pages touched by the given ROW again, which must
+// still be frozen. It's called right before the ROW is reconstructed, so that we don't write into decommitted memory.
+void TextBuffer::_recommitFrozenPages(const std::byte* row)
+{
+    const auto end = reinterpret_cast<uintptr_t>(row + _bufferRowStride);
+    for (auto page = reinterpret_cast<uintptr_t>(row) & ~(_pageSize - 1); page < end; page += _pageSize)
+    {
+        const auto ptr = reinterpret_cast<std::byte*>(page);
+        if (_isFrozenPage(ptr))
+        {
+            THROW_LAST_ERROR_IF_NULL(VirtualAlloc(ptr, _pageSize, MEM_COMMIT, PAGE_READWRITE));
+        }
+    }
+}
+
+// Called by IncrementCircularBuffer() to move ROWs into the cold tier once they're far enough from the bottom of the buffer.
+void TextBuffer::_freezeColdRows() noexcept
+{
+    const auto coldRows = _height - _coldRowDistance;
+    if (coldRows <= 0)
+    {
+        return;
+    }
+
+    // The ROW that just crossed the boundary into the cold tier.
+    _freeze(_getRowOffset(coldRows - 1));
+
+    // ROWs that were thawed by readers stay thawed for a while, in case they get read again (for instance
+    // because the user scrolled up). But we don't want them to accumulate without bounds either.
+    if (_thawedRows.size() > gsl::narrow_cast<size_t>(_coldRowDistance))
+    {
+        const auto mid = _thawedRows.begin() + _thawedRows.size() / 2;
+        for (auto it = _thawedRows.begin(); it != mid; ++it)
+        {
+            // The ROW may have been recycled by IncrementCircularBuffer() or moved by RotateRows() in the meantime.
+            if (_getRowFromOffset(*it) < coldRows)
+            {
+                _freeze(*it);
+            }
+        }
+        _thawedRows.erase(_thawedRows.begin(), mid);
+    }
 }
 
 // Returns the "user-visible" index of the last committed row, which can be used
@@ -227,8 +593,63 @@ const ROW& TextBuffer::GetRowByOffset(const til::CoordType index) const
 // (what corresponds to the top row of the screen buffer).
 ROW& TextBuffer::GetMutableRowByOffset(const til::CoordType index)
 {
+    // Every mutable access counts as a new mutation. GetLastMutationId() relies on that to tell whether
+    // the buffer changed at all, and _markMutated() below stamps the ROW with this new id, which is
+    // what makes it newer than any snapshot that was taken before.
     _lastMutationId++;
-    return _getRow(index);
+    _lowestMutatedRow = std::min(_lowestMutatedRow, index);
+    if (_attributePalette->Size() >= _attributeCollectThreshold) [[unlikely]]
+    {
+        _collectAttributes();
+    }
+    auto& row = _getRow(index);
+    _markMutated(row);
+    return row;
+}
+
+// Frees all palette entries that neither a hot ROW nor a FrozenRow refer to. See _attributePalette.
+// This must only be called when no attribute index is held onto outside of a ROW, which is why
+// it's only called from GetMutableRowByOffset(): Anything prior to that has finished its write.
+void TextBuffer::_collectAttributes() noexcept
+{
+    auto& palette = *_attributePalette;
+    size_t offset = 0;
+    for (auto row = _buffer.get(); row < _commitWatermark; row += _bufferRowStride, ++offset)
+    {
+        // The slots of frozen ROWs have been destroyed. Their entries are kept alive by their refcounts instead.
+        if (!_frozenRows.empty() && til::at(_frozenRows, offset))
+        {
+            continue;
+        }
+        for (const auto& run : reinterpret_cast<const ROW*>(row)->AttributeIndices().runs())
+        {
+            palette.Mark(run.value);
+        }
+    }
+    palette.Sweep();
+    _attributeCollectThreshold = std::max(_attributeCollectMinimum, 2 * palette.Size());
+}
+
+// Stamps the ROW with the current mutation id, so that GetRowsMutatedSince() can find it.
+// The caller must increment _lastMutationId first, or the stamp may not be newer than the last snapshot.
+void TextBuffer::_markMutated(ROW& row) noexcept
+{
+    // The first modification since the last snapshot starts a new range of invalidated columns,
+    // because the ones from before have already been picked up by whoever took the snapshot.
+    if (row.GetMutationId() <= _mutationSnapshot)
+    {
+        row.ResetInvalidatedColumns();
+    }
+    row.SetMutationId(_lastMutationId);
+}
+
+// Marks the given columns of a ROW that was just written to as needing a redraw.
+// Unlike TriggerRedraw() this doesn't invalidate the render engines for every single write.
+// Instead the renderer collects all of them in a single pass once per frame. See TakeMutationSnapshot().
+void TextBuffer::_invalidateColumns(ROW& row, const til::CoordType columnBegin, const til::CoordType columnEnd) noexcept
+{
+    row.InvalidateColumns(columnBegin, columnEnd);
+    NotifyPaintFrame();
 }
 
 // Returns a row filled with whitespace and the current attributes, for you to freely use.
@@ -248,6 +669,47 @@ ROW& TextBuffer::GetScratchpadRow(const TextAttribute& attributes)
     return r;
 }
 
+// Returns the amount of memory the buffer currently holds onto for its rows: The committed part of
+// the ROW arena and the heap allocations of rows that were moved into the cold tier, including
+// the attribute palette they share.
+// Nothing is counted for rows that were never touched, since they're only reserved,
+// nor for the pages that the cold tier decommitted.
+size_t TextBuffer::GetCommittedBytes() const noexcept
+{
+    auto bytes = gsl::narrow_cast<size_t>(_commitWatermark - _buffer.get());
+    if (!_frozenRows.empty())
+    {
+        for (auto page = _buffer.get(); page < _commitWatermark; page += _pageSize)
+        {
+            if (_isFrozenPage(page))
+            {
+                bytes -= _pageSize;
+            }
+        }
+        bytes += _frozenRows.capacity() * sizeof(FrozenRow);
+    }
+    for (const auto& frozen : _frozenRows)
+    {
+        bytes += frozen.MemoryUsage();
+    }
+    bytes += _attributePalette->MemoryUsage();
+    return bytes;
+}
+
+til::CoordType TextBuffer::GetColdRowDistance() const noexcept
+{
+    return _coldRowDistance;
+}
+
+// Sets how many rows at the bottom of the buffer stay out of the cold tier. A host with a
+// tall viewport or frequent scrollback access may want more, a memory constrained one less.
+// Use til::CoordTypeMax to disable the cold tier. ROWs that are already frozen stay frozen.
+void TextBuffer::SetColdRowDistance(const til::CoordType distance) noexcept
+{
+    // _freezeColdRows() must never freeze the bottom row, which is where the cursor usually is.
+    _coldRowDistance = std::max(1, distance);
+}
+
 #pragma warning(pop)
 #pragma endregion
 
@@ -568,7 +1030,8 @@ void TextBuffer::Replace(til::CoordType row, const TextAttribute& attributes, Ro
     auto& r = GetMutableRowByOffset(row);
     r.ReplaceText(state);
     r.ReplaceAttributes(state.columnBegin, state.columnEnd, attributes);
-    TriggerRedraw(Viewport::FromExclusive({ state.columnBeginDirty, row, state.columnEndDirty, row + 1 }));
+    r.EraseImage(state.columnBeginDirty, state.columnEndDirty);
+    _invalidateColumns(r, state.columnBeginDirty, state.columnEndDirty);
 }
 
 void TextBuffer::Insert(til::CoordType row, const TextAttribute& attributes, RowWriteState& state)
@@ -580,6 +1043,7 @@ void TextBuffer::Insert(til::CoordType row, const TextAttribute& attributes, Row
 
     r.ReplaceText(state);
     r.ReplaceAttributes(state.columnBegin, state.columnEnd, attributes);
+    r.EraseImage(state.columnBeginDirty, state.columnLimit);
 
     // Restore trailing text from our backup in scratch.
     RowWriteState restoreState{
@@ -592,13 +1056,13 @@ void TextBuffer::Insert(til::CoordType row, const TextAttribute& attributes, Row
     // Restore trailing attributes as well.
     if (const auto copyAmount = restoreState.columnEnd - restoreState.columnBegin; copyAmount > 0)
     {
-        auto& rowAttr = r.Attributes();
-        const auto& scratchAttr = scratch.Attributes();
-        const auto restoreAttr = scratchAttr.slice(gsl::narrow<uint16_t>(state.columnBegin), gsl::narrow<uint16_t>(state.columnBegin + copyAmount));
-        rowAttr.replace(gsl::narrow<uint16_t>(restoreState.columnBegin), gsl::narrow<uint16_t>(restoreState.columnEnd), restoreAttr);
+        r.CopyAttributesFrom(scratch, state.columnBegin, state.columnBegin + copyAmount, restoreState.columnBegin);
+
+        // The image under the shifted text moves right along with it.
+        r.CopyImageFrom(scratch, state.columnBegin, state.columnBegin + copyAmount, restoreState.columnBegin);
     }
 
-    TriggerRedraw(Viewport::FromExclusive({ state.columnBeginDirty, row, restoreState.columnEndDirty, row + 1 }));
+    _invalidateColumns(r, state.columnBeginDirty, restoreState.columnEndDirty);
 }
 
 // Fills an area of the buffer with a given fill character(s) and attributes.
@@ -651,9 +1115,48 @@ void TextBuffer::FillRect(const til::rect& rect, const std::wstring_view& fill,
             auto& r = GetMutableRowByOffset(y);
             r.CopyTextFrom(state);
             r.ReplaceAttributes(rect.left, rect.right, attributes);
-            TriggerRedraw(Viewport::FromExclusive({ state.columnBeginDirty, y, state.columnEndDirty, y + 1 }));
+            r.EraseImage(rect.left, rect.right);
+            _invalidateColumns(r, state.columnBeginDirty, state.columnEndDirty);
+        }
+    }
+}
+
+// Copies the cells in sourceRect of the given buffer to the target position in this buffer, text, attributes and images alike.
+// The source may be this buffer and the two areas may overlap. Each row is copied in bulk via ROW::CopyCellsFrom().
+void TextBuffer::CopyRect(const TextBuffer& source, const til::rect& sourceRect, const til::point target)
+{
+    if (!sourceRect)
+    {
+        return;
+    }
+
+    const auto sameBuffer = &source == this;
+    const auto height = sourceRect.height();
+    // If the target overlaps the source further down, the rows need to be copied from the bottom up,
+    // so that we don't overwrite any source rows before we've read them.
+    const auto bottomUp = sameBuffer && target.y > sourceRect.top;
+
+    for (til::CoordType i = 0; i < height; ++i)
+    {
+        const auto dy = bottomUp ? height - 1 - i : i;
+        const auto& sourceRow = source.GetRowByOffset(sourceRect.top + dy);
+        auto& targetRow = GetMutableRowByOffset(target.y + dy);
+
+        if (&sourceRow == &targetRow)
+        {
+            // A ROW can't copy from itself, because that would overwrite the text it's still reading.
+            // Moving the cells within the row is done by going through the scratchpad row instead.
+            auto& scratchpad = GetScratchpadRow();
+            scratchpad.CopyCellsFrom(sourceRow, sourceRect.left, sourceRect.right, sourceRect.left);
+            targetRow.CopyCellsFrom(scratchpad, sourceRect.left, sourceRect.right, target.x);
+        }
+        else
+        {
+            targetRow.CopyCellsFrom(sourceRow, sourceRect.left, sourceRect.right, target.x);
         }
     }
+
+    TriggerRedraw(Viewport::FromDimensions(target, sourceRect.size()));
 }
 
 // Routine Description:
@@ -734,6 +1237,7 @@ OutputCellIterator TextBuffer::WriteLine(const OutputCellIterator givenIt,
 
     // Take the cell distance written and notify that it needs to be repainted.
     const auto written = newIt.GetCellDistance(givenIt);
+    row.EraseImage(target.x, target.x + written);
     const auto paint = Viewport::FromDimensions(target, { written, 1 });
     TriggerRedraw(paint);
 
@@ -776,6 +1280,7 @@ void TextBuffer::InsertCharacter(const std::wstring_view chars,
         Row.ReplaceCharacters(iCol, 1, chars);
         break;
     }
+    Row.EraseImage(dbcsAttribute == DbcsAttribute::Trailing ? iCol - 1 : iCol, dbcsAttribute == DbcsAttribute::Leading ? iCol + 2 : iCol + 1);
 
     // Store color data
     Row.SetAttrToEnd(iCol, attr);
@@ -897,6 +1402,9 @@ void TextBuffer::IncrementCircularBuffer(const TextAttribute& fillAttributes)
     _PruneHyperlinks();
 
     // Second, clean out the old "first row" as it will become the "last row" of the buffer after the circle is performed.
+    // If it's frozen there's no point in thawing its contents just to Reset() it.
+    _discardFrozen(_getRowOffset(0));
+    _discardDeferred(_getRowOffset(0));
     GetMutableRowByOffset(0).Reset(fillAttributes);
     {
         // Now proceed to increment.
@@ -909,6 +1417,8 @@ void TextBuffer::IncrementCircularBuffer(const TextAttribute& fillAttributes)
             _firstRow = 0;
         }
     }
+
+    _freezeColdRows();
 }
 
 //Routine Description:
@@ -999,6 +1509,7 @@ const Viewport TextBuffer::GetSize() const noexcept
 void TextBuffer::_SetFirstRowIndex(const til::CoordType FirstRowIndex) noexcept
 {
     _firstRow = FirstRowIndex;
+    _lowestMutatedRow = 0;
 }
 
 void TextBuffer::ScrollRows(const til::CoordType firstRow, til::CoordType size, const til::CoordType delta)
@@ -1071,27 +1582,136 @@ void TextBuffer::ScrollRows(const til::CoordType firstRow, til::CoordType size,
     }
 }
 
-Cursor& TextBuffer::GetCursor() noexcept
-{
-    return _cursor;
-}
-
-const Cursor& TextBuffer::GetCursor() const noexcept
+// Moves the rows [firstRow, firstRow + size) by delta rows, just like ScrollRows(),
+// but by rotating the ROWs in place instead of copying their contents. This makes
+// it O(rows) instead of O(rows * columns). Unlike ScrollRows() the rows that get
+// uncovered by the move don't keep their previous contents: They hold the rows
+// that got overwritten by it instead, and it's up to the caller to clear them.
+void TextBuffer::RotateRows(const til::CoordType firstRow, til::CoordType size, const til::CoordType delta)
 {
-    return _cursor;
-}
+    size = std::max(0, size);
+    if (delta == 0 || size == 0)
+    {
+        return;
+    }
 
-uint64_t TextBuffer::GetLastMutationId() const noexcept
-{
-    return _lastMutationId;
-}
+    // The rotated range consists of the moved rows and the rows they're moved onto.
+    const auto beg = delta < 0 ? firstRow + delta : firstRow;
+    const auto count = size + std::abs(delta);
+    THROW_HR_IF(E_INVALIDARG, count > _height);
 
-const TextAttribute& TextBuffer::GetCurrentAttributes() const noexcept
-{
-    return _currentAttributes;
-}
+    if (_rowMap.empty())
+    {
+        std::vector<uint16_t> rowMap(_height);
+        std::iota(rowMap.begin(), rowMap.end(), uint16_t{ 0 });
+        _rowMapInverse = rowMap;
+        _rowMap = std::move(rowMap);
+    }
 
-void TextBuffer::SetCurrentAttributes(const TextAttribute& currentAttributes) noexcept
+    const auto ring = [&](const til::CoordType y) noexcept {
+        auto index = (_firstRow + y) % _height;
+        if (index < 0)
+        {
+            index += _height;
+        }
+        return gsl::narrow_cast<size_t>(index);
+    };
+
+    // ScrollRows() touches all rows in the range, which commits them. We do the same, so that
+    // estimates based on the commit watermark (like _estimateOffsetOfLastCommittedRow())
+    // continue to cover all rows whose contents got moved around.
+    const auto first = ring(beg);
+    const auto last = first + count > _height ? _height - 1 : first + count - 1;
+    if (const auto row = _buffer.get() + _bufferRowStride * (last + 1); row >= _commitWatermark)
+    {
+        _commit(row);
+    }
+
+    // Rotating the range left by n is the same as reversing [0,n) and [n,count) and then all of it.
+    // This works on the circular buffer without any temporary storage.
+    const auto reverse = [&](til::CoordType lo, til::CoordType hi) noexcept {
+        for (--hi; lo < hi; ++lo, --hi)
+        {
+            const auto a = ring(beg + lo);
+            const auto b = ring(beg + hi);
+            std::swap(til::at(_rowMap, a), til::at(_rowMap, b));
+            til::at(_rowMapInverse, til::at(_rowMap, a)) = gsl::narrow_cast<uint16_t>(a);
+            til::at(_rowMapInverse, til::at(_rowMap, b)) = gsl::narrow_cast<uint16_t>(b);
+        }
+    };
+    const auto n = delta < 0 ? -delta : size;
+    reverse(0, n);
+    reverse(n, count);
+    reverse(0, count);
+
+    _lastMutationId++;
+    _lowestMutatedRow = std::min(_lowestMutatedRow, beg);
+
+    // Every position in the range now holds a different ROW.
+    for (auto y = beg; y < beg + count; ++y)
+    {
+        _markMutated(_getRowByOffsetDirect(_getRowOffset(y)));
+    }
+}
+
+Cursor& TextBuffer::GetCursor() noexcept
+{
+    return _cursor;
+}
+
+const Cursor& TextBuffer::GetCursor() const noexcept
+{
+    return _cursor;
+}
+
+uint64_t TextBuffer::GetLastMutationId() const noexcept
+{
+    return _lastMutationId;
+}
+
+// Returns the mutation id of the last TakeMutationSnapshot() call.
+uint64_t TextBuffer::GetMutationSnapshot() const noexcept
+{
+    return _mutationSnapshot;
+}
+
+// Takes a snapshot of the current mutation state of the buffer and returns its id.
+// GetRowsMutatedSince() can then tell which rows changed after it. Additionally, the columns
+// that were invalidated before this snapshot are discarded lazily on the next write to each ROW.
+// That way ROW::GetInvalidatedColumns() only accumulates the writes that occurred since then.
+// This is used by the renderer, which takes a snapshot for every frame it paints.
+uint64_t TextBuffer::TakeMutationSnapshot() noexcept
+{
+    _mutationSnapshot = _lastMutationId;
+    return _mutationSnapshot;
+}
+
+// Fills `rows` with the indices of all rows in [rowBeg,rowEnd) that were modified
+// after the mutation id returned by TakeMutationSnapshot() or GetLastMutationId().
+// This includes rows that got new contents moved in by ScrollRows() or RotateRows(). IncrementCircularBuffer()
+// on the other hand moves all rows up at once without changing them, which the renderer handles by scrolling.
+void TextBuffer::GetRowsMutatedSince(const uint64_t mutationId, til::CoordType rowBeg, til::CoordType rowEnd, std::vector<til::CoordType>& rows) const
+{
+    rows.clear();
+
+    rowBeg = std::max(0, rowBeg);
+    rowEnd = std::min<til::CoordType>(_height, rowEnd);
+
+    for (auto y = rowBeg; y < rowEnd; ++y)
+    {
+        if (GetRowByOffset(y).GetMutationId() > mutationId)
+        {
+            rows.emplace_back(y);
+        }
+    }
+}
+
+const TextAttribute& TextBuffer::GetCurrentAttributes() const noexcept
+{
+    return _currentAttributes;
+}
+
+void TextBuffer::SetCurrentAttributes(const TextAttribute& currentAttributes) noexcept
 {
     _currentAttributes = currentAttributes;
 }
@@ -1251,6 +1871,14 @@ void TextBuffer::ResizeTraditional(til::size newSize)
     _bufferOffsetCharOffsets = newBuffer._bufferOffsetCharOffsets;
     _width = newBuffer._width;
     _height = newBuffer._height;
+    _frozenRows = std::move(newBuffer._frozenRows);
+    _thawedRows = std::move(newBuffer._thawedRows);
+    _deferredReflow = std::move(newBuffer._deferredReflow);
+    // The ROWs we just took over point to newBuffer's palette, which is why we have to take it along.
+    _attributePalette = std::move(newBuffer._attributePalette);
+    _attributeCollectThreshold = newBuffer._attributeCollectThreshold;
+    _rowMap = std::move(newBuffer._rowMap);
+    _rowMapInverse = std::move(newBuffer._rowMapInverse);
 
     _SetFirstRowIndex(0);
 }
@@ -2556,21 +3184,49 @@ void TextBuffer::Serialize(const wchar_t* destination) const
     static constexpr size_t writeThreshold = 32 * 1024;
     std::wstring buffer;
     buffer.reserve(writeThreshold + writeThreshold / 2);
-    buffer.push_back(L'\uFEFF');
 
+    SerializeState state;
+    for (auto moreRowsRemaining = true; moreRowsRemaining;)
+    {
+        moreRowsRemaining = SerializeRows(state, buffer, writeThreshold);
+
+        const auto fileSize = gsl::narrow<DWORD>(buffer.size() * sizeof(wchar_t));
+        DWORD bytesWritten = 0;
+        THROW_IF_WIN32_BOOL_FALSE(WriteFile(file.get(), buffer.data(), fileSize, &bytesWritten, nullptr));
+        THROW_WIN32_IF_MSG(ERROR_WRITE_FAULT, bytesWritten != fileSize, "failed to write");
+        buffer.clear();
+    }
+}
+
+// Serializes rows starting at state.row into `buffer` until the buffer has grown to `threshold` wchar_t or until
+// all rows were serialized, whichever comes first. Returns true if there are more rows remaining.
+// This allows the caller to serialize the buffer in chunks and to release its lock in between. It's the caller's
+// responsibility to ensure that rows before state.row haven't changed in the meantime (see CanResumeSerialization()).
+//
+// If `resume` is given, it receives the state at the start of the last row, once that row was serialized.
+// The last row is often still being written to (the prompt for instance), so that's where a later,
+// incremental serialization of the same buffer should continue from, instead of from the end.
+bool TextBuffer::SerializeRows(SerializeState& state, std::wstring& buffer, size_t threshold, SerializeState* resume) const
+{
+    _lowestMutatedRow = til::CoordTypeMax;
+
+    const auto initialSize = buffer.size();
     const til::CoordType lastRowWithText = GetLastNonSpaceCharacter(nullptr).y;
-    CharacterAttributes previousAttr = CharacterAttributes::Unused1;
-    TextColor previousFg;
-    TextColor previousBg;
-    TextColor previousUl;
-    uint16_t previousHyperlinkId = 0;
-    bool delayedLineBreak = false;
 
-    // This iterates through each row. The exit condition is at the end
-    // of the for() loop so that we can properly handle file flushing.
-    for (til::CoordType currentRow = 0;; currentRow++)
+    if (state.written == 0)
+    {
+        buffer.push_back(L'\uFEFF');
+    }
+
+    for (;; state.row++)
     {
-        const auto& row = GetRowByOffset(currentRow);
+        if (resume && state.row >= lastRowWithText)
+        {
+            *resume = state;
+            resume->written += buffer.size() - initialSize;
+        }
+
+        const auto& row = GetRowByOffset(state.row);
 
         if (const auto lr = row.GetLineRendition(); lr != LineRendition::SingleWidth)
         {
@@ -2583,7 +3239,8 @@ void TextBuffer::Serialize(const wchar_t* destination) const
             buffer.append(til::at(mappings, idx));
         }
 
-        const auto& runs = row.Attributes().runs();
+        const auto& runs = row.AttributeIndices().runs();
+        const auto& palette = row.AttributePalette();
         const auto beg = runs.begin();
         const auto end = runs.end();
         auto it = beg;
@@ -2593,15 +3250,16 @@ void TextBuffer::Serialize(const wchar_t* destination) const
 
         for (; it != end; ++it)
         {
-            const auto attr = it->value.GetCharacterAttributes();
-            const auto hyperlinkId = it->value.GetHyperlinkId();
-            const auto fg = it->value.GetForeground();
-            const auto bg = it->value.GetBackground();
-            const auto ul = it->value.GetUnderlineColor();
-
-            if (previousAttr != attr)
+            const auto& value = palette.At(it->value);
+            const auto attr = value.GetCharacterAttributes();
+            const auto hyperlinkId = value.GetHyperlinkId();
+            const auto fg = value.GetForeground();
+            const auto bg = value.GetBackground();
+            const auto ul = value.GetUnderlineColor();
+
+            if (state.previousAttr != attr)
             {
-                auto attrDelta = attr ^ previousAttr;
+                auto attrDelta = attr ^ state.previousAttr;
 
                 // There's no escape sequence that only turns off either bold/intense or dim/faint. SGR 22 turns off both.
                 // This results in two issues in our generic "Mapping" code below. Assuming, both Intense and Faint were on...
@@ -2610,7 +3268,7 @@ void TextBuffer::Serialize(const wchar_t* destination) const
                 //
                 // This extra branch takes care of both issues. If both attributes turned off it'll emit a single \x1b[22m,
                 // if faint turned off \x1b[22;1m (intense is still on), and \x1b[22;2m if intense turned off (vice versa).
-                if (WI_AreAllFlagsSet(previousAttr, CharacterAttributes::Intense | CharacterAttributes::Faint) &&
+                if (WI_AreAllFlagsSet(state.previousAttr, CharacterAttributes::Intense | CharacterAttributes::Faint) &&
                     WI_IsAnyFlagSet(attrDelta, CharacterAttributes::Intense | CharacterAttributes::Faint))
                 {
                     wchar_t buf[8] = L"\x1b[22m";
@@ -2665,7 +3323,7 @@ void TextBuffer::Serialize(const wchar_t* destination) const
                         L"\x1b[4:5m", // UnderlineStyle::DashedUnderlined
                     };
 
-                    auto idx = WI_EnumValue(it->value.GetUnderlineStyle());
+                    auto idx = WI_EnumValue(value.GetUnderlineStyle());
                     if (idx >= std::size(mappings))
                     {
                         idx = 1; // UnderlineStyle::SinglyUnderlined
@@ -2674,10 +3332,10 @@ void TextBuffer::Serialize(const wchar_t* destination) const
                     buffer.append(til::at(mappings, idx));
                 }
 
-                previousAttr = attr;
+                state.previousAttr = attr;
             }
 
-            if (previousFg != fg)
+            if (state.previousFg != fg)
             {
                 switch (fg.GetType())
                 {
@@ -2700,10 +3358,10 @@ void TextBuffer::Serialize(const wchar_t* destination) const
                 default:
                     break;
                 }
-                previousFg = fg;
+                state.previousFg = fg;
             }
 
-            if (previousBg != bg)
+            if (state.previousBg != bg)
             {
                 switch (bg.GetType())
                 {
@@ -2726,10 +3384,10 @@ void TextBuffer::Serialize(const wchar_t* destination) const
                 default:
                     break;
                 }
-                previousBg = bg;
+                state.previousBg = bg;
             }
 
-            if (previousUl != ul)
+            if (state.previousUl != ul)
             {
                 switch (fg.GetType())
                 {
@@ -2745,10 +3403,10 @@ void TextBuffer::Serialize(const wchar_t* destination) const
                 default:
                     break;
                 }
-                previousUl = ul;
+                state.previousUl = ul;
             }
 
-            if (previousHyperlinkId != hyperlinkId)
+            if (state.previousHyperlinkId != hyperlinkId)
             {
                 if (hyperlinkId)
                 {
@@ -2758,13 +3416,13 @@ void TextBuffer::Serialize(const wchar_t* destination) const
                         buffer.append(L"\x1b]8;;");
                         buffer.append(uri);
                         buffer.append(L"\x1b\\");
-                        previousHyperlinkId = hyperlinkId;
+                        state.previousHyperlinkId = hyperlinkId;
                     }
                 }
                 else
                 {
                     buffer.append(L"\x1b]8;;\x1b\\");
-                    previousHyperlinkId = 0;
+                    state.previousHyperlinkId = 0;
                 }
             }
 
@@ -2772,10 +3430,10 @@ void TextBuffer::Serialize(const wchar_t* destination) const
             // newly scrolled in rows are initialized with the current attributes. This means we need to set
             // the current attributes to those of the upcoming row before the row comes up. Or inversely:
             // We let the row come up, let it set its attributes and only then print the newline.
-            if (delayedLineBreak)
+            if (state.delayedLineBreak)
             {
                 buffer.append(L"\r\n");
-                delayedLineBreak = false;
+                state.delayedLineBreak = false;
             }
 
             auto newX = oldX + it->length;
@@ -2785,12 +3443,12 @@ void TextBuffer::Serialize(const wchar_t* destination) const
             // to "Hello                    ...". If the user restores the buffer dump with a different window size,
             // this would result in some fairly ugly reflow. This code attempts to at least trim trailing whitespaces.
             //
-            // As mentioned above for `delayedLineBreak`, rows are initialized with their first attribute, BUT
+            // As mentioned above for `state.delayedLineBreak`, rows are initialized with their first attribute, BUT
             // only if the viewport has begun to scroll. Otherwise, they're initialized with the default attributes.
             // In other words, we can only skip \x1b[K = Erase in Line, if both the first/last attribute are the default attribute.
             static constexpr TextAttribute defaultAttr;
             const auto trimTrailingWhitespaces = it == last && lastCharX < newX;
-            const auto clearToEndOfLine = trimTrailingWhitespaces && beg->value != defaultAttr || beg->value != defaultAttr;
+            const auto clearToEndOfLine = trimTrailingWhitespaces && palette.At(beg->value) != defaultAttr || palette.At(beg->value) != defaultAttr;
 
             if (trimTrailingWhitespaces)
             {
@@ -2807,32 +3465,290 @@ void TextBuffer::Serialize(const wchar_t* destination) const
             oldX = newX;
         }
 
-        const auto moreRowsRemaining = currentRow < lastRowWithText;
-        delayedLineBreak = !row.WasWrapForced();
+        const auto moreRowsRemaining = state.row < lastRowWithText;
+        state.delayedLineBreak = !row.WasWrapForced();
 
         if (!moreRowsRemaining)
         {
-            if (previousHyperlinkId)
+            if (state.previousHyperlinkId)
             {
                 buffer.append(L"\x1b]8;;\x1b\\");
             }
             buffer.append(L"\x1b[m\r\n");
         }
 
-        if (buffer.size() >= writeThreshold || !moreRowsRemaining)
+        if (buffer.size() - initialSize >= threshold || !moreRowsRemaining)
         {
-            const auto fileSize = gsl::narrow<DWORD>(buffer.size() * sizeof(wchar_t));
-            DWORD bytesWritten = 0;
-            THROW_IF_WIN32_BOOL_FALSE(WriteFile(file.get(), buffer.data(), fileSize, &bytesWritten, nullptr));
-            THROW_WIN32_IF_MSG(ERROR_WRITE_FAULT, bytesWritten != fileSize, "failed to write");
-            buffer.clear();
+            state.row++;
+            state.written += buffer.size() - initialSize;
+            return moreRowsRemaining;
         }
+    }
+}
 
-        if (!moreRowsRemaining)
+// Returns true if none of the rows before state.row were modified since the last SerializeRows() call,
+// which means that serializing the rows starting at state.row will continue where the output left off.
+// The output then ends up identical to serializing the entire buffer from scratch.
+bool TextBuffer::CanResumeSerialization(const SerializeState& state) const
+{
+    return state.written != 0 && _lowestMutatedRow >= state.row && GetLastNonSpaceCharacter(nullptr).y >= state.row;
+}
+
+static void writeSnapshotColor(SnapshotWriter& writer, const TextColor& color)
+{
+    // For indexed colors GetR() returns the index.
+    writer.Write(static_cast<uint8_t>(color.GetType()));
+    writer.Write(color.GetR());
+    writer.Write(color.GetG());
+    writer.Write(color.GetB());
+}
+
+static std::optional<TextColor> readSnapshotColor(SnapshotReader& reader) noexcept
+{
+    const auto type = reader.Read<uint8_t>();
+    const auto r = reader.Read<uint8_t>();
+    const auto g = reader.Read<uint8_t>();
+    const auto b = reader.Read<uint8_t>();
+
+    switch (static_cast<ColorType>(type))
+    {
+    case ColorType::IsDefault:
+        return TextColor{};
+    case ColorType::IsIndex16:
+        return TextColor{ r, false };
+    case ColorType::IsIndex256:
+        return TextColor{ r, true };
+    case ColorType::IsRgb:
+        return TextColor{ RGB(r, g, b) };
+    default:
+        return std::nullopt;
+    }
+}
+
+static void writeSnapshotAttribute(SnapshotWriter& writer, const TextAttribute& attr)
+{
+    writer.Write(attr.GetCharacterAttributes());
+    writer.Write(attr.GetHyperlinkId());
+    writeSnapshotColor(writer, attr.GetForeground());
+    writeSnapshotColor(writer, attr.GetBackground());
+    writeSnapshotColor(writer, attr.GetUnderlineColor());
+    writer.Write(attr.GetMarkAttributes());
+}
+
+static std::optional<TextAttribute> readSnapshotAttribute(SnapshotReader& reader) noexcept
+{
+    const auto attrs = reader.Read<CharacterAttributes>();
+    const auto hyperlinkId = reader.Read<uint16_t>();
+    const auto fg = readSnapshotColor(reader);
+    const auto bg = readSnapshotColor(reader);
+    const auto ul = readSnapshotColor(reader);
+    const auto markKind = reader.Read<uint16_t>();
+
+    if (reader.Failed() || !fg || !bg || !ul || markKind > static_cast<uint16_t>(MarkKind::Output))
+    {
+        return std::nullopt;
+    }
+
+    TextAttribute attr;
+    attr.SetCharacterAttributes(attrs);
+    attr.SetHyperlinkId(hyperlinkId);
+    attr.SetForeground(*fg);
+    attr.SetBackground(*bg);
+    attr.SetUnderlineColor(*ul);
+    attr.SetMarkAttributes(static_cast<MarkKind>(markKind));
+    return attr;
+}
+
+// Writes the buffer contents in the binary format described in BufferSnapshot.hpp.
+// Unlike Serialize() this preserves everything about each ROW and LoadSnapshot() can restore it without parsing VT.
+void TextBuffer::SaveSnapshot(const wchar_t* destination) const
+{
+    const auto data = SaveSnapshot();
+
+    const wil::unique_handle file{ CreateFileW(destination, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr) };
+    THROW_LAST_ERROR_IF(!file);
+
+    const auto fileSize = gsl::narrow<DWORD>(data.size());
+    DWORD bytesWritten = 0;
+    THROW_IF_WIN32_BOOL_FALSE(WriteFile(file.get(), data.data(), fileSize, &bytesWritten, nullptr));
+    THROW_WIN32_IF_MSG(ERROR_WRITE_FAULT, bytesWritten != fileSize, "failed to write");
+}
+
+std::vector<std::byte> TextBuffer::SaveSnapshot() const
+{
+    const auto cursorPos = _cursor.GetPosition();
+    const auto rowCount = std::max(GetLastNonSpaceCharacter(nullptr).y, cursorPos.y) + 1;
+
+    // ROW::Freeze() already produces a compact representation of a ROW, with its attributes interned into a palette.
+    // The palette is local and we never Release() the FrozenRows, so its indices are contiguous from 0 to Size().
+    TextAttributePalette palette;
+    SnapshotWriter rows;
+    for (til::CoordType y = 0; y < rowCount; ++y)
+    {
+        GetRowByOffset(y).Freeze(palette).Encode(rows);
+    }
+
+    SnapshotWriter writer;
+    writer.Write(SnapshotHeader{
+        .magic = SnapshotHeader::Magic,
+        .version = SnapshotHeader::CurrentVersion,
+        .width = _width,
+        .height = _height,
+        .currentHyperlinkId = _currentHyperlinkId,
+        .cursorX = cursorPos.x,
+        .cursorY = cursorPos.y,
+        .rowCount = gsl::narrow<uint32_t>(rowCount),
+        .attributeCount = gsl::narrow<uint32_t>(palette.Size()),
+        .hyperlinkCount = gsl::narrow<uint32_t>(_hyperlinkMap.size()),
+        .customIdCount = gsl::narrow<uint32_t>(_hyperlinkCustomIdMap.size()),
+    });
+
+    for (size_t i = 0; i < palette.Size(); ++i)
+    {
+        writeSnapshotAttribute(writer, palette.At(gsl::narrow_cast<uint16_t>(i)));
+    }
+    for (const auto& [id, uri] : _hyperlinkMap)
+    {
+        writer.Write(id);
+        writer.WriteString(uri);
+    }
+    for (const auto& [customId, id] : _hyperlinkCustomIdMap)
+    {
+        writer.Write(id);
+        writer.WriteString(customId);
+    }
+
+    auto& data = writer.Data();
+    data.insert(data.end(), rows.Data().begin(), rows.Data().end());
+    return std::move(data);
+}
+
+// Memory maps the given file and restores the snapshot it contains. See LoadSnapshot() below.
+bool TextBuffer::LoadSnapshot(const wchar_t* source)
+{
+    const wil::unique_handle file{ CreateFileW(source, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr) };
+    if (!file)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize{};
+    if (!GetFileSizeEx(file.get(), &fileSize) || fileSize.QuadPart < static_cast<LONGLONG>(sizeof(SnapshotHeader)))
+    {
+        return false;
+    }
+
+    const wil::unique_handle mapping{ CreateFileMappingW(file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr) };
+    if (!mapping)
+    {
+        return false;
+    }
+
+    const wil::unique_mapview_ptr<std::byte> view{ static_cast<std::byte*>(MapViewOfFile(mapping.get(), FILE_MAP_READ, 0, 0, 0)) };
+    if (!view)
+    {
+        return false;
+    }
+
+    return LoadSnapshot({ view.get(), gsl::narrow<size_t>(fileSize.QuadPart) });
+}
+
+// Replaces the contents of this buffer with those of a snapshot created by SaveSnapshot().
+// If the snapshot is of a different width or has more rows than fit into this buffer, the contents are reflowed.
+// Returns false and leaves the buffer untouched if the snapshot is invalid or of an unsupported version.
+bool TextBuffer::LoadSnapshot(const std::span<const std::byte>& data)
+{
+    SnapshotReader reader{ data };
+    const auto header = reader.Read<SnapshotHeader>();
+    if (reader.Failed() ||
+        header.magic != SnapshotHeader::Magic ||
+        header.version != SnapshotHeader::CurrentVersion ||
+        header.width == 0 ||
+        header.rowCount > static_cast<uint32_t>(til::CoordTypeMax) ||
+        header.attributeCount > TextAttributePalette::MaxEntries)
+    {
+        return false;
+    }
+
+    // Decode everything before touching the buffer. We can't rely on the counts in the header
+    // to reserve() memory, as they may be garbage, so we only use them to bound our loops.
+    TextAttributePalette palette;
+    std::vector<uint16_t> attributes;
+    for (uint32_t i = 0; i < header.attributeCount; ++i)
+    {
+        const auto attr = readSnapshotAttribute(reader);
+        if (!attr)
         {
-            break;
+            return false;
+        }
+        attributes.emplace_back(palette.Intern(*attr));
+    }
+
+    std::unordered_map<uint16_t, std::wstring> hyperlinkMap;
+    for (uint32_t i = 0; i < header.hyperlinkCount && !reader.Failed(); ++i)
+    {
+        const auto id = reader.Read<uint16_t>();
+        hyperlinkMap.insert_or_assign(id, reader.ReadString());
+    }
+
+    std::unordered_map<std::wstring, uint16_t> hyperlinkCustomIdMap;
+    for (uint32_t i = 0; i < header.customIdCount && !reader.Failed(); ++i)
+    {
+        const auto id = reader.Read<uint16_t>();
+        hyperlinkCustomIdMap.insert_or_assign(reader.ReadString(), id);
+    }
+
+    std::vector<FrozenRow> rows;
+    for (uint32_t i = 0; i < header.rowCount; ++i)
+    {
+        auto row = FrozenRow::Decode(reader, header.width, attributes);
+        if (!row)
+        {
+            return false;
         }
+        rows.emplace_back(std::move(row));
+    }
+
+    if (reader.Failed() || !reader.AtEnd())
+    {
+        return false;
+    }
+
+    // If the snapshot fits, we can restore it in-place. Otherwise, we restore it into
+    // a temporary buffer of the original width and let Reflow() do the rest.
+    const auto rowCount = gsl::narrow_cast<til::CoordType>(rows.size());
+    const auto fits = header.width == _width && rowCount <= _height;
+    std::optional<TextBuffer> temporary;
+    if (!fits)
+    {
+        temporary.emplace(til::size{ header.width, std::max(1, rowCount) }, _currentAttributes, _cursor.GetSize(), false, _renderer);
+        // Reflow() carries this over into the new buffer.
+        temporary->_coldRowDistance = _coldRowDistance;
+    }
+    auto& target = fits ? *this : *temporary;
+
+    target.Reset();
+    target._SetFirstRowIndex(0);
+    for (til::CoordType y = 0; y < rowCount; ++y)
+    {
+        target.GetMutableRowByOffset(y).Thaw(til::at(rows, y), palette);
+    }
+
+    target._hyperlinkMap = std::move(hyperlinkMap);
+    target._hyperlinkCustomIdMap = std::move(hyperlinkCustomIdMap);
+    target._currentHyperlinkId = std::max<uint16_t>(header.currentHyperlinkId, 1);
+
+    const auto size = target.GetSize().Dimensions();
+    target._cursor.SetPosition({ std::clamp(header.cursorX, 0, size.width - 1), std::clamp(header.cursorY, 0, size.height - 1) });
+
+    if (!fits)
+    {
+        Reset();
+        _SetFirstRowIndex(0);
+        Reflow(*temporary, *this);
     }
+
+    return true;
 }
 
 // Function Description:
@@ -2853,194 +3769,751 @@ void TextBuffer::Serialize(const wchar_t* destination) const
 // - S_OK if we successfully copied the contents to the new buffer, otherwise an appropriate HRESULT.
 void TextBuffer::Reflow(TextBuffer& oldBuffer, TextBuffer& newBuffer, const Viewport* lastCharacterViewport, PositionInformation* positionInfo)
 {
-    const auto& oldCursor = oldBuffer.GetCursor();
-    auto& newCursor = newBuffer.GetCursor();
+    _reflow(oldBuffer, newBuffer, lastCharacterViewport, positionInfo, 0, false);
+}
 
-    til::point oldCursorPos = oldCursor.GetPosition();
-    til::point newCursorPos;
+// Same as Reflow(), but the rows more than _coldRowDistance rows above the cursor and the viewports aren't
+// reflowed right away. Only their layout is computed, which doesn't need to look at their text. Each of
+// these ROWs gets reflowed once something reads it. See _reflowDeferred().
+//
+// oldBuffer keeps its contents, so that the caller can keep using it if this (or anything after it) throws.
+void TextBuffer::ReflowLazily(TextBuffer& oldBuffer, TextBuffer& newBuffer, const Viewport* lastCharacterViewport, PositionInformation* positionInfo)
+{
+    _reflow(oldBuffer, newBuffer, lastCharacterViewport, positionInfo, 0, true);
+}
 
-    // BODGY: We use oldCursorPos in two critical places below:
-    // * To compute an oldHeight that includes at a minimum the cursor row
-    // * For REFLOW_JANK_CURSOR_WRAP (see comment below)
-    // Both of these would break the reflow algorithm, but the latter of the two in particular
-    // would cause the main copy loop below to deadlock. In other words, these two lines
-    // protect this function against yet-unknown bugs in other parts of the code base.
-    oldCursorPos.x = std::clamp(oldCursorPos.x, 0, oldBuffer._width - 1);
-    oldCursorPos.y = std::clamp(oldCursorPos.y, 0, oldBuffer._height - 1);
+// A ROW that isn't part of any TextBuffer. See _reflowParallel() and _materialize().
+struct ScratchRow
+{
+    ScratchRow(const uint16_t width, TextAttributePalette& palette, const TextAttribute& attributes) :
+        chars(width + 1u),
+        charOffsets(width + 1u),
+        row{ chars.data(), charOffsets.data(), width, palette, attributes }
+    {
+    }
 
-    const auto lastRowWithText = oldBuffer.GetLastNonSpaceCharacter(lastCharacterViewport).y;
+    ScratchRow(const ScratchRow&) = delete;
+    ScratchRow& operator=(const ScratchRow&) = delete;
 
-    auto mutableViewportTop = positionInfo ? positionInfo->mutableViewportTop : til::CoordTypeMax;
-    auto visibleViewportTop = positionInfo ? positionInfo->visibleViewportTop : til::CoordTypeMax;
+    std::vector<wchar_t> chars;
+    std::vector<uint16_t> charOffsets;
+    ROW row;
+};
+
+// The state of a reflow in progress. _reflowRow() consumes one row of the old buffer at a time and advances it.
+struct TextBuffer::ReflowState
+{
+    til::point oldCursorPos;
+    til::CoordType newWidth = 0;
+    til::CoordType newHeight = 0;
 
-    til::CoordType oldY = 0;
-    til::CoordType newY = 0;
     til::CoordType newX = 0;
-    til::CoordType newWidth = newBuffer.GetSize().Width();
+    til::CoordType newY = 0;
     til::CoordType newYLimit = til::CoordTypeMax;
+    til::CoordType mutableViewportTop = til::CoordTypeMax;
+    til::CoordType visibleViewportTop = til::CoordTypeMax;
 
-    const auto oldHeight = std::max(lastRowWithText, oldCursorPos.y) + 1;
-    const auto newHeight = newBuffer.GetSize().Height();
-    const auto newWidthU16 = gsl::narrow_cast<uint16_t>(newWidth);
-
-    // Copy oldBuffer into newBuffer until oldBuffer has been fully consumed.
-    for (; oldY < oldHeight && newY < newYLimit; ++oldY)
+    til::point newCursorPos;
+    std::optional<til::CoordType> newMutableViewportTop;
+    std::optional<til::CoordType> newVisibleViewportTop;
+};
+
+// Reflows a single row of the old buffer into the new buffer, starting at (state.newX, state.newY).
+// rowAt(y) returns the ROW at the given y in the new buffer. See _reflowParallel() for why that's abstracted.
+// oldX is the column in oldRow to start at, which is only non-zero for _materialize().
+template<typename RowAt>
+void TextBuffer::_reflowRow(const ROW& oldRow, const til::CoordType oldY, til::CoordType oldX, const TextAttribute& initialAttributes, ReflowState& state, RowAt&& rowAt)
+{
+    const auto& oldCursorPos = state.oldCursorPos;
+    const auto newWidth = state.newWidth;
+    const auto newHeight = state.newHeight;
+    auto& newX = state.newX;
+    auto& newY = state.newY;
+
+    // A pair of double height rows should optimally wrap as a union (i.e. after wrapping there should be 4 lines).
+    // But for this initial implementation I chose the alternative approach: Just truncate them.
+    if (oldRow.GetLineRendition() != LineRendition::SingleWidth)
     {
-        const auto& oldRow = oldBuffer.GetRowByOffset(oldY);
-
-        // A pair of double height rows should optimally wrap as a union (i.e. after wrapping there should be 4 lines).
-        // But for this initial implementation I chose the alternative approach: Just truncate them.
-        if (oldRow.GetLineRendition() != LineRendition::SingleWidth)
+        // Since rows with a non-standard line rendition should be truncated it's important
+        // that we pretend as if the previous row ended in a newline, even if it didn't.
+        // This is what this if does: It newlines.
+        if (newX)
         {
-            // Since rows with a non-standard line rendition should be truncated it's important
-            // that we pretend as if the previous row ended in a newline, even if it didn't.
-            // This is what this if does: It newlines.
-            if (newX)
-            {
-                newX = 0;
-                newY++;
-            }
-
-            auto& newRow = newBuffer.GetMutableRowByOffset(newY);
-
-            // See the comment marked with "REFLOW_RESET".
-            if (newY >= newHeight)
-            {
-                newRow.Reset(newBuffer._initialAttributes);
-            }
-
-            newRow.CopyFrom(oldRow);
-            newRow.SetWrapForced(false);
+            newX = 0;
+            newY++;
+        }
 
-            if (oldY == oldCursorPos.y)
-            {
-                newCursorPos = { newRow.AdjustToGlyphStart(oldCursorPos.x), newY };
-            }
-            if (oldY >= mutableViewportTop)
-            {
-                positionInfo->mutableViewportTop = newY;
-                mutableViewportTop = til::CoordTypeMax;
-            }
-            if (oldY >= visibleViewportTop)
-            {
-                positionInfo->visibleViewportTop = newY;
-                visibleViewportTop = til::CoordTypeMax;
-            }
+        auto& newRow = rowAt(newY);
 
-            newY++;
-            continue;
+        // See the comment marked with "REFLOW_RESET".
+        if (newY >= newHeight)
+        {
+            newRow.Reset(initialAttributes);
         }
 
-        // Rows don't store any information for what column the last written character is in.
-        // We simply truncate all trailing whitespace in this implementation.
-        auto oldRowLimit = oldRow.MeasureRight();
+        newRow.CopyFrom(oldRow);
+        newRow.SetWrapForced(false);
+
         if (oldY == oldCursorPos.y)
         {
-            // REFLOW_JANK_CURSOR_WRAP:
-            // Pretending as if there's always at least whitespace in front of the cursor has the benefit that
-            // * the cursor retains its distance from any preceding text.
-            // * when a client application starts writing on this new, empty line,
-            //   enlarging the buffer unwraps the text onto the preceding line.
-            oldRowLimit = std::max(oldRowLimit, oldCursorPos.x + 1);
+            state.newCursorPos = { newRow.AdjustToGlyphStart(oldCursorPos.x), newY };
         }
-
-        // Immediately copy this mark over to our new row. The positions of the
-        // marks themselves will be preserved, since they're just text
-        // attributes. But the "bookmark" needs to get moved to the new row too.
-        // * If a row wraps as it reflows, that's fine - we want to leave the
-        //   mark on the row it started on.
-        // * If the second row of a wrapped row had a mark, and it de-flows onto a
-        //   single row, that's fine! The mark was on that logical row.
-        if (oldRow.GetScrollbarData().has_value())
+        if (oldY >= state.mutableViewportTop)
         {
-            newBuffer.GetMutableRowByOffset(newY).SetScrollbarData(oldRow.GetScrollbarData());
+            state.newMutableViewportTop = newY;
+            state.mutableViewportTop = til::CoordTypeMax;
         }
-
-        til::CoordType oldX = 0;
-
-        // Copy oldRow into newBuffer until oldRow has been fully consumed.
-        // We use a do-while loop to ensure that line wrapping occurs and
-        // that attributes are copied over even for seemingly empty rows.
-        do
+        if (oldY >= state.visibleViewportTop)
         {
-            // This if condition handles line wrapping.
-            // Only if we write past the last column we should wrap and as such this if
-            // condition is in front of the text insertion code instead of behind it.
-            // A SetWrapForced of false implies an explicit newline, which is the default.
-            if (newX >= newWidth)
-            {
-                newBuffer.GetMutableRowByOffset(newY).SetWrapForced(true);
-                newX = 0;
-                newY++;
-            }
-
-            // REFLOW_RESET:
-            // If we shrink the buffer vertically, for instance from 100 rows to 90 rows, we will write 10 rows in the
-            // new buffer twice. We need to reset them before copying text, or otherwise we'll see the previous contents.
-            // We don't need to be smart about this. Reset() is fast and shrinking doesn't occur often.
-            if (newY >= newHeight && newX == 0)
-            {
-                // We need to ensure not to overwrite the row the cursor is on.
-                if (newY >= newYLimit)
-                {
-                    break;
-                }
-                newBuffer.GetMutableRowByOffset(newY).Reset(newBuffer._initialAttributes);
-            }
+            state.newVisibleViewportTop = newY;
+            state.visibleViewportTop = til::CoordTypeMax;
+        }
 
-            auto& newRow = newBuffer.GetMutableRowByOffset(newY);
+        newY++;
+        return;
+    }
 
-            RowCopyTextFromState state{
-                .source = oldRow,
-                .columnBegin = newX,
-                .columnLimit = til::CoordTypeMax,
-                .sourceColumnBegin = oldX,
-                .sourceColumnLimit = oldRowLimit,
-            };
-            newRow.CopyTextFrom(state);
+    // Rows don't store any information for what column the last written character is in.
+    // We simply truncate all trailing whitespace in this implementation.
+    auto oldRowLimit = oldRow.MeasureRight();
+    if (oldY == oldCursorPos.y)
+    {
+        // REFLOW_JANK_CURSOR_WRAP:
+        // Pretending as if there's always at least whitespace in front of the cursor has the benefit that
+        // * the cursor retains its distance from any preceding text.
+        // * when a client application starts writing on this new, empty line,
+        //   enlarging the buffer unwraps the text onto the preceding line.
+        oldRowLimit = std::max(oldRowLimit, oldCursorPos.x + 1);
+    }
 
-            const auto& oldAttr = oldRow.Attributes();
-            auto& newAttr = newRow.Attributes();
-            const auto attributes = oldAttr.slice(gsl::narrow_cast<uint16_t>(oldX), oldAttr.size());
-            newAttr.replace(gsl::narrow_cast<uint16_t>(newX), newAttr.size(), attributes);
-            newAttr.resize_trailing_extent(newWidthU16);
+    // Copy this mark over to the new row the old row's text begins on. The positions of the
+    // marks themselves will be preserved, since they're just text
+    // attributes. But the "bookmark" needs to get moved to the new row too.
+    // * If a row wraps as it reflows, that's fine - we want to leave the
+    //   mark on the row it started on.
+    // * If the second row of a wrapped row had a mark, and it de-flows onto a
+    //   single row, that's fine! The mark was on that logical row.
+    // It's set inside the loop below, because the row at newY may be the full preceding one
+    // (the text then begins on the next row) or get Reset() by REFLOW_RESET first.
+    auto copyScrollbarData = oldX == 0 && oldRow.GetScrollbarData().has_value();
+
+    // Copy oldRow into newBuffer until oldRow has been fully consumed.
+    // We use a do-while loop to ensure that line wrapping occurs and
+    // that attributes are copied over even for seemingly empty rows.
+    do
+    {
+        // This if condition handles line wrapping.
+        // Only if we write past the last column we should wrap and as such this if
+        // condition is in front of the text insertion code instead of behind it.
+        // A SetWrapForced of false implies an explicit newline, which is the default.
+        if (newX >= newWidth)
+        {
+            rowAt(newY).SetWrapForced(true);
+            newX = 0;
+            newY++;
+        }
 
-            if (oldY == oldCursorPos.y && oldCursorPos.x >= oldX)
-            {
-                // In theory AdjustToGlyphStart ensures we don't put the cursor on a trailing wide glyph.
-                // In practice I don't think that this can possibly happen. Better safe than sorry.
-                newCursorPos = { newRow.AdjustToGlyphStart(oldCursorPos.x - oldX + newX), newY };
-                // If there's so much text past the old cursor position that it doesn't fit into new buffer,
-                // then the new cursor position will be "lost", because it's overwritten by unrelated text.
-                // We have two choices how can handle this:
-                // * If the new cursor is at an y < 0, just put the cursor at (0,0)
-                // * Stop writing into the new buffer before we overwrite the new cursor position
-                // This implements the second option. There's no fundamental reason why this is better.
-                newYLimit = newY + newHeight;
-            }
-            if (oldY >= mutableViewportTop)
-            {
-                positionInfo->mutableViewportTop = newY;
-                mutableViewportTop = til::CoordTypeMax;
-            }
-            if (oldY >= visibleViewportTop)
+        // REFLOW_RESET:
+        // If we shrink the buffer vertically, for instance from 100 rows to 90 rows, we will write 10 rows in the
+        // new buffer twice. We need to reset them before copying text, or otherwise we'll see the previous contents.
+        // We don't need to be smart about this. Reset() is fast and shrinking doesn't occur often.
+        if (newY >= newHeight && newX == 0)
+        {
+            // We need to ensure not to overwrite the row the cursor is on.
+            if (newY >= state.newYLimit)
             {
-                positionInfo->visibleViewportTop = newY;
-                visibleViewportTop = til::CoordTypeMax;
+                break;
             }
+            rowAt(newY).Reset(initialAttributes);
+        }
 
-            oldX = state.sourceColumnEnd;
-            newX = state.columnEnd;
-        } while (oldX < oldRowLimit);
+        auto& newRow = rowAt(newY);
 
-        // If the row had an explicit newline we also need to newline. :)
-        if (!oldRow.WasWrapForced())
+        if (copyScrollbarData)
         {
+            newRow.SetScrollbarData(oldRow.GetScrollbarData());
+            copyScrollbarData = false;
+        }
+
+        RowCopyTextFromState copyState{
+            .source = oldRow,
+            .columnBegin = newX,
+            .columnLimit = til::CoordTypeMax,
+            .sourceColumnBegin = oldX,
+            .sourceColumnLimit = oldRowLimit,
+        };
+        newRow.CopyTextFrom(copyState);
+
+        newRow.CopyAttributesToEnd(oldRow, oldX, newX);
+
+        if (oldY == oldCursorPos.y && oldCursorPos.x >= oldX)
+        {
+            // In theory AdjustToGlyphStart ensures we don't put the cursor on a trailing wide glyph.
+            // In practice I don't think that this can possibly happen. Better safe than sorry.
+            state.newCursorPos = { newRow.AdjustToGlyphStart(oldCursorPos.x - oldX + newX), newY };
+            // If there's so much text past the old cursor position that it doesn't fit into new buffer,
+            // then the new cursor position will be "lost", because it's overwritten by unrelated text.
+            // We have two choices how can handle this:
+            // * If the new cursor is at an y < 0, just put the cursor at (0,0)
+            // * Stop writing into the new buffer before we overwrite the new cursor position
+            // This implements the second option. There's no fundamental reason why this is better.
+            state.newYLimit = newY + newHeight;
+        }
+        if (oldY >= state.mutableViewportTop)
+        {
+            state.newMutableViewportTop = newY;
+            state.mutableViewportTop = til::CoordTypeMax;
+        }
+        if (oldY >= state.visibleViewportTop)
+        {
+            state.newVisibleViewportTop = newY;
+            state.visibleViewportTop = til::CoordTypeMax;
+        }
+
+        oldX = copyState.sourceColumnEnd;
+        newX = copyState.columnEnd;
+    } while (oldX < oldRowLimit);
+
+    // If the row had an explicit newline we also need to newline. :)
+    if (!oldRow.WasWrapForced())
+    {
+        newX = 0;
+        newY++;
+    }
+}
+
+// Runs func(0) to func(count - 1) concurrently, each on its own thread, and rethrows the first exception, if any.
+template<typename Func>
+static void runConcurrently(const size_t count, const Func& func)
+{
+    std::vector<std::exception_ptr> exceptions(count);
+    const auto run = [&](size_t i) noexcept {
+        try
+        {
+            func(i);
+        }
+        catch (...)
+        {
+            til::at(exceptions, i) = std::current_exception();
+        }
+    };
+
+    {
+        std::vector<std::jthread> threads;
+        threads.reserve(count - 1);
+        for (size_t i = 1; i < count; ++i)
+        {
+            threads.emplace_back(run, i);
+        }
+        run(0);
+    }
+
+    for (const auto& exception : exceptions)
+    {
+        if (exception)
+        {
+            std::rethrow_exception(exception);
+        }
+    }
+}
+
+// A reflow of the old buffer can be split up at any row that ends in a hard line break, because the next row
+// starts at column 0 of a new row, independent of what came before. This function splits the old buffer into
+// segmentCount such pieces and reflows them concurrently, producing the exact same result as the sequential loop.
+//
+// It works in two passes. The first pass reflows each segment into a scratch ROW to measure how many rows it
+// produces. This tells us the final y of every segment and which rows end up surviving in the circular new buffer.
+// The second pass then repeats the work, but writes the surviving rows directly into the new buffer.
+//
+// Returns false if the cursor row limit (see _reflowRow()) would kick in, which the sequential loop handles.
+// newBuffer is left untouched in that case. Like the sequential loop this expects newBuffer to be freshly reset.
+bool TextBuffer::_reflowParallel(TextBuffer& oldBuffer, TextBuffer& newBuffer, const til::CoordType oldHeight, ReflowState& state, const size_t segmentCount)
+{
+    struct Segment
+    {
+        til::CoordType oldBeg = 0;
+        til::CoordType oldEnd = 0;
+        til::CoordType newBeg = 0;
+        ReflowState state;
+    };
+
+    // Reading a ROW may thaw or commit it, neither of which is thread-safe. Reading them all upfront
+    // turns any concurrent reads later on into pure lookups. The sequential loop thaws them all anyway.
+    for (til::CoordType y = 0; y < oldHeight; ++y)
+    {
+        std::ignore = oldBuffer.GetRowByOffset(y);
+    }
+
+    // The same goes for the attribute palette of the new buffer: Translating an attribute that's already
+    // in it is a pure lookup, so we add all of them upfront. Unused ones get collected eventually.
+    newBuffer._attributePalette->Merge(*oldBuffer._attributePalette);
+    std::ignore = newBuffer._attributePalette->Index(newBuffer._initialAttributes);
+
+    const auto isHardLineBreak = [&](til::CoordType y) {
+        const auto& row = oldBuffer.GetRowByOffset(y);
+        return !row.WasWrapForced() || row.GetLineRendition() != LineRendition::SingleWidth;
+    };
+
+    std::vector<Segment> segments;
+    for (til::CoordType beg = 0; beg < oldHeight;)
+    {
+        const auto ideal = gsl::narrow_cast<til::CoordType>(int64_t{ oldHeight } * gsl::narrow_cast<int64_t>(segments.size() + 1) / gsl::narrow_cast<int64_t>(segmentCount));
+        auto end = std::max(ideal, beg + 1);
+        while (end < oldHeight && !isHardLineBreak(end - 1))
+        {
+            ++end;
+        }
+
+        auto& segment = segments.emplace_back();
+        segment.oldBeg = beg;
+        segment.oldEnd = end;
+        beg = end;
+    }
+
+    if (segments.size() < 2)
+    {
+        return false;
+    }
+
+    const auto& initialAttributes = newBuffer._initialAttributes;
+    const auto newWidthU16 = gsl::narrow_cast<uint16_t>(state.newWidth);
+
+    // Reflows a segment, starting at the given y in the new buffer. Rows before `firstSurvivor`
+    // are going to be overwritten later on, which is why they're written into a scratch ROW instead.
+    const auto reflowSegment = [&](Segment& segment, til::CoordType newBeg, til::CoordType firstSurvivor) {
+        ScratchRow scratchRow{ newWidthU16, *newBuffer._attributePalette, initialAttributes };
+        auto& scratch = scratchRow.row;
+        auto scratchY = til::CoordTypeMin;
+
+        const auto rowAt = [&](til::CoordType y) -> ROW& {
+            if (y >= firstSurvivor)
+            {
+                return newBuffer._getRow(y);
+            }
+            if (y != scratchY)
+            {
+                scratch.Reset(initialAttributes);
+                scratchY = y;
+            }
+            return scratch;
+        };
+
+        segment.state = state;
+        segment.state.newY = newBeg;
+        for (auto oldY = segment.oldBeg; oldY < segment.oldEnd && segment.state.newY < segment.state.newYLimit; ++oldY)
+        {
+            _reflowRow(oldBuffer.GetRowByOffset(oldY), oldY, 0, initialAttributes, segment.state, rowAt);
+        }
+    };
+
+    // Pass 1: Measure the segments.
+    runConcurrently(segments.size(), [&](size_t i) {
+        reflowSegment(til::at(segments, i), 0, til::CoordTypeMax);
+    });
+
+    til::CoordType newEnd = 0;
+    til::CoordType newYLimit = til::CoordTypeMax;
+    for (auto& segment : segments)
+    {
+        if (segment.state.newYLimit != til::CoordTypeMax)
+        {
+            newYLimit = newEnd + segment.state.newYLimit;
+        }
+        segment.newBeg = newEnd;
+        newEnd += segment.state.newY;
+    }
+
+    // Every segment but the last one ends in a hard line break, which is why the final newX is that of the last one.
+    const auto lastRow = segments.back().state.newX ? newEnd : newEnd - 1;
+    if (newEnd >= newYLimit)
+    {
+        return false;
+    }
+
+    // Pass 2: Write the rows that survive into the new buffer. Just like with the old buffer,
+    // we need to commit them upfront, so that the concurrent _getRow() calls are pure lookups.
+    const auto firstSurvivor = std::max(0, lastRow - state.newHeight + 1);
+    for (auto y = firstSurvivor; y <= lastRow; ++y)
+    {
+        std::ignore = newBuffer._getRow(y);
+    }
+
+    runConcurrently(segments.size(), [&](size_t i) {
+        auto& segment = til::at(segments, i);
+        reflowSegment(segment, segment.newBeg, firstSurvivor);
+    });
+
+    // We bypassed GetMutableRowByOffset() above, so we need to replicate its bookkeeping.
+    newBuffer._lastMutationId++;
+    newBuffer._lowestMutatedRow = 0;
+
+    // Only the first segment to reach the viewport tops records them. See _reflowRow().
+    for (const auto& segment : segments)
+    {
+        if (segment.state.newMutableViewportTop && !state.newMutableViewportTop)
+        {
+            state.newMutableViewportTop = segment.state.newMutableViewportTop;
+        }
+        if (segment.state.newVisibleViewportTop && !state.newVisibleViewportTop)
+        {
+            state.newVisibleViewportTop = segment.state.newVisibleViewportTop;
+        }
+        if (state.oldCursorPos.y >= segment.oldBeg && state.oldCursorPos.y < segment.oldEnd)
+        {
+            state.newCursorPos = segment.state.newCursorPos;
+        }
+    }
+
+    state.newX = segments.back().state.newX;
+    state.newY = segments.back().state.newY;
+    return true;
+}
+
+// Implements the lazy part of ReflowLazily(). The rows of oldBuffer that are more than _coldRowDistance rows above
+// the cursor and the viewports are copied into newBuffer as FrozenRows, to become the source of its deferred ROWs.
+// Their layout in the new width is computed by _layoutDeferred() and the ROWs themselves are left blank.
+//
+// Returns the first row of oldBuffer that still needs to be reflowed regularly, and state.newY is advanced past
+// the deferred rows. Returns 0 if there's nothing to defer. This expects newBuffer to be freshly reset.
+til::CoordType TextBuffer::_reflowDeferred(const TextBuffer& oldBuffer, TextBuffer& newBuffer, const til::CoordType oldHeight, ReflowState& state)
+{
+    auto split = std::min({ state.oldCursorPos.y, state.mutableViewportTop, state.visibleViewportTop, oldHeight }) - oldBuffer._coldRowDistance;
+    // Just like in _reflowParallel(), the regular reflow needs to start at the beginning of a line.
+    while (split > 0 && oldBuffer._wasWrapForced(split - 1))
+    {
+        --split;
+    }
+    if (split <= 0)
+    {
+        return 0;
+    }
+
+    assert(newBuffer._firstRow == 0 && !newBuffer._deferredReflow);
+
+    auto deferred = std::make_unique<DeferredReflow>();
+    uint16_t firstColumn = 0;
+    til::CoordType y = 0;
+
+    // If oldBuffer is the result of a lazy reflow itself, the source of its deferred ROWs can be reused as is.
+    // This way resizing the window repeatedly doesn't reflow the scrollback at all. Otherwise, the deferred ROWs get
+    // materialized below, which makes a chain of lazy reflows produce the same result as a chain of eager ones.
+    if (const auto& old = oldBuffer._deferredReflow; old && !old->materialized && !old->lossy && oldBuffer._isDeferred(oldBuffer._getRowOffset(0)))
+    {
+        const auto& first = til::at(old->rows, oldBuffer._getRowOffset(0));
+        while (y < split && oldBuffer._isDeferred(oldBuffer._getRowOffset(y)))
+        {
+            ++y;
+        }
+
+        // Since the split is at the beginning of a line, the deferred ROW there begins at the start of a source row.
+        const auto splitOffset = oldBuffer._getRowOffset(y);
+        const size_t sourceEnd = oldBuffer._isDeferred(splitOffset) ? til::at(old->rows, splitOffset).sourceRow : old->source.size();
+        deferred->source.reserve(sourceEnd - first.sourceRow + gsl::narrow_cast<size_t>(split - y));
+        for (auto r = first.sourceRow; r < sourceEnd; ++r)
+        {
+            deferred->source.emplace_back(til::at(old->source, r).Clone(*oldBuffer._attributePalette, *newBuffer._attributePalette));
+        }
+        firstColumn = first.sourceColumn;
+    }
+
+    for (; y < split; ++y)
+    {
+        deferred->source.emplace_back(oldBuffer._copyFrozen(y, *newBuffer._attributePalette));
+    }
+
+    const auto layout = _layoutDeferred(deferred->source, firstColumn, state.newWidth, deferred->lossy);
+    const auto rowCount = gsl::narrow<til::CoordType>(layout.size());
+    const auto newHeight = state.newHeight;
+
+    // Only the last newHeight rows survive in the circular buffer. See the end of _reflow().
+    deferred->rows.resize(gsl::narrow_cast<size_t>(newHeight) + 1);
+    for (auto abs = std::max(0, rowCount - newHeight); abs < rowCount; ++abs)
+    {
+        auto& row = til::at(deferred->rows, gsl::narrow_cast<size_t>(abs % newHeight) + 1);
+        row = til::at(layout, gsl::narrow_cast<size_t>(abs));
+        row.pending = true;
+        deferred->pending++;
+    }
+
+    newBuffer._deferredReflow = std::move(deferred);
+    state.newY = rowCount;
+    return split;
+}
+
+// Computes which rows the source rows produce when reflowed to the given width, and where each of them begins,
+// without copying any text. It mirrors what _reflowRow() does for a buffer without cursor or viewports.
+// lossy is set if reflowing the result again wouldn't produce the same as reflowing the source. See DeferredReflow.
+std::vector<TextBuffer::DeferredRow> TextBuffer::_layoutDeferred(const std::vector<FrozenRow>& source, const uint16_t firstColumn, const til::CoordType newWidth, bool& lossy)
+{
+    std::vector<DeferredRow> rows;
+    til::CoordType newX = 0;
+    // Whether rows.back() is the row that's currently being written.
+    auto open = false;
+    // Whether the text in rows.back() ends in a space.
+    auto endsWithSpace = false;
+
+    for (size_t r = 0; r < source.size(); ++r)
+    {
+        const auto& row = til::at(source, r);
+        const auto sourceRow = gsl::narrow<uint32_t>(r);
+
+        // Rows with a non-standard line rendition are truncated. See _reflowRow().
+        if (row.GetLineRendition() != LineRendition::SingleWidth)
+        {
+            lossy |= row.ColumnCount() > newWidth;
+            // This ends the preceding line, even if it was wrapped. See below for why a space at its end is lossy.
+            lossy |= newX > 0 && endsWithSpace;
+            if (newX)
+            {
+                newX = 0;
+                open = false;
+            }
+            if (!open)
+            {
+                rows.emplace_back(DeferredRow{ .sourceRow = sourceRow });
+            }
+            open = false;
+            continue;
+        }
+
+        const auto limit = row.MeasureRight();
+        til::CoordType oldX = r == 0 ? firstColumn : 0;
+        // The end of the columns whose attributes _reflowRow() copies into the current row.
+        til::CoordType attributesEnd = 0;
+        auto first = true;
+
+        do
+        {
+            if (newX >= newWidth)
+            {
+                rows.back().wrapForced = true;
+                newX = 0;
+                open = false;
+            }
+
+            if (!open)
+            {
+                rows.emplace_back(DeferredRow{ .sourceRow = sourceRow, .sourceColumn = gsl::narrow_cast<uint16_t>(oldX) });
+                open = true;
+                endsWithSpace = false;
+            }
+
+            if (first)
+            {
+                rows.back().hasScrollbarData |= oldX == 0 && row.HasScrollbarData();
+                first = false;
+            }
+
+            attributesEnd = oldX + newWidth - newX;
+            if (oldX < limit)
+            {
+                endsWithSpace = row.EndsWithSpace();
+            }
+
+            // This follows ROW::CopyTextFrom(), which copies as much text as fits, but never half a wide glyph.
+            if (oldX >= limit)
+            {
+                oldX = row.ColumnCount();
+            }
+            else if (limit - oldX <= newWidth - newX)
+            {
+                newX += limit - oldX;
+                oldX = limit;
+            }
+            else
+            {
+                auto end = oldX + newWidth - newX;
+                if (row.IsTrailer(end))
+                {
+                    --end;
+                }
+                oldX = end;
+                newX = newWidth;
+            }
+        } while (oldX < limit);
+
+        if (!row.WasWrapForced())
+        {
+            // The attributes past the end of the text only get copied as far as they fit into the row the text ends on.
+            // The row's attributes are then extended with the last one that fit. Unless that's the same as the attributes
+            // that didn't fit, another reflow of the result can't get them back and one of the source would.
+            lossy |= attributesEnd < row.ColumnCount() && attributesEnd - 1 < row.LastRunBegin();
+            // Similarly, spaces at the end of a wrapped row are kept, unless the line ends right after them.
+            // Then they're trailing whitespace of the row they end up in, which another reflow of the result trims.
+            lossy |= newX > 0 && endsWithSpace;
             newX = 0;
-            newY++;
+            open = false;
+        }
+    }
+
+    return rows;
+}
+
+// Returns a frozen copy of the ROW at the given y for use by _reflowDeferred(), with its attributes interned in
+// `palette`. Frozen ROWs are copied without thawing them. Either way the ROW itself is left as is.
+FrozenRow TextBuffer::_copyFrozen(const til::CoordType y, TextAttributePalette& palette) const
+{
+    const auto offset = _getRowOffset(y);
+    if (offset < _frozenRows.size() && _frozenRows[offset])
+    {
+        return _frozenRows[offset].Clone(*_attributePalette, palette);
+    }
+    return _getRow(y).Freeze(palette);
+}
+
+// Same as GetRowByOffset(y).WasWrapForced(), but without thawing or materializing the ROW.
+bool TextBuffer::_wasWrapForced(const til::CoordType y) const
+{
+    const auto offset = _getRowOffset(y);
+    if (_isDeferred(offset))
+    {
+        return _deferredReflow->rows[offset].wrapForced;
+    }
+    if (offset < _frozenRows.size() && _frozenRows[offset])
+    {
+        return _frozenRows[offset].WasWrapForced();
+    }
+    return _getRow(y).WasWrapForced();
+}
+
+// The counterpart to _reflowDeferred(). It reflows the contents of a deferred ROW from the source
+// rows into its slot in the memory arena. Just like _thaw() this is marked as noinline.
+__declspec(noinline) void TextBuffer::_materialize(size_t offset)
+{
+    auto& deferred = *_deferredReflow;
+    auto& entry = til::at(deferred.rows, offset);
+    auto& target = *reinterpret_cast<ROW*>(_buffer.get() + _bufferRowStride * offset);
+
+    // This ensures that we can simply try again if anything below throws.
+    target.Reset(_initialAttributes);
+
+    ReflowState state{
+        .oldCursorPos = { -1, -1 },
+        .newWidth = _width,
+        .newHeight = til::CoordTypeMax,
+    };
+
+    // _reflowRow() only notices that the target ROW is complete once it wrote past it.
+    // Whatever it writes into the next row ends up in the scratch ROW and is discarded.
+    ScratchRow scratch{ _width, *_attributePalette, _initialAttributes };
+    const auto rowAt = [&](til::CoordType y) -> ROW& {
+        return y == 0 ? target : scratch.row;
+    };
+
+    std::optional<ScratchRow> source;
+    auto oldX = gsl::narrow_cast<til::CoordType>(entry.sourceColumn);
+    for (auto r = entry.sourceRow; r < deferred.source.size() && state.newY == 0; ++r, oldX = 0)
+    {
+        const auto& frozen = til::at(deferred.source, r);
+        const auto columnCount = frozen.ColumnCount();
+        if (!source || source->row.size() != columnCount)
+        {
+            source.emplace(columnCount, *_attributePalette, _initialAttributes);
+        }
+        else
+        {
+            source->row.Reset(_initialAttributes);
+        }
+        source->row.Thaw(frozen, *_attributePalette);
+        _reflowRow(source->row, gsl::narrow_cast<til::CoordType>(r), oldX, _initialAttributes, state, rowAt);
+    }
+
+    // Materialized ROWs are treated like thawed ones, so that _freezeColdRows() eventually freezes them again.
+    _thawedRows.emplace_back(offset);
+
+    entry.pending = false;
+    deferred.materialized = true;
+    if (--deferred.pending == 0)
+    {
+        _releaseDeferred();
+    }
+}
+
+// See Reflow() and ReflowLazily(). segmentCount is the number of pieces the old buffer is split into to be reflowed
+// concurrently. The result is identical regardless of its value. 1 means sequential reflow and 0 picks one automatically.
+void TextBuffer::_reflow(TextBuffer& oldBuffer, TextBuffer& newBuffer, const Viewport* lastCharacterViewport, PositionInformation* positionInfo, size_t segmentCount, const bool lazy)
+{
+    // Splitting the work across threads only pays off for larger buffers.
+    // Below this size the sequential algorithm finishes in about a millisecond.
+    static constexpr til::CoordType parallelMinimumRows = 4096;
+    static constexpr size_t parallelMaximumSegments = 8;
+
+    if (segmentCount == 0)
+    {
+        segmentCount = 1;
+        if (oldBuffer._estimateOffsetOfLastCommittedRow() >= parallelMinimumRows)
+        {
+            segmentCount = std::clamp<size_t>(std::thread::hardware_concurrency(), 1, parallelMaximumSegments);
         }
     }
 
+    const auto& oldCursor = oldBuffer.GetCursor();
+    auto& newCursor = newBuffer.GetCursor();
+
+    til::point oldCursorPos = oldCursor.GetPosition();
+
+    newBuffer._coldRowDistance = oldBuffer._coldRowDistance;
+
+    // BODGY: We use oldCursorPos in two critical places below:
+    // * To compute an oldHeight that includes at a minimum the cursor row
+    // * For REFLOW_JANK_CURSOR_WRAP (see comment in _reflowRow())
+    // Both of these would break the reflow algorithm, but the latter of the two in particular
+    // would cause the main copy loop below to deadlock. In other words, these two lines
+    // protect this function against yet-unknown bugs in other parts of the code base.
+    oldCursorPos.x = std::clamp(oldCursorPos.x, 0, oldBuffer._width - 1);
+    oldCursorPos.y = std::clamp(oldCursorPos.y, 0, oldBuffer._height - 1);
+
+    const auto lastRowWithText = oldBuffer.GetLastNonSpaceCharacter(lastCharacterViewport).y;
+
+    ReflowState state{
+        .oldCursorPos = oldCursorPos,
+        .newWidth = newBuffer.GetSize().Width(),
+        .newHeight = newBuffer.GetSize().Height(),
+        .mutableViewportTop = positionInfo ? positionInfo->mutableViewportTop : til::CoordTypeMax,
+        .visibleViewportTop = positionInfo ? positionInfo->visibleViewportTop : til::CoordTypeMax,
+    };
+
+    const auto oldHeight = std::max(lastRowWithText, oldCursorPos.y) + 1;
+    const auto newHeight = state.newHeight;
+
+    til::CoordType oldY = 0;
+
+    if (lazy)
+    {
+        oldY = _reflowDeferred(oldBuffer, newBuffer, oldHeight, state);
+    }
+
+    if (oldY == 0 && segmentCount > 1 && _reflowParallel(oldBuffer, newBuffer, oldHeight, state, segmentCount))
+    {
+        oldY = oldHeight;
+    }
+    else
+    {
+        const auto rowAt = [&](til::CoordType y) -> ROW& {
+            // If the buffer shrinks vertically, deferred rows may get overwritten. See REFLOW_RESET.
+            newBuffer._discardDeferred(newBuffer._getRowOffset(y));
+            return newBuffer.GetMutableRowByOffset(y);
+        };
+
+        // Copy oldBuffer into newBuffer until oldBuffer has been fully consumed.
+        for (; oldY < oldHeight && state.newY < state.newYLimit; ++oldY)
+        {
+            _reflowRow(oldBuffer.GetRowByOffset(oldY), oldY, 0, newBuffer._initialAttributes, state, rowAt);
+        }
+    }
+
+    auto newY = state.newY;
+    auto newCursorPos = state.newCursorPos;
+
+    if (state.newMutableViewportTop)
+    {
+        positionInfo->mutableViewportTop = *state.newMutableViewportTop;
+    }
+    if (state.newVisibleViewportTop)
+    {
+        positionInfo->visibleViewportTop = *state.newVisibleViewportTop;
+    }
+
     // Finish copying buffer attributes to remaining rows below the last
     // printable character. This is to fix the `color 2f` scenario, where you
     // change the buffer colors then resize and everything below the last
@@ -3050,9 +4523,7 @@ void TextBuffer::Reflow(TextBuffer& oldBuffer, TextBuffer& newBuffer, const View
     {
         auto& oldRow = oldBuffer.GetRowByOffset(oldY);
         auto& newRow = newBuffer.GetMutableRowByOffset(newY);
-        auto& newAttr = newRow.Attributes();
-        newAttr = oldRow.Attributes();
-        newAttr.resize_trailing_extent(newWidthU16);
+        newRow.CopyAttributesToEnd(oldRow, 0, 0);
     }
 
     // Since we didn't use IncrementCircularBuffer() we need to compute the proper
@@ -3068,10 +4539,17 @@ void TextBuffer::Reflow(TextBuffer& oldBuffer, TextBuffer& newBuffer, const View
         newCursorPos.y = (newCursorPos.y - newBuffer._firstRow + newHeight) % newHeight;
     }
 
+    // The new buffer was written directly, bypassing IncrementCircularBuffer(),
+    // which is why we need to populate its cold tier ourselves.
+    for (til::CoordType y = 0, coldRows = newHeight - newBuffer._coldRowDistance; y < coldRows; ++y)
+    {
+        newBuffer._freeze(newBuffer._getRowOffset(y));
+    }
+
     newBuffer.CopyProperties(oldBuffer);
     newBuffer.CopyHyperlinkMaps(oldBuffer);
 
-    assert(newCursorPos.x >= 0 && newCursorPos.x < newWidth);
+    assert(newCursorPos.x >= 0 && newCursorPos.x < state.newWidth);
     assert(newCursorPos.y >= 0 && newCursorPos.y < newHeight);
     newCursor.SetSize(oldCursor.GetSize());
     newCursor.SetPosition(newCursorPos);
@@ -3205,38 +4683,173 @@ std::optional<std::vector<til::point_span>> TextBuffer::SearchText(const std::ws
         return results;
     }
 
-    auto text = ICU::UTextFromTextBuffer(*this, rowBeg, rowEnd);
-
+    const auto caseInsensitive = WI_IsFlagSet(flags, SearchFlag::CaseInsensitive);
+    const auto regularExpression = WI_IsFlagSet(flags, SearchFlag::RegularExpression);
     uint32_t icuFlags{ 0 };
-    WI_SetFlagIf(icuFlags, UREGEX_CASE_INSENSITIVE, WI_IsFlagSet(flags, SearchFlag::CaseInsensitive));
+    WI_SetFlagIf(icuFlags, UREGEX_CASE_INSENSITIVE, caseInsensitive);
+    WI_SetFlag(icuFlags, regularExpression ? UREGEX_MULTILINE : UREGEX_LITERAL);
 
-    if (WI_IsFlagSet(flags, SearchFlag::RegularExpression))
+    // Literal patterns can't fail to compile, so we only need to create the regex upfront for regular expressions.
+    // Literal searches only need it for lines that searchLiteral() can't handle.
+    UErrorCode status = U_ZERO_ERROR;
+    ICU::unique_uregex re;
+    if (regularExpression)
     {
-        WI_SetFlag(icuFlags, UREGEX_MULTILINE);
+        re = ICU::CreateRegex(needle, icuFlags, &status);
+        if (status > U_ZERO_ERROR)
+        {
+            return std::nullopt;
+        }
     }
-    else
+
+    const auto searchRows = [&](til::CoordType beg, til::CoordType end) {
+        if (!re)
+        {
+            re = ICU::CreateRegex(needle, icuFlags, &status);
+        }
+
+        auto text = ICU::UTextFromTextBuffer(*this, beg, end);
+        uregex_setUText(re.get(), &text, &status);
+
+        if (uregex_find(re.get(), -1, &status))
+        {
+            do
+            {
+                results.emplace_back(ICU::BufferRangeFromMatch(&text, re.get()));
+            } while (uregex_findNext(re.get(), &status));
+        }
+    };
+
+    // Needles with newlines may match across lines, which neither the signatures below nor searchLiteral() support.
+    // Surrogates are excluded, because ICU matches code points and wouldn't find a lone surrogate inside a pair.
+    if (regularExpression || std::ranges::any_of(needle, [](wchar_t ch) { return ch == L'\n' || til::is_surrogate(ch); }))
     {
-        WI_SetFlag(icuFlags, UREGEX_LITERAL);
+        searchRows(rowBeg, rowEnd);
+        return results;
     }
 
-    UErrorCode status = U_ZERO_ERROR;
-    const auto re = ICU::CreateRegex(needle, icuFlags, &status);
-    if (status > U_ZERO_ERROR)
+    // Literal needles can't match a line unless all of their bigrams occur in it. The RowSearchSignature of each ROW
+    // lets us skip over all other lines without searching them (or thawing them if they're frozen).
+    // Only the signatures of ROWs that were modified since the last search need to be recomputed.
+    const auto needleSignature = RowSearchSignature::FromText(needle);
+    // searchLiteral() only implements ASCII case folding. ICU handles everything else.
+    const auto literalCaseInsensitive = caseInsensitive && !needleSignature.nonAscii;
+
+    // Adjacent lines that need to go through ICU are coalesced into [icuBeg,icuEnd) to reduce the number of regex calls.
+    auto icuBeg = rowBeg;
+    auto icuEnd = rowBeg;
+
+    for (auto y = rowBeg; y < rowEnd;)
     {
-        return std::nullopt;
+        // Wrapped rows are matched as a single string, so we need to combine their signatures.
+        const auto lineBeg = y;
+        RowSearchSignature line;
+        auto wrapForced = true;
+
+        for (; y < rowEnd && wrapForced; ++y)
+        {
+            line.Append(_getSearchSignature(y, wrapForced));
+        }
+
+        if (!line.MayContain(needleSignature, caseInsensitive))
+        {
+            continue;
+        }
+
+        if (caseInsensitive && (!literalCaseInsensitive || line.nonAscii))
+        {
+            if (lineBeg != icuEnd)
+            {
+                if (icuBeg != icuEnd)
+                {
+                    searchRows(icuBeg, icuEnd);
+                }
+                icuBeg = lineBeg;
+            }
+            icuEnd = y;
+            continue;
+        }
+
+        if (icuBeg != icuEnd)
+        {
+            searchRows(icuBeg, icuEnd);
+            icuBeg = icuEnd;
+        }
+
+        _searchLiteral(needle, caseInsensitive, lineBeg, y, results);
     }
 
-    uregex_setUText(re.get(), &text, &status);
+    if (icuBeg != icuEnd)
+    {
+        searchRows(icuBeg, icuEnd);
+    }
+
+    return results;
+}
+
+// Finds all non-overlapping occurrences of the `needle` in the line consisting of the rows [rowBeg,rowEnd),
+// just like ICU would with UREGEX_LITERAL, but without the overhead of regex and UText.
+// If `caseInsensitive` is true, both the needle and the rows must consist of only ASCII.
+void TextBuffer::_searchLiteral(const std::wstring_view& needle, bool caseInsensitive, til::CoordType rowBeg, til::CoordType rowEnd, std::vector<til::point_span>& results) const
+{
+    // Most lines consist of a single row, the text of which we can search in-place.
+    std::wstring_view haystack;
+    std::wstring wrappedLine;
 
-    if (uregex_find(re.get(), -1, &status))
+    if (rowEnd - rowBeg == 1)
     {
-        do
+        haystack = GetRowByOffset(rowBeg).GetText();
+    }
+    else
+    {
+        for (auto y = rowBeg; y < rowEnd; ++y)
         {
-            results.emplace_back(ICU::BufferRangeFromMatch(&text, re.get()));
-        } while (uregex_findNext(re.get(), &status));
+            wrappedLine.append(GetRowByOffset(y).GetText());
+        }
+        haystack = wrappedLine;
     }
 
-    return results;
+    // Turns an offset into `haystack` into a row and a char offset into that row's text.
+    const auto locate = [&](size_t offset) {
+        auto y = rowBeg;
+        for (;;)
+        {
+            const auto size = GetRowByOffset(y).GetText().size();
+            if (offset < size || y + 1 >= rowEnd)
+            {
+                return std::pair{ y, gsl::narrow_cast<ptrdiff_t>(offset) };
+            }
+            offset -= size;
+            ++y;
+        }
+    };
+
+    findLiteral(haystack, needle, caseInsensitive, [&](size_t offset) {
+        const auto [begY, begOffset] = locate(offset);
+        const auto [endY, endOffset] = locate(offset + needle.size() - 1);
+        results.emplace_back(til::point_span{
+            .start = { GetRowByOffset(begY).GetLeadingColumnAtCharOffset(begOffset), begY },
+            .end = { GetRowByOffset(endY).GetTrailingColumnAtCharOffset(endOffset), endY },
+        });
+    });
+}
+
+// Returns the ROW::GetSearchSignature() of the given row, as well as whether it wraps into the next one.
+// Unlike GetRowByOffset() this doesn't thaw frozen ROWs.
+RowSearchSignature TextBuffer::_getSearchSignature(til::CoordType y, bool& wrapForced) const
+{
+    const auto offset = _getRowOffset(y);
+
+    if (offset < _frozenRows.size() && _frozenRows[offset])
+    {
+        const auto& frozen = _frozenRows[offset];
+        wrapForced = frozen.WasWrapForced();
+        return frozen.GetSearchSignature();
+    }
+
+    const auto& row = _getRow(y);
+    wrapForced = row.WasWrapForced();
+    return row.GetSearchSignature();
 }
 
 // Collect up all the rows that were marked, and the data marked on that row.
@@ -3247,6 +4860,12 @@ std::vector<ScrollMark> TextBuffer::GetMarkRows() const
     const auto bottom = _estimateOffsetOfLastCommittedRow();
     for (auto y = 0; y <= bottom; y++)
     {
+        // Deferred ROWs know whether they have a mark without being materialized.
+        if (const auto offset = _getRowOffset(y); _isDeferred(offset) && !_deferredReflow->rows[offset].hasScrollbarData)
+        {
+            continue;
+        }
+
         const auto& row = GetRowByOffset(y);
         const auto& data{ row.GetScrollbarData() };
         if (data.has_value())
@@ -3328,12 +4947,8 @@ void TextBuffer::ClearMarksInRange(
     for (auto y = top; y <= bottom; y++)
     {
         auto& row = GetMutableRowByOffset(y);
-        auto& runs = row.Attributes().runs();
         row.SetScrollbarData(std::nullopt);
-        for (auto& [attr, length] : runs)
-        {
-            attr.SetMarkAttributes(MarkKind::None);
-        }
+        row.SetMarkAttributes(MarkKind::None);
     }
 }
 void TextBuffer::ClearAllMarks()
@@ -3632,8 +5247,5 @@ void TextBuffer::SetScrollbarData(ScrollbarData mark, til::CoordType y)
 void TextBuffer::ManuallyMarkRowAsPrompt(til::CoordType y)
 {
     auto& row = GetMutableRowByOffset(y);
-    for (auto& [attr, len] : row.Attributes().runs())
-    {
-        attr.SetMarkAttributes(MarkKind::Prompt);
-    }
+    row.SetMarkAttributes(MarkKind::Prompt);
 }
@@ -52,6 +52,7 @@ filling in the last row, and updating the screen.
 #include "cursor.h"
 #include "Row.hpp"
 #include "TextAttribute.hpp"
+#include "TextAttributePalette.hpp"
 #include "../types/inc/Viewport.hpp"
 
 #include "../buffer/out/textBufferCellIterator.hpp"
@@ -81,6 +82,13 @@ public:
 
     ~TextBuffer();
 
+    size_t GetCommittedBytes() const noexcept;
+
+    // Rows further than this from the bottom of the buffer are moved into the cold tier. See _frozenRows.
+    static constexpr til::CoordType DefaultColdRowDistance = 1024;
+    til::CoordType GetColdRowDistance() const noexcept;
+    void SetColdRowDistance(til::CoordType distance) noexcept;
+
     // Used for duplicating properties to another text buffer
     void CopyProperties(const TextBuffer& OtherBuffer) noexcept;
 
@@ -109,6 +117,7 @@ public:
     void Replace(til::CoordType row, const TextAttribute& attributes, RowWriteState& state);
     void Insert(til::CoordType row, const TextAttribute& attributes, RowWriteState& state);
     void FillRect(const til::rect& rect, const std::wstring_view& fill, const TextAttribute& attributes);
+    void CopyRect(const TextBuffer& source, const til::rect& sourceRect, til::point target);
 
     OutputCellIterator Write(const OutputCellIterator givenIt);
 
@@ -135,11 +144,15 @@ public:
     const Cursor& GetCursor() const noexcept;
 
     uint64_t GetLastMutationId() const noexcept;
+    uint64_t GetMutationSnapshot() const noexcept;
+    uint64_t TakeMutationSnapshot() noexcept;
+    void GetRowsMutatedSince(uint64_t mutationId, til::CoordType rowBeg, til::CoordType rowEnd, std::vector<til::CoordType>& rows) const;
     const til::CoordType GetFirstRowIndex() const noexcept;
 
     const Microsoft::Console::Types::Viewport GetSize() const noexcept;
 
     void ScrollRows(const til::CoordType firstRow, const til::CoordType size, const til::CoordType delta);
+    void RotateRows(const til::CoordType firstRow, const til::CoordType size, const til::CoordType delta);
 
     til::CoordType TotalRowCount() const noexcept;
 
@@ -284,7 +297,29 @@ public:
                        const bool isIntenseBold,
                        std::function<std::tuple<COLORREF, COLORREF, COLORREF>(const TextAttribute&)> GetAttributeColors) const noexcept;
 
+    // The state of a Serialize() that was split up into multiple SerializeRows() calls.
+    struct SerializeState
+    {
+        // The next row to be serialized.
+        til::CoordType row = 0;
+        // The number of wchar_t that were serialized so far, including the BOM.
+        uint64_t written = 0;
+        CharacterAttributes previousAttr = CharacterAttributes::Unused1;
+        TextColor previousFg;
+        TextColor previousBg;
+        TextColor previousUl;
+        uint16_t previousHyperlinkId = 0;
+        bool delayedLineBreak = false;
+    };
+
     void Serialize(const wchar_t* destination) const;
+    bool SerializeRows(SerializeState& state, std::wstring& buffer, size_t threshold, SerializeState* resume = nullptr) const;
+    bool CanResumeSerialization(const SerializeState& state) const;
+
+    void SaveSnapshot(const wchar_t* destination) const;
+    std::vector<std::byte> SaveSnapshot() const;
+    bool LoadSnapshot(const wchar_t* source);
+    bool LoadSnapshot(const std::span<const std::byte>& data);
 
     struct PositionInformation
     {
@@ -293,6 +328,7 @@ public:
     };
 
     static void Reflow(TextBuffer& oldBuffer, TextBuffer& newBuffer, const Microsoft::Console::Types::Viewport* lastCharacterViewport = nullptr, PositionInformation* positionInfo = nullptr);
+    static void ReflowLazily(TextBuffer& oldBuffer, TextBuffer& newBuffer, const Microsoft::Console::Types::Viewport* lastCharacterViewport = nullptr, PositionInformation* positionInfo = nullptr);
 
     std::optional<std::vector<til::point_span>> SearchText(const std::wstring_view& needle, SearchFlag flags) const;
     std::optional<std::vector<til::point_span>> SearchText(const std::wstring_view& needle, SearchFlag flags, til::CoordType rowBeg, til::CoordType rowEnd) const;
@@ -315,12 +351,42 @@ private:
     void _reserve(til::size screenBufferSize, const TextAttribute& defaultAttributes);
     void _commit(const std::byte* row);
     void _decommit() noexcept;
-    void _construct(const std::byte* until) noexcept;
+    void _construct(const std::byte* until);
+    ROW* _constructRow(std::byte* row) const;
     void _destroy() const noexcept;
     ROW& _getRowByOffsetDirect(size_t offset);
+    size_t _getRowOffset(til::CoordType y) const noexcept;
+    til::CoordType _getRowFromOffset(size_t offset) const noexcept;
     ROW& _getRow(til::CoordType y) const;
+    void _markMutated(ROW& row) noexcept;
+    void _collectAttributes() noexcept;
+    void _invalidateColumns(ROW& row, til::CoordType columnBegin, til::CoordType columnEnd) noexcept;
+    RowSearchSignature _getSearchSignature(til::CoordType y, bool& wrapForced) const;
+    void _searchLiteral(const std::wstring_view& needle, bool caseInsensitive, til::CoordType rowBeg, til::CoordType rowEnd, std::vector<til::point_span>& results) const;
+    void _freeze(size_t offset) noexcept;
+    void _thaw(size_t offset);
+    void _discardFrozen(size_t offset);
+    bool _isFrozenPage(const std::byte* page) const noexcept;
+    void _decommitFrozenPages(const std::byte* row) noexcept;
+    void _recommitFrozenPages(const std::byte* row);
+    void _freezeColdRows() noexcept;
     til::CoordType _estimateOffsetOfLastCommittedRow() const noexcept;
 
+    struct ReflowState;
+    struct DeferredRow;
+    static void _reflow(TextBuffer& oldBuffer, TextBuffer& newBuffer, const Microsoft::Console::Types::Viewport* lastCharacterViewport, PositionInformation* positionInfo, size_t segmentCount, bool lazy);
+    template<typename RowAt>
+    static void _reflowRow(const ROW& oldRow, til::CoordType oldY, til::CoordType oldX, const TextAttribute& initialAttributes, ReflowState& state, RowAt&& rowAt);
+    static bool _reflowParallel(TextBuffer& oldBuffer, TextBuffer& newBuffer, til::CoordType oldHeight, ReflowState& state, size_t segmentCount);
+    static til::CoordType _reflowDeferred(const TextBuffer& oldBuffer, TextBuffer& newBuffer, til::CoordType oldHeight, ReflowState& state);
+    static std::vector<DeferredRow> _layoutDeferred(const std::vector<FrozenRow>& source, uint16_t firstColumn, til::CoordType newWidth, bool& lossy);
+    FrozenRow _copyFrozen(til::CoordType y, TextAttributePalette& palette) const;
+    bool _wasWrapForced(til::CoordType y) const;
+    bool _isDeferred(size_t offset) const noexcept;
+    void _materialize(size_t offset);
+    void _discardDeferred(size_t offset) noexcept;
+    void _releaseDeferred() noexcept;
+
     void _SetFirstRowIndex(const til::CoordType FirstRowIndex) noexcept;
     til::point _GetPreviousFromCursor() const;
     void _SetWrapOnCurrentRow();
@@ -389,6 +455,8 @@ private:
     // There's probably a better metric than this. (This comment was written when ROW had both,
     // a _chars array containing text and a _charOffsets array contain column-to-text indices.)
     static constexpr size_t _commitReadAheadRowCount = 128;
+    // This is the page size on all architectures we support. See _decommitFrozenPages().
+    static constexpr uintptr_t _pageSize = 4096;
     // Before TextBuffer was made to use virtual memory it initialized the entire memory arena with the initial
     // attributes right away. To ensure it continues to work the way it used to, this stores these initial attributes.
     TextAttribute _initialAttributes;
@@ -401,6 +469,66 @@ private:
     size_t _bufferRowStride = 0;
     size_t _bufferOffsetChars = 0;
     size_t _bufferOffsetCharOffsets = 0;
+    // The cold scrollback tier. ROWs that are more than _coldRowDistance rows away from the bottom of the buffer
+    // get frozen into a FrozenRow (see ROW::Freeze()) by IncrementCircularBuffer(). A frozen ROW gets destroyed
+    // and its slot in the memory arena holds garbage until it gets thawed again by _getRowByOffsetDirect(),
+    // which happens transparently whenever something accesses it. Memory pages that are fully covered by frozen
+    // ROWs are MEM_DECOMMITted, which returns them to the OS and lowers our commit charge. _thaw() commits them again.
+    //
+    // _frozenRows is indexed the same way as _getRowByOffsetDirect() and is empty until the first ROW is frozen.
+    std::vector<FrozenRow> _frozenRows;
+    // Offsets of ROWs that got thawed, because something read them (search, copy, scrolling up, etc.).
+    // Once there are more than _coldRowDistance of them, the oldest half gets frozen again.
+    std::vector<size_t> _thawedRows;
+    // The TextAttributes of all ROWs, deduplicated. ROWs and FrozenRows only store indices into this palette.
+    // It's allocated separately, so that its address stays the same when ResizeTraditional() moves it over.
+    //
+    // Hot ROWs don't hold a reference count on their entries, because counting them on every write would
+    // be expensive. Instead, GetMutableRowByOffset() calls _collectAttributes() whenever the palette grew to
+    // _attributeCollectThreshold entries, which frees all entries that no ROW uses anymore (a mark and sweep).
+    // Afterwards the threshold is set to twice the number of surviving entries, which amortizes the cost of
+    // marking all ROWs over the attributes that were added in the meantime.
+    std::unique_ptr<TextAttributePalette> _attributePalette = std::make_unique<TextAttributePalette>();
+    static constexpr size_t _attributeCollectMinimum = 1024;
+    size_t _attributeCollectThreshold = _attributeCollectMinimum;
+    // RotateRows() moves ROWs around without copying them, by permuting which slot in the memory arena holds
+    // which row of the circular buffer. _rowMap[i] is the slot of the i-th row of the circular buffer (minus the
+    // scratchpad row) and is applied by _getRowOffset(), so everything indexed by slot offset moves along with
+    // the ROW, like _frozenRows or the deferred reflow state. It's empty (the identity) until the first rotation.
+    std::vector<uint16_t> _rowMap;
+    // The inverse of _rowMap, which maps slots back to rows of the circular buffer. See _getRowFromOffset().
+    std::vector<uint16_t> _rowMapInverse;
+
+    // ReflowLazily() only reflows the rows near the viewport right away. The ROWs further up in the scrollback
+    // are blank and marked as deferred instead. Their contents get reflowed from `source` by _materialize()
+    // once something reads them, just like frozen ROWs get thawed. The source consists of frozen copies of the
+    // old buffer's rows in their original width, which is why resizing repeatedly doesn't reflow the scrollback.
+    struct DeferredRow
+    {
+        // Where in DeferredReflow::source the contents of this ROW begin.
+        uint32_t sourceRow = 0;
+        uint16_t sourceColumn = 0;
+        // These are known without materializing the ROW. See _wasWrapForced() and GetMarkRows().
+        bool wrapForced = false;
+        bool hasScrollbarData = false;
+        bool pending = false;
+    };
+    struct DeferredReflow
+    {
+        std::vector<FrozenRow> source;
+        // Indexed the same way as _frozenRows.
+        std::vector<DeferredRow> rows;
+        size_t pending = 0;
+        // Set once any ROW got materialized. After that the next reflow can't reuse `source` anymore,
+        // because the materialized ROWs may have been modified in the meantime.
+        bool materialized = false;
+        // Set if the layout in this buffer's width drops something an eager reflow would lose for good, like the text
+        // of a truncated DoubleWidth row or trailing whitespace. The next reflow can't reuse `source` then either.
+        // See _layoutDeferred().
+        bool lossy = false;
+    };
+    std::unique_ptr<DeferredReflow> _deferredReflow;
+    til::CoordType _coldRowDistance = DefaultColdRowDistance;
     // The width of the buffer in columns.
     uint16_t _width = 0;
     // The height of the buffer in rows, excluding the scratchpad row.
@@ -409,11 +537,20 @@ private:
     TextAttribute _currentAttributes;
     til::CoordType _firstRow = 0; // indexes top row (not necessarily 0)
     uint64_t _lastMutationId = 0;
+    // The value of _lastMutationId at the last TakeMutationSnapshot() call. ROWs that were mutated
+    // after it carry a larger mutation id, which is how GetRowsMutatedSince() finds them.
+    uint64_t _mutationSnapshot = 0;
+    // The lowest row index that was passed to GetMutableRowByOffset() since the last SerializeRows() call.
+    // This tells us whether an earlier serialization can be resumed, see CanResumeSerialization().
+    // Anything that moves rows around (IncrementCircularBuffer(), ScrollRows(), etc.) mutates them in the process,
+    // so this also catches scrolling. It's mutable, because SerializeRows() is otherwise a const operation.
+    mutable til::CoordType _lowestMutatedRow = 0;
 
     Cursor _cursor;
     bool _isActiveBuffer = false;
 
 #ifdef UNIT_TESTING
+    friend class ReflowTests;
     friend class TextBufferTests;
     friend class UiaTextRangeTests;
 #endif
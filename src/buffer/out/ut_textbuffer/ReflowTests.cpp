@@ -11,6 +11,8 @@
 
 #include <IDataSource.h>
 
+#include <random>
+
 template<>
 class WEX::TestExecution::VerifyOutputTraits<wchar_t>
 {
@@ -726,10 +728,43 @@ class ReflowTests
     static std::unique_ptr<TextBuffer> _textBufferByReflowingTextBuffer(TextBuffer& originalBuffer, const til::size newSize)
     {
         auto buffer = std::make_unique<TextBuffer>(newSize, TextAttribute{ 0x7 }, 0, false, renderer);
-        TextBuffer::Reflow(originalBuffer, *buffer);
+        TextBuffer::_reflow(originalBuffer, *buffer, nullptr, nullptr, 1, false);
+
+        // The test cases are tiny, but the parallel reflow splits them up all the same.
+        TextBuffer parallel{ newSize, TextAttribute{ 0x7 }, 0, false, renderer };
+        TextBuffer::_reflow(originalBuffer, parallel, nullptr, nullptr, 3, false);
+        _compareTextBuffers(*buffer, parallel);
+
         return buffer;
     }
 
+    static void _compareTextBuffers(const TextBuffer& expected, const TextBuffer& actual)
+    {
+        VERIFY_ARE_EQUAL(expected.GetCursor().GetPosition(), actual.GetCursor().GetPosition());
+        VERIFY_ARE_EQUAL(expected.GetSize().Dimensions(), actual.GetSize().Dimensions());
+
+        const auto size = expected.GetSize().Dimensions();
+        for (til::CoordType y = 0; y < size.height; ++y)
+        {
+            NoThrowString indexString;
+            indexString.Format(L"[Row %d]", y);
+
+            const auto& expectedRow = expected.GetRowByOffset(y);
+            const auto& actualRow = actual.GetRowByOffset(y);
+
+            VERIFY_ARE_EQUAL(expectedRow.GetText(), actualRow.GetText(), indexString);
+            VERIFY_ARE_EQUAL(expectedRow.WasWrapForced(), actualRow.WasWrapForced(), indexString);
+            VERIFY_IS_TRUE(expectedRow.GetLineRendition() == actualRow.GetLineRendition(), indexString);
+            VERIFY_IS_TRUE(expectedRow.Attributes() == actualRow.Attributes(), indexString);
+            VERIFY_ARE_EQUAL(expectedRow.GetScrollbarData().has_value(), actualRow.GetScrollbarData().has_value(), indexString);
+
+            for (til::CoordType x = 0; x < size.width; ++x)
+            {
+                VERIFY_IS_TRUE(expectedRow.DbcsAttrAt(x) == actualRow.DbcsAttrAt(x), indexString);
+            }
+        }
+    }
+
     static void _compareTextBufferAgainstTestBuffer(const TextBuffer& buffer, const TestBuffer& testBuffer)
     {
         VERIFY_ARE_EQUAL(testBuffer.cursor, buffer.GetCursor().GetPosition());
@@ -805,6 +840,247 @@ class ReflowTests
             _compareTextBufferAgainstTestBuffer(*textBuffer, testBuffer);
         }
     }
+
+    TEST_METHOD(MarksStayOnTheirText)
+    {
+        const auto oldBuffer = _textBufferFromTestBuffer(TestBuffer{
+            { 4, 4 },
+            {
+                { L"abcd", true },
+                { L"efgh", false },
+                { L"ij  ", false },
+                { L"kl  ", false },
+            },
+            { 0, 3 },
+        });
+        for (til::CoordType y = 1; y < 4; ++y)
+        {
+            oldBuffer->GetMutableRowByOffset(y).SetScrollbarData(ScrollbarData{ .category = MarkCategory::Prompt });
+        }
+
+        // "efgh" continues "abcd" on the next row, after "cd" filled the row before it. The result is 6 rows long,
+        // which means that the last 2 rows wrap around and overwrite the first 2 in the circular buffer.
+        TextBuffer newBuffer{ { 2, 4 }, TextAttribute{ 0x7 }, 0, false, renderer };
+        TextBuffer::Reflow(*oldBuffer, newBuffer);
+
+        static constexpr std::wstring_view expectedText[]{ L"ef", L"gh", L"ij", L"kl" };
+        static constexpr bool expectedMark[]{ true, false, true, true };
+        for (til::CoordType y = 0; y < 4; ++y)
+        {
+            const auto& row = newBuffer.GetRowByOffset(y);
+            VERIFY_ARE_EQUAL(til::at(expectedText, y), row.GetText());
+            VERIFY_ARE_EQUAL(til::at(expectedMark, y), row.GetScrollbarData().has_value());
+        }
+    }
+
+    // Fills the given buffer with random text, attributes, line renditions and marks and puts the cursor somewhere
+    // in it. Returns the number of rows that were written. The result only depends on the state of `rng`.
+    static til::CoordType _fillTextBufferRandomly(TextBuffer& buffer, std::mt19937& rng)
+    {
+        static constexpr std::wstring_view glyphs[]{ L"a", L"b", L" ", L"\u732B", L"\U0001F600" };
+
+        const auto random = [&](int min, int max) {
+            return std::uniform_int_distribution<int>{ min, max }(rng);
+        };
+
+        const auto size = buffer.GetSize().Dimensions();
+        const auto rows = random(1, size.height);
+        for (til::CoordType y = 0; y < rows; ++y)
+        {
+            std::wstring text;
+            for (auto i = random(0, size.width); i > 0; --i)
+            {
+                text.append(til::at(glyphs, random(0, 4)));
+            }
+
+            RowWriteState state{ .text = text };
+            auto& row = buffer.GetMutableRowByOffset(y);
+            row.ReplaceText(state);
+            row.ReplaceAttributes(random(0, size.width / 2), random(size.width / 2, size.width), TextAttribute{ gsl::narrow_cast<WORD>(random(1, 0xff)) });
+            row.SetWrapForced(random(0, 3) != 0);
+
+            switch (random(0, 20))
+            {
+            case 0:
+                row.SetLineRendition(LineRendition::DoubleWidth);
+                break;
+            case 1:
+                row.SetScrollbarData(ScrollbarData{ .category = MarkCategory::Prompt });
+                break;
+            default:
+                break;
+            }
+        }
+
+        buffer.GetCursor().SetPosition({ random(0, size.width - 1), random(0, rows - 1) });
+        return rows;
+    }
+
+    static constexpr til::size _randomReflowSizes(const til::size oldSize, size_t i) noexcept
+    {
+        switch (i)
+        {
+        case 0:
+            return { oldSize.width / 2, oldSize.height };
+        case 1:
+            return { oldSize.width * 2, oldSize.height };
+        case 2:
+            return { oldSize.width - 1, oldSize.height / 4 };
+        default:
+            return { oldSize.width + 3, oldSize.height / 2 };
+        }
+    }
+
+    TEST_METHOD(ParallelReflowMatchesSequential)
+    {
+        WEX::TestExecution::DisableVerifyExceptions disableVerifyExceptions{};
+        WEX::TestExecution::SetVerifyOutput verifyOutputScope{ WEX::TestExecution::VerifyOutputSettings::LogOnlyFailures };
+
+        for (uint32_t seed = 0; seed < 16; ++seed)
+        {
+            std::mt19937 rng{ seed };
+            const til::size oldSize{
+                std::uniform_int_distribution<int>{ 10, 40 }(rng),
+                std::uniform_int_distribution<int>{ 50, 200 }(rng),
+            };
+            TextBuffer oldBuffer{ oldSize, TextAttribute{ 0x7 }, 0, false, renderer };
+            const auto rows = _fillTextBufferRandomly(oldBuffer, rng);
+
+            for (size_t i = 0; i < 4; ++i)
+            {
+                const auto newSize = _randomReflowSizes(oldSize, i);
+                Log::Comment(NoThrowString().Format(L"seed %u: %dx%d -> %dx%d", seed, oldSize.width, oldSize.height, newSize.width, newSize.height));
+
+                TextBuffer::PositionInformation expectedPositionInfo{ rows / 3, rows / 2 };
+                TextBuffer expected{ newSize, TextAttribute{ 0x7 }, 0, false, renderer };
+                TextBuffer::_reflow(oldBuffer, expected, nullptr, &expectedPositionInfo, 1, false);
+
+                for (const size_t segmentCount : { 2, 3, 7 })
+                {
+                    TextBuffer::PositionInformation actualPositionInfo{ rows / 3, rows / 2 };
+                    TextBuffer actual{ newSize, TextAttribute{ 0x7 }, 0, false, renderer };
+                    TextBuffer::_reflow(oldBuffer, actual, nullptr, &actualPositionInfo, segmentCount, false);
+
+                    _compareTextBuffers(expected, actual);
+                    VERIFY_ARE_EQUAL(expectedPositionInfo.mutableViewportTop, actualPositionInfo.mutableViewportTop);
+                    VERIFY_ARE_EQUAL(expectedPositionInfo.visibleViewportTop, actualPositionInfo.visibleViewportTop);
+                }
+            }
+        }
+    }
+
+    TEST_METHOD(LazyReflowMatchesEager)
+    {
+        WEX::TestExecution::DisableVerifyExceptions disableVerifyExceptions{};
+        WEX::TestExecution::SetVerifyOutput verifyOutputScope{ WEX::TestExecution::VerifyOutputSettings::LogOnlyFailures };
+
+        size_t deferredCount = 0;
+
+        for (uint32_t seed = 0; seed < 16; ++seed)
+        {
+            for (size_t i = 0; i < 4; ++i)
+            {
+                std::mt19937 rng{ seed };
+                const til::size oldSize{
+                    std::uniform_int_distribution<int>{ 10, 40 }(rng),
+                    std::uniform_int_distribution<int>{ 50, 200 }(rng),
+                };
+                const auto newSize = _randomReflowSizes(oldSize, i);
+                Log::Comment(NoThrowString().Format(L"seed %u: %dx%d -> %dx%d", seed, oldSize.width, oldSize.height, newSize.width, newSize.height));
+
+                // ReflowLazily() must leave the old buffer intact. A second, identical one lets us verify that.
+                auto lazyRng = rng;
+                TextBuffer eagerOld{ oldSize, TextAttribute{ 0x7 }, 0, false, renderer };
+                TextBuffer lazyOld{ oldSize, TextAttribute{ 0x7 }, 0, false, renderer };
+                const auto rows = _fillTextBufferRandomly(eagerOld, rng);
+                _fillTextBufferRandomly(lazyOld, lazyRng);
+
+                // Defer as much as possible and exercise the path that copies frozen rows.
+                lazyOld._coldRowDistance = 4;
+                for (til::CoordType y = 0; y < rows / 2; y += 2)
+                {
+                    lazyOld._freeze(lazyOld._getRowOffset(y));
+                }
+
+                TextBuffer::PositionInformation expectedPositionInfo{ rows / 3, rows / 2 };
+                TextBuffer expected{ newSize, TextAttribute{ 0x7 }, 0, false, renderer };
+                TextBuffer::_reflow(eagerOld, expected, nullptr, &expectedPositionInfo, 1, false);
+
+                TextBuffer::PositionInformation actualPositionInfo{ rows / 3, rows / 2 };
+                TextBuffer actual{ newSize, TextAttribute{ 0x7 }, 0, false, renderer };
+                TextBuffer::_reflow(lazyOld, actual, nullptr, &actualPositionInfo, 1, true);
+
+                if (actual._deferredReflow)
+                {
+                    deferredCount++;
+                }
+
+                _compareTextBuffers(expected, actual);
+                VERIFY_ARE_EQUAL(expectedPositionInfo.mutableViewportTop, actualPositionInfo.mutableViewportTop);
+                VERIFY_ARE_EQUAL(expectedPositionInfo.visibleViewportTop, actualPositionInfo.visibleViewportTop);
+
+                // Reading every row materializes them all, after which the source is released.
+                VERIFY_IS_NULL(actual._deferredReflow.get());
+
+                _compareTextBuffers(eagerOld, lazyOld);
+            }
+        }
+
+        VERIFY_IS_GREATER_THAN(deferredCount, 0u);
+    }
+
+    TEST_METHOD(ChainedLazyReflowMatchesEager)
+    {
+        WEX::TestExecution::DisableVerifyExceptions disableVerifyExceptions{};
+        WEX::TestExecution::SetVerifyOutput verifyOutputScope{ WEX::TestExecution::VerifyOutputSettings::LogOnlyFailures };
+
+        size_t reusedCount = 0;
+
+        for (uint32_t seed = 0; seed < 16; ++seed)
+        {
+            std::mt19937 rng{ seed };
+            const til::size oldSize{
+                std::uniform_int_distribution<int>{ 10, 40 }(rng),
+                std::uniform_int_distribution<int>{ 50, 200 }(rng),
+            };
+
+            auto lazyRng = rng;
+            auto eager = std::make_unique<TextBuffer>(oldSize, TextAttribute{ 0x7 }, 0, false, renderer);
+            auto lazy = std::make_unique<TextBuffer>(oldSize, TextAttribute{ 0x7 }, 0, false, renderer);
+            _fillTextBufferRandomly(*eager, rng);
+            _fillTextBufferRandomly(*lazy, lazyRng);
+            lazy->_coldRowDistance = 4;
+
+            // None of the rows are read until all resizes are done. Each lazy reflow after the first
+            // one starts out with the deferred rows of the previous one and may reuse their source.
+            for (auto i = 0; i < 4; ++i)
+            {
+                const auto newSize = _randomReflowSizes(oldSize, std::uniform_int_distribution<size_t>{ 0, 3 }(rng));
+                Log::Comment(NoThrowString().Format(L"seed %u: resize %d to %dx%d", seed, i, newSize.width, newSize.height));
+
+                auto newEager = std::make_unique<TextBuffer>(newSize, TextAttribute{ 0x7 }, 0, false, renderer);
+                TextBuffer::_reflow(*eager, *newEager, nullptr, nullptr, 1, false);
+
+                const auto& old = lazy->_deferredReflow;
+                const auto reusable = old && !old->materialized && !old->lossy;
+                auto newLazy = std::make_unique<TextBuffer>(newSize, TextAttribute{ 0x7 }, 0, false, renderer);
+                newLazy->_coldRowDistance = 4;
+                TextBuffer::_reflow(*lazy, *newLazy, nullptr, nullptr, 1, true);
+
+                if (reusable && newLazy->_deferredReflow)
+                {
+                    reusedCount++;
+                }
+
+                eager = std::move(newEager);
+                lazy = std::move(newLazy);
+            }
+
+            _compareTextBuffers(*eager, *lazy);
+        }
+
+        VERIFY_IS_GREATER_THAN(reusedCount, 0u);
+    }
 };
 
 DummyRenderer ReflowTests::renderer{};
@@ -633,18 +633,30 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
                 }
             }
 
-            const auto result{ til::u8u16(std::string_view{ _buffer.data(), read }, _u16Str, _u8State) };
-            if (FAILED(result))
+            // If someone parses our output as UTF-8, we skip transcoding it entirely.
+            const auto utf8 = static_cast<bool>(TerminalOutputUtf8);
+            if (utf8)
             {
-                // EXIT POINT
-                _indicateExitWithStatus(result); // print a message
-                _transitionToState(ConnectionState::Failed);
-                return gsl::narrow_cast<DWORD>(result);
+                if (read == 0)
+                {
+                    return 0;
+                }
             }
-
-            if (_u16Str.empty())
+            else
             {
-                return 0;
+                const auto result{ til::u8u16(std::string_view{ _buffer.data(), read }, _u16Str, _u8State) };
+                if (FAILED(result))
+                {
+                    // EXIT POINT
+                    _indicateExitWithStatus(result); // print a message
+                    _transitionToState(ConnectionState::Failed);
+                    return gsl::narrow_cast<DWORD>(result);
+                }
+
+                if (_u16Str.empty())
+                {
+                    return 0;
+                }
             }
 
             if (!_receivedFirstByte)
@@ -664,7 +676,15 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
             }
 
             // Pass the output to our registered event handlers
-            TerminalOutput.raise(_u16Str);
+            if (utf8)
+            {
+#pragma warning(suppress : 26490) // Don't use reinterpret_cast (type.1).
+                TerminalOutputUtf8.raise(winrt::array_view<const uint8_t>{ reinterpret_cast<const uint8_t*>(_buffer.data()), read });
+            }
+            else
+            {
+                TerminalOutput.raise(_u16Str);
+            }
         }
 
         return 0;
@@ -58,6 +58,7 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
                                                                          const winrt::guid& profileGuid);
 
         til::event<TerminalOutputHandler> TerminalOutput;
+        til::event<TerminalOutputUtf8Handler> TerminalOutputUtf8;
 
     private:
         static void closePseudoConsoleAsync(HPCON hPC) noexcept;
@@ -4,6 +4,8 @@
 #include "pch.h"
 #include "ControlCore.h"
 
+#include <condition_variable>
+
 // MidiAudio
 #include <mmeapi.h>
 #include <dsound.h>
@@ -31,6 +33,11 @@ using namespace winrt::Windows::ApplicationModel::DataTransfer;
 
 namespace winrt::Microsoft::Terminal::Control::implementation
 {
+    // The number of PersistToPath() background threads that are still running, across all ControlCores.
+    static std::mutex s_persistenceLock;
+    static std::condition_variable s_persistenceDone;
+    static size_t s_persistencePending = 0;
+
     static winrt::Microsoft::Terminal::Core::OptionalColor OptionalFromColor(const til::color& c) noexcept
     {
         Core::OptionalColor result;
@@ -239,6 +246,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         // revoke ALL old handlers immediately
 
         _connectionOutputEventRevoker.revoke();
+        _connectionOutputUtf8EventRevoker.revoke();
         _connectionStateChangedRevoker.revoke();
 
         _connection = newConnection;
@@ -267,6 +275,11 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 
             // This event is explicitly revoked in the destructor: does not need weak_ref
             _connectionOutputEventRevoker = _connection.TerminalOutput(winrt::auto_revoke, { this, &ControlCore::_connectionOutputHandler });
+            // Connections with UTF-8 output (ConPTY) hand it to the parser without transcoding it first.
+            if (const auto utf8 = _connection.try_as<TerminalConnection::ITerminalConnectionUtf8>())
+            {
+                _connectionOutputUtf8EventRevoker = utf8.TerminalOutputUtf8(winrt::auto_revoke, { this, &ControlCore::_connectionOutputUtf8Handler });
+            }
         }
 
         // Fire off a connection state changed notification, to let our hosting
@@ -1748,15 +1761,71 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 
             // Stop accepting new output and state changes before we disconnect everything.
             _connectionOutputEventRevoker.revoke();
+            _connectionOutputUtf8EventRevoker.revoke();
             _connectionStateChangedRevoker.revoke();
             _connection.Close();
         }
     }
 
+    // Persisting a buffer with 100k rows takes a while, most of which is spent encoding and writing it.
+    // This happens on a background thread, so that closing a window doesn't stall its UI thread and so that
+    // multiple panes get persisted in parallel. Call WaitForPersistence() before exiting the process.
+    //
+    // A later call cancels the previous one for this control, because both write to the same file. The previous
+    // call finishes writing its current chunk of rows and the later one then overwrites it or appends to it.
     void ControlCore::PersistToPath(const wchar_t* path) const
     {
-        const auto lock = _terminal->LockForReading();
-        _terminal->SerializeMainBuffer(path);
+        _persistenceStop.request_stop();
+        _persistenceStop = {};
+
+        {
+            const std::scoped_lock lock{ s_persistenceLock };
+            s_persistencePending++;
+        }
+
+        const auto done = [] {
+            {
+                const std::scoped_lock lock{ s_persistenceLock };
+                s_persistencePending--;
+            }
+            s_persistenceDone.notify_all();
+        };
+
+        try
+        {
+            std::thread{ [terminal = _terminal, persistence = _persistence, path = std::wstring{ path }, token = _persistenceStop.get_token(), done]() {
+                {
+                    const std::scoped_lock lock{ persistence->lock };
+
+                    // The checkpoint only applies to the file it was made for.
+                    if (persistence->path != path)
+                    {
+                        persistence->path = path;
+                        persistence->checkpoint = {};
+                    }
+
+                    try
+                    {
+                        terminal->SerializeMainBuffer(path.c_str(), persistence->checkpoint, token);
+                    }
+                    CATCH_LOG();
+                }
+
+                done();
+            } }.detach();
+        }
+        catch (...)
+        {
+            LOG_CAUGHT_EXCEPTION();
+            done();
+        }
+    }
+
+    // Blocks until all outstanding PersistToPath() calls have finished writing their files.
+    void ControlCore::WaitForPersistence()
+    {
+        std::unique_lock lock{ s_persistenceLock };
+        s_persistenceDone.wait(lock, [] { return s_persistencePending == 0; });
     }
 
     void ControlCore::RestoreFromPath(const wchar_t* path) const
@@ -2143,12 +2212,25 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         RaiseNotice.raise(*this, std::move(noticeArgs));
     }
     void ControlCore::_connectionOutputHandler(const hstring& hstr)
+    {
+        _writeConnectionOutput(std::wstring_view{ hstr });
+    }
+
+    void ControlCore::_connectionOutputUtf8Handler(const winrt::array_view<const uint8_t>& bytes)
+    {
+#pragma warning(suppress : 26490) // Don't use reinterpret_cast (type.1).
+        _writeConnectionOutput(std::string_view{ reinterpret_cast<const char*>(bytes.data()), bytes.size() });
+    }
+
+    // Writes either UTF-16 (std::wstring_view) or UTF-8 (std::string_view) output of the connection.
+    template<typename T>
+    void ControlCore::_writeConnectionOutput(T text)
     {
         try
         {
             {
                 const auto lock = _terminal->LockForWriting();
-                _terminal->Write(hstr);
+                _terminal->Write(text);
             }
 
             // Start the throttled update of where our hyperlinks are.
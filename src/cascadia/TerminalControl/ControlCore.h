@@ -152,6 +152,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         void Close();
         void PersistToPath(const wchar_t* path) const;
         void RestoreFromPath(const wchar_t* path) const;
+        static void WaitForPersistence();
 
 #pragma region ICoreState
         const size_t TaskbarState() const noexcept;
@@ -297,11 +298,20 @@ namespace winrt::Microsoft::Terminal::Control::implementation
             std::shared_ptr<ThrottledFuncTrailing<Control::ScrollPositionChangedArgs>> updateScrollBar;
         };
 
+        // The state of PersistToPath() that's shared with its background thread.
+        struct PersistenceState
+        {
+            std::mutex lock;
+            std::wstring path;
+            ::TextBuffer::SerializeState checkpoint;
+        };
+
         std::atomic<bool> _initializedTerminal{ false };
         bool _closing{ false };
 
         TerminalConnection::ITerminalConnection _connection{ nullptr };
         TerminalConnection::ITerminalConnection::TerminalOutput_revoker _connectionOutputEventRevoker;
+        TerminalConnection::ITerminalConnectionUtf8::TerminalOutputUtf8_revoker _connectionOutputUtf8EventRevoker;
         TerminalConnection::ITerminalConnection::StateChanged_revoker _connectionStateChangedRevoker;
 
         winrt::com_ptr<ControlSettings> _settings{ nullptr };
@@ -319,6 +329,9 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         ::Search _searcher;
         bool _snapSearchResultToSelection;
 
+        std::shared_ptr<PersistenceState> _persistence = std::make_shared<PersistenceState>();
+        mutable std::stop_source _persistenceStop;
+
         winrt::handle _lastSwapChainHandle{ nullptr };
 
         FontInfoDesired _desiredFont;
@@ -393,6 +406,9 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         void _raiseReadOnlyWarning();
         void _updateAntiAliasingMode();
         void _connectionOutputHandler(const hstring& hstr);
+        void _connectionOutputUtf8Handler(const winrt::array_view<const uint8_t>& bytes);
+        template<typename T>
+        void _writeConnectionOutput(T text);
         void _updateHoveredCell(const std::optional<til::point> terminalPosition);
         void _setOpacity(const float opacity, const bool focused = true);
 
@@ -2398,6 +2398,12 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         _restorePath = std::move(path);
     }
 
+    // PersistToPath() writes the file on a background thread. This waits for all of them to finish.
+    void TermControl::WaitForPersistence()
+    {
+        ControlCore::WaitForPersistence();
+    }
+
     void TermControl::PersistToPath(const winrt::hstring& path) const
     {
         // Don't persist us if we weren't ever initialized. In that case, we
@@ -154,6 +154,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
                                                                int32_t commandlineCols,
                                                                int32_t commandlineRows);
         static Windows::Foundation::Size GetProposedDimensions(const IControlSettings& settings, const uint32_t dpi, const winrt::Windows::Foundation::Size& initialSizeInChars);
+        static void WaitForPersistence();
 
         void BellLightOn();
 
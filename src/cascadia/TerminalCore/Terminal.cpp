@@ -295,7 +295,7 @@ try
         .visibleViewportTop = _VisibleStartIndex(),
     };
 
-    TextBuffer::Reflow(*_mainBuffer.get(), *newTextBuffer.get(), &_mutableViewport, &positionInfo);
+    TextBuffer::ReflowLazily(*_mainBuffer.get(), *newTextBuffer.get(), &_mutableViewport, &positionInfo);
 
     // Restore the active text attributes
     newTextBuffer->SetCurrentAttributes(_mainBuffer->GetCurrentAttributes());
@@ -425,6 +425,13 @@ void Terminal::Write(std::wstring_view stringView)
     _stateMachine->ProcessString(stringView);
 }
 
+// Same as above, but for output that's still UTF-8 encoded. It's transcoded by the parser
+// as it goes, which saves transcoding it all up front. See StateMachine::ProcessUtf8.
+void Terminal::Write(std::string_view utf8)
+{
+    _stateMachine->ProcessUtf8(utf8);
+}
+
 // Method Description:
 // - Attempts to snap to the bottom of the buffer, if SnapOnInput is true. Does
 //   nothing if SnapOnInput is set to false, or we're already at the bottom of
@@ -1529,9 +1536,95 @@ std::wstring Terminal::CurrentCommand() const
     return _activeBuffer().CurrentCommand();
 }
 
-void Terminal::SerializeMainBuffer(const wchar_t* destination) const
-{
-    _mainBuffer->Serialize(destination);
+// Serializes the main buffer into the given file. Unlike TextBuffer::Serialize() this must be called without holding
+// the lock: It only acquires the lock while encoding a chunk of rows and releases it while writing the chunk to disk.
+// That allows it to run on a background thread without stalling the output or rendering of large buffers.
+//
+// `checkpoint` is where a previous call left off in the same file. If none of the rows it covered have changed
+// since then, the file is truncated to that point and appended to, instead of being rewritten from scratch.
+// Either way, the file ends up with the same contents. On return `checkpoint` is updated for the next call.
+// If `token` is signaled, this returns early and leaves the file incomplete.
+void Terminal::SerializeMainBuffer(const wchar_t* destination, TextBuffer::SerializeState& checkpoint, const std::stop_token& token) const
+{
+    static constexpr size_t writeThreshold = 32 * 1024;
+    // If the buffer keeps scrolling while we serialize it, we'll eventually hold onto the lock until we're done.
+    static constexpr int maxRestarts = 2;
+
+    const wil::unique_handle file{ CreateFileW(destination, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr) };
+    THROW_LAST_ERROR_IF(!file);
+
+    LARGE_INTEGER fileSize{};
+    THROW_IF_WIN32_BOOL_FALSE(GetFileSizeEx(file.get(), &fileSize));
+
+    const auto previous = std::exchange(checkpoint, {});
+    const auto previousSize = gsl::narrow_cast<int64_t>(previous.written * sizeof(wchar_t));
+    const TextBuffer* textBuffer = nullptr;
+    TextBuffer::SerializeState state;
+    TextBuffer::SerializeState resume;
+    std::unique_lock<til::recursive_ticket_lock> lock;
+    std::wstring buffer;
+    buffer.reserve(writeThreshold + writeThreshold / 2);
+    int restarts = 0;
+
+    for (auto moreRowsRemaining = true; moreRowsRemaining;)
+    {
+        if (token.stop_requested())
+        {
+            return;
+        }
+
+        if (!lock)
+        {
+            lock = LockForReading();
+        }
+
+        // The main buffer gets replaced when the terminal is resized, and its rows may have
+        // been modified or scrolled while we didn't hold the lock. Either way we need to start over.
+        std::optional<int64_t> truncateAt;
+        if (textBuffer != _mainBuffer.get() || !textBuffer->CanResumeSerialization(state))
+        {
+            if (textBuffer)
+            {
+                restarts++;
+            }
+
+            textBuffer = _mainBuffer.get();
+
+            if (restarts == 0 && fileSize.QuadPart >= previousSize && textBuffer->CanResumeSerialization(previous))
+            {
+                state = previous;
+                truncateAt = previousSize;
+            }
+            else
+            {
+                state = {};
+                truncateAt = 0;
+            }
+        }
+
+        moreRowsRemaining = textBuffer->SerializeRows(state, buffer, writeThreshold, &resume);
+
+        if (restarts < maxRestarts)
+        {
+            lock.unlock();
+        }
+
+        if (truncateAt)
+        {
+            LARGE_INTEGER offset{};
+            offset.QuadPart = *truncateAt;
+            THROW_IF_WIN32_BOOL_FALSE(SetFilePointerEx(file.get(), offset, nullptr, FILE_BEGIN));
+            THROW_IF_WIN32_BOOL_FALSE(SetEndOfFile(file.get()));
+        }
+
+        const auto bytes = gsl::narrow<DWORD>(buffer.size() * sizeof(wchar_t));
+        DWORD bytesWritten = 0;
+        THROW_IF_WIN32_BOOL_FALSE(WriteFile(file.get(), buffer.data(), bytes, &bytesWritten, nullptr));
+        THROW_WIN32_IF_MSG(ERROR_WRITE_FAULT, bytesWritten != bytes, "failed to write");
+        buffer.clear();
+    }
+
+    checkpoint = resume;
 }
 
 void Terminal::ColorSelection(const TextAttribute& attr, winrt::Microsoft::Terminal::Core::MatchMode matchMode)
@@ -15,6 +15,8 @@
 #include "../../types/inc/GlyphWidth.hpp"
 #include "../../cascadia/terminalcore/ITerminalInput.hpp"
 
+#include <stop_token>
+
 #include <til/ticket_lock.h>
 #include <til/winrt.h>
 
@@ -102,6 +104,7 @@ public:
 
     // Write comes from the PTY and goes to our parser to be stored in the output buffer
     void Write(std::wstring_view stringView);
+    void Write(std::string_view utf8);
 
     void _assertLocked() const noexcept;
     void _assertUnlocked() const noexcept;
@@ -125,7 +128,7 @@ public:
 
     std::wstring CurrentCommand() const;
 
-    void SerializeMainBuffer(const wchar_t* destination) const;
+    void SerializeMainBuffer(const wchar_t* destination, TextBuffer::SerializeState& checkpoint, const std::stop_token& token) const;
 
 #pragma region ITerminalApi
     // These methods are defined in TerminalApi.cpp
@@ -205,6 +208,7 @@ public:
     const std::wstring GetHyperlinkUri(uint16_t id) const override;
     const std::wstring GetHyperlinkCustomId(uint16_t id) const override;
     const std::vector<size_t> GetPatternId(const til::point location) const override;
+    std::vector<til::CoordType> GetPatternBoundaries(const til::CoordType row) const override;
 
     std::pair<COLORREF, COLORREF> GetAttributeColors(const TextAttribute& attr) const noexcept override;
     std::vector<Microsoft::Console::Types::Viewport> GetSelectionRects() noexcept override;
@@ -122,6 +122,33 @@ const std::vector<size_t> Terminal::GetPatternId(const til::point location) cons
     return {};
 }
 
+// Method Description:
+// - Gets the columns at which regex patterns start or end in the given row
+// Arguments:
+// - The viewport-relative row
+// Return value:
+// - The columns in ascending order
+std::vector<til::CoordType> Terminal::GetPatternBoundaries(const til::CoordType row) const
+{
+    _assertLocked();
+
+    // The intervals are half-open, so the column of the end point
+    // is the first one that doesn't belong to the pattern anymore.
+    std::vector<til::CoordType> result;
+    _patternIntervalTree.visit_overlapping({ 0, row }, { til::CoordTypeMax, row }, [&](const auto& interval) {
+        if (interval.start.y == row)
+        {
+            result.emplace_back(interval.start.x);
+        }
+        if (interval.stop.y == row)
+        {
+            result.emplace_back(interval.stop.x);
+        }
+    });
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
 std::pair<COLORREF, COLORREF> Terminal::GetAttributeColors(const TextAttribute& attr) const noexcept
 {
     return GetRenderSettings().GetAttributeColors(attr);
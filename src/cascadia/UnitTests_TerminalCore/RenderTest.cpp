@@ -0,0 +1,396 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+
+#include <chrono>
+
+#include "../cascadia/TerminalCore/Terminal.hpp"
+#include "../renderer/inc/DummyRenderer.hpp"
+#include "../renderer/inc/RenderEngineBase.hpp"
+
+using namespace winrt::Microsoft::Terminal::Core;
+using namespace Microsoft::Terminal::Core;
+using namespace Microsoft::Console::Render;
+using namespace ::Microsoft::Console::Types;
+
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+namespace
+{
+    // A render engine that treats the entire viewport as dirty on every frame
+    // and records the text that gets painted into each line.
+    class RecordingRenderEngine final : public RenderEngineBase
+    {
+    public:
+        explicit RecordingRenderEngine(const til::size viewportSize) :
+            _dirtyArea{ til::point{}, viewportSize },
+            _lines(viewportSize.height)
+        {
+        }
+
+        const std::vector<std::wstring>& Lines() const noexcept
+        {
+            return _lines;
+        }
+
+        size_t PaintBufferLineCount() const noexcept
+        {
+            return _paintBufferLineCount;
+        }
+
+        void Reset()
+        {
+            for (auto& line : _lines)
+            {
+                line.clear();
+            }
+            _paintBufferLineCount = 0;
+        }
+
+        // While enabled, StartPaint() signals Painting() and then blocks until Resume() is signaled,
+        // so that a test can act while the render thread is in the middle of painting a frame.
+        void SetBlockPaints(const bool block) noexcept
+        {
+            _blockPaints.store(block, std::memory_order_relaxed);
+        }
+
+        void SetContinuousRedraw(const bool enable) noexcept
+        {
+            _continuousRedraw.store(enable, std::memory_order_relaxed);
+        }
+
+        const wil::unique_event& Painting() const noexcept
+        {
+            return _painting;
+        }
+
+        const wil::unique_event& Resume() const noexcept
+        {
+            return _resume;
+        }
+
+        HRESULT StartPaint() noexcept
+        {
+            if (_blockPaints.load(std::memory_order_relaxed))
+            {
+                _painting.SetEvent();
+                _resume.wait(5000);
+            }
+            return S_OK;
+        }
+        bool RequiresContinuousRedraw() noexcept { return _continuousRedraw.load(std::memory_order_relaxed); }
+        void WaitUntilCanRender() noexcept {}
+        HRESULT EndPaint() noexcept { return S_OK; }
+        HRESULT Present() noexcept { return S_OK; }
+        HRESULT PrepareForTeardown(_Out_ bool* /*pForcePaint*/) noexcept { return S_OK; }
+        HRESULT ScrollFrame() noexcept { return S_OK; }
+        HRESULT Invalidate(const til::rect* /*psrRegion*/) noexcept { return S_OK; }
+        HRESULT InvalidateCursor(const til::rect* /*psrRegion*/) noexcept { return S_OK; }
+        HRESULT InvalidateSystem(const til::rect* /*prcDirtyClient*/) noexcept { return S_OK; }
+        HRESULT InvalidateSelection(const std::vector<til::rect>& /*rectangles*/) noexcept { return S_OK; }
+        HRESULT InvalidateScroll(const til::point* /*pcoordDelta*/) noexcept { return S_OK; }
+        HRESULT InvalidateAll() noexcept { return S_OK; }
+        HRESULT InvalidateCircling(_Out_ bool* /*pForcePaint*/) noexcept { return S_OK; }
+        HRESULT PaintBackground() noexcept { return S_OK; }
+        HRESULT PaintBufferLine(std::span<const Cluster> clusters, til::point coord, bool /*fTrimLeft*/, bool /*lineWrapped*/) noexcept
+        try
+        {
+            auto& line = _lines.at(coord.y);
+            for (const auto& cluster : clusters)
+            {
+                line.append(cluster.GetText());
+            }
+            _paintBufferLineCount++;
+            return S_OK;
+        }
+        CATCH_RETURN()
+        HRESULT PaintBufferGridLines(GridLineSet /*lines*/, COLORREF /*gridlineColor*/, COLORREF /*underlineColor*/, size_t /*cchLine*/, til::point /*coordTarget*/) noexcept { return S_OK; }
+        HRESULT PaintSelection(const til::rect& /*rect*/) noexcept { return S_OK; }
+        HRESULT PaintCursor(const CursorOptions& /*options*/) noexcept { return S_OK; }
+        HRESULT UpdateDrawingBrushes(const TextAttribute& /*textAttributes*/, const RenderSettings& /*renderSettings*/, gsl::not_null<IRenderData*> /*pData*/, bool /*usingSoftFont*/, bool /*isSettingDefaultBrushes*/) noexcept { return S_OK; }
+        HRESULT UpdateFont(const FontInfoDesired& /*FontInfoDesired*/, _Out_ FontInfo& /*FontInfo*/) noexcept { return S_OK; }
+        HRESULT UpdateDpi(int /*iDpi*/) noexcept { return S_OK; }
+        HRESULT UpdateViewport(const til::inclusive_rect& /*srNewViewport*/) noexcept { return S_OK; }
+        HRESULT GetProposedFont(const FontInfoDesired& /*FontInfoDesired*/, _Out_ FontInfo& /*FontInfo*/, int /*iDpi*/) noexcept { return S_OK; }
+        HRESULT GetDirtyArea(std::span<const til::rect>& area) noexcept
+        {
+            area = { &_dirtyArea, 1 };
+            return S_OK;
+        }
+        HRESULT GetFontSize(_Out_ til::size* /*pFontSize*/) noexcept { return S_OK; }
+        HRESULT IsGlyphWideByFont(std::wstring_view /*glyph*/, _Out_ bool* /*pResult*/) noexcept { return S_OK; }
+
+    protected:
+        HRESULT _DoUpdateTitle(const std::wstring_view /*newTitle*/) noexcept { return S_OK; }
+
+    private:
+        til::rect _dirtyArea;
+        std::vector<std::wstring> _lines;
+        size_t _paintBufferLineCount = 0;
+        std::atomic<bool> _blockPaints{ false };
+        std::atomic<bool> _continuousRedraw{ false };
+        wil::unique_event _painting{ wil::EventOptions::None };
+        wil::unique_event _resume{ wil::EventOptions::None };
+    };
+
+    // A Terminal with a Renderer that has an actual RenderThread, unlike the DummyRenderer the other tests use.
+    // Paints start out blocked and the first frame is already requested, so that a test can control
+    // exactly which requests arrive while the render thread paints.
+    struct ThreadedRenderer
+    {
+        explicit ThreadedRenderer(const til::size viewportSize) :
+            terminal{ std::make_unique<Terminal>(Terminal::TestDummyMarker{}) },
+            engine{ viewportSize }
+        {
+            auto thread = std::make_unique<RenderThread>();
+            renderThread = thread.get();
+            renderer = std::make_unique<Renderer>(terminal->GetRenderSettings(), terminal.get(), nullptr, 0, std::move(thread));
+            renderer->AddRenderEngine(&engine);
+            terminal->Create(viewportSize, 0, *renderer);
+
+            engine.SetBlockPaints(true);
+            renderer->NotifyPaintFrame();
+            THROW_IF_FAILED(renderThread->Initialize(renderer.get()));
+            renderThread->EnablePainting();
+        }
+
+        ~ThreadedRenderer()
+        {
+            // The render thread has to exit before the terminal it paints goes away.
+            engine.SetBlockPaints(false);
+            engine.SetContinuousRedraw(false);
+            engine.Resume().SetEvent();
+            renderer.reset();
+            terminal.reset();
+        }
+
+        uint32_t FrameCount()
+        {
+            const auto histogram = renderer->GetLatencyHistogram();
+            return std::accumulate(histogram.begin(), histogram.end(), 0u);
+        }
+
+        // Waits until the render thread has finished the given number of frames, but no longer than 5s.
+        bool WaitForFrames(const uint32_t count)
+        {
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{ 5 };
+            while (FrameCount() < count)
+            {
+                if (std::chrono::steady_clock::now() > deadline)
+                {
+                    return false;
+                }
+                Sleep(1);
+            }
+            return true;
+        }
+
+        std::unique_ptr<Terminal> terminal;
+        RecordingRenderEngine engine;
+        std::unique_ptr<Renderer> renderer;
+        RenderThread* renderThread = nullptr;
+    };
+}
+
+namespace TerminalCoreUnitTests
+{
+    class RenderTest;
+};
+using namespace TerminalCoreUnitTests;
+
+class TerminalCoreUnitTests::RenderTest final
+{
+    static const til::CoordType TerminalViewWidth = 300;
+    static const til::CoordType TerminalViewHeight = 100;
+
+    TEST_CLASS(RenderTest);
+
+    TEST_METHOD(PaintedTextMatchesBuffer);
+    TEST_METHOD(FullFrameBenchmark);
+    TEST_METHOD(FramePacerPolicy);
+    TEST_METHOD(RenderThreadBacksOffWhileWriterIsBusy);
+    TEST_METHOD(RenderThreadIgnoresItsOwnRequests);
+
+    TEST_METHOD_SETUP(MethodSetup)
+    {
+        _term = std::make_unique<::Microsoft::Terminal::Core::Terminal>(Terminal::TestDummyMarker{});
+        _renderEngine = std::make_unique<RecordingRenderEngine>(til::size{ TerminalViewWidth, TerminalViewHeight });
+        _renderer = std::make_unique<DummyRenderer>(_term.get());
+        _renderer->AddRenderEngine(_renderEngine.get());
+        _term->Create({ TerminalViewWidth, TerminalViewHeight }, 0, *_renderer);
+        return true;
+    }
+
+    TEST_METHOD_CLEANUP(MethodCleanup)
+    {
+        _term = nullptr;
+        return true;
+    }
+
+private:
+    // Fills every line of the viewport with 270 columns of short runs of colored text,
+    // underlines and wide glyphs, positioned with CUP so that nothing wraps or scrolls.
+    void _fillViewport()
+    {
+        static constexpr std::wstring_view pattern{ L"\x1b[31mred  \x1b[32;1mgreen\x1b[m \u732b\u5b50 \x1b[4mlink\x1b[24m plain " };
+        for (til::CoordType y = 0; y < TerminalViewHeight; y++)
+        {
+            _term->Write(fmt::format(L"\x1b[{}H", y + 1));
+            for (auto i = 0; i < 10; i++)
+            {
+                _term->Write(pattern);
+            }
+        }
+    }
+
+    void _verifyPaintedText() const
+    {
+        const auto& buffer = _term->GetTextBuffer();
+        const auto& lines = _renderEngine->Lines();
+        for (til::CoordType y = 0; y < TerminalViewHeight; y++)
+        {
+            const auto expected = buffer.GetRowByOffset(y).GetText(0, TerminalViewWidth);
+            VERIFY_ARE_EQUAL(std::wstring{ expected }, lines.at(y));
+        }
+    }
+
+    std::unique_ptr<Terminal> _term;
+    std::unique_ptr<RecordingRenderEngine> _renderEngine;
+    std::unique_ptr<DummyRenderer> _renderer;
+};
+
+void RenderTest::PaintedTextMatchesBuffer()
+{
+    _fillViewport();
+    VERIFY_SUCCEEDED(_renderer->PaintFrame());
+    _verifyPaintedText();
+
+    // Each repetition of the pattern is painted in 5 runs, plus one for the blank remainder.
+    // Runs of spaces are merged into the preceding run if they look the same.
+    VERIFY_IS_LESS_THAN_OR_EQUAL(_renderEngine->PaintBufferLineCount(), static_cast<size_t>(TerminalViewHeight * (10 * 5 + 1)));
+}
+
+void RenderTest::FullFrameBenchmark()
+{
+    static constexpr auto frames = 100;
+
+    _fillViewport();
+
+    // Paint a frame up front, so that the measurement doesn't include any one-time setup.
+    VERIFY_SUCCEEDED(_renderer->PaintFrame());
+
+    const auto beg = std::chrono::steady_clock::now();
+    for (auto i = 0; i < frames; i++)
+    {
+        _renderEngine->Reset();
+        VERIFY_SUCCEEDED(_renderer->PaintFrame());
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    const auto perFrame = std::chrono::duration<double, std::micro>(end - beg).count() / frames;
+    Log::Comment(fmt::format(L"{}x{} cells, {} runs per frame: {:.1f}us per frame", TerminalViewWidth, TerminalViewHeight, _renderEngine->PaintBufferLineCount(), perFrame).c_str());
+}
+
+void RenderTest::FramePacerPolicy()
+{
+    using namespace std::chrono_literals;
+    using clock = FramePacer::clock;
+
+    FramePacer pacer{ 4ms, 32ms };
+    const clock::time_point start{};
+
+    // Nothing was painted yet, so the first frame is painted right away.
+    VERIFY_IS_TRUE(pacer.NextFrameTime(start) == start);
+
+    // While the writer is busy, the interval doubles up to the maximum...
+    auto begin = start;
+    for (const auto expected : { 8ms, 16ms, 32ms, 32ms })
+    {
+        pacer.FramePainted(begin, begin, begin + 1ms, true);
+        VERIFY_IS_TRUE(pacer.FrameInterval() == expected);
+        VERIFY_IS_TRUE(pacer.NextFrameTime(begin + 1ms) == begin + expected);
+        begin += expected;
+    }
+
+    // ...and halves back down to the minimum once it calms down.
+    for (const auto expected : { 16ms, 8ms, 4ms, 4ms })
+    {
+        pacer.FramePainted(begin, begin, begin + 1ms, false);
+        VERIFY_IS_TRUE(pacer.FrameInterval() == expected);
+        begin += expected;
+    }
+
+    // After a pause, the next frame is painted immediately.
+    const auto later = begin + 1s;
+    VERIFY_IS_TRUE(pacer.NextFrameTime(later) == later);
+
+    VERIFY_ARE_EQUAL(size_t{ 0 }, FramePacer::LatencyBucket(500us));
+    VERIFY_ARE_EQUAL(size_t{ 1 }, FramePacer::LatencyBucket(1ms));
+    VERIFY_ARE_EQUAL(size_t{ 2 }, FramePacer::LatencyBucket(3ms));
+    VERIFY_ARE_EQUAL(size_t{ 3 }, FramePacer::LatencyBucket(4ms));
+    VERIFY_ARE_EQUAL(FramePacer::LatencyBucketCount - 1, FramePacer::LatencyBucket(1h));
+
+    // All 8 frames above took 1ms from the request to the end of the frame.
+    const auto& histogram = pacer.GetLatencyHistogram();
+    VERIFY_ARE_EQUAL(8u, histogram.at(1));
+    VERIFY_ARE_EQUAL(8u, std::accumulate(histogram.begin(), histogram.end(), 0u));
+}
+
+void RenderTest::RenderThreadBacksOffWhileWriterIsBusy()
+{
+    ThreadedRenderer r{ { TerminalViewWidth, TerminalViewHeight } };
+
+    // The first frame is painted without anything else happening, so the interval stays at its minimum.
+    VERIFY_IS_TRUE(r.engine.Painting().wait(5000));
+    r.engine.Resume().SetEvent();
+    uint32_t frames = 1;
+    VERIFY_IS_TRUE(r.WaitForFrames(frames));
+    VERIFY_IS_TRUE(r.renderThread->GetFrameInterval() == FramePacer::DefaultMinFrameInterval);
+
+    Log::Comment(L"Requests from other threads while a frame is painted mean that the writer is busy. The interval doubles each time.");
+    r.renderer->NotifyPaintFrame();
+    auto expected = FramePacer::DefaultMinFrameInterval;
+    for (auto i = 0; i < 4; ++i)
+    {
+        VERIFY_IS_TRUE(r.engine.Painting().wait(5000));
+        r.renderer->NotifyPaintFrame();
+        r.engine.Resume().SetEvent();
+        VERIFY_IS_TRUE(r.WaitForFrames(++frames));
+        expected = std::min(expected * 2, FramePacer::DefaultMaxFrameInterval);
+        VERIFY_IS_TRUE(r.renderThread->GetFrameInterval() == expected);
+    }
+
+    Log::Comment(L"The last request gets its own frame. Nothing arrives while it's painted, so the interval halves again.");
+    VERIFY_IS_TRUE(r.engine.Painting().wait(5000));
+    r.engine.Resume().SetEvent();
+    VERIFY_IS_TRUE(r.WaitForFrames(++frames));
+    VERIFY_IS_TRUE(r.renderThread->GetFrameInterval() == expected / 2);
+}
+
+void RenderTest::RenderThreadIgnoresItsOwnRequests()
+{
+    ThreadedRenderer r{ { TerminalViewWidth, TerminalViewHeight } };
+
+    Log::Comment(L"An engine that requires continuous redraw makes the render thread request the next frame while it paints.");
+    r.engine.SetContinuousRedraw(true);
+    VERIFY_IS_TRUE(r.engine.Painting().wait(5000));
+    r.engine.SetBlockPaints(false);
+    r.engine.Resume().SetEvent();
+
+    // If those requests counted as a busy writer, the interval would have reached its maximum long before this.
+    VERIFY_IS_TRUE(r.WaitForFrames(16));
+    VERIFY_IS_TRUE(r.renderThread->GetFrameInterval() == FramePacer::DefaultMinFrameInterval);
+
+    Log::Comment(L"A request from another thread still counts, even if the render thread already requested the same frame.");
+    r.engine.SetBlockPaints(true);
+    VERIFY_IS_TRUE(r.engine.Painting().wait(5000));
+    const auto frames = r.FrameCount();
+    r.renderer->NotifyPaintFrame();
+    // Paints stay blocked, so that the next frame can't halve the interval before we get to look at it.
+    r.engine.Resume().SetEvent();
+    VERIFY_IS_TRUE(r.WaitForFrames(frames + 1));
+    VERIFY_IS_TRUE(r.renderThread->GetFrameInterval() == FramePacer::DefaultMinFrameInterval * 2);
+}
@@ -489,6 +489,9 @@ winrt::fire_and_forget WindowEmperor::_close()
 
 void WindowEmperor::_finalizeSessionPersistence() const
 {
+    // The buffer_*.txt files are written on background threads, which TerminateProcess() would cut short.
+    Control::TermControl::WaitForPersistence();
+
     const auto state = ApplicationState::SharedInstance();
 
     // Ensure to write the state.json before we TerminateProcess()
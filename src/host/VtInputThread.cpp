@@ -27,7 +27,6 @@ VtInputThread::VtInputThread(_In_ wil::unique_hfile hPipe,
                              const bool inheritCursor) :
     _hFile{ std::move(hPipe) },
     _hThread{},
-    _u8State{},
     _dwThreadId{ 0 },
     _pfnSetLookingForDSR{}
 {
@@ -89,12 +88,6 @@ bool VtInputThread::DoReadInput()
         return false;
     }
 
-    // If we hit a parsing error, eat it. It's bad utf-8, we can't do anything with it.
-    if (FAILED_LOG(til::u8u16({ buffer, gsl::narrow_cast<size_t>(dwRead) }, _wstr, _u8State)))
-    {
-        return true;
-    }
-
     try
     {
         // Make sure to call the GLOBAL Lock/Unlock, not the gci's lock/unlock.
@@ -105,7 +98,8 @@ bool VtInputThread::DoReadInput()
         LockConsole();
         const auto unlock = wil::scope_exit([&] { UnlockConsole(); });
 
-        _pInputStateMachine->ProcessString(_wstr);
+        // The state machine transcodes the input itself and carries partial code points over to the next read.
+        _pInputStateMachine->ProcessUtf8({ buffer, gsl::narrow_cast<size_t>(dwRead) });
     }
     CATCH_LOG();
 
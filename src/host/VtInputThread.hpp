@@ -38,7 +38,5 @@ namespace Microsoft::Console
         std::function<void(bool)> _pfnSetLookingForDSR;
 
         std::unique_ptr<Microsoft::Console::VirtualTerminal::StateMachine> _pInputStateMachine;
-        til::u8state _u8State;
-        std::wstring _wstr;
     };
 }
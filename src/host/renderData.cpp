@@ -289,6 +289,11 @@ const std::vector<size_t> RenderData::GetPatternId(const til::point /*location*/
     return {};
 }
 
+std::vector<til::CoordType> RenderData::GetPatternBoundaries(const til::CoordType /*row*/) const
+{
+    return {};
+}
+
 // Routine Description:
 // - Converts a text attribute into the RGB values that should be presented, applying
 //   relevant table translation information and preferences.
@@ -46,6 +46,7 @@ public:
     const std::wstring GetHyperlinkCustomId(uint16_t id) const override;
 
     const std::vector<size_t> GetPatternId(const til::point location) const override;
+    std::vector<til::CoordType> GetPatternBoundaries(const til::CoordType row) const override;
 
     std::pair<COLORREF, COLORREF> GetAttributeColors(const TextAttribute& attr) const noexcept override;
     const bool IsSelectionActive() const override;
@@ -1388,7 +1388,7 @@ try
     // we're capturing _textBuffer by reference here because when we exit, we want to EndDefer on the current active buffer.
     auto endDefer = wil::scope_exit([&]() noexcept { _textBuffer->GetCursor().EndDeferDrawing(); });
 
-    TextBuffer::Reflow(*_textBuffer.get(), *newTextBuffer.get());
+    TextBuffer::ReflowLazily(*_textBuffer.get(), *newTextBuffer.get());
 
     // Since the reflow doesn't preserve the virtual bottom, we try and
     // estimate where it ought to be by making it the same distance from
@@ -12,6 +12,8 @@
 
 #include "globals.h"
 #include "../buffer/out/textBuffer.hpp"
+#include "../buffer/out/BufferSnapshot.hpp"
+#include "../buffer/out/search.h"
 
 #include "input.h"
 #include "_stream.h"
@@ -91,6 +93,7 @@ class TextBufferTests
     TEST_METHOD(TestBoundaryMeasuresFullString);
     TEST_METHOD(TestBoundaryMeasuresRegularString);
     TEST_METHOD(TestBoundaryMeasuresFloatingString);
+    TEST_METHOD(TestBoundaryMeasuresEveryColumn);
 
     TEST_METHOD(TestCopyProperties);
 
@@ -141,6 +144,7 @@ class TextBufferTests
 
     TEST_METHOD(ResizeTraditionalRotationPreservesHighUnicode);
     TEST_METHOD(ScrollBufferRotationPreservesHighUnicode);
+    TEST_METHOD(RotateRowsMatchesScrollRows);
 
     TEST_METHOD(ResizeTraditionalHighUnicodeRowRemoval);
     TEST_METHOD(ResizeTraditionalHighUnicodeColumnRemoval);
@@ -164,6 +168,17 @@ class TextBufferTests
     TEST_METHOD(NoHyperlinkTrim);
 
     TEST_METHOD(ReflowPromptRegions);
+
+    TEST_METHOD(ColdScrollbackTier);
+    TEST_METHOD(ColdScrollbackTierMemoryUsage);
+    TEST_METHOD(ColdScrollbackTierAttributeMemoryUsage);
+    TEST_METHOD(AttributePaletteCollection);
+    TEST_METHOD(TrivialRowTransitions);
+    TEST_METHOD(SearchTextSkipsRowsBySignature);
+    TEST_METHOD(LiteralSearchMatchesIcu);
+    TEST_METHOD(SerializeInChunks);
+    TEST_METHOD(SnapshotRoundTrip);
+    TEST_METHOD(RowsMutatedSinceSnapshot);
 };
 
 void TextBufferTests::TestBufferCreate()
@@ -362,6 +377,28 @@ void TextBufferTests::TestBoundaryMeasuresFloatingString()
     DoBoundaryTest(pwszOffsets, 14, csBufferWidth, 5, 9);
 }
 
+void TextBufferTests::TestBoundaryMeasuresEveryColumn()
+{
+    // The measurements are vectorized. Placing a single glyph into each column
+    // ensures that we hit every lane as well as the scalar head and tail.
+    TextBuffer textBuffer{ { 77, 1 }, TextAttribute{ 0x7 }, 0, false, _renderer };
+    auto& row = textBuffer.GetMutableRowByOffset(0);
+
+    VERIFY_IS_FALSE(row.ContainsText());
+    VERIFY_ARE_EQUAL(0, row.GetLastNonSpaceColumn());
+
+    for (til::CoordType x = 0; x < row.size(); ++x)
+    {
+        row.Reset(TextAttribute{ 0x7 });
+        row.ReplaceCharacters(x, 1, L"X");
+
+        VERIFY_IS_TRUE(row.ContainsText());
+        VERIFY_ARE_EQUAL(x, row.MeasureLeft());
+        VERIFY_ARE_EQUAL(x + 1, row.GetLastNonSpaceColumn());
+        VERIFY_ARE_EQUAL(x + 1, row.MeasureRight());
+    }
+}
+
 void TextBufferTests::TestCopyProperties()
 {
     auto& otherTbi = GetTbi();
@@ -1869,6 +1906,106 @@ void TextBufferTests::ScrollBufferRotationPreservesHighUnicode()
     VERIFY_ARE_EQUAL(String(fire), String(shouldBeFireText.data(), gsl::narrow<int>(shouldBeFireText.size())));
 }
 
+// RotateRows() must move rows exactly like ScrollRows() does, apart from the rows it uncovers,
+// which the caller is expected to clear. This also covers ranges that wrap around the end of
+// the circular buffer, rows that get frozen into the cold tier, and resizing afterwards.
+void TextBufferTests::RotateRowsMatchesScrollRows()
+{
+    static constexpr til::size bufferSize{ 20, 16 };
+    static constexpr struct
+    {
+        til::CoordType firstRow;
+        til::CoordType size;
+        til::CoordType delta;
+    } scrolls[] = {
+        { 1, 10, -1 },
+        { 0, 16, 0 },
+        { 4, 12, -4 },
+        { 0, 12, 4 },
+        { 3, 5, 7 },
+        { 9, 7, -9 },
+        { 0, 1, 15 },
+        { 15, 1, -15 },
+    };
+
+    TextBuffer copied{ bufferSize, TextAttribute{ 0x7 }, 0, false, _renderer };
+    TextBuffer rotated{ bufferSize, TextAttribute{ 0x7 }, 0, false, _renderer };
+    copied._coldRowDistance = 4;
+    rotated._coldRowDistance = 4;
+
+    auto counter = 0;
+    const auto write = [&](const til::CoordType y) {
+        const auto text = fmt::format(FMT_COMPILE(L"row {}"), counter);
+        for (const auto tb : { &copied, &rotated })
+        {
+            RowWriteState state{ .text = text };
+            tb->Replace(y, TextAttribute{ gsl::narrow_cast<WORD>(counter & 0xff) }, state);
+            tb->GetMutableRowByOffset(y).SetWrapForced(counter % 3 == 0);
+        }
+        counter++;
+    };
+    const auto verify = [&]() {
+        for (til::CoordType y = 0; y < bufferSize.height; ++y)
+        {
+            const auto& expected = copied.GetRowByOffset(y);
+            const auto& actual = rotated.GetRowByOffset(y);
+            VERIFY_ARE_EQUAL(expected.GetText(), actual.GetText());
+            VERIFY_ARE_EQUAL(expected.WasWrapForced(), actual.WasWrapForced());
+            VERIFY_IS_TRUE(expected.Attributes() == actual.Attributes());
+        }
+    };
+    // The rows near the bottom must stay hot, no matter which slot RotateRows() moved them to.
+    // verify() thaws all rows, which makes IncrementCircularBuffer() freeze half of them again.
+    const auto verifyHotRows = [&]() {
+        for (auto y = bufferSize.height - rotated._coldRowDistance; y < bufferSize.height; ++y)
+        {
+            const auto offset = rotated._getRowOffset(y);
+            VERIFY_IS_FALSE(offset < rotated._frozenRows.size() && rotated._frozenRows[offset]);
+        }
+    };
+
+    for (til::CoordType y = 0; y < bufferSize.height; ++y)
+    {
+        write(y);
+    }
+
+    // Each pass starts at a different _firstRow, so that the ranges wrap around at different offsets.
+    for (auto pass = 0; pass < bufferSize.height; ++pass)
+    {
+        for (const auto& s : scrolls)
+        {
+            copied.ScrollRows(s.firstRow, s.size, s.delta);
+            rotated.RotateRows(s.firstRow, s.size, s.delta);
+
+            // Overwrite the uncovered rows in both buffers, just like the callers do.
+            const auto uncoveredBeg = s.delta < 0 ? s.firstRow + s.size + s.delta : s.firstRow;
+            const auto uncoveredEnd = uncoveredBeg + std::abs(s.delta);
+            for (auto y = uncoveredBeg; y < uncoveredEnd; ++y)
+            {
+                write(y);
+            }
+            verify();
+        }
+
+        write(bufferSize.height - 1);
+        copied.IncrementCircularBuffer();
+        rotated.IncrementCircularBuffer();
+        verifyHotRows();
+        verify();
+    }
+
+    Log::Comment(L"Ranges that don't fit into the buffer are rejected.");
+    VERIFY_THROWS(rotated.RotateRows(0, bufferSize.height, 1), wil::ResultException);
+
+    Log::Comment(L"Resizing must preserve the rotated rows.");
+    copied.ResizeTraditional({ bufferSize.width + 5, bufferSize.height - 3 });
+    rotated.ResizeTraditional({ bufferSize.width + 5, bufferSize.height - 3 });
+    for (til::CoordType y = 0; y < bufferSize.height - 3; ++y)
+    {
+        VERIFY_ARE_EQUAL(copied.GetRowByOffset(y).GetText(), rotated.GetRowByOffset(y).GetText());
+    }
+}
+
 // This tests that rows removed from the buffer while resizing traditionally will also drop the high unicode
 // characters from the Unicode Storage buffer
 void TextBufferTests::ResizeTraditionalHighUnicodeRowRemoval()
@@ -3092,3 +3229,699 @@ void TextBufferTests::ReflowPromptRegions()
     Log::Comment(L"========== Checking the host buffer state (after) ==========");
     verifyBuffer(*newBuffer, si.GetViewport().ToExclusive(), false, true);
 }
+
+void TextBufferTests::ColdScrollbackTier()
+{
+    static constexpr til::size bufferSize{ 40, 64 };
+    static constexpr std::wstring_view lines[] = {
+        L"Hello, World!",
+        L"",
+        L"   leading whitespace",
+        L"wide \u732B\u732B glyphs",
+        L"emoji \U0001F600 and surrogates",
+        L"e\u0301 combining mark",
+        L"0123456789012345678901234567890123456789",
+        L"trailing whitespace     ",
+    };
+    const TextAttribute attributes[] = {
+        TextAttribute{ 0x07 },
+        TextAttribute{ 0x1e },
+        TextAttribute{ RGB(1, 2, 3), RGB(4, 5, 6) },
+    };
+
+    const auto fill = [&](TextBuffer& tb) {
+        for (size_t i = 0; i < 200; ++i)
+        {
+            const auto y = tb.GetSize().Height() - 1;
+            RowWriteState state{ .text = til::at(lines, i % std::size(lines)) };
+            tb.Replace(y, til::at(attributes, i % std::size(attributes)), state);
+            tb.GetMutableRowByOffset(y).SetWrapForced(i % 5 == 0);
+            if (i % 7 == 0)
+            {
+                tb.SetScrollbarData(ScrollbarData{ MarkCategory::Prompt }, y);
+            }
+            tb.IncrementCircularBuffer();
+        }
+    };
+
+    TextBuffer hot{ bufferSize, TextAttribute{ 0x7 }, 0, false, _renderer };
+    hot._coldRowDistance = til::CoordTypeMax;
+    TextBuffer cold{ bufferSize, TextAttribute{ 0x7 }, 0, false, _renderer };
+    cold._coldRowDistance = 8;
+
+    fill(hot);
+    fill(cold);
+
+    Log::Comment(L"The cold tier should hold all but the last 8 rows.");
+    VERIFY_IS_TRUE(hot._frozenRows.empty());
+    size_t frozenCount = 0;
+    for (const auto& frozen : cold._frozenRows)
+    {
+        frozenCount += frozen ? 1 : 0;
+    }
+    VERIFY_ARE_EQUAL(56u, frozenCount);
+    Log::Comment(L"All rows share their attributes: 0x07, 0x1e and RGB(1, 2, 3).");
+    VERIFY_ARE_EQUAL(3u, cold._attributePalette->Size());
+
+    Log::Comment(L"Searching thaws rows and must find the same matches.");
+    for (const auto needle : { L"World", L"\u732B", L"\U0001F600", L"whitespace", L"e\u0301" })
+    {
+        const auto expected = hot.SearchText(needle, SearchFlag::CaseInsensitive).value();
+        const auto actual = cold.SearchText(needle, SearchFlag::CaseInsensitive).value();
+        VERIFY_ARE_EQUAL(expected.size(), actual.size());
+        for (size_t i = 0; i < expected.size(); ++i)
+        {
+            VERIFY_ARE_EQUAL(expected[i].start, actual[i].start);
+            VERIFY_ARE_EQUAL(expected[i].end, actual[i].end);
+        }
+    }
+
+    Log::Comment(L"Freeze everything again and ensure that copying and individual rows are identical.");
+    for (til::CoordType y = 0; y < bufferSize.height - cold._coldRowDistance; ++y)
+    {
+        cold._freeze(cold._getRowOffset(y));
+    }
+    {
+        const auto req = TextBuffer::CopyRequest{ hot, { 0, 0 }, { bufferSize.width - 1, bufferSize.height - 1 }, false, true, true, false };
+        VERIFY_ARE_EQUAL(hot.GetPlainText(req), cold.GetPlainText(req));
+    }
+    for (til::CoordType y = 0; y < bufferSize.height; ++y)
+    {
+        const auto& expected = hot.GetRowByOffset(y);
+        const auto& actual = cold.GetRowByOffset(y);
+        VERIFY_ARE_EQUAL(expected.GetText(), actual.GetText());
+        VERIFY_ARE_EQUAL(expected.WasWrapForced(), actual.WasWrapForced());
+        VERIFY_ARE_EQUAL(expected.GetScrollbarData().has_value(), actual.GetScrollbarData().has_value());
+        VERIFY_IS_TRUE(expected.Attributes() == actual.Attributes());
+        for (til::CoordType x = 0; x < bufferSize.width; ++x)
+        {
+            VERIFY_ARE_EQUAL(expected.GlyphAt(x), actual.GlyphAt(x));
+            VERIFY_IS_TRUE(expected.DbcsAttrAt(x) == actual.DbcsAttrAt(x));
+        }
+    }
+
+    Log::Comment(L"Thawed rows refer to the same palette entries, which a collection must keep.");
+    cold._collectAttributes();
+    VERIFY_ARE_EQUAL(3u, cold._attributePalette->Size());
+
+    Log::Comment(L"Reflowing across the tier boundary must produce identical results.");
+    for (const auto width : { 17, 40, 53 })
+    {
+        TextBuffer hotReflow{ { width, bufferSize.height }, TextAttribute{ 0x7 }, 0, false, _renderer };
+        hotReflow._coldRowDistance = til::CoordTypeMax;
+        TextBuffer coldReflow{ { width, bufferSize.height }, TextAttribute{ 0x7 }, 0, false, _renderer };
+        coldReflow._coldRowDistance = 8;
+
+        TextBuffer::Reflow(hot, hotReflow);
+        TextBuffer::Reflow(cold, coldReflow);
+
+        VERIFY_IS_FALSE(coldReflow._frozenRows.empty());
+        for (til::CoordType y = 0; y < bufferSize.height; ++y)
+        {
+            VERIFY_ARE_EQUAL(hotReflow.GetRowByOffset(y).GetText(), coldReflow.GetRowByOffset(y).GetText());
+            VERIFY_IS_TRUE(hotReflow.GetRowByOffset(y).Attributes() == coldReflow.GetRowByOffset(y).Attributes());
+        }
+        VERIFY_ARE_EQUAL(hotReflow.GetCursor().GetPosition(), coldReflow.GetCursor().GetPosition());
+    }
+}
+
+void TextBufferTests::ColdScrollbackTierMemoryUsage()
+{
+    // 120 columns is the most common width. The lines resemble the output of a build agent,
+    // which is mostly short ASCII text and the case the cold tier is meant for.
+    static constexpr til::size bufferSize{ 120, 1000 };
+    static constexpr std::wstring_view lines[] = {
+        L"Building CXX object src/Row.cpp.obj",
+        L"  OK",
+        L"",
+        L"warning C4100: unreferenced parameter",
+        L"Linking CXX executable conhost.exe",
+        L"$ git status",
+    };
+
+    const auto fill = [&](TextBuffer& tb) {
+        for (size_t i = 0; i < 2000; ++i)
+        {
+            RowWriteState state{ .text = til::at(lines, i % std::size(lines)) };
+            tb.Replace(tb.GetSize().Height() - 1, TextAttribute{ 0x7 }, state);
+            tb.IncrementCircularBuffer();
+        }
+    };
+
+    TextBuffer hot{ bufferSize, TextAttribute{ 0x7 }, 0, false, _renderer };
+    hot.SetColdRowDistance(til::CoordTypeMax);
+    TextBuffer cold{ bufferSize, TextAttribute{ 0x7 }, 0, false, _renderer };
+    cold.SetColdRowDistance(8);
+
+    fill(hot);
+    fill(cold);
+
+    size_t frozenCount = 0;
+    size_t frozenBytes = 0;
+    for (const auto& frozen : cold._frozenRows)
+    {
+        frozenCount += frozen ? 1 : 0;
+        frozenBytes += frozen.MemoryUsage();
+    }
+    VERIFY_ARE_EQUAL(992u, frozenCount);
+
+    Log::Comment(L"A frozen line, including its slot in _frozenRows, should be at least 5x smaller than a ROW.");
+    const auto residentPerLine = (frozenBytes + cold._frozenRows.capacity() * sizeof(FrozenRow)) / frozenCount;
+    Log::Comment(NoThrowString().Format(L"%zu bytes per frozen line, %zu bytes per ROW", residentPerLine, cold._bufferRowStride));
+    VERIFY_IS_LESS_THAN(residentPerLine * 5, cold._bufferRowStride);
+
+    Log::Comment(L"Pages that only hold frozen rows are decommitted. Only the hot rows and the pages they share with frozen ones remain.");
+    const auto arenaBytes = cold.GetCommittedBytes() - frozenBytes - cold._frozenRows.capacity() * sizeof(FrozenRow) - cold._attributePalette->MemoryUsage();
+    VERIFY_IS_LESS_THAN_OR_EQUAL(arenaBytes, gsl::narrow_cast<size_t>(cold.GetColdRowDistance() + 1) * cold._bufferRowStride + 2 * TextBuffer::_pageSize);
+
+    Log::Comment(L"Across the whole buffer, including the hot rows, the savings should still be at least 4x.");
+    Log::Comment(NoThrowString().Format(L"%zu bytes hot, %zu bytes cold", hot.GetCommittedBytes(), cold.GetCommittedBytes()));
+    VERIFY_IS_LESS_THAN(cold.GetCommittedBytes() * 4, hot.GetCommittedBytes());
+
+    Log::Comment(L"Thawing a row commits its pages again, so that it can be read and written.");
+    const auto req = TextBuffer::CopyRequest{ hot, { 0, 0 }, { bufferSize.width - 1, bufferSize.height - 1 }, false, true, true, false };
+    VERIFY_ARE_EQUAL(hot.GetPlainText(req), cold.GetPlainText(req));
+    RowWriteState state{ .text = L"rewritten" };
+    hot.Replace(0, TextAttribute{ 0x7 }, state);
+    state = RowWriteState{ .text = L"rewritten" };
+    cold.Replace(0, TextAttribute{ 0x7 }, state);
+    VERIFY_ARE_EQUAL(hot.GetRowByOffset(0).GetText(), cold.GetRowByOffset(0).GetText());
+}
+
+void TextBufferTests::ColdScrollbackTierAttributeMemoryUsage()
+{
+    // Like ColdScrollbackTierMemoryUsage, but every line consists of many short attribute
+    // runs, like the output of ls or of a compiler with colored diagnostics.
+    static constexpr til::size bufferSize{ 120, 1000 };
+    static constexpr std::wstring_view words[] = {
+        L"build",
+        L"configure",
+        L"README.md",
+        L"latest",
+        L"release.tar.gz",
+        L"src",
+        L"test.sh",
+        L" ",
+    };
+    const TextAttribute attributes[] = {
+        TextAttribute{ 0x07 },
+        TextAttribute{ 0x09 },
+        TextAttribute{ 0x0a },
+        TextAttribute{ 0x0b },
+        TextAttribute{ 0x0c },
+        TextAttribute{ 0x1e },
+        TextAttribute{ 0x70 },
+        TextAttribute{ RGB(255, 128, 64), RGB(0, 0, 0) },
+    };
+
+    const auto fill = [&](TextBuffer& tb, bool colorful) {
+        for (size_t i = 0; i < 2000; ++i)
+        {
+            const auto y = tb.GetSize().Height() - 1;
+            RowWriteState state;
+            for (size_t j = 0; j < std::size(words); ++j)
+            {
+                state.text = til::at(words, j);
+                state.columnBegin = state.columnEnd;
+                tb.Replace(y, colorful ? til::at(attributes, (i + j) % std::size(attributes)) : TextAttribute{ 0x7 }, state);
+            }
+            tb.IncrementCircularBuffer();
+        }
+    };
+    const auto frozenBytes = [](const TextBuffer& tb) {
+        size_t bytes = 0;
+        for (const auto& frozen : tb._frozenRows)
+        {
+            bytes += frozen.MemoryUsage();
+        }
+        return bytes;
+    };
+
+    TextBuffer hot{ bufferSize, TextAttribute{ 0x7 }, 0, false, _renderer };
+    hot.SetColdRowDistance(til::CoordTypeMax);
+    TextBuffer cold{ bufferSize, TextAttribute{ 0x7 }, 0, false, _renderer };
+    cold.SetColdRowDistance(8);
+    TextBuffer plain{ bufferSize, TextAttribute{ 0x7 }, 0, false, _renderer };
+    plain.SetColdRowDistance(8);
+
+    fill(hot, true);
+    fill(cold, true);
+    fill(plain, false);
+
+    static constexpr size_t frozenCount = 992;
+    Log::Comment(NoThrowString().Format(L"%zu bytes hot, %zu bytes cold, %zu bytes of which are the palette", hot.GetCommittedBytes(), cold.GetCommittedBytes(), cold._attributePalette->MemoryUsage()));
+
+    Log::Comment(L"The palette only holds the distinct attributes, plus the default one of the row remainders.");
+    VERIFY_IS_LESS_THAN_OR_EQUAL(cold._attributePalette->Size(), std::size(attributes) + 1);
+    VERIFY_IS_LESS_THAN(cold._attributePalette->MemoryUsage() * 100, frozenBytes(cold));
+
+    Log::Comment(L"The 7 or more additional runs per line should take at least 3x less space than (TextAttribute, length) pairs would.");
+    const auto runBytesPerLine = (frozenBytes(cold) - frozenBytes(plain)) / frozenCount;
+    Log::Comment(NoThrowString().Format(L"%zu bytes per line for the additional runs", runBytesPerLine));
+    VERIFY_IS_LESS_THAN(runBytesPerLine * 3, 7 * sizeof(til::rle_pair<TextAttribute, uint16_t>));
+
+    Log::Comment(L"Across the whole buffer, including the hot rows and the palette, the savings should still be at least 2x.");
+    VERIFY_IS_LESS_THAN(cold.GetCommittedBytes() * 2, hot.GetCommittedBytes());
+
+    Log::Comment(L"Thawed rows get their attributes back.");
+    for (til::CoordType y = 0; y < bufferSize.height; y += 97)
+    {
+        VERIFY_IS_TRUE(hot.GetRowByOffset(y).Attributes() == cold.GetRowByOffset(y).Attributes());
+    }
+}
+
+void TextBufferTests::AttributePaletteCollection()
+{
+    // A true color gradient or animation writes a new attribute for almost every cell.
+    // Overwriting the same cell over and over leaves all but the last one unused.
+    TextBuffer tb{ { 80, 25 }, TextAttribute{ 0x7 }, 0, false, _renderer };
+
+    TextAttribute attr;
+    size_t largestSize = 0;
+    for (uint32_t i = 0; i < 100000; ++i)
+    {
+        attr = TextAttribute{ RGB(i & 0xff, (i >> 8) & 0xff, (i >> 16) & 0xff), RGB(0, 0, 0) };
+        RowWriteState state{ .text = L"x" };
+        tb.Replace(0, attr, state);
+        largestSize = std::max(largestSize, tb._attributePalette->Size());
+    }
+
+    Log::Comment(L"The palette is collected periodically and never grows past the collection threshold.");
+    VERIFY_IS_LESS_THAN_OR_EQUAL(largestSize, TextBuffer::_attributeCollectMinimum + 1);
+
+    Log::Comment(L"Only the default attributes and the last one written are still in use.");
+    tb._collectAttributes();
+    VERIFY_ARE_EQUAL(2u, tb._attributePalette->Size());
+    VERIFY_ARE_EQUAL(attr, tb.GetRowByOffset(0).GetAttrByColumn(0));
+    VERIFY_ARE_EQUAL(TextAttribute{ 0x7 }, tb.GetRowByOffset(0).GetAttrByColumn(1));
+}
+
+void TextBufferTests::TrivialRowTransitions()
+{
+    TextBuffer tb{ { 10, 4 }, TextAttribute{ 0x7 }, 0, false, _renderer };
+    auto& row = tb.GetMutableRowByOffset(0);
+
+    const auto verifyGlyphs = [&](std::initializer_list<std::wstring_view> glyphs) {
+        til::CoordType x = 0;
+        for (const auto& glyph : glyphs)
+        {
+            VERIFY_ARE_EQUAL(glyph, row.GlyphAt(x));
+            VERIFY_ARE_EQUAL(x, row.AdjustToGlyphStart(x));
+            const auto end = row.AdjustToGlyphEnd(x + 1);
+            VERIFY_ARE_EQUAL(end, row.NavigateToNext(x));
+            x = end;
+        }
+        VERIFY_ARE_EQUAL(til::CoordType{ row.size() }, x);
+    };
+
+    Log::Comment(L"ASCII keeps the row trivial.");
+    {
+        RowWriteState state{ .text = L"abc", .columnBegin = 2 };
+        row.ReplaceText(state);
+        row.ReplaceCharacters(6, 1, L"d");
+        VERIFY_ARE_EQUAL(L"  abc d   ", row.GetText());
+        VERIFY_ARE_EQUAL(3, row.GetLeadingColumnAtCharOffset(3));
+        VERIFY_ARE_EQUAL(9, row.GetTrailingColumnAtCharOffset(42));
+        verifyGlyphs({ L" ", L" ", L"a", L"b", L"c", L" ", L"d", L" ", L" ", L" " });
+    }
+
+    Log::Comment(L"Copying a trivial row into another one.");
+    {
+        auto& other = tb.GetMutableRowByOffset(1);
+        RowCopyTextFromState state{ .source = row, .columnBegin = 1, .sourceColumnBegin = 2, .sourceColumnLimit = 5 };
+        other.CopyTextFrom(state);
+        VERIFY_ARE_EQUAL(L" abc      ", other.GetText());
+        VERIFY_ARE_EQUAL(4, state.columnEnd);
+        VERIFY_ARE_EQUAL(5, state.sourceColumnEnd);
+    }
+
+    Log::Comment(L"Wide glyphs and surrogate pairs turn the row non-trivial.");
+    {
+        RowWriteState state{ .text = L"x\u732By\U0001F600", .columnBegin = 3 };
+        row.ReplaceText(state);
+        VERIFY_ARE_EQUAL(L"  ax\u732By\U0001F600 ", row.GetText());
+        VERIFY_IS_TRUE(DbcsAttribute::Leading == row.DbcsAttrAt(4));
+        VERIFY_IS_TRUE(DbcsAttribute::Trailing == row.DbcsAttrAt(5));
+        VERIFY_ARE_EQUAL(4, row.GetLeadingColumnAtCharOffset(4));
+        VERIFY_ARE_EQUAL(8, row.GetTrailingColumnAtCharOffset(7));
+        verifyGlyphs({ L" ", L" ", L"a", L"x", L"\u732B", L"y", L"\U0001F600", L" " });
+    }
+
+    Log::Comment(L"Copying from a non-trivial row retains the wide glyphs.");
+    {
+        auto& other = tb.GetMutableRowByOffset(1);
+        RowCopyTextFromState state{ .source = row, .columnBegin = 0, .sourceColumnBegin = 3, .sourceColumnLimit = 10 };
+        other.CopyTextFrom(state);
+        VERIFY_ARE_EQUAL(L"x\u732By\U0001F600    ", other.GetText());
+        VERIFY_IS_TRUE(DbcsAttribute::Trailing == other.DbcsAttrAt(2));
+    }
+
+    Log::Comment(L"Reset() returns the row into the trivial state.");
+    {
+        row.Reset(TextAttribute{ 0x7 });
+        VERIFY_ARE_EQUAL(L"          ", row.GetText());
+        RowWriteState state{ .text = L"0123456789" };
+        row.ReplaceText(state);
+        VERIFY_ARE_EQUAL(L"0123456789", row.GetText());
+        VERIFY_IS_TRUE(DbcsAttribute::Single == row.DbcsAttrAt(5));
+        verifyGlyphs({ L"0", L"1", L"2", L"3", L"4", L"5", L"6", L"7", L"8", L"9" });
+    }
+}
+
+void TextBufferTests::SearchTextSkipsRowsBySignature()
+{
+    TextBuffer tb{ { 20, 10 }, TextAttribute{ 0x7 }, 0, false, _renderer };
+
+    const auto write = [&](til::CoordType y, std::wstring_view text) {
+        // Rows are 20 columns wide. Any text longer than that wraps into the next row.
+        for (; !text.empty(); ++y)
+        {
+            RowWriteState state{ .text = text };
+            auto& row = tb.GetMutableRowByOffset(y);
+            row.Reset(TextAttribute{ 0x7 });
+            row.ReplaceText(state);
+            text = state.text;
+            row.SetWrapForced(!text.empty());
+        }
+    };
+
+    write(0, L"Hello, World!");
+    write(1, L"the quick brown fox jumps over the lazy dog");
+    write(4, L"\u212Aelvin, code \u732B");
+    write(5, L"HELLO again");
+
+    // The regex path doesn't use the signatures, which makes it a good reference implementation.
+    const auto verify = [&](std::wstring_view needle, SearchFlag flags) {
+        const auto expected = tb.SearchText(needle, flags | SearchFlag::RegularExpression).value();
+        const auto actual = tb.SearchText(needle, flags).value();
+        VERIFY_ARE_EQUAL(expected.size(), actual.size());
+        for (size_t i = 0; i < expected.size(); ++i)
+        {
+            VERIFY_ARE_EQUAL(expected[i].start, actual[i].start);
+            VERIFY_ARE_EQUAL(expected[i].end, actual[i].end);
+        }
+        return actual.size();
+    };
+
+    VERIFY_ARE_EQUAL(1u, verify(L"Hello", SearchFlag::None));
+    VERIFY_ARE_EQUAL(2u, verify(L"hello", SearchFlag::CaseInsensitive));
+    Log::Comment(L"Matches that span across wrapped rows.");
+    VERIFY_ARE_EQUAL(1u, verify(L"fox jumps", SearchFlag::None));
+    VERIFY_ARE_EQUAL(1u, verify(L"LAZY DOG", SearchFlag::CaseInsensitive));
+    Log::Comment(L"KELVIN SIGN matches \"k\" case-insensitively.");
+    VERIFY_ARE_EQUAL(1u, verify(L"kelvin", SearchFlag::CaseInsensitive));
+    VERIFY_ARE_EQUAL(0u, verify(L"kelvin", SearchFlag::None));
+    VERIFY_ARE_EQUAL(1u, verify(L"code \u732B", SearchFlag::None));
+    VERIFY_ARE_EQUAL(0u, verify(L"not there", SearchFlag::CaseInsensitive));
+
+    Log::Comment(L"The signatures must be updated when rows change.");
+    {
+        const auto& row = tb.GetRowByOffset(0);
+        const auto needle = RowSearchSignature::FromText(L"Hello");
+        VERIFY_IS_TRUE(row.GetSearchSignature().MayContain(needle, false));
+        VERIFY_IS_FALSE(tb.GetRowByOffset(7).GetSearchSignature().MayContain(needle, false));
+    }
+    write(0, L"Goodbye, World!");
+    VERIFY_ARE_EQUAL(0u, verify(L"Hello", SearchFlag::None));
+    VERIFY_ARE_EQUAL(1u, verify(L"Goodbye", SearchFlag::None));
+}
+
+void TextBufferTests::LiteralSearchMatchesIcu()
+{
+    TextBuffer tb{ { 120, 9001 }, TextAttribute{ 0x7 }, 0, false, _renderer };
+
+    // Every 7th line wraps across two rows and every 11th contains wide glyphs, which makes for a mix of
+    // lines that are searched in-place, concatenated, or (when case-insensitive and non-ASCII) handed to ICU.
+    for (til::CoordType y = 0; y < 9001; ++y)
+    {
+        std::wstring text = fmt::format(FMT_COMPILE(L"{:05} aaaa Lorem ipsum dolor sit amet, LOREM IPSUM "), y);
+        if (y % 11 == 0)
+        {
+            text.append(L"\u732B\u732B lorem ");
+        }
+        if (y % 7 == 0)
+        {
+            text.append(90, L'x');
+            text.append(L"lorem ipsum");
+        }
+
+        std::wstring_view remaining{ text };
+        for (; !remaining.empty(); ++y)
+        {
+            RowWriteState state{ .text = remaining };
+            auto& row = tb.GetMutableRowByOffset(y);
+            row.ReplaceText(state);
+            remaining = state.text;
+            row.SetWrapForced(!remaining.empty());
+        }
+        --y;
+    }
+
+    const auto verify = [&](std::wstring_view needle, SearchFlag flags) {
+        // \Q...\E turns the regex path into a literal search done entirely by ICU.
+        const auto pattern = fmt::format(FMT_COMPILE(L"\\Q{}\\E"), needle);
+
+        const auto icuBeg = std::chrono::steady_clock::now();
+        const auto expected = tb.SearchText(pattern, flags | SearchFlag::RegularExpression).value();
+        const auto icuEnd = std::chrono::steady_clock::now();
+        const auto actual = tb.SearchText(needle, flags).value();
+        const auto literalEnd = std::chrono::steady_clock::now();
+
+        Log::Comment(NoThrowString().Format(
+            L"\"%.*s\": %zu matches, ICU %lldus, literal %lldus",
+            gsl::narrow_cast<int>(needle.size()),
+            needle.data(),
+            actual.size(),
+            std::chrono::duration_cast<std::chrono::microseconds>(icuEnd - icuBeg).count(),
+            std::chrono::duration_cast<std::chrono::microseconds>(literalEnd - icuEnd).count()));
+
+        VERIFY_ARE_EQUAL(expected.size(), actual.size());
+        for (size_t i = 0; i < expected.size(); ++i)
+        {
+            VERIFY_ARE_EQUAL(expected[i].start, actual[i].start);
+            VERIFY_ARE_EQUAL(expected[i].end, actual[i].end);
+        }
+        return actual.size();
+    };
+
+    verify(L"ipsum", SearchFlag::None);
+    verify(L"ipsum", SearchFlag::CaseInsensitive);
+    verify(L"lorem", SearchFlag::CaseInsensitive);
+    Log::Comment(L"Matches don't overlap.");
+    verify(L"aa", SearchFlag::None);
+    verify(L"AAA", SearchFlag::CaseInsensitive);
+    Log::Comment(L"Matches that span across wrapped rows.");
+    verify(L"xxlorem ip", SearchFlag::None);
+    verify(L"XXLOREM", SearchFlag::CaseInsensitive);
+    Log::Comment(L"Wide glyphs.");
+    verify(L"\u732B lorem", SearchFlag::None);
+    verify(L"\u732B LOREM", SearchFlag::CaseInsensitive);
+    verify(L"x", SearchFlag::None);
+    VERIFY_ARE_EQUAL(0u, verify(L"ipsum lorem", SearchFlag::CaseInsensitive));
+}
+
+void TextBufferTests::SerializeInChunks()
+{
+    TextBuffer tb{ { 40, 30 }, TextAttribute{ 0x7 }, 0, false, _renderer };
+
+    const auto write = [&](til::CoordType y, std::wstring_view text, const TextAttribute& attr) {
+        RowWriteState state{ .text = text };
+        auto& row = tb.GetMutableRowByOffset(y);
+        row.ReplaceText(state);
+        row.ReplaceAttributes(2, 6, attr);
+    };
+
+    for (til::CoordType y = 0; y < 10; ++y)
+    {
+        write(y, fmt::format(FMT_COMPILE(L"row {} says hello"), y), TextAttribute{ gsl::narrow_cast<WORD>(y + 1) });
+    }
+
+    const auto serialize = [&](size_t threshold) {
+        TextBuffer::SerializeState state;
+        std::wstring buffer;
+        while (tb.SerializeRows(state, buffer, threshold))
+        {
+        }
+        VERIFY_ARE_EQUAL(uint64_t{ buffer.size() }, state.written);
+        return buffer;
+    };
+
+    const auto expected = serialize(SIZE_MAX);
+    VERIFY_ARE_EQUAL(L'\uFEFF', expected.front());
+    VERIFY_ARE_EQUAL(std::wstring_view{ expected }, std::wstring_view{ serialize(1) });
+    VERIFY_ARE_EQUAL(std::wstring_view{ expected }, std::wstring_view{ serialize(100) });
+
+    TextBuffer::SerializeState state;
+    TextBuffer::SerializeState resume;
+    std::wstring actual;
+    while (tb.SerializeRows(state, actual, SIZE_MAX, &resume))
+    {
+    }
+    VERIFY_ARE_EQUAL(9, resume.row);
+
+    Log::Comment(L"Modifying the last serialized row or any rows after it allows appending to the output.");
+    write(9, L"row 9 was modified", TextAttribute{ 0x1f });
+    write(12, L"row 12 is new", TextAttribute{ 0x2f });
+    VERIFY_IS_TRUE(tb.CanResumeSerialization(resume));
+
+    actual.resize(gsl::narrow_cast<size_t>(resume.written));
+    state = resume;
+    while (tb.SerializeRows(state, actual, 1, &resume))
+    {
+    }
+    VERIFY_ARE_EQUAL(12, resume.row);
+    VERIFY_ARE_EQUAL(std::wstring_view{ serialize(SIZE_MAX) }, std::wstring_view{ actual });
+
+    Log::Comment(L"Modifying any rows before it requires starting over.");
+    write(3, L"row 3 was modified", TextAttribute{ 0x3f });
+    VERIFY_IS_FALSE(tb.CanResumeSerialization(resume));
+
+    Log::Comment(L"...and so does scrolling.");
+    serialize(SIZE_MAX);
+    VERIFY_IS_TRUE(tb.CanResumeSerialization(resume));
+    tb.IncrementCircularBuffer();
+    VERIFY_IS_FALSE(tb.CanResumeSerialization(resume));
+}
+
+void TextBufferTests::SnapshotRoundTrip()
+{
+    TextBuffer tb{ { 20, 10 }, TextAttribute{ 0x7 }, 0, false, _renderer };
+
+    const auto write = [&](til::CoordType y, std::wstring_view text, til::CoordType columnBegin, til::CoordType columnEnd, const TextAttribute& attr) -> ROW& {
+        RowWriteState state{ .text = text };
+        auto& row = tb.GetMutableRowByOffset(y);
+        row.ReplaceText(state);
+        row.ReplaceAttributes(columnBegin, columnEnd, attr);
+        return row;
+    };
+
+    TextAttribute rgb;
+    rgb.SetForeground(TextColor{ RGB(1, 2, 3) });
+    rgb.SetBackground(TextColor{ 200, true });
+    rgb.SetUnderlineColor(TextColor{ 5, false });
+    rgb.SetUnderlineStyle(UnderlineStyle::CurlyUnderlined);
+    write(0, L"hello \u732B\u732B \U0001F600 world", 6, 10, rgb);
+
+    auto& doubleWidth = write(1, L"double width", 0, 6, TextAttribute{ 0x1f });
+    doubleWidth.SetLineRendition(LineRendition::DoubleWidth);
+
+    auto& wrapped = write(2, L"01234567890123456789", 10, 20, TextAttribute{ 0x2f });
+    wrapped.SetWrapForced(true);
+    write(3, L"0123456789012345678", 0, 20, TextAttribute{ 0x3f }).SetDoubleBytePadded(true);
+    tb.GetMutableRowByOffset(3).SetScrollbarData(ScrollbarData{ .category = MarkCategory::Prompt, .color = til::color{ 0x11, 0x22, 0x33 }, .exitCode = 42 });
+
+    const auto hyperlinkId = tb.GetHyperlinkId(L"https://example.com", L"abc");
+    tb.AddHyperlinkToMap(L"https://example.com", hyperlinkId);
+    TextAttribute hyperlink{ 0x4f };
+    hyperlink.SetHyperlinkId(hyperlinkId);
+    write(5, L"a link", 2, 6, hyperlink);
+
+    tb.GetCursor().SetPosition({ 7, 5 });
+
+    const auto snapshot = tb.SaveSnapshot();
+
+    TextBuffer actual{ { 20, 10 }, TextAttribute{ 0x7 }, 0, false, _renderer };
+    VERIFY_IS_TRUE(actual.LoadSnapshot(snapshot));
+
+    for (til::CoordType y = 0; y < 10; ++y)
+    {
+        const auto& expectedRow = tb.GetRowByOffset(y);
+        const auto& actualRow = actual.GetRowByOffset(y);
+
+        VERIFY_ARE_EQUAL(expectedRow.GetText(), actualRow.GetText());
+        for (til::CoordType x = 0; x < 20; ++x)
+        {
+            VERIFY_ARE_EQUAL(expectedRow.GlyphAt(x), actualRow.GlyphAt(x));
+            VERIFY_IS_TRUE(expectedRow.DbcsAttrAt(x) == actualRow.DbcsAttrAt(x));
+        }
+        VERIFY_IS_TRUE(expectedRow.Attributes() == actualRow.Attributes());
+        VERIFY_IS_TRUE(expectedRow.GetLineRendition() == actualRow.GetLineRendition());
+        VERIFY_ARE_EQUAL(expectedRow.WasWrapForced(), actualRow.WasWrapForced());
+        VERIFY_ARE_EQUAL(expectedRow.WasDoubleBytePadded(), actualRow.WasDoubleBytePadded());
+        VERIFY_ARE_EQUAL(expectedRow.GetScrollbarData().has_value(), actualRow.GetScrollbarData().has_value());
+    }
+
+    const auto& scrollbarData = actual.GetRowByOffset(3).GetScrollbarData();
+    VERIFY_IS_TRUE(scrollbarData->category == MarkCategory::Prompt);
+    VERIFY_IS_TRUE(scrollbarData->color == til::color(0x11, 0x22, 0x33));
+    VERIFY_ARE_EQUAL(42u, scrollbarData->exitCode.value());
+
+    VERIFY_ARE_EQUAL(std::wstring_view{ L"https://example.com" }, std::wstring_view{ actual.GetHyperlinkUriFromId(hyperlinkId) });
+    VERIFY_ARE_EQUAL(hyperlinkId, actual.GetHyperlinkId(L"https://example.com", L"abc"));
+    VERIFY_ARE_EQUAL(til::point(7, 5), actual.GetCursor().GetPosition());
+
+    Log::Comment(L"Snapshots of a different width are reflowed.");
+    TextBuffer narrow{ { 10, 10 }, TextAttribute{ 0x7 }, 0, false, _renderer };
+    VERIFY_IS_TRUE(narrow.LoadSnapshot(snapshot));
+    VERIFY_ARE_EQUAL(std::wstring_view{ L"hello \u732B\u732B" }, narrow.GetRowByOffset(0).GetText());
+    VERIFY_IS_TRUE(narrow.GetRowByOffset(0).WasWrapForced());
+
+    Log::Comment(L"Invalid snapshots are rejected and leave the buffer untouched.");
+    const std::span<const std::byte> data{ snapshot };
+    VERIFY_IS_FALSE(actual.LoadSnapshot(data.first(data.size() - 1)));
+    VERIFY_IS_FALSE(actual.LoadSnapshot(data.first(sizeof(SnapshotHeader) - 1)));
+
+    auto corrupt = snapshot;
+    corrupt.push_back(std::byte{ 0 });
+    VERIFY_IS_FALSE(actual.LoadSnapshot(corrupt));
+    corrupt = snapshot;
+    corrupt[0] = std::byte{ 0 };
+    VERIFY_IS_FALSE(actual.LoadSnapshot(corrupt));
+
+    VERIFY_ARE_EQUAL(tb.GetRowByOffset(0).GetText(), actual.GetRowByOffset(0).GetText());
+}
+
+// GetRowsMutatedSince() must report exactly the rows that were modified after a given snapshot,
+// while ROW::GetInvalidatedColumns() accumulates the columns written since the last snapshot.
+void TextBufferTests::RowsMutatedSinceSnapshot()
+{
+    static constexpr til::size bufferSize{ 20, 10 };
+    TextBuffer tb{ bufferSize, TextAttribute{ 0x7 }, 0, false, _renderer };
+    std::vector<til::CoordType> rows;
+
+    const auto write = [&](const til::CoordType y, const til::CoordType x, const std::wstring_view text) {
+        RowWriteState state{ .text = text, .columnBegin = x };
+        tb.Replace(y, TextAttribute{ 0x7 }, state);
+    };
+    const auto verifyRows = [&](const uint64_t mutationId, const til::CoordType rowBeg, const std::initializer_list<til::CoordType> expected) {
+        tb.GetRowsMutatedSince(mutationId, rowBeg, bufferSize.height, rows);
+        VERIFY_ARE_EQUAL(expected.size(), rows.size());
+        for (size_t i = 0; i < expected.size(); ++i)
+        {
+            VERIFY_ARE_EQUAL(expected.begin()[i], rows[i]);
+        }
+    };
+    const auto verifyColumns = [&](const til::CoordType y, const til::CoordType expectedBegin, const til::CoordType expectedEnd) {
+        const auto [columnBegin, columnEnd] = tb.GetRowByOffset(y).GetInvalidatedColumns();
+        VERIFY_ARE_EQUAL(expectedBegin, columnBegin);
+        VERIFY_ARE_EQUAL(expectedEnd, columnEnd);
+    };
+
+    const auto first = tb.TakeMutationSnapshot();
+    verifyRows(first, 0, {});
+
+    write(2, 3, L"foo");
+    write(7, 0, L"bar");
+    write(2, 10, L"baz");
+    verifyRows(first, 0, { 2, 7 });
+    verifyRows(first, 3, { 7 });
+    verifyColumns(2, 3, 13);
+    verifyColumns(7, 0, 3);
+
+    const auto second = tb.TakeMutationSnapshot();
+    verifyRows(second, 0, {});
+
+    // The first write after a snapshot starts a new range of invalidated columns.
+    write(2, 15, L"x");
+    verifyRows(first, 0, { 2, 7 });
+    verifyRows(second, 0, { 2 });
+    verifyColumns(2, 15, 16);
+    // Rows that weren't written to since keep their stale range, but aren't reported.
+    verifyColumns(7, 0, 3);
+
+    // Moving rows around changes the contents of every row in the rotated range.
+    const auto third = tb.TakeMutationSnapshot();
+    tb.RotateRows(4, 3, -1);
+    verifyRows(third, 0, { 3, 4, 5, 6 });
+    verifyRows(second, 0, { 2, 3, 4, 5, 6 });
+}
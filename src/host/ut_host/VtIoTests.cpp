@@ -389,6 +389,11 @@ public:
     {
         return {};
     }
+
+    std::vector<til::CoordType> GetPatternBoundaries(const til::CoordType /*row*/) const
+    {
+        return {};
+    }
 };
 
 void VtIoTests::RendererDtorAndThread()
@@ -0,0 +1,84 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "FramePacer.hpp"
+
+#include <bit>
+
+#pragma hdrstop
+
+using namespace Microsoft::Console::Render;
+
+FramePacer::FramePacer(const clock::duration minFrameInterval, const clock::duration maxFrameInterval) noexcept :
+    _minFrameInterval{ minFrameInterval },
+    _maxFrameInterval{ std::max(minFrameInterval, maxFrameInterval) },
+    _frameInterval{ minFrameInterval }
+{
+}
+
+// Method Description:
+// - Returns the point in time at which the next frame should be painted, given that it was requested by `now`.
+//   If the last frame began long enough ago, that's `now` itself, so that a key press after
+//   a period of inactivity is drawn as soon as possible.
+// Arguments:
+// - now: The current time.
+// Return Value:
+// - The time at which to paint the next frame. Never earlier than `now`.
+FramePacer::clock::time_point FramePacer::NextFrameTime(const clock::time_point now) const noexcept
+{
+    if (!_painted)
+    {
+        return now;
+    }
+    return std::max(now, _lastFrameBegin + _frameInterval);
+}
+
+// Method Description:
+// - Tells the pacer that a frame was painted and adjusts the frame interval for the next one.
+// Arguments:
+// - firstRequest: The time the first paint request for this frame was made.
+// - begin: The time painting the frame began.
+// - end: The time the frame was presented.
+// - writerBusy: Whether more output was written while the frame was being painted.
+//   If that's the case frame after frame, the writer is saturated and we back off.
+// Return Value:
+// - <none>
+void FramePacer::FramePainted(const clock::time_point firstRequest, const clock::time_point begin, const clock::time_point end, const bool writerBusy) noexcept
+{
+    _lastFrameBegin = begin;
+    _painted = true;
+
+    if (writerBusy)
+    {
+        _frameInterval = std::min(_frameInterval * 2, _maxFrameInterval);
+    }
+    else
+    {
+        _frameInterval = std::max(_frameInterval / 2, _minFrameInterval);
+    }
+
+    til::at(_latencyHistogram, LatencyBucket(end - std::min(firstRequest, begin)))++;
+}
+
+FramePacer::clock::duration FramePacer::FrameInterval() const noexcept
+{
+    return _frameInterval;
+}
+
+const FramePacer::LatencyHistogram& FramePacer::GetLatencyHistogram() const noexcept
+{
+    return _latencyHistogram;
+}
+
+// Returns the index of the histogram bucket the given latency falls into. See LatencyBucketCount.
+size_t FramePacer::LatencyBucket(const clock::duration latency) noexcept
+{
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(latency).count();
+    if (ms <= 0)
+    {
+        return 0;
+    }
+    const auto bucket = gsl::narrow_cast<size_t>(std::bit_width(gsl::narrow_cast<uint64_t>(ms)));
+    return std::min(bucket, LatencyBucketCount - 1);
+}
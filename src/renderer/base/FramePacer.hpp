@@ -0,0 +1,57 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- FramePacer.hpp
+
+Abstract:
+- The policy the RenderThread uses to decide when to paint the next frame.
+- Frames are spaced at least a minimum interval apart. While the writer keeps producing
+  output during every frame, the interval is doubled up to a maximum, so that more output
+  gets coalesced into fewer frames and the console lock is held less often. Once the writer
+  calms down, the interval is halved again. An idle console gets its next frame immediately.
+- It also records a histogram of the latency between the first paint request for a frame
+  and the end of that frame.
+- It doesn't read the clock itself, so that it can be tested deterministically.
+--*/
+
+#pragma once
+
+#include <array>
+#include <chrono>
+
+namespace Microsoft::Console::Render
+{
+    class FramePacer
+    {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        // Frames are painted at most at 240 FPS and at least at 30 FPS while the writer floods us.
+        static constexpr clock::duration DefaultMinFrameInterval = std::chrono::microseconds{ 4167 };
+        static constexpr clock::duration DefaultMaxFrameInterval = std::chrono::microseconds{ 33333 };
+
+        // Bucket 0 counts latencies below 1ms, bucket N latencies in [2^(N-1), 2^N) ms,
+        // and the last bucket everything from 2^(LatencyBucketCount-2) ms upwards.
+        static constexpr size_t LatencyBucketCount = 12;
+        using LatencyHistogram = std::array<uint32_t, LatencyBucketCount>;
+
+        FramePacer(clock::duration minFrameInterval = DefaultMinFrameInterval, clock::duration maxFrameInterval = DefaultMaxFrameInterval) noexcept;
+
+        clock::time_point NextFrameTime(clock::time_point now) const noexcept;
+        void FramePainted(clock::time_point firstRequest, clock::time_point begin, clock::time_point end, bool writerBusy) noexcept;
+
+        clock::duration FrameInterval() const noexcept;
+        const LatencyHistogram& GetLatencyHistogram() const noexcept;
+        static size_t LatencyBucket(clock::duration latency) noexcept;
+
+    private:
+        clock::duration _minFrameInterval;
+        clock::duration _maxFrameInterval;
+        clock::duration _frameInterval;
+        clock::time_point _lastFrameBegin{};
+        bool _painted = false;
+        LatencyHistogram _latencyHistogram{};
+    };
+}
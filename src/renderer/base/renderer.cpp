@@ -121,6 +121,9 @@ IRenderData* Renderer::GetRenderData() const noexcept
         // Last chance check if anything scrolled without an explicit invalidate notification since the last frame.
         _CheckViewportAndScroll();
 
+        // Pick up all the text that was written since the last frame.
+        _invalidateMutatedRows();
+
         _invalidateCurrentCursor(); // Invalidate the previous cursor position.
         _invalidateOldComposition();
 
@@ -763,14 +766,13 @@ void Renderer::_PaintBufferOutput(_In_ IRenderEngine* const pEngine)
             const auto& r = buffer.GetRowByOffset(row);
 
             // Draw the active composition.
-            // We have to use some tricks here with const_cast, because the code after it relies on TextBufferCellIterator,
-            // which isn't compatible with the scratchpad row. This forces us to back up and modify the actual row `r`.
-            ROW* rowBackup = nullptr;
+            // It's written into a copy of the row in the scratchpad, which is then painted in place of the row itself.
+            auto paintRow = &r;
             if (row == compositionRow)
             {
                 auto& scratch = buffer.GetScratchpadRow();
                 scratch.CopyFrom(r);
-                rowBackup = &scratch;
+                paintRow = &scratch;
 
                 std::wstring_view text{ _pData->activeComposition.text };
                 RowWriteState state{
@@ -796,17 +798,11 @@ void Renderer::_PaintBufferOutput(_In_ IRenderEngine* const pEngine)
 
                     state.text = text.substr(off, len);
                     state.columnBegin = state.columnEnd;
-                    const_cast<ROW&>(r).ReplaceText(state);
-                    const_cast<ROW&>(r).ReplaceAttributes(state.columnBegin, state.columnEnd, attr);
+                    scratch.ReplaceText(state);
+                    scratch.ReplaceAttributes(state.columnBegin, state.columnEnd, attr);
                     off += len;
                 }
             }
-            const auto restore = wil::scope_exit([&] {
-                if (rowBackup)
-                {
-                    const_cast<ROW&>(r).CopyFrom(*rowBackup);
-                }
-            });
 
             // Convert the screen coordinates of the line to an equivalent
             // range of buffer cells, taking line rendition into account.
@@ -820,21 +816,18 @@ void Renderer::_PaintBufferOutput(_In_ IRenderEngine* const pEngine)
             // of the backing buffer to fill in line 1 of the screen.
             const auto screenPosition = bufferLine.Origin() - til::point{ 0, view.Top() };
 
-            // Retrieve the cell information iterator limited to just this line we want to redraw.
-            auto it = buffer.GetCellDataAt(bufferLine.Origin(), bufferLine);
-
             // Calculate if two things are true:
             // 1. this row wrapped
             // 2. We're painting the last col of the row.
             // In that case, set lineWrapped=true for the _PaintBufferOutputHelper call.
-            const auto lineWrapped = (buffer.GetRowByOffset(bufferLine.Origin().y).WasWrapForced()) &&
+            const auto lineWrapped = paintRow->WasWrapForced() &&
                                      (bufferLine.RightExclusive() == buffer.GetSize().Width());
 
             // Prepare the appropriate line transform for the current row and viewport offset.
             LOG_IF_FAILED(pEngine->PrepareLineTransform(lineRendition, screenPosition.y, view.Left()));
 
             // Ask the helper to paint through this specific line.
-            _PaintBufferOutputHelper(pEngine, it, screenPosition, lineWrapped);
+            _PaintBufferOutputHelper(pEngine, *paintRow, bufferLine.Left(), bufferLine.RightExclusive(), screenPosition, lineWrapped);
         }
     }
 }
@@ -845,154 +838,191 @@ static bool _IsAllSpaces(const std::wstring_view v)
     return v.find_first_not_of(L' ') == decltype(v)::npos;
 }
 
+// Routine Description:
+// - Paint helper for a single line of the buffer. It walks the glyphs in the given range of the ROW
+//   and splits them into runs of the same attributes, regex patterns and font usage, which are then
+//   handed to the engine as clusters pointing straight into the ROW's text.
+// - Runs can only change where an attribute run of the ROW ends or where a pattern starts or ends,
+//   so the attributes are only compared at those boundaries and not for every single cell.
+// Arguments:
+// - row - The ROW to paint
+// - columnBegin - The first column of the ROW to paint
+// - columnEnd - The column past the last one to paint
+// - target - The position on the screen where columnBegin is painted
+// - lineWrapped - Whether the line wrapped and the last column of the ROW is being painted
+// Return Value:
+// - <none>
 void Renderer::_PaintBufferOutputHelper(_In_ IRenderEngine* const pEngine,
-                                        TextBufferCellIterator it,
+                                        const ROW& row,
+                                        const til::CoordType columnBegin,
+                                        til::CoordType columnEnd,
                                         const til::point target,
                                         const bool lineWrapped)
 {
-    auto globalInvert{ _renderSettings.GetRenderMode(RenderSettings::Mode::ScreenReversed) };
+    columnEnd = std::min<til::CoordType>(columnEnd, row.size());
+    if (columnBegin >= columnEnd)
+    {
+        return;
+    }
 
-    // If we have valid data, let's figure out how to draw it.
-    if (it)
+    const auto globalInvert{ _renderSettings.GetRenderMode(RenderSettings::Mode::ScreenReversed) };
+    const auto screenOffset = target.x - columnBegin;
+
+    // Find the attribute run the first column belongs to. The runs store indices into the
+    // row's attribute palette, which deduplicates attributes, so equal indices mean equal attributes.
+    const auto& runs = row.AttributeIndices().runs();
+    const auto& palette = row.AttributePalette();
+    auto run = runs.begin();
+    til::CoordType runEnd = run->length;
+    const auto seekRun = [&](const til::CoordType column) {
+        while (runEnd <= column)
+        {
+            ++run;
+            runEnd += run->length;
+        }
+    };
+    seekRun(columnBegin);
+
+    // The columns at which the regex patterns on this line start or end, in ascending order.
+    // The ones at or before the first column don't split anything and are skipped right away.
+    const auto patternBoundaries = _pData->GetPatternBoundaries(target.y);
+    auto nextPatternBoundary = std::upper_bound(patternBoundaries.begin(), patternBoundaries.end(), target.x);
+
+    // Retrieve the first color and determine whether we're using a soft font.
+    auto colorIndex = run->value;
+    auto color = palette.At(colorIndex);
+    auto usingSoftFont = s_IsSoftFontChar(row.GlyphAt(columnBegin), _firstSoftFontChar, _lastSoftFontChar);
+
+    // This outer loop will continue until we reach the end of the text we are trying to draw.
+    auto column = columnBegin;
+    while (column < columnEnd)
     {
-        // TODO: MSFT: 20961091 -  This is a perf issue. Instead of rebuilding this and allocing memory to hold the reinterpretation,
-        // we should have an iterator/view adapter for the rendering.
-        // That would probably also eliminate the RenderData needing to give us the entire TextBuffer as well...
-        // Retrieve the iterator for one line of information.
-        til::CoordType cols = 0;
-
-        // Retrieve the first color.
-        auto color = it->TextAttr();
-        // Retrieve the first pattern id
-        auto patternIds = _pData->GetPatternId(target);
-        // Determine whether we're using a soft font.
-        auto usingSoftFont = s_IsSoftFontChar(it->Chars(), _firstSoftFontChar, _lastSoftFontChar);
-
-        // And hold the point where we should start drawing.
-        auto screenPoint = target;
-
-        // This outer loop will continue until we reach the end of the text we are trying to draw.
-        while (it)
+        // Hold onto the current run color right here for the length of the outer loop.
+        // We'll be changing the persistent one as we run through the inner loop to detect
+        // when a run changes, but we will still need to know this color at the bottom
+        // when we go to draw gridlines for the length of the run.
+        const auto currentRunColor = color;
+
+        // Update the drawing brushes with our color and font usage.
+        THROW_IF_FAILED(_UpdateDrawingBrushes(pEngine, currentRunColor, usingSoftFont, false));
+
+        // Hold onto the column where this run starts in case we need
+        // to do some special work to paint the line drawing characters.
+        const auto currentRunColumnBegin = column;
+        auto screenPoint = til::point{ column + screenOffset, target.y };
+
+        // Ensure that our cluster vector is clear.
+        _clusterBuffer.clear();
+
+        // Reset our flag to know when we're in the special circumstance
+        // of attempting to draw only the right-half of a two-column character
+        // as the first item in our run.
+        auto trimLeft = false;
+
+        // Run contains wide character (>1 columns)
+        auto containsWideCharacter = false;
+
+        // Whether the attributes at the current column differ from the run's.
+        // This only needs to be rechecked once we cross into another attribute run.
+        auto attributesChanged = false;
+
+        // This inner loop will accumulate clusters until the color changes.
+        // When the color changes, it will save the new color off and break.
+        // We also accumulate clusters according to regex patterns
+        do
         {
-            // Hold onto the current run color right here for the length of the outer loop.
-            // We'll be changing the persistent one as we run through the inner loops to detect
-            // when a run changes, but we will still need to know this color at the bottom
-            // when we go to draw gridlines for the length of the run.
-            const auto currentRunColor = color;
-
-            // Hold onto the current pattern id as well
-            const auto currentPatternId = patternIds;
-
-            // Update the drawing brushes with our color and font usage.
-            THROW_IF_FAILED(_UpdateDrawingBrushes(pEngine, currentRunColor, usingSoftFont, false));
-
-            // Advance the point by however many columns we've just outputted and reset the accumulator.
-            screenPoint.x += cols;
-            cols = 0;
-
-            // Hold onto the start of this run iterator and the target location where we started
-            // in case we need to do some special work to paint the line drawing characters.
-            const auto currentRunItStart = it;
-            const auto currentRunTargetStart = screenPoint;
-
-            // Ensure that our cluster vector is clear.
-            _clusterBuffer.clear();
-
-            // Reset our flag to know when we're in the special circumstance
-            // of attempting to draw only the right-half of a two-column character
-            // as the first item in our run.
-            auto trimLeft = false;
-
-            // Run contains wide character (>1 columns)
-            auto containsWideCharacter = false;
-
-            // This inner loop will accumulate clusters until the color changes.
-            // When the color changes, it will save the new color off and break.
-            // We also accumulate clusters according to regex patterns
-            do
+            const auto glyph = row.GlyphAt(column);
+
+            // The first glyph of a run always belongs to it. For all others we check whether the attributes,
+            // regex patterns or font usage changed. Attributes can only change where an attribute run ends,
+            // and patterns only where one of them starts or ends, so only those two need to be compared.
+            if (column != currentRunColumnBegin)
             {
-                til::point thisPoint{ screenPoint.x + cols, screenPoint.y };
-                const auto thisPointPatterns = _pData->GetPatternId(thisPoint);
-                const auto thisUsingSoftFont = s_IsSoftFontChar(it->Chars(), _firstSoftFontChar, _lastSoftFontChar);
-                const auto changedPatternOrFont = patternIds != thisPointPatterns || usingSoftFont != thisUsingSoftFont;
-                if (color != it->TextAttr() || changedPatternOrFont)
+                if (column >= runEnd)
+                {
+                    seekRun(column);
+                    attributesChanged = run->value != colorIndex;
+                }
+
+                auto changedPatternOrFont = false;
+                for (; nextPatternBoundary != patternBoundaries.end() && *nextPatternBoundary <= column + screenOffset; ++nextPatternBoundary)
                 {
-                    auto newAttr{ it->TextAttr() };
+                    changedPatternOrFont = true;
+                }
+
+                const auto thisUsingSoftFont = s_IsSoftFontChar(glyph, _firstSoftFontChar, _lastSoftFontChar);
+                changedPatternOrFont |= usingSoftFont != thisUsingSoftFont;
+
+                if (attributesChanged || changedPatternOrFont)
+                {
+                    const auto& newAttr = palette.At(run->value);
                     // foreground doesn't matter for runs of spaces (!)
                     // if we trick it . . . we call Paint far fewer times for cmatrix
-                    if (!_IsAllSpaces(it->Chars()) || !newAttr.HasIdenticalVisualRepresentationForBlankSpace(color, globalInvert) || changedPatternOrFont)
+                    if (!_IsAllSpaces(glyph) || !newAttr.HasIdenticalVisualRepresentationForBlankSpace(color, globalInvert) || changedPatternOrFont)
                     {
                         color = newAttr;
-                        patternIds = thisPointPatterns;
+                        colorIndex = run->value;
                         usingSoftFont = thisUsingSoftFont;
                         break; // vend this run
                     }
                 }
+            }
 
-                // Walk through the text data and turn it into rendering clusters.
-                // Keep the columnCount as we go to improve performance over digging it out of the vector at the end.
-                auto columnCount = it->Columns();
-
-                // If we're on the first cluster to be added and it's marked as "trailing"
-                // (a.k.a. the right half of a two column character), then we need some special handling.
-                if (_clusterBuffer.empty() && it->DbcsAttr() == DbcsAttribute::Trailing)
-                {
-                    // Move left to the one so the whole character can be struck correctly.
-                    --screenPoint.x;
-                    // And tell the next function to trim off the left half of it.
-                    trimLeft = true;
-                    // And add one to the number of columns we expect it to take as we insert it.
-                    ++columnCount;
-                }
+            // Walk through the text data and turn it into rendering clusters.
+            const auto dbcsAttr = row.DbcsAttrAt(column);
+            auto columnCount = dbcsAttr == DbcsAttribute::Leading ? 2 : 1;
 
-                if (columnCount > 1)
-                {
-                    containsWideCharacter = true;
-                }
+            // If we're on the first cluster to be added and it's marked as "trailing"
+            // (a.k.a. the right half of a two column character), then we need some special handling.
+            if (_clusterBuffer.empty() && dbcsAttr == DbcsAttribute::Trailing)
+            {
+                // Move left to the one so the whole character can be struck correctly.
+                --screenPoint.x;
+                // And tell the next function to trim off the left half of it.
+                trimLeft = true;
+                // And add one to the number of columns we expect it to take as we insert it.
+                ++columnCount;
+            }
 
-                // Advance the cluster and column counts.
-                _clusterBuffer.emplace_back(it->Chars(), columnCount);
-                it += std::max(it->Columns(), 1); // prevent infinite loop for no visible columns
-                cols += columnCount;
+            if (columnCount > 1)
+            {
+                containsWideCharacter = true;
+            }
 
-            } while (it);
+            // Advance the cluster and column counts.
+            _clusterBuffer.emplace_back(glyph, columnCount);
+            column += dbcsAttr == DbcsAttribute::Leading ? 2 : 1;
+        } while (column < columnEnd);
 
-            // Do the painting.
-            THROW_IF_FAILED(pEngine->PaintBufferLine({ _clusterBuffer.data(), _clusterBuffer.size() }, screenPoint, trimLeft, lineWrapped));
+        // Do the painting.
+        THROW_IF_FAILED(pEngine->PaintBufferLine({ _clusterBuffer.data(), _clusterBuffer.size() }, screenPoint, trimLeft, lineWrapped));
 
-            // If we're allowed to do grid drawing, draw that now too (since it will be coupled with the color data)
-            // We're only allowed to draw the grid lines under certain circumstances.
-            if (_pData->IsGridLineDrawingAllowed())
+        // If we're allowed to do grid drawing, draw that now too (since it will be coupled with the color data)
+        // We're only allowed to draw the grid lines under certain circumstances.
+        if (_pData->IsGridLineDrawingAllowed())
+        {
+            // See GH: 803
+            // If we found a wide character while we looped above, it's possible we skipped over the right half
+            // attribute that could have contained different line information than the left half.
+            if (containsWideCharacter)
             {
-                // See GH: 803
-                // If we found a wide character while we looped above, it's possible we skipped over the right half
-                // attribute that could have contained different line information than the left half.
-                if (containsWideCharacter)
-                {
-                    // Start from the original position in this run.
-                    auto lineIt = currentRunItStart;
-                    // Start from the original target in this run.
-                    auto lineTarget = currentRunTargetStart;
-
-                    // We need to go through the iterators again to ensure we get the lines associated with each
-                    // exact column. The code above will condense two-column characters into one, but it is possible
-                    // (like with the IME) that the line drawing characters will vary from the left to right half
-                    // of a wider character.
-                    // We could theoretically pre-pass for this in the loop above to be more efficient about walking
-                    // the iterator, but I fear it would make the code even more confusing than it already is.
-                    // Do that in the future if some WPR trace points you to this spot as super bad.
-                    for (til::CoordType colsPainted = 0; colsPainted < cols; ++colsPainted, ++lineIt, ++lineTarget.x)
-                    {
-                        auto lines = lineIt->TextAttr();
-                        _PaintBufferOutputGridLineHelper(pEngine, lines, 1, lineTarget);
-                    }
-                }
-                else
+                // We need to go through the attributes again to ensure we get the lines associated with each
+                // exact column. The code above will condense two-column characters into one, but it is possible
+                // (like with the IME) that the line drawing characters will vary from the left to right half
+                // of a wider character.
+                auto lineTarget = til::point{ currentRunColumnBegin + screenOffset, target.y };
+                auto lineAttr = row.AttrBegin() + currentRunColumnBegin;
+                const auto lineEnd = std::min<til::CoordType>(column, row.size());
+                for (auto lineColumn = currentRunColumnBegin; lineColumn < lineEnd; ++lineColumn, ++lineAttr, ++lineTarget.x)
                 {
-                    // If nothing exciting is going on, draw the lines in bulk.
-                    _PaintBufferOutputGridLineHelper(pEngine, currentRunColor, cols, screenPoint);
+                    _PaintBufferOutputGridLineHelper(pEngine, *lineAttr, 1, lineTarget);
                 }
             }
+            else
+            {
+                // If nothing exciting is going on, draw the lines in bulk.
+                _PaintBufferOutputGridLineHelper(pEngine, currentRunColor, column - currentRunColumnBegin, screenPoint);
+            }
         }
     }
 }
@@ -1171,6 +1201,51 @@ void Renderer::_updateCursorInfo()
     _currentCursorOptions.inViewport = xInRange && yInRange;
 }
 
+// Routine Description:
+// - Invalidates the columns the TextBuffer recorded as written to since the last frame (see
+//   TextBuffer::TakeMutationSnapshot()) and starts recording anew for the next one.
+// - Writing text doesn't call TriggerRedraw() for every single write, because it used to be
+//   a significant cost of printing text. This catches up on all of them in a single pass.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void Renderer::_invalidateMutatedRows()
+{
+    auto& buffer = _pData->GetTextBuffer();
+    const auto view = _pData->GetViewport();
+
+    buffer.GetRowsMutatedSince(buffer.GetMutationSnapshot(), view.Top(), view.BottomExclusive(), _mutatedRows);
+    buffer.TakeMutationSnapshot();
+
+    for (const auto y : _mutatedRows)
+    {
+        const auto& row = buffer.GetRowByOffset(y);
+        auto [columnBegin, columnEnd] = row.GetInvalidatedColumns();
+        if (columnBegin >= columnEnd)
+        {
+            continue;
+        }
+
+        // Each column of a double width line covers two columns on the screen.
+        if (row.GetLineRendition() != LineRendition::SingleWidth)
+        {
+            columnBegin *= 2;
+            columnEnd *= 2;
+        }
+
+        til::rect rect{ columnBegin, y, columnEnd, y + 1 };
+        if (view.TrimToViewport(&rect))
+        {
+            view.ConvertToOrigin(&rect);
+            FOREACH_ENGINE(pEngine)
+            {
+                LOG_IF_FAILED(pEngine->Invalidate(&rect));
+            }
+        }
+    }
+}
+
 void Renderer::_invalidateCurrentCursor() const
 {
     if (!_currentCursorOptions.inViewport || !_currentCursorOptions.isOn)
@@ -1525,3 +1600,11 @@ void Renderer::WaitUntilCanRender()
         pEngine->WaitUntilCanRender();
     }
 }
+
+// Method Description:
+// - Returns the frame latency histogram of the render thread. See RenderThread::GetLatencyHistogram().
+//   It's empty if there's no render thread, like in our unit tests.
+FramePacer::LatencyHistogram Renderer::GetLatencyHistogram() noexcept
+{
+    return _pThread ? _pThread->GetLatencyHistogram() : FramePacer::LatencyHistogram{};
+}
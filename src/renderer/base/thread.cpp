@@ -13,12 +13,15 @@ using namespace Microsoft::Console::Render;
 RenderThread::RenderThread() :
     _pRenderer(nullptr),
     _hThread(nullptr),
+    _threadId(0),
     _hEvent(nullptr),
     _hPaintCompletedEvent(nullptr),
+    _hPaceTimer(nullptr),
     _fKeepRunning(true),
     _hPaintEnabledEvent(nullptr),
     _fNextFrameRequested(false),
-    _fWaiting(false)
+    _fWaiting(false),
+    _firstRequestTime(0)
 {
 }
 
@@ -51,6 +54,12 @@ RenderThread::~RenderThread()
         CloseHandle(_hPaintCompletedEvent);
         _hPaintCompletedEvent = nullptr;
     }
+
+    if (_hPaceTimer)
+    {
+        CloseHandle(_hPaceTimer);
+        _hPaceTimer = nullptr;
+    }
 }
 
 // Method Description:
@@ -120,6 +129,26 @@ RenderThread::~RenderThread()
         }
     }
 
+    if (SUCCEEDED(hr))
+    {
+        // High resolution timers are only supported since Windows 10 1803.
+        // Older versions get a regular one, which has the same resolution as Sleep().
+        auto hPaceTimer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+        if (hPaceTimer == nullptr)
+        {
+            hPaceTimer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+        }
+
+        if (hPaceTimer == nullptr)
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+        }
+        else
+        {
+            _hPaceTimer = hPaceTimer;
+        }
+    }
+
     if (SUCCEEDED(hr))
     {
         auto hThread = CreateThread(nullptr, // non-inheritable security attributes
@@ -127,8 +156,7 @@ RenderThread::~RenderThread()
                                     s_ThreadProc,
                                     this,
                                     0, // create immediately
-                                    nullptr // we don't need the thread ID
-        );
+                                    &_threadId);
 
         if (hThread == nullptr)
         {
@@ -213,16 +241,81 @@ DWORD WINAPI RenderThread::_ThreadProc()
             ResetEvent(_hEvent);
         }
 
-        ResetEvent(_hPaintCompletedEvent);
-        LOG_IF_FAILED(_pRenderer->PaintFrame());
-        SetEvent(_hPaintCompletedEvent);
+        _PaceFrame();
     }
 
     return S_OK;
 }
 
+// Method Description:
+// - Paints the requested frame, but no earlier than the FramePacer allows.
+//   Any output written in the meantime gets coalesced into the same frame.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void RenderThread::_PaceFrame() noexcept
+{
+    using clock = FramePacer::clock;
+
+    // Reset the event before we wait for the pacer, or WaitForPaintCompletionAndDisable()
+    // could return and disable painting while we're about to paint another frame.
+    ResetEvent(_hPaintCompletedEvent);
+
+    const auto now = clock::now();
+    const auto next = _pacer.NextFrameTime(now);
+    if (next > now)
+    {
+        _WaitFor(next - now);
+    }
+
+    const auto begin = clock::now();
+    const auto firstRequestTime = _firstRequestTime.exchange(0, std::memory_order_relaxed);
+    const auto firstRequest = firstRequestTime ? clock::time_point{ clock::duration{ firstRequestTime } } : begin;
+    LOG_IF_FAILED(_pRenderer->PaintFrame());
+    const auto end = clock::now();
+
+    SetEvent(_hPaintCompletedEvent);
+
+    // If another request came in while we were painting, the writer produced more output in the meantime.
+    const auto writerBusy = _firstRequestTime.load(std::memory_order_relaxed) != 0;
+    _pacer.FramePainted(firstRequest, begin, end, writerBusy);
+
+    const auto guard = _latencyHistogramLock.lock_exclusive();
+    _latencyHistogram = _pacer.GetLatencyHistogram();
+    _frameInterval = _pacer.FrameInterval();
+}
+
+// Method Description:
+// - Blocks the render thread for the given duration. Sleep() rounds up to the system timer resolution,
+//   which is 15.6ms by default and would cap us at 64 FPS. The high resolution timer doesn't.
+// Arguments:
+// - duration: How long to wait.
+// Return Value:
+// - <none>
+void RenderThread::_WaitFor(const FramePacer::clock::duration duration) noexcept
+{
+    // Negative due times are relative and in 100ns units.
+    using filetime_duration = std::chrono::duration<int64_t, std::ratio<1, 10'000'000>>;
+    LARGE_INTEGER dueTime{};
+    dueTime.QuadPart = -std::max<int64_t>(1, std::chrono::ceil<filetime_duration>(duration).count());
+
+    if (SetWaitableTimer(_hPaceTimer, &dueTime, 0, nullptr, nullptr, FALSE))
+    {
+        WaitForSingleObject(_hPaceTimer, INFINITE);
+    }
+}
+
 void RenderThread::NotifyPaint() noexcept
 {
+    // Requests made by the render thread itself (for instance for engines that require continuous redraw)
+    // are neither a sign of a busy writer, nor should they count towards the latency of the next frame.
+    if (_firstRequestTime.load(std::memory_order_relaxed) == 0 && GetCurrentThreadId() != _threadId)
+    {
+        auto expected = FramePacer::clock::rep{ 0 };
+        _firstRequestTime.compare_exchange_strong(expected, FramePacer::clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+    }
+
     if (_fWaiting.load(std::memory_order_acquire))
     {
         SetEvent(_hEvent);
@@ -233,6 +326,23 @@ void RenderThread::NotifyPaint() noexcept
     }
 }
 
+// Method Description:
+// - Returns a histogram of the time between the first paint request for a frame and the end of that frame.
+//   See FramePacer::LatencyBucketCount for the buckets.
+FramePacer::LatencyHistogram RenderThread::GetLatencyHistogram() noexcept
+{
+    const auto guard = _latencyHistogramLock.lock_shared();
+    return _latencyHistogram;
+}
+
+// Method Description:
+// - Returns the interval the pacer currently keeps between frames. It grows while the writer is busy.
+FramePacer::clock::duration RenderThread::GetFrameInterval() noexcept
+{
+    const auto guard = _latencyHistogramLock.lock_shared();
+    return _frameInterval;
+}
+
 void RenderThread::EnablePainting() noexcept
 {
     SetEvent(_hPaintEnabledEvent);
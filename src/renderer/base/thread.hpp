@@ -14,6 +14,8 @@ Author(s):
 
 #pragma once
 
+#include "FramePacer.hpp"
+
 namespace Microsoft::Console::Render
 {
     class Renderer;
@@ -31,20 +33,36 @@ namespace Microsoft::Console::Render
         void DisablePainting() noexcept;
         void WaitForPaintCompletionAndDisable(const DWORD dwTimeoutMs) noexcept;
 
+        FramePacer::LatencyHistogram GetLatencyHistogram() noexcept;
+        FramePacer::clock::duration GetFrameInterval() noexcept;
+
     private:
         static DWORD WINAPI s_ThreadProc(_In_ LPVOID lpParameter);
         DWORD WINAPI _ThreadProc();
+        void _PaceFrame() noexcept;
+        void _WaitFor(FramePacer::clock::duration duration) noexcept;
 
         HANDLE _hThread;
+        DWORD _threadId;
         HANDLE _hEvent;
 
         HANDLE _hPaintEnabledEvent;
         HANDLE _hPaintCompletedEvent;
+        HANDLE _hPaceTimer;
 
         Renderer* _pRenderer; // Non-ownership pointer
 
         bool _fKeepRunning;
         std::atomic<bool> _fNextFrameRequested;
         std::atomic<bool> _fWaiting;
+
+        // The time (in FramePacer::clock ticks) of the first paint request for the upcoming frame that didn't come from
+        // the render thread itself, or 0 if there's none yet. If one arrives while a frame is being painted, the writer is busy.
+        std::atomic<FramePacer::clock::rep> _firstRequestTime;
+        FramePacer _pacer;
+        // Protects the copies of the pacer's state returned by GetLatencyHistogram() and GetFrameInterval().
+        wil::srwlock _latencyHistogramLock;
+        FramePacer::LatencyHistogram _latencyHistogram{};
+        FramePacer::clock::duration _frameInterval{ FramePacer::DefaultMinFrameInterval };
     };
 }
@@ -65,6 +65,7 @@ namespace Microsoft::Console::Render
         virtual const std::wstring GetHyperlinkUri(uint16_t id) const = 0;
         virtual const std::wstring GetHyperlinkCustomId(uint16_t id) const = 0;
         virtual const std::vector<size_t> GetPatternId(const til::point location) const = 0;
+        virtual std::vector<til::CoordType> GetPatternBoundaries(const til::CoordType row) const = 0;
 
         // This block used to be IUiaData.
         virtual std::pair<COLORREF, COLORREF> GetAttributeColors(const TextAttribute& attr) const noexcept = 0;
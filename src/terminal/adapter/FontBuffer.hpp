@@ -27,7 +27,7 @@ namespace Microsoft::Console::VirtualTerminal
                            const DispatchTypes::DrcsFontUsage fontUsage) noexcept;
         bool SetStartChar(const VTParameter startChar,
                           const DispatchTypes::CharsetSize charsetSize) noexcept;
-        void AddSixelData(const wchar_t ch);
+        void AddSixelData(const std::wstring_view data);
         bool FinalizeSixelData();
 
         std::span<const uint16_t> GetBitPattern() const noexcept;
@@ -23,7 +23,7 @@ namespace Microsoft::Console::VirtualTerminal
 class Microsoft::Console::VirtualTerminal::ITermDispatch
 {
 public:
-    using StringHandler = std::function<bool(const wchar_t)>;
+    using StringHandler = std::function<bool(const std::wstring_view)>; // See IStateMachineEngine::StringHandler
 
 #pragma warning(push)
 #pragma warning(disable : 26432) // suppress rule of 5 violation on interface because tampering with this is fraught with peril
@@ -31,6 +31,7 @@ public:
 
     virtual void Print(const wchar_t wchPrintable) = 0;
     virtual void PrintString(const std::wstring_view string) = 0;
+    virtual void PrintAsciiString(const std::wstring_view string) = 0; // PrintString, for printable ASCII only
 
     virtual bool CursorUp(const VTInt distance) = 0; // CUU
     virtual bool CursorDown(const VTInt distance) = 0; // CUD
@@ -164,6 +165,10 @@ public:
                                       const DispatchTypes::MacroEncoding encoding) = 0; // DECDMAC
     virtual bool InvokeMacro(const VTInt macroId) = 0; // DECINVM
 
+    virtual StringHandler DefineSixelImage(const VTParameter aspectRatio,
+                                           const DispatchTypes::SixelBackground backgroundSelect,
+                                           const VTParameter gridSize) = 0; // SIXEL
+
     virtual StringHandler RestoreTerminalState(const DispatchTypes::ReportFormat format) = 0; // DECRSTS
 
     virtual StringHandler RequestSetting() = 0; // DECRQSS
@@ -53,7 +53,16 @@ void MacroBuffer::InvokeMacro(const size_t macroId, StateMachine& stateMachine)
                     _invokedSequenceLength = 0;
                 }
             });
-            stateMachine.ProcessString(macroSequence);
+            // Rather than parsing the macro every time it's invoked, we replay
+            // the actions that were recorded when it was first parsed. It has
+            // to be recorded again if the parser modes have since changed.
+            auto recording = til::at(_recordings, macroId);
+            if (!recording || !stateMachine.CanReplay(*recording))
+            {
+                recording = std::make_shared<StateMachine::Recording>(stateMachine.Record(macroSequence));
+                til::at(_recordings, macroId) = recording;
+            }
+            stateMachine.Replay(*recording, macroSequence);
         }
     }
 }
@@ -70,6 +79,14 @@ void MacroBuffer::ClearMacrosIfInUse()
         {
             std::fill(macro.begin(), macro.end(), AsciiChars::NUL);
         }
+        // The recordings would otherwise still replay the original content.
+        for (auto& recording : _recordings)
+        {
+            if (recording)
+            {
+                recording->Invalidate();
+            }
+        }
     }
 }
 
@@ -99,12 +116,14 @@ bool MacroBuffer::InitParser(const size_t macroId, const DispatchTypes::MacroDel
         {
         case DispatchTypes::MacroDeleteControl::DeleteId:
             _deleteMacro(_activeMacro());
+            til::at(_recordings, macroId) = nullptr;
             return true;
         case DispatchTypes::MacroDeleteControl::DeleteAll:
             for (auto& macro : _macros)
             {
                 _deleteMacro(macro);
             }
+            _recordings = {};
             return true;
         default:
             return false;
@@ -113,7 +132,31 @@ bool MacroBuffer::InitParser(const size_t macroId, const DispatchTypes::MacroDel
     return false;
 }
 
-bool MacroBuffer::ParseDefinition(const wchar_t ch)
+bool MacroBuffer::ParseDefinition(const std::wstring_view data)
+{
+    for (auto it = data.begin(); it != data.end();)
+    {
+        // Text encoded content is copied as is, so everything up to the next
+        // control character can be appended to the macro in one go.
+        if (_parseState == State::ExpectingText && *it >= L' ')
+        {
+            const auto end = std::find_if(it, data.end(), [](const auto ch) { return ch < L' '; });
+            if (!_appendToActiveMacro(std::wstring_view{ it, end }))
+            {
+                _deleteMacro(_activeMacro());
+                return false;
+            }
+            it = end;
+        }
+        else if (!_parseDefinitionChar(*it++))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool MacroBuffer::_parseDefinitionChar(const wchar_t ch)
 {
     // Once we receive an ESC, that marks the end of the definition, but if
     // an unterminated repeat is still pending, we should apply that now.
@@ -233,6 +276,17 @@ bool MacroBuffer::_appendToActiveMacro(const wchar_t ch)
     return false;
 }
 
+bool MacroBuffer::_appendToActiveMacro(const std::wstring_view text)
+{
+    if (GetSpaceAvailable() >= text.length())
+    {
+        _activeMacro().append(text);
+        _spaceUsed += text.length();
+        return true;
+    }
+    return false;
+}
+
 std::wstring& MacroBuffer::_activeMacro()
 {
     return _macros.at(_activeMacroId);
@@ -12,6 +12,7 @@ Abstract:
 #pragma once
 
 #include "DispatchTypes.hpp"
+#include "../parser/stateMachine.hpp"
 #include <array>
 #include <bitset>
 #include <string>
@@ -23,8 +24,6 @@ class AdapterTest;
 
 namespace Microsoft::Console::VirtualTerminal
 {
-    class StateMachine;
-
     class MacroBuffer
     {
     public:
@@ -44,11 +43,13 @@ namespace Microsoft::Console::VirtualTerminal
         void InvokeMacro(const size_t macroId, StateMachine& stateMachine);
         void ClearMacrosIfInUse();
         bool InitParser(const size_t macroId, const DispatchTypes::MacroDeleteControl deleteControl, const DispatchTypes::MacroEncoding encoding);
-        bool ParseDefinition(const wchar_t ch);
+        bool ParseDefinition(const std::wstring_view data);
 
     private:
+        bool _parseDefinitionChar(const wchar_t ch);
         bool _decodeHexDigit(const wchar_t ch) noexcept;
         bool _appendToActiveMacro(const wchar_t ch);
+        bool _appendToActiveMacro(const std::wstring_view text);
         std::wstring& _activeMacro();
         void _deleteMacro(std::wstring& macro) noexcept;
         bool _applyPendingRepeat();
@@ -67,6 +68,10 @@ namespace Microsoft::Console::VirtualTerminal
         size_t _repeatCount{ 0 };
         size_t _repeatStart{ 0 };
         std::array<std::wstring, 64> _macros;
+        // The parsed form of each macro, recorded on its first invocation. A
+        // recording is shared with the invocations that are replaying it, so
+        // it stays alive if it's replaced by a nested invocation.
+        std::array<std::shared_ptr<StateMachine::Recording>, 64> _recordings;
         size_t _activeMacroId{ 0 };
         size_t _spaceUsed{ 0 };
         size_t _invokedDepth{ 0 };
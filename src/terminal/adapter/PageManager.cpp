@@ -163,32 +163,14 @@ void PageManager::MoveTo(const til::CoordType pageNumber, const bool makeVisible
     const auto visibleTop = visibleViewport.top;
     const auto wasVisible = _activePageNumber == _visiblePageNumber;
     const auto newPageNumber = std::min(std::max(pageNumber, 1), MAX_PAGES);
-    auto redrawRequired = false;
-
-    // If we're changing the visible page, what we do is swap out the current
-    // visible page into its backing buffer, and swap in the new page from the
-    // backing buffer to the main buffer. That way the rest of the system only
-    // ever has to deal with the main buffer.
-    if (makeVisible && _visiblePageNumber != newPageNumber)
-    {
-        const auto& newBuffer = _getBuffer(newPageNumber, pageSize);
-        auto& saveBuffer = _getBuffer(_visiblePageNumber, pageSize);
-        for (auto i = 0; i < pageSize.height; i++)
-        {
-            saveBuffer.GetMutableRowByOffset(i).CopyFrom(visibleBuffer.GetRowByOffset(visibleTop + i));
-        }
-        for (auto i = 0; i < pageSize.height; i++)
-        {
-            visibleBuffer.GetMutableRowByOffset(visibleTop + i).CopyFrom(newBuffer.GetRowByOffset(i));
-        }
-        _visiblePageNumber = newPageNumber;
-        redrawRequired = true;
-    }
+    const auto newVisiblePageNumber = makeVisible ? newPageNumber : _visiblePageNumber;
 
     // If the active page was previously visible, and is now still visible,
     // there is no need to update any buffer properties, because we'll have
-    // been using the main buffer in both cases.
-    const auto isVisible = newPageNumber == _visiblePageNumber;
+    // been using the main buffer in both cases. This is done before the
+    // visible page is swapped, since that may hand the buffer of the new
+    // page over to the old one.
+    const auto isVisible = newPageNumber == newVisiblePageNumber;
     if (!wasVisible || !isVisible)
     {
         // Otherwise we need to copy the properties from the old buffer to the
@@ -219,9 +201,15 @@ void PageManager::MoveTo(const til::CoordType pageNumber, const bool makeVisible
         }
     }
 
+    // If we're changing the visible page, what we do is swap out the current
+    // visible page into its backing buffer, and swap in the new page from the
+    // backing buffer to the main buffer. That way the rest of the system only
+    // ever has to deal with the main buffer.
     _activePageNumber = newPageNumber;
-    if (redrawRequired)
+    if (newVisiblePageNumber != _visiblePageNumber)
     {
+        _swapVisiblePage(visibleBuffer, visibleTop, pageSize, newVisiblePageNumber);
+        _visiblePageNumber = newVisiblePageNumber;
         _renderer.TriggerRedrawAll();
     }
 }
@@ -239,6 +227,100 @@ void PageManager::MakeActivePageVisible()
     }
 }
 
+// Releases the buffers of all background pages that are blank, other than
+// the active page, which holds the cursor position and attributes. This is
+// used by a soft reset, which is typically sent by apps when they exit.
+void PageManager::ReleaseBlankPages()
+{
+    for (auto pageNumber = 1; pageNumber <= MAX_PAGES; pageNumber++)
+    {
+        auto& buffer = til::at(_buffers, pageNumber - 1);
+        if (buffer && pageNumber != _activePageNumber)
+        {
+            const auto height = buffer->GetSize().Height();
+            if (pageNumber == _visiblePageNumber || _isBlank(*buffer, 0, height))
+            {
+                buffer.reset();
+            }
+        }
+    }
+}
+
+// Returns the memory committed by the backing buffer of the given page.
+// This is 0 for pages that are blank or visible, since they don't have one.
+size_t PageManager::CommittedBytes(const til::CoordType pageNumber) const noexcept
+{
+    const auto& buffer = til::at(_buffers, std::min(std::max(pageNumber, 1), MAX_PAGES) - 1);
+    return buffer ? buffer->GetCommittedBytes() : 0;
+}
+
+// Swaps the content of the visible page with that of the given page. A page
+// without a buffer is blank, so it can be made visible by simply erasing the
+// visible rows, and a blank visible page doesn't need a buffer to be saved to.
+// Otherwise the buffer of the new page is reused to hold the old visible page,
+// so that a page swap never needs more than one buffer.
+void PageManager::_swapVisiblePage(TextBuffer& visibleBuffer, const til::CoordType visibleTop, const til::size pageSize, const til::CoordType newPageNumber)
+{
+    auto& newSlot = til::at(_buffers, newPageNumber - 1);
+    auto& saveSlot = til::at(_buffers, _visiblePageNumber - 1);
+    const auto saveRequired = !_isBlank(visibleBuffer, visibleTop, pageSize.height);
+
+    if (newSlot)
+    {
+        auto& newBuffer = _getBuffer(newPageNumber, pageSize);
+        auto& scratchpad = newBuffer.GetScratchpadRow();
+        for (auto i = 0; i < pageSize.height; i++)
+        {
+            auto& visibleRow = visibleBuffer.GetMutableRowByOffset(visibleTop + i);
+            auto& pageRow = newBuffer.GetMutableRowByOffset(i);
+            scratchpad.CopyFrom(pageRow);
+            pageRow.CopyFrom(visibleRow);
+            visibleRow.CopyFrom(scratchpad);
+        }
+        saveSlot = saveRequired ? std::move(newSlot) : nullptr;
+        newSlot = nullptr;
+    }
+    else
+    {
+        if (saveRequired)
+        {
+            auto& saveBuffer = _getBuffer(_visiblePageNumber, pageSize);
+            for (auto i = 0; i < pageSize.height; i++)
+            {
+                saveBuffer.GetMutableRowByOffset(i).CopyFrom(visibleBuffer.GetRowByOffset(visibleTop + i));
+            }
+        }
+        else
+        {
+            saveSlot = nullptr;
+        }
+        for (auto i = 0; i < pageSize.height; i++)
+        {
+            visibleBuffer.GetMutableRowByOffset(visibleTop + i).Reset(TextAttribute{});
+        }
+    }
+}
+
+// Returns true if the given rows look exactly like those of a newly created
+// page buffer: No text, images or line renditions and default attributes.
+bool PageManager::_isBlank(const TextBuffer& buffer, const til::CoordType top, const til::CoordType height)
+{
+    for (auto y = top; y < top + height; y++)
+    {
+        const auto& row = buffer.GetRowByOffset(y);
+        const auto& runs = row.AttributeIndices().runs();
+        if (row.ContainsText() ||
+            row.GetImageSlice() ||
+            row.GetLineRendition() != LineRendition::SingleWidth ||
+            runs.size() != 1 ||
+            row.AttributePalette().At(runs.front().value) != TextAttribute{})
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 TextBuffer& PageManager::_getBuffer(const til::CoordType pageNumber, const til::size pageSize) const
 {
     auto& buffer = til::at(_buffers, pageNumber - 1);
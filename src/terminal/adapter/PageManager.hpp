@@ -54,15 +54,23 @@ namespace Microsoft::Console::VirtualTerminal
         void MoveTo(const til::CoordType pageNumber, const bool makeVisible);
         void MoveRelative(const til::CoordType pageCount, const bool makeVisible);
         void MakeActivePageVisible();
+        void ReleaseBlankPages();
+        size_t CommittedBytes(const til::CoordType pageNumber) const noexcept;
 
     private:
         TextBuffer& _getBuffer(const til::CoordType pageNumber, const til::size pageSize) const;
+        void _swapVisiblePage(TextBuffer& visibleBuffer, const til::CoordType visibleTop, const til::size pageSize, const til::CoordType newPageNumber);
+        static bool _isBlank(const TextBuffer& buffer, const til::CoordType top, const til::CoordType height);
 
         ITerminalApi& _api;
         Renderer& _renderer;
         til::CoordType _activePageNumber = 1;
         til::CoordType _visiblePageNumber = 1;
         static constexpr til::CoordType MAX_PAGES = 6;
+        // A page without a buffer is blank. Buffers are only created once a page
+        // is actually accessed, and are released again when a page turns blank.
+        // The buffer of the visible page is always released, because its content
+        // lives in the main buffer while it's visible.
         mutable std::array<std::unique_ptr<TextBuffer>, MAX_PAGES> _buffers;
     };
 }
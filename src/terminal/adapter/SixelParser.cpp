@@ -0,0 +1,295 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "SixelParser.hpp"
+
+#include "../../types/inc/utils.hpp"
+
+using namespace Microsoft::Console::VirtualTerminal;
+
+// The default color palette of the VT340 (the first 16 entries repeat to fill the table).
+static constexpr std::array<til::color, 16> defaultPalette{
+    til::color{ 0, 0, 0 },
+    til::color{ 51, 51, 204 },
+    til::color{ 204, 33, 33 },
+    til::color{ 51, 204, 51 },
+    til::color{ 204, 51, 204 },
+    til::color{ 51, 204, 204 },
+    til::color{ 204, 204, 51 },
+    til::color{ 135, 135, 135 },
+    til::color{ 66, 66, 66 },
+    til::color{ 84, 84, 153 },
+    til::color{ 153, 66, 66 },
+    til::color{ 84, 153, 84 },
+    til::color{ 153, 84, 153 },
+    til::color{ 84, 153, 153 },
+    til::color{ 153, 153, 84 },
+    til::color{ 204, 204, 204 },
+};
+
+SixelParser::SixelParser(const VTParameter aspectRatio, const DispatchTypes::SixelBackground backgroundSelect) noexcept :
+    _transparent{ backgroundSelect == DispatchTypes::SixelBackground::Transparent }
+{
+    // The first parameter of the DCS selects the pixel aspect ratio (the number
+    // of pixel rows per sixel bit), unless it's overridden by raster attributes.
+    switch (aspectRatio.value_or(0))
+    {
+    case 2:
+        _aspectRatio = 5;
+        break;
+    case 3:
+    case 4:
+        _aspectRatio = 3;
+        break;
+    case 7:
+    case 8:
+    case 9:
+        _aspectRatio = 1;
+        break;
+    default:
+        _aspectRatio = 2;
+        break;
+    }
+
+    for (size_t i = 0; i < _palette.size(); ++i)
+    {
+        til::at(_palette, i) = til::at(defaultPalette, i % defaultPalette.size());
+    }
+    _color = til::at(_palette, 0);
+}
+
+void SixelParser::Parse(const std::wstring_view data)
+{
+    for (auto it = data.begin(); it != data.end(); ++it)
+    {
+        const auto ch = *it;
+
+        // Parameters of the current command are accumulated until a character other than a digit or semicolon.
+        if (_state != State::Normal)
+        {
+            if (ch >= L'0' && ch <= L'9')
+            {
+                auto& value = til::at(_parameters, std::min(_parameterCount, _parameters.size() - 1));
+                value = std::min(value * 10 + (ch - L'0'), MAX_PARAMETER);
+                continue;
+            }
+            if (ch == L';')
+            {
+                _parameterCount = std::min(_parameterCount + 1, _parameters.size());
+                continue;
+            }
+
+            if (_state == State::Repeat && ch >= L'?' && ch <= L'~')
+            {
+                _state = State::Normal;
+                _writeSixel(ch - L'?', std::max(_parameters[0], 1));
+                continue;
+            }
+
+            _executeCommand();
+        }
+
+        if (ch >= L'?' && ch <= L'~')
+        {
+            _writeSixel(ch - L'?', 1);
+        }
+        else if (ch == L'#')
+        {
+            _startCommand(State::Color);
+        }
+        else if (ch == L'!')
+        {
+            _startCommand(State::Repeat);
+        }
+        else if (ch == L'"')
+        {
+            _startCommand(State::Attributes);
+        }
+        else if (ch == L'$')
+        {
+            _x = 0;
+        }
+        else if (ch == L'-')
+        {
+            _x = 0;
+            _bandTop = std::min(_bandTop + 6 * _aspectRatio, MAX_HEIGHT);
+        }
+    }
+}
+
+// Must be called once the data string has ended. Applies the background color if requested.
+void SixelParser::Finish()
+{
+    if (_state != State::Normal)
+    {
+        _executeCommand();
+    }
+
+    if (!_transparent)
+    {
+        const auto background = til::at(_palette, 0);
+        for (til::CoordType y = 0; y < _size.height; ++y)
+        {
+            const auto line = _pixels.begin() + gsl::narrow_cast<ptrdiff_t>(y) * _capacity.width;
+            std::replace_if(line, line + _size.width, [](const auto& px) { return px.a == 0; }, background);
+        }
+    }
+
+    // Compact the pixels to a stride of _size.width, which is what Pixels() promises.
+    if (_capacity.width != _size.width)
+    {
+        for (til::CoordType y = 1; y < _size.height; ++y)
+        {
+            const auto src = _pixels.begin() + gsl::narrow_cast<ptrdiff_t>(y) * _capacity.width;
+            std::copy(src, src + _size.width, _pixels.begin() + gsl::narrow_cast<ptrdiff_t>(y) * _size.width);
+        }
+        _capacity.width = _size.width;
+    }
+    _pixels.resize(gsl::narrow_cast<size_t>(_size.width) * _size.height);
+    _capacity.height = _size.height;
+}
+
+til::size SixelParser::ImageSize() const noexcept
+{
+    return _size;
+}
+
+// Returns the pixels of the image line by line. Only valid after Finish().
+std::span<const til::color> SixelParser::Pixels() const noexcept
+{
+    return _pixels;
+}
+
+void SixelParser::_startCommand(const State state) noexcept
+{
+    _state = state;
+    _parameters = {};
+    _parameterCount = 0;
+}
+
+void SixelParser::_executeCommand()
+{
+    switch (_state)
+    {
+    case State::Color:
+        _defineColor();
+        break;
+    case State::Attributes:
+        _setRasterAttributes();
+        break;
+    default:
+        break;
+    }
+    _state = State::Normal;
+}
+
+// #Pc selects a color, #Pc;Pu;Px;Py;Pz defines it in the HLS (Pu = 1) or RGB (Pu = 2) color space.
+void SixelParser::_defineColor() noexcept
+{
+    const auto index = gsl::narrow_cast<size_t>(_parameters[0] % MAX_COLORS);
+    auto& color = til::at(_palette, index);
+
+    if (_parameterCount >= 4)
+    {
+        const auto x = _parameters[2];
+        const auto y = std::min(_parameters[3], 100);
+        const auto z = std::min(_parameters[4], 100);
+
+        if (_parameters[1] == 1)
+        {
+            color = Utils::ColorFromHLS(std::min(x, 360), y, z);
+        }
+        else if (_parameters[1] == 2)
+        {
+            color = Utils::ColorFromRGB100(std::min(x, 100), y, z);
+        }
+    }
+
+    _color = color;
+}
+
+// "Pan;Pad;Ph;Pv sets the pixel aspect ratio (Pan/Pad) and the size of the image.
+void SixelParser::_setRasterAttributes()
+{
+    const auto numerator = _parameters[0];
+    const auto denominator = _parameters[1];
+    if (numerator > 0 && denominator > 0)
+    {
+        _aspectRatio = std::clamp((numerator + denominator - 1) / denominator, 1, 100);
+    }
+
+    const auto width = std::min(_parameters[2], MAX_WIDTH);
+    const auto height = std::min(_parameters[3], MAX_HEIGHT);
+    if (width > 0 && height > 0)
+    {
+        _reserve(width, height);
+        _size.width = std::max(_size.width, width);
+        _size.height = std::max(_size.height, height);
+    }
+}
+
+// Sets the pixels of the bits in value (0-63) in `count` consecutive columns of the current band.
+void SixelParser::_writeSixel(const VTInt value, const til::CoordType count)
+{
+    const auto x = _x;
+    _x = std::min(_x + count, MAX_WIDTH);
+
+    const auto width = _x - x;
+    if (width <= 0 || value == 0)
+    {
+        return;
+    }
+
+    const auto lastBit = 32 - std::countl_zero(gsl::narrow_cast<uint32_t>(value));
+    const auto bottom = std::min(_bandTop + lastBit * _aspectRatio, MAX_HEIGHT);
+    _reserve(_x, bottom);
+    _size.width = std::max(_size.width, _x);
+    _size.height = std::max(_size.height, bottom);
+
+    for (auto bit = 0; bit < lastBit; ++bit)
+    {
+        if (!(value & (1 << bit)))
+        {
+            continue;
+        }
+
+        const auto top = _bandTop + bit * _aspectRatio;
+        const auto end = std::min(top + _aspectRatio, MAX_HEIGHT);
+        for (auto y = top; y < end; ++y)
+        {
+            const auto line = _pixels.begin() + gsl::narrow_cast<ptrdiff_t>(y) * _capacity.width;
+            std::fill(line + x, line + _x, _color);
+        }
+    }
+}
+
+// Ensures that the pixel buffer is at least width x height large. The buffer grows geometrically in
+// both dimensions, so that the total cost of growing it is linear in the size of the final image.
+void SixelParser::_reserve(const til::CoordType width, const til::CoordType height)
+{
+    if (width <= _capacity.width && height <= _capacity.height)
+    {
+        return;
+    }
+
+    const auto newWidth = width <= _capacity.width ? _capacity.width : std::min(std::max({ width, _capacity.width * 2, 64 }), MAX_WIDTH);
+    const auto newHeight = height <= _capacity.height ? _capacity.height : std::min(std::max({ height, _capacity.height * 2, 6 * _aspectRatio }), MAX_HEIGHT);
+
+    if (newWidth == _capacity.width)
+    {
+        _pixels.resize(gsl::narrow_cast<size_t>(newWidth) * newHeight);
+    }
+    else
+    {
+        std::vector<til::color> pixels(gsl::narrow_cast<size_t>(newWidth) * newHeight);
+        for (til::CoordType y = 0; y < _capacity.height; ++y)
+        {
+            const auto src = _pixels.begin() + gsl::narrow_cast<ptrdiff_t>(y) * _capacity.width;
+            std::copy(src, src + _capacity.width, pixels.begin() + gsl::narrow_cast<ptrdiff_t>(y) * newWidth);
+        }
+        _pixels = std::move(pixels);
+    }
+
+    _capacity = { newWidth, newHeight };
+}
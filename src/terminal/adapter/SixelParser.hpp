@@ -0,0 +1,70 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- SixelParser.hpp
+
+Abstract:
+- This decodes the data string of a Sixel image (DCS q) into an RGBA pixel buffer.
+--*/
+
+#pragma once
+
+#include "DispatchTypes.hpp"
+
+namespace Microsoft::Console::VirtualTerminal
+{
+    class SixelParser
+    {
+    public:
+        // Images are mapped onto the text buffer as if each cell was 10x20 pixels, like on a VT340.
+        static constexpr til::size CellSize{ 10, 20 };
+        static constexpr VTInt MAX_COLORS = 256;
+        static constexpr til::CoordType MAX_WIDTH = 4096;
+        static constexpr til::CoordType MAX_HEIGHT = 4096;
+
+        SixelParser(const VTParameter aspectRatio, const DispatchTypes::SixelBackground backgroundSelect) noexcept;
+        void Parse(const std::wstring_view data);
+        void Finish();
+
+        til::size ImageSize() const noexcept;
+        std::span<const til::color> Pixels() const noexcept;
+
+    private:
+        static constexpr VTInt MAX_PARAMETER = 65535;
+
+        enum class State
+        {
+            Normal,
+            Attributes,
+            Color,
+            Repeat
+        };
+
+        void _executeCommand();
+        void _startCommand(const State state) noexcept;
+        void _defineColor() noexcept;
+        void _setRasterAttributes();
+        void _writeSixel(const VTInt value, const til::CoordType count);
+        void _reserve(const til::CoordType width, const til::CoordType height);
+
+        State _state = State::Normal;
+        std::array<VTInt, 5> _parameters{};
+        size_t _parameterCount = 0;
+
+        std::array<til::color, MAX_COLORS> _palette{};
+        til::color _color;
+        bool _transparent = false;
+
+        til::CoordType _aspectRatio = 2;
+        til::CoordType _x = 0;
+        til::CoordType _bandTop = 0;
+
+        // The pixels are stored with a stride of _capacity.width, which grows geometrically,
+        // so that images of unknown size can be decoded in linear time.
+        std::vector<til::color> _pixels;
+        til::size _capacity;
+        til::size _size;
+    };
+}
@@ -16,6 +16,24 @@ using namespace Microsoft::Console::VirtualTerminal;
 
 static constexpr std::wstring_view whitespace{ L" " };
 
+// Turns a function that parses a data string one character at a time into a
+// StringHandler. This is fine for the short strings of reports and IDs, but
+// large data strings should be handled in bulk.
+template<typename T>
+static ITermDispatch::StringHandler _forEachChar(T parser)
+{
+    return [parser = std::move(parser)](const std::wstring_view string) mutable {
+        for (const auto ch : string)
+        {
+            if (!parser(ch))
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+}
+
 AdaptDispatch::AdaptDispatch(ITerminalApi& api, Renderer& renderer, RenderSettings& renderSettings, TerminalInput& terminalInput) :
     _api{ api },
     _renderer{ renderer },
@@ -71,7 +89,27 @@ void AdaptDispatch::PrintString(const std::wstring_view string)
     }
 }
 
-void AdaptDispatch::_WriteToBuffer(const std::wstring_view string)
+// Routine Description
+// - Same as PrintString, but the string is known to consist of printable ASCII
+//   characters only. This allows the TextBuffer to skip glyph width lookups.
+// Arguments:
+// - string - Text to display
+// Return Value:
+// - <none>
+void AdaptDispatch::PrintAsciiString(const std::wstring_view string)
+{
+    // The translation may map ASCII to anything, for instance DEC line drawing characters.
+    if (_termOutput.NeedToTranslate())
+    {
+        PrintString(string);
+    }
+    else
+    {
+        _WriteToBuffer(string, true);
+    }
+}
+
+void AdaptDispatch::_WriteToBuffer(const std::wstring_view string, const bool ascii)
 {
     auto page = _pages.ActivePage();
     auto& textBuffer = page.Buffer();
@@ -95,6 +133,7 @@ void AdaptDispatch::_WriteToBuffer(const std::wstring_view string)
     RowWriteState state{
         .text = string,
         .columnLimit = lineWidth,
+        .ascii = ascii,
     };
 
     while (!state.text.empty())
@@ -604,27 +643,30 @@ void AdaptDispatch::_ScrollRectVertically(const Page& page, const til::rect& scr
         if (width == page.Width())
         {
             // If the scrollRect is the full width of the buffer, we can scroll
-            // more efficiently by rotating the row storage.
-            textBuffer.ScrollRows(top, height, actualDelta);
-            textBuffer.TriggerRedraw(Viewport::FromExclusive(scrollRect));
+            // more efficiently by rotating the row storage. The rows that are
+            // rotated into the revealed area get erased below.
+            textBuffer.RotateRows(top, height, actualDelta);
+
+            // If the whole page scrolls, the renderer can scroll its previous
+            // frame as well, instead of redrawing everything. Like for a line
+            // feed, the cursor needs to be turned off first, to avoid leaving
+            // a ghost cursor behind.
+            if (scrollRect.top == page.Top() && scrollRect.bottom == page.Bottom())
+            {
+                textBuffer.GetCursor().SetIsOn(false);
+                textBuffer.TriggerScroll({ 0, actualDelta });
+            }
+            else
+            {
+                textBuffer.TriggerRedraw(Viewport::FromExclusive(scrollRect));
+            }
         }
         else
         {
             // Otherwise we have to move the content up or down by copying the
-            // requested buffer range one cell at a time.
-            const auto srcOrigin = til::point{ scrollRect.left, top };
-            const auto dstOrigin = til::point{ scrollRect.left, top + actualDelta };
-            const auto srcView = Viewport::FromDimensions(srcOrigin, width, height);
-            const auto dstView = Viewport::FromDimensions(dstOrigin, width, height);
-            const auto walkDirection = Viewport::DetermineWalkDirection(srcView, dstView);
-            auto srcPos = srcView.GetWalkOrigin(walkDirection);
-            auto dstPos = dstView.GetWalkOrigin(walkDirection);
-            do
-            {
-                const auto current = OutputCell(*textBuffer.GetCellDataAt(srcPos));
-                textBuffer.WriteLine(OutputCellIterator({ &current, 1 }), dstPos);
-                srcView.WalkInBounds(srcPos, walkDirection);
-            } while (dstView.WalkInBounds(dstPos, walkDirection));
+            // requested buffer range one row at a time.
+            const auto srcRect = til::rect{ til::point{ scrollRect.left, top }, til::size{ width, height } };
+            textBuffer.CopyRect(textBuffer, srcRect, { scrollRect.left, top + actualDelta });
         }
     }
 
@@ -659,22 +701,10 @@ void AdaptDispatch::_ScrollRectHorizontally(const Page& page, const til::rect& s
         const auto height = scrollRect.height();
         const auto actualDelta = delta > 0 ? absoluteDelta : -absoluteDelta;
 
-        const auto source = Viewport::FromDimensions({ left, top }, width, height);
-        const auto target = Viewport::Offset(source, { actualDelta, 0 });
-        const auto walkDirection = Viewport::DetermineWalkDirection(source, target);
-        auto sourcePos = source.GetWalkOrigin(walkDirection);
-        auto targetPos = target.GetWalkOrigin(walkDirection);
-        // Note that we read two cells from the source before we start writing
-        // to the target, so a two-cell DBCS character can't accidentally delete
-        // itself when moving one cell horizontally.
-        auto next = OutputCell(*textBuffer.GetCellDataAt(sourcePos));
-        do
-        {
-            const auto current = next;
-            source.WalkInBounds(sourcePos, walkDirection);
-            next = OutputCell(*textBuffer.GetCellDataAt(sourcePos));
-            textBuffer.WriteLine(OutputCellIterator({ &current, 1 }), targetPos);
-        } while (target.WalkInBounds(targetPos, walkDirection));
+        // CopyRect moves each row through a scratchpad, so a two-cell DBCS
+        // character can't accidentally delete itself when moving one cell.
+        const auto source = til::rect{ til::point{ left, top }, til::size{ width, height } };
+        textBuffer.CopyRect(textBuffer, source, { left + actualDelta, top });
     }
 
     // Columns revealed by the scroll are filled with standard erase attributes.
@@ -883,17 +913,36 @@ void AdaptDispatch::_SelectiveEraseRect(const Page& page, const til::rect& erase
 {
     if (eraseRect)
     {
+        auto& textBuffer = page.Buffer();
+        // The scratchpad row is all whitespace, so copying its text over a
+        // range of cells clears them, without touching their attributes.
+        const auto& blankRow = textBuffer.GetScratchpadRow();
         for (auto row = eraseRect.top; row < eraseRect.bottom; row++)
         {
-            auto& rowBuffer = page.Buffer().GetMutableRowByOffset(row);
-            for (auto col = eraseRect.left; col < eraseRect.right; col++)
+            auto& rowBuffer = textBuffer.GetMutableRowByOffset(row);
+            // Only unprotected cells are affected, so we walk the attribute
+            // runs of the row and clear each unprotected one in a single go.
+            const auto& palette = rowBuffer.AttributePalette();
+            auto runEnd = 0;
+            for (const auto& run : rowBuffer.AttributeIndices().runs())
             {
-                // Only unprotected cells are affected.
-                if (!rowBuffer.GetAttrByColumn(col).IsProtected())
+                const auto runBegin = std::max(runEnd, eraseRect.left);
+                runEnd += run.length;
+                const auto clearEnd = std::min(runEnd, eraseRect.right);
+                if (runBegin < clearEnd && !palette.At(run.value).IsProtected())
+                {
+                    RowCopyTextFromState state{
+                        .source = blankRow,
+                        .columnBegin = runBegin,
+                        .columnLimit = clearEnd,
+                        .sourceColumnBegin = runBegin,
+                    };
+                    rowBuffer.CopyTextFrom(state);
+                    textBuffer.TriggerRedraw(Viewport::FromExclusive({ state.columnBeginDirty, row, state.columnEndDirty, row + 1 }));
+                }
+                if (runEnd >= eraseRect.right)
                 {
-                    // The text is cleared but the attributes are left as is.
-                    rowBuffer.ClearCell(col);
-                    page.Buffer().TriggerRedraw(Viewport::FromCoord({ col, row }));
+                    break;
                 }
             }
         }
@@ -1229,28 +1278,21 @@ bool AdaptDispatch::CopyRectangularArea(const VTInt top, const VTInt left, const
     {
         // If the source is bigger than the available space at the destination
         // it needs to be clipped, so we only care about the destination size.
-        const auto srcView = Viewport::FromDimensions(srcRect.origin(), dstRect.size());
-        const auto dstView = Viewport::FromDimensions(dstRect.origin(), dstRect.size());
-        const auto walkDirection = Viewport::DetermineWalkDirection(srcView, dstView);
-        auto srcPos = srcView.GetWalkOrigin(walkDirection);
-        auto dstPos = dstView.GetWalkOrigin(walkDirection);
-        // Note that we read two cells from the source before we start writing
-        // to the target, so a two-cell DBCS character can't accidentally delete
-        // itself when moving one cell horizontally.
-        auto next = OutputCell(*src.Buffer().GetCellDataAt(srcPos));
-        do
+        const auto width = dstRect.width();
+        const auto height = dstRect.height();
+        // The rows are copied one at a time, since the source rows may have
+        // different widths. If the areas overlap and the destination is further
+        // down, they need to be copied from the bottom up.
+        const auto bottomUp = &src.Buffer() == &dst.Buffer() && dstRect.top > srcRect.top;
+        for (auto i = 0; i < height; i++)
         {
-            const auto current = next;
-            const auto currentSrcPos = srcPos;
-            srcView.WalkInBounds(srcPos, walkDirection);
-            next = OutputCell(*src.Buffer().GetCellDataAt(srcPos));
-            // If the source position is offscreen (which can occur on double
-            // width lines), then we shouldn't copy anything to the destination.
-            if (currentSrcPos.x < src.Buffer().GetLineWidth(currentSrcPos.y))
-            {
-                dst.Buffer().WriteLine(OutputCellIterator({ &current, 1 }), dstPos);
-            }
-        } while (dstView.WalkInBounds(dstPos, walkDirection));
+            const auto dy = bottomUp ? height - 1 - i : i;
+            const auto srcRow = srcRect.top + dy;
+            // Cells that are offscreen in the source (which can occur on double
+            // width lines) aren't copied to the destination.
+            const auto srcRight = std::min(srcRect.left + width, src.Buffer().GetLineWidth(srcRow));
+            dst.Buffer().CopyRect(src.Buffer(), { srcRect.left, srcRow, srcRight, srcRow + 1 }, { dstRect.left, dstRect.top + dy });
+        }
         _api.NotifyAccessibilityChange(dstRect);
     }
 
@@ -1425,8 +1467,7 @@ bool AdaptDispatch::RequestChecksumRectangularArea(const VTInt id, const VTInt p
             }
         }
     }
-    const auto response = wil::str_printf<std::wstring>(L"\033P%d!~%04X\033\\", id, checksum);
-    _api.ReturnResponse(response);
+    _ReturnFormattedResponse(FMT_COMPILE(L"\033P{}!~{:04X}\033\\"), id, checksum);
     return true;
 }
 
@@ -1629,15 +1670,32 @@ bool AdaptDispatch::RequestTerminalParameters(const DispatchTypes::ReportingPerm
     }
 }
 
+// Routine Description:
+// - Transmits a report that was formatted into a ResponseBuffer, counting the
+//   reports that didn't fit into its inline storage and had to be allocated.
+//   Allocations made by ITerminalApi::ReturnResponse itself aren't counted.
+// Arguments:
+// - response - The formatted report
+// Return Value:
+// - <none>
+void AdaptDispatch::_ReturnResponse(const ResponseBuffer& response)
+{
+    if (response.capacity() > ResponseBufferSize)
+    {
+        _responseFormatAllocations++;
+    }
+    _api.ReturnResponse({ response.data(), response.size() });
+}
+
 // Routine Description:
 // - DSR - Transmits a device status report with a given parameter string.
 // Arguments:
 // - parameters - One or more parameter values representing the status
 // Return Value:
 // - <none>
-void AdaptDispatch::_DeviceStatusReport(const wchar_t* parameters) const
+void AdaptDispatch::_DeviceStatusReport(const wchar_t* parameters)
 {
-    _api.ReturnResponse(fmt::format(FMT_COMPILE(L"\033[{}n"), parameters));
+    _ReturnFormattedResponse(FMT_COMPILE(L"\033[{}n"), parameters);
 }
 
 // Routine Description:
@@ -1673,14 +1731,12 @@ void AdaptDispatch::_CursorPositionReport(const bool extendedReport)
     {
         // An extended report also includes the page number.
         const auto pageNumber = page.Number();
-        const auto response = wil::str_printf<std::wstring>(L"\x1b[?%d;%d;%dR", cursorPosition.y, cursorPosition.x, pageNumber);
-        _api.ReturnResponse(response);
+        _ReturnFormattedResponse(FMT_COMPILE(L"\033[?{};{};{}R"), cursorPosition.y, cursorPosition.x, pageNumber);
     }
     else
     {
         // The standard report only returns the cursor position.
-        const auto response = wil::str_printf<std::wstring>(L"\x1b[%d;%dR", cursorPosition.y, cursorPosition.x);
-        _api.ReturnResponse(response);
+        _ReturnFormattedResponse(FMT_COMPILE(L"\033[{};{}R"), cursorPosition.y, cursorPosition.x);
     }
 }
 
@@ -1690,12 +1746,11 @@ void AdaptDispatch::_CursorPositionReport(const bool extendedReport)
 // - <none>
 // Return Value:
 // - <none>
-void AdaptDispatch::_MacroSpaceReport() const
+void AdaptDispatch::_MacroSpaceReport()
 {
     const auto spaceInBytes = _macroBuffer ? _macroBuffer->GetSpaceAvailable() : MacroBuffer::MAX_SPACE;
     // The available space is measured in blocks of 16 bytes, so we need to divide by 16.
-    const auto response = wil::str_printf<std::wstring>(L"\x1b[%zu*{", spaceInBytes / 16);
-    _api.ReturnResponse(response);
+    _ReturnFormattedResponse(FMT_COMPILE(L"\033[{}*{{"), spaceInBytes / 16);
 }
 
 // Routine Description:
@@ -1704,12 +1759,11 @@ void AdaptDispatch::_MacroSpaceReport() const
 // - id - a numeric label used to identify the DSR request
 // Return Value:
 // - <none>
-void AdaptDispatch::_MacroChecksumReport(const VTParameter id) const
+void AdaptDispatch::_MacroChecksumReport(const VTParameter id)
 {
     const auto requestId = id.value_or(0);
     const auto checksum = _macroBuffer ? _macroBuffer->CalculateChecksum() : 0;
-    const auto response = wil::str_printf<std::wstring>(L"\033P%d!~%04X\033\\", requestId, checksum);
-    _api.ReturnResponse(response);
+    _ReturnFormattedResponse(FMT_COMPILE(L"\033P{}!~{:04X}\033\\"), requestId, checksum);
 }
 
 // Routine Description:
@@ -1828,7 +1882,7 @@ bool AdaptDispatch::RequestDisplayedExtent()
     const auto height = page.Viewport().height();
     const auto left = page.XPanOffset() + 1;
     const auto top = page.YPanOffset() + 1;
-    _api.ReturnResponse(fmt::format(FMT_COMPILE(L"\033[{};{};{};{};{}\"w"), height, width, left, top, page.Number()));
+    _ReturnFormattedResponse(FMT_COMPILE(L"\033[{};{};{};{};{}\"w"), height, width, left, top, page.Number());
     return true;
 }
 
@@ -2173,8 +2227,7 @@ bool AdaptDispatch::RequestMode(const DispatchTypes::ModeParams param)
     const auto isPrivate = param >= DispatchTypes::DECPrivateMode(0);
     const auto prefix = isPrivate ? L"?" : L"";
     const auto mode = isPrivate ? param - DispatchTypes::DECPrivateMode(0) : param;
-    const auto response = wil::str_printf<std::wstring>(L"\x1b[%s%d;%d$y", prefix, mode, state);
-    _api.ReturnResponse(response);
+    _ReturnFormattedResponse(FMT_COMPILE(L"\033[{}{};{}$y"), prefix, mode, state);
     return true;
 }
 
@@ -3138,6 +3191,10 @@ bool AdaptDispatch::SoftReset()
     _savedCursorState.at(0).TermOutput = _termOutput;
     _savedCursorState.at(1).TermOutput = _termOutput;
 
+    // A soft reset doesn't erase any pages, but apps typically send one when
+    // they exit, so it's a good time to release the buffers of blank pages.
+    _pages.ReleaseBlankPages();
+
     return !_api.IsConsolePty();
 }
 
@@ -3612,7 +3669,7 @@ bool AdaptDispatch::WindowManipulation(const DispatchTypes::WindowManipulationTy
     case DispatchTypes::WindowManipulationType::ReportTextSizeInCharacters:
     {
         const auto page = _pages.VisiblePage();
-        _api.ReturnResponse(fmt::format(FMT_COMPILE(L"\033[8;{};{}t"), page.Height(), page.Width()));
+        _ReturnFormattedResponse(FMT_COMPILE(L"\033[8;{};{}t"), page.Height(), page.Width());
         return true;
     }
     default:
@@ -4022,20 +4079,18 @@ ITermDispatch::StringHandler AdaptDispatch::DownloadDRCS(const VTInt fontNumber,
     // set translation is correctly handled on the host side.
     const auto conptyPassthrough = _api.IsConsolePty() ? _CreateDrcsPassthroughHandler(charsetSize) : nullptr;
 
-    return [=](const auto ch) {
+    return [=](const std::wstring_view string) {
         if (conptyPassthrough)
         {
-            conptyPassthrough(ch);
+            conptyPassthrough(string);
         }
         // We pass the data string straight through to the font buffer class
         // until we receive an ESC, indicating the end of the string. At that
         // point we can finalize the buffer, and if valid, update the renderer
         // with the constructed bit pattern.
-        if (ch != AsciiChars::ESC)
-        {
-            _fontBuffer->AddSixelData(ch);
-        }
-        else if (_fontBuffer->FinalizeSixelData())
+        const auto end = string.find(AsciiChars::ESC);
+        _fontBuffer->AddSixelData(string.substr(0, end));
+        if (end != std::wstring_view::npos && _fontBuffer->FinalizeSixelData())
         {
             // We also need to inform the character set mapper of the ID that
             // will map to this font (we only support one font buffer so there
@@ -4071,20 +4126,22 @@ ITermDispatch::StringHandler AdaptDispatch::_CreateDrcsPassthroughHandler(const
     if (defaultPassthrough)
     {
         auto& engine = _api.GetStateMachine().Engine();
-        return [=, &engine, gotId = false](const auto ch) mutable {
+        return [=, &engine, gotId = false](std::wstring_view string) mutable {
             // The character set ID is contained in the first characters of the
             // sequence, so we just ignore that initial content until we receive
             // a "final" character (i.e. in range 30 to 7E). At that point we
             // pass through a hard-coded ID of "@".
-            if (!gotId)
+            while (!gotId && !string.empty())
             {
+                const auto ch = string.front();
+                string = string.substr(1);
                 if (ch >= 0x30 && ch <= 0x7E)
                 {
                     gotId = true;
-                    defaultPassthrough('@');
+                    defaultPassthrough(L"@");
                 }
             }
-            else if (!defaultPassthrough(ch))
+            if (gotId && !string.empty() && !defaultPassthrough(string))
             {
                 // Once the DECDLD sequence is finished, we also output an SCS
                 // sequence to map the character set into the G1 table.
@@ -4107,7 +4164,7 @@ bool AdaptDispatch::RequestUserPreferenceCharset()
 {
     const auto size = _termOutput.GetUserPreferenceCharsetSize();
     const auto id = _termOutput.GetUserPreferenceCharsetId();
-    _api.ReturnResponse(fmt::format(FMT_COMPILE(L"\033P{}!u{}\033\\"), (size == 96 ? 1 : 0), id.ToString()));
+    _ReturnFormattedResponse(FMT_COMPILE(L"\033P{}!u{}\033\\"), (size == 96 ? 1 : 0), id.ToString());
     return true;
 }
 
@@ -4119,7 +4176,7 @@ bool AdaptDispatch::RequestUserPreferenceCharset()
 // - a function to parse the character set ID
 ITermDispatch::StringHandler AdaptDispatch::AssignUserPreferenceCharset(const DispatchTypes::CharsetSize charsetSize)
 {
-    return [this, charsetSize, idBuilder = VTIDBuilder{}](const auto ch) mutable {
+    return _forEachChar([this, charsetSize, idBuilder = VTIDBuilder{}](const auto ch) mutable {
         if (ch >= L'\x20' && ch <= L'\x2f')
         {
             idBuilder.AddIntermediate(ch);
@@ -4139,7 +4196,7 @@ ITermDispatch::StringHandler AdaptDispatch::AssignUserPreferenceCharset(const Di
             return false;
         }
         return true;
-    };
+    });
 }
 
 // Method Description:
@@ -4162,8 +4219,8 @@ ITermDispatch::StringHandler AdaptDispatch::DefineMacro(const VTInt macroId,
 
     if (_macroBuffer->InitParser(macroId, deleteControl, encoding))
     {
-        return [&](const auto ch) {
-            return _macroBuffer->ParseDefinition(ch);
+        return [&](const std::wstring_view string) {
+            return _macroBuffer->ParseDefinition(string);
         };
     }
 
@@ -4196,6 +4253,98 @@ bool AdaptDispatch::InvokeMacro(const VTInt macroId)
     return true;
 }
 
+// Method Description:
+// - SIXEL - Defines a Sixel image, which is displayed at the cursor position
+//   once the data string has been received in full.
+// Arguments:
+// - aspectRatio - the pixel aspect ratio (may be overridden by raster attributes).
+// - backgroundSelect - whether unset pixels are transparent or the background color.
+// - gridSize - the horizontal grid size (ignored).
+// Return Value:
+// - a function to receive the pixel data.
+ITermDispatch::StringHandler AdaptDispatch::DefineSixelImage(const VTParameter aspectRatio,
+                                                             const DispatchTypes::SixelBackground backgroundSelect,
+                                                             const VTParameter /*gridSize*/)
+{
+    // The parser decodes the data as it streams in, so the size of the
+    // data string has no bearing on how much memory is needed to hold it.
+    const auto parser = std::make_shared<SixelParser>(aspectRatio, backgroundSelect);
+    return [=](const std::wstring_view string) {
+        const auto end = string.find(AsciiChars::ESC);
+        parser->Parse(string.substr(0, end));
+        if (end != std::wstring_view::npos)
+        {
+            parser->Finish();
+            _DisplayImage(parser->ImageSize(), parser->Pixels(), SixelParser::CellSize);
+        }
+        return true;
+    };
+}
+
+// Routine Description:
+// - Helper method to write an image into the buffer at the cursor position.
+//   The image is split into one slice per row, which means it's scrolled and
+//   evicted along with the text. The cursor ends up on the line below the
+//   image, in the column where the image started.
+// Arguments:
+// - imageSize - the size of the image in pixels.
+// - pixels - the pixels of the image, line by line.
+// - cellSize - the number of pixels covered by a single cell.
+// Return Value:
+// - <none>
+void AdaptDispatch::_DisplayImage(const til::size imageSize, const std::span<const til::color> pixels, const til::size cellSize)
+{
+    if (imageSize.width <= 0 || imageSize.height <= 0)
+    {
+        return;
+    }
+
+    auto page = _pages.ActivePage();
+    auto& textBuffer = page.Buffer();
+    auto& cursor = page.Cursor();
+    const auto columnBegin = cursor.GetPosition().x;
+    const auto columnCount = (imageSize.width + cellSize.width - 1) / cellSize.width;
+    const auto columnEnd = std::min(columnBegin + columnCount, page.Width());
+    const auto rowCount = (imageSize.height + cellSize.height - 1) / cellSize.height;
+
+    // Anything past the right edge of the page is clipped.
+    const auto visibleWidth = std::min<size_t>(imageSize.width, gsl::narrow_cast<size_t>((columnEnd - columnBegin) * cellSize.width));
+    if (visibleWidth == 0)
+    {
+        return;
+    }
+
+    cursor.SetIsOn(false);
+
+    for (til::CoordType row = 0; row < rowCount; ++row)
+    {
+        if (row > 0 && _DoLineFeed(page, false, false))
+        {
+            page.MoveViewportDown();
+        }
+
+        const auto y = cursor.GetPosition().y;
+        auto& slice = textBuffer.GetMutableRowByOffset(y).GetMutableImageSlice(cellSize);
+        const auto lineCount = std::min(cellSize.height, imageSize.height - row * cellSize.height);
+        for (til::CoordType line = 0; line < lineCount; ++line)
+        {
+            const auto offset = gsl::narrow_cast<size_t>(row * cellSize.height + line) * imageSize.width;
+            const auto source = pixels.subspan(offset, visibleWidth);
+            const auto target = slice.MutablePixelLine(line, columnBegin, columnEnd);
+            // Transparent pixels leave whatever was there before intact.
+            std::transform(source.begin(), source.end(), target.begin(), target.begin(), [](const auto& src, const auto& dst) {
+                return src.a ? src : dst;
+            });
+        }
+        textBuffer.TriggerRedraw(Viewport::FromExclusive({ columnBegin, y, columnEnd, y + 1 }));
+    }
+
+    if (_DoLineFeed(page, false, false))
+    {
+        page.MoveViewportDown();
+    }
+}
+
 // Method Description:
 // - DECRSTS - Restores the terminal state from a stream of data previously
 //   saved with a DECRQTSR query.
@@ -4234,7 +4383,7 @@ ITermDispatch::StringHandler AdaptDispatch::_RestoreColorTable()
         return _CreatePassthroughHandler();
     }
 
-    return [this, parameter = VTInt{}, parameters = std::vector<VTParameter>{}](const auto ch) mutable {
+    return _forEachChar([this, parameter = VTInt{}, parameters = std::vector<VTParameter>{}](const auto ch) mutable {
         if (ch >= L'0' && ch <= L'9')
         {
             parameter *= 10;
@@ -4273,7 +4422,7 @@ ITermDispatch::StringHandler AdaptDispatch::_RestoreColorTable()
             parameter = 0;
         }
         return (ch != AsciiChars::ESC);
-    };
+    });
 }
 
 // Method Description:
@@ -4292,7 +4441,7 @@ ITermDispatch::StringHandler AdaptDispatch::RequestSetting()
     // this is the opposite of what is documented in most DEC manuals, which
     // say that 0 is for a valid response, and 1 is for an error. The correct
     // interpretation is documented in the DEC STD 070 reference.
-    return [this, parameter = VTInt{}, idBuilder = VTIDBuilder{}](const auto ch) mutable {
+    return _forEachChar([this, parameter = VTInt{}, idBuilder = VTIDBuilder{}](const auto ch) mutable {
         const auto isFinal = ch >= L'\x40' && ch <= L'\x7e';
         if (isFinal)
         {
@@ -4344,7 +4493,7 @@ ITermDispatch::StringHandler AdaptDispatch::RequestSetting()
             }
             return true;
         }
-    };
+    });
 }
 
 // Method Description:
@@ -4353,13 +4502,13 @@ ITermDispatch::StringHandler AdaptDispatch::RequestSetting()
 // - None
 // Return Value:
 // - None
-void AdaptDispatch::_ReportSGRSetting() const
+void AdaptDispatch::_ReportSGRSetting()
 {
     using namespace std::string_view_literals;
 
     // A valid response always starts with DCS 1 $ r.
     // Then the '0' parameter is to reset the SGR attributes to the defaults.
-    fmt::basic_memory_buffer<wchar_t, 64> response;
+    ResponseBuffer response;
     response.append(L"\033P1$r0"sv);
 
     const auto& attr = _pages.ActivePage().Attributes();
@@ -4414,7 +4563,7 @@ void AdaptDispatch::_ReportSGRSetting() const
 
     // The 'm' indicates this is an SGR response, and ST ends the sequence.
     response.append(L"m\033\\"sv);
-    _api.ReturnResponse({ response.data(), response.size() });
+    _ReturnResponse(response);
 }
 
 // Method Description:
@@ -4428,7 +4577,7 @@ void AdaptDispatch::_ReportDECSTBMSetting()
     using namespace std::string_view_literals;
 
     // A valid response always starts with DCS 1 $ r.
-    fmt::basic_memory_buffer<wchar_t, 64> response;
+    ResponseBuffer response;
     response.append(L"\033P1$r"sv);
 
     const auto page = _pages.ActivePage();
@@ -4438,7 +4587,7 @@ void AdaptDispatch::_ReportDECSTBMSetting()
 
     // The 'r' indicates this is an DECSTBM response, and ST ends the sequence.
     response.append(L"r\033\\"sv);
-    _api.ReturnResponse({ response.data(), response.size() });
+    _ReturnResponse(response);
 }
 
 // Method Description:
@@ -4452,7 +4601,7 @@ void AdaptDispatch::_ReportDECSLRMSetting()
     using namespace std::string_view_literals;
 
     // A valid response always starts with DCS 1 $ r.
-    fmt::basic_memory_buffer<wchar_t, 64> response;
+    ResponseBuffer response;
     response.append(L"\033P1$r"sv);
 
     const auto pageWidth = _pages.ActivePage().Width();
@@ -4462,7 +4611,7 @@ void AdaptDispatch::_ReportDECSLRMSetting()
 
     // The 's' indicates this is an DECSLRM response, and ST ends the sequence.
     response.append(L"s\033\\"sv);
-    _api.ReturnResponse({ response.data(), response.size() });
+    _ReturnResponse(response);
 }
 
 // Method Description:
@@ -4471,12 +4620,12 @@ void AdaptDispatch::_ReportDECSLRMSetting()
 // - None
 // Return Value:
 // - None
-void AdaptDispatch::_ReportDECSCASetting() const
+void AdaptDispatch::_ReportDECSCASetting()
 {
     using namespace std::string_view_literals;
 
     // A valid response always starts with DCS 1 $ r.
-    fmt::basic_memory_buffer<wchar_t, 64> response;
+    ResponseBuffer response;
     response.append(L"\033P1$r"sv);
 
     const auto& attr = _pages.ActivePage().Attributes();
@@ -4484,7 +4633,7 @@ void AdaptDispatch::_ReportDECSCASetting() const
 
     // The '"q' indicates this is an DECSCA response, and ST ends the sequence.
     response.append(L"\"q\033\\"sv);
-    _api.ReturnResponse({ response.data(), response.size() });
+    _ReturnResponse(response);
 }
 
 // Method Description:
@@ -4493,19 +4642,19 @@ void AdaptDispatch::_ReportDECSCASetting() const
 // - None
 // Return Value:
 // - None
-void AdaptDispatch::_ReportDECSACESetting() const
+void AdaptDispatch::_ReportDECSACESetting()
 {
     using namespace std::string_view_literals;
 
     // A valid response always starts with DCS 1 $ r.
-    fmt::basic_memory_buffer<wchar_t, 64> response;
+    ResponseBuffer response;
     response.append(L"\033P1$r"sv);
 
     response.append(_modes.test(Mode::RectangularChangeExtent) ? L"2"sv : L"1"sv);
 
     // The '*x' indicates this is an DECSACE response, and ST ends the sequence.
     response.append(L"*x\033\\"sv);
-    _api.ReturnResponse({ response.data(), response.size() });
+    _ReturnResponse(response);
 }
 
 // Method Description:
@@ -4514,7 +4663,7 @@ void AdaptDispatch::_ReportDECSACESetting() const
 // - None
 // Return Value:
 // - None
-void AdaptDispatch::_ReportDECACSetting(const VTInt itemNumber) const
+void AdaptDispatch::_ReportDECACSetting(const VTInt itemNumber)
 {
     using namespace std::string_view_literals;
 
@@ -4536,14 +4685,14 @@ void AdaptDispatch::_ReportDECACSetting(const VTInt itemNumber) const
     }
 
     // A valid response always starts with DCS 1 $ r.
-    fmt::basic_memory_buffer<wchar_t, 64> response;
+    ResponseBuffer response;
     response.append(L"\033P1$r"sv);
 
     fmt::format_to(std::back_inserter(response), FMT_COMPILE(L"{};{};{}"), itemNumber, fgIndex, bgIndex);
 
     // The ',|' indicates this is a DECAC response, and ST ends the sequence.
     response.append(L",|\033\\"sv);
-    _api.ReturnResponse({ response.data(), response.size() });
+    _ReturnResponse(response);
 }
 
 // Routine Description:
@@ -4659,7 +4808,7 @@ void AdaptDispatch::_ReportCursorInformation()
     const auto charset3 = _termOutput.GetCharsetId(3);
 
     // A valid response always starts with DCS 1 $ u and ends with ST.
-    const auto response = fmt::format(
+    _ReturnFormattedResponse(
         FMT_COMPILE(L"\033P1$u{};{};{};{};{};{};{};{};{};{}{}{}{}\033\\"),
         cursorPosition.y,
         cursorPosition.x,
@@ -4674,7 +4823,6 @@ void AdaptDispatch::_ReportCursorInformation()
         charset1.ToString(),
         charset2.ToString(),
         charset3.ToString());
-    _api.ReturnResponse({ response.data(), response.size() });
 }
 
 // Method Description:
@@ -4700,7 +4848,7 @@ ITermDispatch::StringHandler AdaptDispatch::_RestoreCursorInformation()
         VTParameter row{};
         VTParameter column{};
     };
-    return [&, state = State{}](const auto ch) mutable {
+    return _forEachChar([&, state = State{}](const auto ch) mutable {
         if (numeric.test(state.field))
         {
             if (ch >= '0' && ch <= '9')
@@ -4820,7 +4968,7 @@ ITermDispatch::StringHandler AdaptDispatch::_RestoreCursorInformation()
             }
         }
         return (ch != AsciiChars::ESC);
-    };
+    });
 }
 
 // Method Description:
@@ -4840,7 +4988,7 @@ void AdaptDispatch::_ReportTabStops()
     using namespace std::string_view_literals;
 
     // A valid response always starts with DCS 2 $ u.
-    fmt::basic_memory_buffer<wchar_t, 64> response;
+    ResponseBuffer response;
     response.append(L"\033P2$u"sv);
 
     auto need_separator = false;
@@ -4856,7 +5004,7 @@ void AdaptDispatch::_ReportTabStops()
 
     // An ST ends the sequence.
     response.append(L"\033\\"sv);
-    _api.ReturnResponse({ response.data(), response.size() });
+    _ReturnResponse(response);
 }
 
 // Method Description:
@@ -4874,7 +5022,7 @@ ITermDispatch::StringHandler AdaptDispatch::_RestoreTabStops()
     _ClearAllTabStops();
     _InitTabStopsForWidth(width);
 
-    return [this, width, column = size_t{}](const auto ch) mutable {
+    return _forEachChar([this, width, column = size_t{}](const auto ch) mutable {
         if (ch >= L'0' && ch <= L'9')
         {
             column *= 10;
@@ -4898,7 +5046,7 @@ ITermDispatch::StringHandler AdaptDispatch::_RestoreTabStops()
             return false;
         }
         return (ch != AsciiChars::ESC);
-    };
+    });
 }
 
 // Routine Description:
@@ -4957,13 +5105,14 @@ ITermDispatch::StringHandler AdaptDispatch::_CreatePassthroughHandler()
         // And finally we create a StringHandler to receive the rest of the
         // sequence data, and pass it through to the connected terminal.
         auto& engine = stateMachine.Engine();
-        return [&, buffer = std::wstring{}](const auto ch) mutable {
+        return [&, buffer = std::wstring{}](const std::wstring_view string) mutable {
             // To make things more efficient, we buffer the string data before
             // passing it through, only flushing if the buffer gets too large,
             // or we're dealing with the last character in the current output
             // fragment, or we've reached the end of the string.
-            const auto endOfString = ch == AsciiChars::ESC;
-            buffer += ch;
+            const auto end = string.find(AsciiChars::ESC);
+            const auto endOfString = end != std::wstring_view::npos;
+            buffer.append(endOfString ? string.substr(0, end + 1) : string);
             if (buffer.length() >= 4096 || stateMachine.IsProcessingLastCharacter() || endOfString)
             {
                 // The end of the string is signaled with an escape, but for it
@@ -18,6 +18,7 @@ Author(s):
 #include "ITerminalApi.hpp"
 #include "FontBuffer.hpp"
 #include "MacroBuffer.hpp"
+#include "SixelParser.hpp"
 #include "PageManager.hpp"
 #include "terminalOutput.hpp"
 #include "../input/terminalInput.hpp"
@@ -40,6 +41,7 @@ namespace Microsoft::Console::VirtualTerminal
 
         void Print(const wchar_t wchPrintable) override;
         void PrintString(const std::wstring_view string) override;
+        void PrintAsciiString(const std::wstring_view string) override;
 
         bool CursorUp(const VTInt distance) override; // CUU
         bool CursorDown(const VTInt distance) override; // CUD
@@ -167,6 +169,10 @@ namespace Microsoft::Console::VirtualTerminal
                                   const DispatchTypes::MacroEncoding encoding) override; // DECDMAC
         bool InvokeMacro(const VTInt macroId) override; // DECINVM
 
+        StringHandler DefineSixelImage(const VTParameter aspectRatio,
+                                       const DispatchTypes::SixelBackground backgroundSelect,
+                                       const VTParameter gridSize) override; // SIXEL
+
         StringHandler RestoreTerminalState(const DispatchTypes::ReportFormat format) override; // DECRSTS
 
         StringHandler RequestSetting() override; // DECRQSS
@@ -222,7 +228,7 @@ namespace Microsoft::Console::VirtualTerminal
             std::optional<TextColor> underlineColor;
         };
 
-        void _WriteToBuffer(const std::wstring_view string);
+        void _WriteToBuffer(const std::wstring_view string, const bool ascii = false);
         std::pair<int, int> _GetVerticalMargins(const Page& page, const bool absolute) noexcept;
         std::pair<int, int> _GetHorizontalMargins(const til::CoordType bufferWidth) noexcept;
         bool _CursorMovePosition(const Offset rowOffset, const Offset colOffset, const bool clampInMargins);
@@ -251,10 +257,28 @@ namespace Microsoft::Console::VirtualTerminal
 
         bool _DoLineFeed(const Page& page, const bool withReturn, const bool wrapForced);
 
-        void _DeviceStatusReport(const wchar_t* parameters) const;
+        // Reports are formatted into a buffer on the stack, which is large
+        // enough for all of them but a DECTABSR for a very wide page, so that
+        // formatting the reports of applications polling CPR or DECRQM doesn't
+        // cause any heap allocations. This only covers the formatting: whatever
+        // ITerminalApi::ReturnResponse does with the report may still allocate,
+        // like conhost's InputBuffer growing its queue of input records.
+        static constexpr size_t ResponseBufferSize = 128;
+        using ResponseBuffer = fmt::basic_memory_buffer<wchar_t, ResponseBufferSize>;
+        void _ReturnResponse(const ResponseBuffer& response);
+        template<typename S, typename... Args>
+        void _ReturnFormattedResponse(const S& format, Args&&... args)
+        {
+            ResponseBuffer response;
+            fmt::format_to(std::back_inserter(response), format, std::forward<Args>(args)...);
+            _ReturnResponse(response);
+        }
+        size_t _responseFormatAllocations = 0;
+
+        void _DeviceStatusReport(const wchar_t* parameters);
         void _CursorPositionReport(const bool extendedReport);
-        void _MacroSpaceReport() const;
-        void _MacroChecksumReport(const VTParameter id) const;
+        void _MacroSpaceReport();
+        void _MacroChecksumReport(const VTParameter id);
 
         void _SetColumnMode(const bool enable);
         void _SetAlternateScreenBufferMode(const bool enable);
@@ -267,12 +291,12 @@ namespace Microsoft::Console::VirtualTerminal
 
         StringHandler _RestoreColorTable();
 
-        void _ReportSGRSetting() const;
+        void _ReportSGRSetting();
         void _ReportDECSTBMSetting();
         void _ReportDECSLRMSetting();
-        void _ReportDECSCASetting() const;
-        void _ReportDECSACESetting() const;
-        void _ReportDECACSetting(const VTInt itemNumber) const;
+        void _ReportDECSCASetting();
+        void _ReportDECSACESetting();
+        void _ReportDECACSetting(const VTInt itemNumber);
 
         void _ReportCursorInformation();
         StringHandler _RestoreCursorInformation();
@@ -282,6 +306,8 @@ namespace Microsoft::Console::VirtualTerminal
         StringHandler _CreateDrcsPassthroughHandler(const DispatchTypes::CharsetSize charsetSize);
         StringHandler _CreatePassthroughHandler();
 
+        void _DisplayImage(const til::size imageSize, const std::span<const til::color> pixels, const til::size cellSize);
+
         std::vector<uint8_t> _tabStopColumns;
         bool _initDefaultTabStops = true;
 
@@ -309,6 +335,24 @@ namespace Microsoft::Console::VirtualTerminal
 
         SgrStack _sgrStack;
 
+        // Applications like ls or diff emit the same few SGR sequences over and
+        // over, so the result of applying a parameter sequence to an attribute
+        // is remembered in a small direct-mapped cache. The key holds the
+        // parameter values, with sub parameters encoded as negative numbers.
+        static constexpr size_t SgrCacheSize = 16;
+        static constexpr size_t SgrCacheMaxKey = 16;
+        struct SgrCacheEntry
+        {
+            size_t hash = 0;
+            size_t keySize = 0;
+            std::array<VTInt, SgrCacheMaxKey> key{};
+            TextAttribute before;
+            TextAttribute after;
+        };
+        std::array<SgrCacheEntry, SgrCacheSize> _sgrCache;
+
+        static bool _BuildSgrCacheKey(const VTParameters options, const TextAttribute& attr, SgrCacheEntry& entry) noexcept;
+
         void _SetUnderlineStyleHelper(const VTParameter option, TextAttribute& attr) noexcept;
         size_t _SetRgbColorsHelper(const VTParameters options,
                                    TextAttribute& attr,
@@ -6,6 +6,8 @@
 #include "adaptDispatch.hpp"
 #include "../../types/inc/utils.hpp"
 
+#include <til/hash.h>
+
 #define ENABLE_INTSAFE_SIGNED_FUNCTIONS
 #include <intsafe.h>
 
@@ -410,6 +412,54 @@ void AdaptDispatch::_ApplyGraphicsOptions(const VTParameters options,
     }
 }
 
+// Routine Description:
+// - Fills in the key of an SGR cache entry for the given parameters and the
+//   attribute they're about to be applied to. Parameters are stored as they
+//   are (-1 when omitted), sub parameters as -2 when omitted or -3 - value
+//   otherwise, so that 38:5:1 and 38;5;1 end up with different keys.
+// Arguments:
+// - options - The parameters of the SGR sequence.
+// - attr - The attribute the parameters will be applied to.
+// - entry - The entry that receives the key, hash and initial attribute.
+// Return Value:
+// - False if the sequence is too long to be cached.
+bool AdaptDispatch::_BuildSgrCacheKey(const VTParameters options, const TextAttribute& attr, SgrCacheEntry& entry) noexcept
+{
+    size_t keySize = 0;
+    const auto append = [&](const VTInt value) noexcept {
+        if (keySize >= SgrCacheMaxKey)
+        {
+            return false;
+        }
+        til::at(entry.key, keySize++) = value;
+        return true;
+    };
+
+    for (size_t i = 0; i < options.size(); i++)
+    {
+        const auto option = options.at(i);
+        if (!append(option.has_value() ? option.value() : -1))
+        {
+            return false;
+        }
+
+        const auto subParams = options.subParamsFor(i);
+        for (size_t j = 0; j < subParams.size(); j++)
+        {
+            const auto subParam = subParams.at(j);
+            if (!append(subParam.has_value() ? -3 - subParam.value() : -2))
+            {
+                return false;
+            }
+        }
+    }
+
+    entry.keySize = keySize;
+    entry.before = attr;
+    entry.hash = til::hasher{}.write(entry.key.data(), keySize).write(attr).finalize();
+    return true;
+}
+
 // Routine Description:
 // - SGR - Modifies the graphical rendering options applied to the next
 //   characters written into the buffer.
@@ -424,7 +474,29 @@ bool AdaptDispatch::SetGraphicsRendition(const VTParameters options)
 {
     const auto page = _pages.ActivePage();
     auto attr = page.Attributes();
-    _ApplyGraphicsOptions(options, attr);
+
+    // Applying the options only depends on the options and the current
+    // attribute, so a cached result can be used as is.
+    SgrCacheEntry lookup;
+    if (_BuildSgrCacheKey(options, attr, lookup))
+    {
+        auto& entry = til::at(_sgrCache, lookup.hash % SgrCacheSize);
+        if (entry.hash == lookup.hash && entry.keySize == lookup.keySize && entry.key == lookup.key && entry.before == attr)
+        {
+            attr = entry.after;
+        }
+        else
+        {
+            _ApplyGraphicsOptions(options, attr);
+            lookup.after = attr;
+            entry = lookup;
+        }
+    }
+    else
+    {
+        _ApplyGraphicsOptions(options, attr);
+    }
+
     page.SetAttributes(attr, &_api);
     return true;
 }
@@ -24,6 +24,7 @@ class Microsoft::Console::VirtualTerminal::TermDispatch : public Microsoft::Cons
 public:
     void Print(const wchar_t wchPrintable) override = 0;
     void PrintString(const std::wstring_view string) override = 0;
+    void PrintAsciiString(const std::wstring_view string) override { PrintString(string); }
 
     bool CursorUp(const VTInt /*distance*/) override { return false; } // CUU
     bool CursorDown(const VTInt /*distance*/) override { return false; } // CUD
@@ -157,6 +158,10 @@ public:
                               const DispatchTypes::MacroEncoding /*encoding*/) override { return nullptr; } // DECDMAC
     bool InvokeMacro(const VTInt /*macroId*/) override { return false; } // DECINVM
 
+    StringHandler DefineSixelImage(const VTParameter /*aspectRatio*/,
+                                   const DispatchTypes::SixelBackground /*backgroundSelect*/,
+                                   const VTParameter /*gridSize*/) override { return nullptr; } // SIXEL
+
     StringHandler RestoreTerminalState(const DispatchTypes::ReportFormat /*format*/) override { return nullptr; }; // DECRSTS
 
     StringHandler RequestSetting() override { return nullptr; }; // DECRQSS
@@ -1172,6 +1172,71 @@ public:
         VERIFY_IS_TRUE(_pDispatch->SetGraphicsRendition({ std::span{ rgOptions, cOptions }, subParams, subParamRanges }));
     }
 
+    TEST_METHOD(GraphicsCacheTests)
+    {
+        Log::Comment(L"Starting test...");
+        _testGetSet->PrepData();
+
+        VTParameter rgOptions[20];
+        std::vector<VTParameter> subParams;
+        std::vector<std::pair<BYTE, BYTE>> subParamRanges;
+        size_t cOptions = 2;
+        rgOptions[0] = DispatchTypes::GraphicsOptions::Intense;
+        rgOptions[1] = DispatchTypes::GraphicsOptions::ForegroundRed;
+
+        Log::Comment(L"Test 1: Applying the same options twice gives the same result");
+        for (auto i = 0; i < 2; i++)
+        {
+            _testGetSet->_textBuffer->SetCurrentAttributes({});
+            _testGetSet->_expectedAttribute = {};
+            _testGetSet->_expectedAttribute.SetIntense(true);
+            _testGetSet->_expectedAttribute.SetIndexedForeground(TextColor::DARK_RED);
+            VERIFY_IS_TRUE(_pDispatch->SetGraphicsRendition({ rgOptions, cOptions }));
+        }
+
+        Log::Comment(L"Test 2: The same options applied to a different attribute aren't served from the cache");
+        TextAttribute startingAttribute;
+        startingAttribute.SetItalic(true);
+        startingAttribute.SetIndexedBackground(TextColor::DARK_BLUE);
+        _testGetSet->_textBuffer->SetCurrentAttributes(startingAttribute);
+        _testGetSet->_expectedAttribute = startingAttribute;
+        _testGetSet->_expectedAttribute.SetIntense(true);
+        _testGetSet->_expectedAttribute.SetIndexedForeground(TextColor::DARK_RED);
+        VERIFY_IS_TRUE(_pDispatch->SetGraphicsRendition({ rgOptions, cOptions }));
+
+        Log::Comment(L"Test 3: Sub parameters are distinguished from parameters");
+        rgOptions[0] = DispatchTypes::GraphicsOptions::Underline;
+        rgOptions[1] = DispatchTypes::GraphicsOptions::Italics;
+        _testGetSet->_textBuffer->SetCurrentAttributes({});
+        _testGetSet->_expectedAttribute = {};
+        _testGetSet->_expectedAttribute.SetUnderlineStyle(UnderlineStyle::SinglyUnderlined);
+        _testGetSet->_expectedAttribute.SetItalic(true);
+        VERIFY_IS_TRUE(_pDispatch->SetGraphicsRendition({ rgOptions, cOptions }));
+
+        cOptions = 1;
+        _testGetSet->MakeSubParamsAndRanges({ { 3 } }, subParams, subParamRanges);
+        _testGetSet->_textBuffer->SetCurrentAttributes({});
+        _testGetSet->_expectedAttribute = {};
+        _testGetSet->_expectedAttribute.SetUnderlineStyle(UnderlineStyle::CurlyUnderlined);
+        VERIFY_IS_TRUE(_pDispatch->SetGraphicsRendition({ std::span{ rgOptions, cOptions }, subParams, subParamRanges }));
+
+        Log::Comment(L"Test 4: Sequences too long for the cache are still applied");
+        cOptions = 20;
+        for (size_t i = 0; i < cOptions; i++)
+        {
+            rgOptions[i] = i % 2 ? DispatchTypes::GraphicsOptions::ForegroundGreen : DispatchTypes::GraphicsOptions::Overline;
+        }
+        _testGetSet->_textBuffer->SetCurrentAttributes({});
+        _testGetSet->_expectedAttribute = {};
+        _testGetSet->_expectedAttribute.SetOverlined(true);
+        _testGetSet->_expectedAttribute.SetIndexedForeground(TextColor::DARK_GREEN);
+        VERIFY_IS_TRUE(_pDispatch->SetGraphicsRendition({ rgOptions, cOptions }));
+        rgOptions[19] = DispatchTypes::GraphicsOptions::ForegroundBlue;
+        _testGetSet->_textBuffer->SetCurrentAttributes({});
+        _testGetSet->_expectedAttribute.SetIndexedForeground(TextColor::DARK_BLUE);
+        VERIFY_IS_TRUE(_pDispatch->SetGraphicsRendition({ rgOptions, cOptions }));
+    }
+
     TEST_METHOD(GraphicsPushPopTests)
     {
         Log::Comment(L"Starting test...");
@@ -1815,11 +1880,8 @@ public:
     {
         const auto requestSetting = [=](const std::wstring_view settingId = {}) {
             const auto stringHandler = _pDispatch->RequestSetting();
-            for (auto ch : settingId)
-            {
-                stringHandler(ch);
-            }
-            stringHandler(L'\033'); // String terminator
+            stringHandler(settingId);
+            stringHandler(L"\033"); // String terminator
         };
 
         Log::Comment(L"Requesting DECSTBM margins (5 to 10).");
@@ -2372,6 +2434,54 @@ public:
         VERIFY_ARE_EQUAL(VTID("F"), termOutput.GetCharsetId(3));
     }
 
+    TEST_METHOD(ReportFormattingDoesntAllocate)
+    {
+        _testGetSet->PrepData();
+        auto& textBuffer = *_testGetSet->_textBuffer;
+        const auto requestSetting = [=](const std::wstring_view settingId) {
+            const auto stringHandler = _pDispatch->RequestSetting();
+            stringHandler(settingId);
+            stringHandler(L"\033"); // String terminator
+        };
+
+        // The longest SGR report, with every attribute and RGB colors.
+        auto attribute = TextAttribute{};
+        attribute.SetIntense(true);
+        attribute.SetFaint(true);
+        attribute.SetItalic(true);
+        attribute.SetUnderlineStyle(UnderlineStyle::DoublyUnderlined);
+        attribute.SetBlinking(true);
+        attribute.SetReverseVideo(true);
+        attribute.SetInvisible(true);
+        attribute.SetCrossedOut(true);
+        attribute.SetOverlined(true);
+        attribute.SetForeground(RGB(255, 255, 255));
+        attribute.SetBackground(RGB(255, 255, 255));
+        attribute.SetUnderlineColor(RGB(255, 255, 255));
+        textBuffer.SetCurrentAttributes(attribute);
+
+        Log::Comment(L"Polling reports in a loop");
+        _pDispatch->_responseFormatAllocations = 0;
+        for (auto i = 0; i < 100; i++)
+        {
+            VERIFY_IS_TRUE(_pDispatch->DeviceStatusReport(DispatchTypes::StatusType::CursorPositionReport, {}));
+            VERIFY_IS_TRUE(_pDispatch->DeviceStatusReport(DispatchTypes::StatusType::ExtendedCursorPositionReport, {}));
+            VERIFY_IS_TRUE(_pDispatch->DeviceStatusReport(DispatchTypes::StatusType::MacroSpaceReport, {}));
+            VERIFY_IS_TRUE(_pDispatch->RequestMode(DispatchTypes::DECCKM_CursorKeysMode));
+            VERIFY_IS_TRUE(_pDispatch->RequestChecksumRectangularArea(1, 1, 1, 1, 10, 10));
+            requestSetting(L"m");
+            _pDispatch->RequestPresentationStateReport(DispatchTypes::PresentationReportFormat::CursorInformationReport);
+            _pDispatch->RequestPresentationStateReport(DispatchTypes::PresentationReportFormat::TabulationStopReport);
+        }
+        _testGetSet->ValidateInputEvent(L"\033P2$u9/17/25/33/41/49/57/65/73/81/89/97\033\\");
+        VERIFY_ARE_EQUAL(0u, _pDispatch->_responseFormatAllocations);
+
+        Log::Comment(L"A tab stop report for a very wide page needs an allocation");
+        textBuffer.ResizeTraditional({ 400, 600 });
+        _pDispatch->RequestPresentationStateReport(DispatchTypes::PresentationReportFormat::TabulationStopReport);
+        VERIFY_ARE_EQUAL(1u, _pDispatch->_responseFormatAllocations);
+    }
+
     TEST_METHOD(CursorKeysModeTest)
     {
         Log::Comment(L"Starting test...");
@@ -2822,11 +2932,8 @@ public:
             RETURN_BOOL_IF_FALSE(fontBuffer.SetAttributes(cellMatrix, cmh, ss, u));
             RETURN_BOOL_IF_FALSE(fontBuffer.SetStartChar(0, DispatchTypes::CharsetSize::Size94));
 
-            fontBuffer.AddSixelData(L'B'); // Charset identifier
-            for (auto ch : data)
-            {
-                fontBuffer.AddSixelData(ch);
-            }
+            fontBuffer.AddSixelData(L"B"); // Charset identifier
+            fontBuffer.AddSixelData(data);
             RETURN_BOOL_IF_FALSE(fontBuffer.FinalizeSixelData());
 
             const auto cellSize = fontBuffer.GetCellSize();
@@ -3067,11 +3174,8 @@ public:
     {
         const auto assignCharset = [=](const auto charsetSize, const std::wstring_view charsetId = {}) {
             const auto stringHandler = _pDispatch->AssignUserPreferenceCharset(charsetSize);
-            for (auto ch : charsetId)
-            {
-                stringHandler(ch);
-            }
-            stringHandler(L'\033'); // String terminator
+            stringHandler(charsetId);
+            stringHandler(L"\033"); // String terminator
         };
         auto& termOutput = _pDispatch->_termOutput;
         termOutput.SoftReset();
@@ -3296,6 +3400,7 @@ public:
 
         const auto setMacroText = [&](const auto id, const auto value) {
             _pDispatch->_macroBuffer->_macros.at(id) = value;
+            _pDispatch->_macroBuffer->_recordings.at(id) = nullptr;
         };
 
         setMacroText(0, L"Macro 0");
@@ -3351,6 +3456,279 @@ public:
         _pDispatch->_macroBuffer = nullptr;
     }
 
+    TEST_METHOD(MacroInvokesReplayRecordings)
+    {
+        const auto getBufferOutput = [&]() {
+            const auto& textBuffer = _testGetSet->GetBufferAndViewport().buffer;
+            const auto cursorPos = textBuffer.GetCursor().GetPosition();
+            return textBuffer.GetRowByOffset(cursorPos.y).GetText().substr(0, cursorPos.x);
+        };
+        const auto getRecording = [&](const auto id) {
+            return _pDispatch->_macroBuffer->_recordings.at(id).get();
+        };
+
+        Log::Comment(L"A macro is recorded when it's first invoked");
+        _stateMachine->ProcessString(L"\033P1;0;0!zABC\033\\");
+        VERIFY_IS_NULL(getRecording(1));
+        _testGetSet->PrepData();
+        _stateMachine->ProcessString(L"\033[1*z\033[1*z");
+        VERIFY_ARE_EQUAL(L"ABCABC", getBufferOutput());
+        VERIFY_IS_NOT_NULL(getRecording(1));
+
+        Log::Comment(L"Redefining a macro discards its recording");
+        _stateMachine->ProcessString(L"\033P1;0;0!zXYZ\033\\");
+        VERIFY_IS_NULL(getRecording(1));
+        _testGetSet->PrepData();
+        _stateMachine->ProcessString(L"\033[1*z");
+        VERIFY_ARE_EQUAL(L"XYZ", getBufferOutput());
+
+        Log::Comment(L"Deleting all macros discards all recordings");
+        _stateMachine->ProcessString(L"\033P2;1;0!z\033\\");
+        VERIFY_IS_NULL(getRecording(1));
+
+        Log::Comment(L"Parser mode changes apply to the rest of the macro");
+        // A ESC SP 7 CSI 3 G B ESC SP 6, with the CSI as a C1 control.
+        _stateMachine->ProcessString(L"\033P3;0;1!z411B20379B3347421B2036\033\\");
+        _testGetSet->PrepData();
+        _stateMachine->ProcessString(L"\033[3*z");
+        VERIFY_ARE_EQUAL(L"A B", getBufferOutput());
+        VERIFY_IS_FALSE(_stateMachine->GetParserMode(StateMachine::Mode::AcceptC1));
+        // Holding on to the recording makes sure a new one can't reuse its address.
+        const auto recording = _pDispatch->_macroBuffer->_recordings.at(3);
+        VERIFY_IS_NOT_NULL(recording.get());
+
+        Log::Comment(L"The recording is reused when the parser modes are unchanged");
+        _testGetSet->PrepData();
+        _stateMachine->ProcessString(L"\033[3*z");
+        VERIFY_ARE_EQUAL(L"A B", getBufferOutput());
+        VERIFY_ARE_EQUAL(recording.get(), getRecording(3));
+
+        Log::Comment(L"The macro is recorded again when the parser modes differ");
+        _stateMachine->SetParserMode(StateMachine::Mode::AcceptC1, true);
+        _testGetSet->PrepData();
+        _stateMachine->ProcessString(L"\033[3*z");
+        VERIFY_ARE_EQUAL(L"A B", getBufferOutput());
+        VERIFY_ARE_NOT_EQUAL(recording.get(), getRecording(3));
+        _stateMachine->SetParserMode(StateMachine::Mode::AcceptC1, false);
+
+        _pDispatch->_macroBuffer = nullptr;
+    }
+
+    TEST_METHOD(SixelDecoding)
+    {
+        const auto decode = [](const std::wstring_view data, const VTParameter aspectRatio, const DispatchTypes::SixelBackground background, const size_t chunkSize) {
+            SixelParser parser{ aspectRatio, background };
+            for (size_t i = 0; i < data.size(); i += chunkSize)
+            {
+                parser.Parse(data.substr(i, chunkSize));
+            }
+            parser.Finish();
+            return std::pair{ parser.ImageSize(), std::vector<til::color>{ parser.Pixels().begin(), parser.Pixels().end() } };
+        };
+
+        const til::color red{ 255, 0, 0 };
+        const til::color green{ 0, 255, 0 };
+        const til::color black{ 0, 0, 0 };
+        const auto transparent = DispatchTypes::SixelBackground::Transparent;
+        const auto opaque = DispatchTypes::SixelBackground::Opaque;
+
+        Log::Comment(L"Single sixel with the default aspect ratio of 2:1");
+        {
+            const auto [size, pixels] = decode(L"#1;2;100;0;0#1@", {}, transparent, SIZE_MAX);
+            VERIFY_ARE_EQUAL(til::size(1, 2), size);
+            VERIFY_ARE_EQUAL(red, pixels.at(0));
+            VERIFY_ARE_EQUAL(red, pixels.at(1));
+        }
+
+        Log::Comment(L"Repeat count, carriage return and color selection");
+        {
+            const auto [size, pixels] = decode(L"\"1;1#1;2;100;0;0#2;2;0;100;0#1!3~$#2?@", {}, transparent, SIZE_MAX);
+            VERIFY_ARE_EQUAL(til::size(3, 6), size);
+            VERIFY_ARE_EQUAL(red, pixels.at(0));
+            VERIFY_ARE_EQUAL(green, pixels.at(1));
+            VERIFY_ARE_EQUAL(red, pixels.at(2));
+            VERIFY_ARE_EQUAL(red, pixels.at(3 + 1));
+        }
+
+        Log::Comment(L"Graphics new line moves down a band");
+        {
+            const auto [size, pixels] = decode(L"\"1;1#1;2;100;0;0#1@-@", {}, transparent, SIZE_MAX);
+            VERIFY_ARE_EQUAL(til::size(1, 7), size);
+            VERIFY_ARE_EQUAL(red, pixels.at(0));
+            VERIFY_ARE_EQUAL(til::color{}, pixels.at(1));
+            VERIFY_ARE_EQUAL(red, pixels.at(6));
+        }
+
+        Log::Comment(L"Raster attributes set the image size");
+        {
+            const auto [size, pixels] = decode(L"\"1;1;8;12#1;2;100;0;0#1@", {}, transparent, SIZE_MAX);
+            VERIFY_ARE_EQUAL(til::size(8, 12), size);
+            VERIFY_ARE_EQUAL(8u * 12u, pixels.size());
+        }
+
+        Log::Comment(L"Opaque images fill unset pixels with color 0");
+        {
+            const auto [size, pixels] = decode(L"\"1;1;2;1#1;2;100;0;0#1@", {}, opaque, SIZE_MAX);
+            VERIFY_ARE_EQUAL(red, pixels.at(0));
+            VERIFY_ARE_EQUAL(black, pixels.at(1));
+        }
+
+        Log::Comment(L"HLS color definitions");
+        {
+            const auto [size, pixels] = decode(L"#1;1;120;50;100#1@", {}, transparent, SIZE_MAX);
+            VERIFY_ARE_EQUAL(red, pixels.at(0));
+        }
+
+        Log::Comment(L"Decoding is independent of how the data string is split up");
+        {
+            std::wstring data = L"\"1;1";
+            for (auto band = 0; band < 50; band++)
+            {
+                data += fmt::format(FMT_COMPILE(L"#{};2;{};{};0!{}~{}-"), band % 16, band * 2, 100 - band * 2, 100 + band, static_cast<wchar_t>(L'?' + band));
+            }
+            const auto expected = decode(data, {}, transparent, SIZE_MAX);
+            for (const auto chunkSize : { 1u, 2u, 3u, 7u, 64u })
+            {
+                const auto actual = decode(data, {}, transparent, chunkSize);
+                VERIFY_ARE_EQUAL(expected.first, actual.first);
+                VERIFY_IS_TRUE(expected.second == actual.second);
+            }
+        }
+    }
+
+    TEST_METHOD(SixelImages)
+    {
+        auto& textBuffer = *_testGetSet->_textBuffer;
+        const til::color red{ 255, 0, 0 };
+        const til::color blue{ 0, 0, 255 };
+
+        Log::Comment(L"A 20x24 image occupies two columns and two rows");
+        _testGetSet->PrepData();
+        textBuffer.GetCursor().SetPosition({ 5, 30 });
+        _stateMachine->ProcessString(L"\033P0;1q\"1;1;20;24#1;2;100;0;0#1!20~-!20~-!20~-!20~\033\\");
+        VERIFY_ARE_EQUAL(til::point(5, 32), textBuffer.GetCursor().GetPosition());
+
+        const auto top = textBuffer.GetRowByOffset(30).GetImageSlice();
+        const auto bottom = textBuffer.GetRowByOffset(31).GetImageSlice();
+        VERIFY_IS_NOT_NULL(top);
+        VERIFY_IS_NOT_NULL(bottom);
+        VERIFY_IS_NULL(textBuffer.GetRowByOffset(32).GetImageSlice());
+        VERIFY_ARE_EQUAL(5, top->ColumnBegin());
+        VERIFY_ARE_EQUAL(7, top->ColumnEnd());
+        VERIFY_ARE_EQUAL(red, top->PixelLine(19)[19]);
+        VERIFY_ARE_EQUAL(red, bottom->PixelLine(3)[0]);
+        VERIFY_ARE_EQUAL(til::color{}, bottom->PixelLine(4)[0]);
+
+        Log::Comment(L"Compositing onto the text layer keeps transparent pixels");
+        const auto cellSize = SixelParser::CellSize;
+        const auto canvasWidth = 10 * cellSize.width;
+        std::vector<til::color> canvas(gsl::narrow_cast<size_t>(canvasWidth * cellSize.height), blue);
+        bottom->CompositeOnto(canvas, canvasWidth);
+        VERIFY_ARE_EQUAL(blue, canvas.at(5 * cellSize.width - 1));
+        VERIFY_ARE_EQUAL(red, canvas.at(5 * cellSize.width));
+        VERIFY_ARE_EQUAL(red, canvas.at(3 * canvasWidth + 7 * cellSize.width - 1));
+        VERIFY_ARE_EQUAL(blue, canvas.at(3 * canvasWidth + 7 * cellSize.width));
+        VERIFY_ARE_EQUAL(blue, canvas.at(4 * canvasWidth + 5 * cellSize.width));
+
+        Log::Comment(L"Erasing characters erases the image beneath them");
+        textBuffer.GetCursor().SetPosition({ 5, 30 });
+        _stateMachine->ProcessString(L"\033[X");
+        VERIFY_ARE_EQUAL(til::color{}, top->PixelLine(0)[0]);
+        VERIFY_ARE_EQUAL(red, top->PixelLine(0)[cellSize.width]);
+        _stateMachine->ProcessString(L"\033[2X");
+        VERIFY_IS_NULL(textBuffer.GetRowByOffset(30).GetImageSlice());
+
+        Log::Comment(L"Images scroll with their rows and are evicted with them");
+        const auto bufferHeight = textBuffer.GetSize().Height();
+        textBuffer.IncrementCircularBuffer({});
+        VERIFY_IS_NOT_NULL(textBuffer.GetRowByOffset(30).GetImageSlice());
+        for (auto i = 0; i < 31; i++)
+        {
+            textBuffer.IncrementCircularBuffer({});
+        }
+        for (auto y = 0; y < bufferHeight; y++)
+        {
+            VERIFY_IS_NULL(textBuffer.GetRowByOffset(y).GetImageSlice());
+        }
+    }
+
+    TEST_METHOD(SixelImagesFollowText)
+    {
+        auto& textBuffer = *_testGetSet->_textBuffer;
+        const til::color red{ 255, 0, 0 };
+        const auto cellSize = SixelParser::CellSize;
+
+        // Writes a 20x24 image to the columns 5 and 6 of the rows 30 and 31.
+        const auto prepImage = [&]() {
+            _testGetSet->PrepData();
+            textBuffer.GetCursor().SetPosition({ 5, 30 });
+            _stateMachine->ProcessString(L"\033P0;1q\"1;1;20;24#1;2;100;0;0#1!20~-!20~-!20~-!20~\033\\");
+            textBuffer.GetCursor().SetPosition({ 0, 30 });
+        };
+        const auto verifyImage = [&](const til::CoordType row, const til::CoordType columnBegin, const til::CoordType columnEnd) {
+            const auto slice = textBuffer.GetRowByOffset(row).GetImageSlice();
+            VERIFY_IS_NOT_NULL(slice);
+            VERIFY_ARE_EQUAL(columnBegin, slice->ColumnBegin());
+            VERIFY_ARE_EQUAL(columnEnd, slice->ColumnEnd());
+            VERIFY_ARE_EQUAL(red, slice->PixelLine(0).front());
+            VERIFY_ARE_EQUAL(red, slice->PixelLine(0).back());
+        };
+
+        Log::Comment(L"Writing text erases the image beneath it");
+        prepImage();
+        textBuffer.GetCursor().SetPosition({ 5, 30 });
+        _stateMachine->ProcessString(L"A");
+        const auto written = textBuffer.GetRowByOffset(30).GetImageSlice();
+        VERIFY_IS_NOT_NULL(written);
+        VERIFY_ARE_EQUAL(til::color{}, written->PixelLine(0)[0]);
+        VERIFY_ARE_EQUAL(red, written->PixelLine(0)[cellSize.width]);
+        _stateMachine->ProcessString(L"B");
+        VERIFY_IS_NULL(textBuffer.GetRowByOffset(30).GetImageSlice());
+        verifyImage(31, 5, 7);
+
+        Log::Comment(L"Writing text in insert mode pushes the image to the right");
+        prepImage();
+        _stateMachine->ProcessString(L"\033[4hAB\033[4l");
+        verifyImage(30, 7, 9);
+        verifyImage(31, 5, 7);
+
+        Log::Comment(L"ICH moves the image to the right");
+        prepImage();
+        _stateMachine->ProcessString(L"\033[2@");
+        verifyImage(30, 7, 9);
+        verifyImage(31, 5, 7);
+
+        Log::Comment(L"DCH moves the image to the left and erases the deleted part");
+        prepImage();
+        _stateMachine->ProcessString(L"\033[P");
+        verifyImage(30, 4, 6);
+        _stateMachine->ProcessString(L"\033[4P");
+        verifyImage(30, 0, 2);
+        _stateMachine->ProcessString(L"\033[P");
+        verifyImage(30, 0, 1);
+
+        Log::Comment(L"DECDC moves the image of every row to the left");
+        prepImage();
+        _stateMachine->ProcessString(L"\033[2'~");
+        verifyImage(30, 3, 5);
+        verifyImage(31, 3, 5);
+
+        Log::Comment(L"DECCRA copies the image along with the cells");
+        prepImage();
+        _pDispatch->CopyRectangularArea(11, 6, 12, 7, 1, 1, 1, 1);
+        verifyImage(20, 0, 2);
+        verifyImage(21, 0, 2);
+        verifyImage(30, 5, 7);
+        verifyImage(31, 5, 7);
+
+        Log::Comment(L"DECCRA without an image erases the target's image");
+        _pDispatch->CopyRectangularArea(1, 3, 1, 3, 1, 11, 6, 1);
+        const auto copied = textBuffer.GetRowByOffset(30).GetImageSlice();
+        VERIFY_IS_NOT_NULL(copied);
+        VERIFY_ARE_EQUAL(til::color{}, copied->PixelLine(0)[0]);
+        VERIFY_ARE_EQUAL(red, copied->PixelLine(0)[cellSize.width]);
+    }
+
     TEST_METHOD(WindowManipulationTypeTests)
     {
         _testGetSet->PrepData();
@@ -3470,6 +3848,137 @@ public:
         _pDispatch->PagePositionAbsolute(1);
     }
 
+    TEST_METHOD(PageMemoryTests)
+    {
+        _testGetSet->PrepData();
+        auto& pages = _pDispatch->_pages;
+        auto& textBuffer = *_testGetSet->_textBuffer;
+        const auto top = pages.VisiblePage().Top();
+        const auto writeText = [&](const std::wstring_view text) {
+            RowWriteState state{ .text = text };
+            textBuffer.Replace(top, TextAttribute{}, state);
+        };
+        const auto readText = [&]() {
+            return std::wstring{ textBuffer.GetRowByOffset(top).GetText(0, 5) };
+        };
+
+        Log::Comment(L"Blank pages can be made visible without allocating buffers");
+        _pDispatch->SetMode(DispatchTypes::ModeParams::DECPCCM_PageCursorCouplingMode);
+        _pDispatch->PagePositionAbsolute(2);
+        VERIFY_ARE_EQUAL(2, pages.VisiblePage().Number());
+        for (auto page = 1; page <= 6; page++)
+        {
+            VERIFY_ARE_EQUAL(0u, pages.CommittedBytes(page));
+        }
+
+        Log::Comment(L"Pages with content are saved when they're swapped out");
+        writeText(L"Page2");
+        _pDispatch->PagePositionAbsolute(1);
+        VERIFY_ARE_EQUAL(L"     ", readText());
+        VERIFY_IS_GREATER_THAN(pages.CommittedBytes(2), 0u);
+        VERIFY_ARE_EQUAL(0u, pages.CommittedBytes(1));
+
+        Log::Comment(L"Swapping pages reuses the buffer of the page that becomes visible");
+        writeText(L"Page1");
+        _pDispatch->PagePositionAbsolute(2);
+        VERIFY_ARE_EQUAL(L"Page2", readText());
+        VERIFY_IS_GREATER_THAN(pages.CommittedBytes(1), 0u);
+        VERIFY_ARE_EQUAL(0u, pages.CommittedBytes(2));
+        _pDispatch->PagePositionAbsolute(1);
+        VERIFY_ARE_EQUAL(L"Page1", readText());
+
+        Log::Comment(L"Probed pages are released by a soft reset, but pages with content are kept");
+        _pDispatch->ResetMode(DispatchTypes::ModeParams::DECPCCM_PageCursorCouplingMode);
+        _pDispatch->PagePositionAbsolute(4);
+        _pDispatch->PagePositionAbsolute(1);
+        _pDispatch->SoftReset();
+        VERIFY_ARE_EQUAL(0u, pages.CommittedBytes(4));
+        VERIFY_IS_GREATER_THAN(pages.CommittedBytes(2), 0u);
+
+        Log::Comment(L"A hard reset releases all pages");
+        _testGetSet->PrepData();
+        VERIFY_IS_TRUE(_pDispatch->HardReset());
+        VERIFY_ARE_EQUAL(0u, pages.CommittedBytes(2));
+    }
+
+    TEST_METHOD(RectangularAreaTests)
+    {
+        _testGetSet->PrepData();
+        auto& textBuffer = *_testGetSet->_textBuffer;
+        // The page starts at row 20 of the buffer, so VT row 1 is buffer row 20.
+        const auto top = 20;
+
+        const auto write = [&](const til::CoordType y, const std::wstring_view text, const TextAttribute& attr, const til::CoordType x = 0) {
+            RowWriteState state{ .text = text, .columnBegin = x };
+            textBuffer.Replace(y, attr, state);
+        };
+        const auto textAt = [&](const til::CoordType y) {
+            return std::wstring{ textBuffer.GetRowByOffset(y).GetText(0, 10) };
+        };
+        const auto attrAt = [&](const til::CoordType x, const til::CoordType y) {
+            return textBuffer.GetRowByOffset(y).GetAttrByColumn(x);
+        };
+
+        const auto attr1 = TextAttribute{ FOREGROUND_RED };
+        const auto attr2 = TextAttribute{ FOREGROUND_GREEN };
+        const auto attr3 = TextAttribute{ FOREGROUND_BLUE };
+        write(top + 0, L"0123456789", attr1);
+        write(top + 1, L"abcdefghij", attr2);
+        write(top + 2, L"ABCDEFGHIJ", attr3);
+        write(top + 3, L"ABCDEFGHIJ", attr3);
+
+        Log::Comment(L"DECCRA copies the text and attributes of each row");
+        _pDispatch->CopyRectangularArea(1, 1, 2, 5, 1, 3, 3, 1);
+        VERIFY_ARE_EQUAL(L"AB01234HIJ", textAt(top + 2));
+        VERIFY_ARE_EQUAL(L"ABabcdeHIJ", textAt(top + 3));
+        VERIFY_ARE_EQUAL(attr3, attrAt(1, top + 2));
+        VERIFY_ARE_EQUAL(attr1, attrAt(2, top + 2));
+        VERIFY_ARE_EQUAL(attr2, attrAt(6, top + 3));
+        VERIFY_ARE_EQUAL(attr3, attrAt(7, top + 3));
+
+        Log::Comment(L"DECCRA handles areas that overlap further down");
+        _pDispatch->CopyRectangularArea(1, 1, 3, 2, 1, 2, 1, 1);
+        VERIFY_ARE_EQUAL(L"0123456789", textAt(top + 0));
+        VERIFY_ARE_EQUAL(L"01cdefghij", textAt(top + 1));
+        VERIFY_ARE_EQUAL(L"ab01234HIJ", textAt(top + 2));
+        VERIFY_ARE_EQUAL(L"ABabcdeHIJ", textAt(top + 3));
+
+        Log::Comment(L"Wide glyphs can be moved within a row without erasing themselves");
+        write(top + 4, L"\u3042\u3044\u3046xyz", attr1);
+        _pDispatch->CopyRectangularArea(5, 1, 5, 9, 1, 5, 2, 1);
+        VERIFY_ARE_EQUAL(L" \u3042\u3044\u3046xyz", textAt(top + 4));
+        textBuffer.GetCursor().SetPosition({ 0, top + 4 });
+        _pDispatch->DeleteCharacter(1);
+        VERIFY_ARE_EQUAL(L"\u3042\u3044\u3046xyz ", textAt(top + 4));
+        _pDispatch->InsertCharacter(2);
+        VERIFY_ARE_EQUAL(L"  \u3042\u3044\u3046xy", textAt(top + 4));
+
+        Log::Comment(L"Wide glyphs cut in half by the source area turn into spaces");
+        write(top + 5, L"ABCDEFGHIJ", attr3);
+        _pDispatch->CopyRectangularArea(5, 4, 5, 7, 1, 6, 1, 1);
+        VERIFY_ARE_EQUAL(L" \u3044 EFGHIJ", textAt(top + 5));
+
+        Log::Comment(L"DECSERA only erases unprotected cells and keeps their attributes");
+        auto protectedAttr = attr2;
+        protectedAttr.SetProtected(true);
+        write(top + 6, L"PPPPP", protectedAttr);
+        write(top + 7, L"PPPPP", protectedAttr);
+        write(top + 6, L"uuuuu", attr3, 5);
+        _pDispatch->SelectiveEraseRectangularArea(7, 3, 7, 8);
+        VERIFY_ARE_EQUAL(L"PPPPP   uu", textAt(top + 6));
+        VERIFY_ARE_EQUAL(protectedAttr, attrAt(4, top + 6));
+        VERIFY_ARE_EQUAL(attr3, attrAt(5, top + 6));
+        VERIFY_ARE_EQUAL(L"PPPPP     ", textAt(top + 7));
+
+        Log::Comment(L"DECFRA and DECERA fill the area in every row");
+        _pDispatch->FillRectangularArea(L'*', 1, 2, 2, 4);
+        VERIFY_ARE_EQUAL(L"0***456789", textAt(top + 0));
+        VERIFY_ARE_EQUAL(L"0***efghij", textAt(top + 1));
+        _pDispatch->EraseRectangularArea(1, 3, 2, 10);
+        VERIFY_ARE_EQUAL(L"0*        ", textAt(top + 0));
+        VERIFY_ARE_EQUAL(L"0*        ", textAt(top + 1));
+    }
+
 private:
     TerminalInput _terminalInput;
     std::unique_ptr<TestGetSet> _testGetSet;
@@ -20,7 +20,9 @@ namespace Microsoft::Console::VirtualTerminal
     class IStateMachineEngine
     {
     public:
-        using StringHandler = std::function<bool(const wchar_t)>;
+        // Receives the data string of a DCS sequence in chunks as large as possible.
+        // The end of the string is signaled with a chunk containing an ESC.
+        using StringHandler = std::function<bool(const std::wstring_view)>;
 
         virtual ~IStateMachineEngine() = 0;
         IStateMachineEngine(const IStateMachineEngine&) = default;
@@ -34,6 +36,8 @@ namespace Microsoft::Console::VirtualTerminal
         virtual bool ActionExecuteFromEscape(const wchar_t wch) = 0;
         virtual bool ActionPrint(const wchar_t wch) = 0;
         virtual bool ActionPrintString(const std::wstring_view string) = 0;
+        // Same as ActionPrintString, but the string is known to consist of printable ASCII characters only.
+        virtual bool ActionPrintAsciiString(const std::wstring_view string) = 0;
 
         virtual bool ActionPassThroughString(const std::wstring_view string, const bool flush = false) = 0;
 
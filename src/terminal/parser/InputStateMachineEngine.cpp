@@ -271,6 +271,17 @@ bool InputStateMachineEngine::ActionPrintString(const std::wstring_view string)
     return _pDispatch->WriteString(string);
 }
 
+// Method Description:
+// - Same as ActionPrintString. Input doesn't benefit from knowing that the string is ASCII.
+// Arguments:
+// - string - string to dispatch.
+// Return Value:
+// - true iff we successfully dispatched the sequence.
+bool InputStateMachineEngine::ActionPrintAsciiString(const std::wstring_view string)
+{
+    return ActionPrintString(string);
+}
+
 // Method Description:
 // - Triggers the Print action to indicate that the listener should render the
 //      string of characters given.
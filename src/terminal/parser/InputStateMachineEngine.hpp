@@ -141,6 +141,7 @@ namespace Microsoft::Console::VirtualTerminal
         bool ActionPrint(const wchar_t wch) override;
 
         bool ActionPrintString(const std::wstring_view string) override;
+        bool ActionPrintAsciiString(const std::wstring_view string) override;
 
         bool ActionPassThroughString(const std::wstring_view string, const bool flush) override;
 
@@ -170,6 +170,28 @@ bool OutputStateMachineEngine::ActionPrintString(const std::wstring_view string)
     return true;
 }
 
+// Routine Description:
+// - Same as ActionPrintString, but the string consists of printable ASCII
+//      characters only, which allows the dispatcher to skip width lookups.
+// Arguments:
+// - string - string to dispatch.
+// Return Value:
+// - true iff we successfully dispatched the sequence.
+bool OutputStateMachineEngine::ActionPrintAsciiString(const std::wstring_view string)
+{
+    if (string.empty())
+    {
+        return true;
+    }
+
+    // All printable ASCII characters are graphical characters.
+    _lastPrintedChar = string.back();
+
+    _dispatch->PrintAsciiString(string);
+
+    return true;
+}
+
 // Routine Description:
 // This is called when we have determined that we don't understand a particular
 //      sequence, or the adapter has determined that the string is intended for
@@ -736,6 +758,9 @@ IStateMachineEngine::StringHandler OutputStateMachineEngine::ActionDcsDispatch(c
     case DcsActionCodes::DECDMAC_DefineMacro:
         handler = _dispatch->DefineMacro(parameters.at(0).value_or(0), parameters.at(1), parameters.at(2));
         break;
+    case DcsActionCodes::SIXEL_DefineImage:
+        handler = _dispatch->DefineSixelImage(parameters.at(0), parameters.at(1), parameters.at(2));
+        break;
     case DcsActionCodes::DECRSTS_RestoreTerminalState:
         handler = _dispatch->RestoreTerminalState(parameters.at(0));
         break;
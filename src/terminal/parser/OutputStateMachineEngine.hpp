@@ -37,6 +37,7 @@ namespace Microsoft::Console::VirtualTerminal
         bool ActionPrint(const wchar_t wch) override;
 
         bool ActionPrintString(const std::wstring_view string) override;
+        bool ActionPrintAsciiString(const std::wstring_view string) override;
 
         bool ActionPassThroughString(const std::wstring_view string, const bool flush) override;
 
@@ -185,6 +186,7 @@ namespace Microsoft::Console::VirtualTerminal
             DECDLD_DownloadDRCS = VTID("{"),
             DECAUPSS_AssignUserPreferenceSupplementalSet = VTID("!u"),
             DECDMAC_DefineMacro = VTID("!z"),
+            SIXEL_DefineImage = VTID("q"),
             DECRSTS_RestoreTerminalState = VTID("$p"),
             DECRQSS_RequestSetting = VTID("$q"),
             DECRSPS_RestorePresentationState = VTID("$t"),
@@ -0,0 +1,238 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// A differential fuzzing harness for the output state machine.
+//
+// Every input is decoded from UTF-8 and run through a StateMachine with an
+// OutputStateMachineEngine and a RecordingDispatch, first in a single call to
+// ProcessString and then again split into chunks of random sizes. Valid UTF-8
+// input is also fed through ProcessUtf8 in random byte chunks. Since the state
+// machine is supposed to resume sequences across calls, all of these have to
+// produce the same trace. If they don't, the traces are written to stderr and
+// the harness aborts, which libFuzzer reports as a crash.
+//
+// In the Fuzzing configuration this links against libFuzzer, which provides
+// main() and reports exec/s itself. In any other configuration it builds as a
+// regular program that replays the given files or directories (for instance
+// the corpus directory next to this file) and reports its own exec/s.
+//
+// On Windows it builds through FuzzHarness.vcxproj. Elsewhere it builds with
+// clang (or gcc, without libFuzzer) through the CMakeLists.txt next to this
+// file, against the windows.h/WIL/GSL/TraceLogging shims in portable/:
+//   CC=clang CXX=clang++ cmake -S src/terminal/parser/ft_fuzzharness -B build/fuzz -DFUZZING=ON
+//   cmake --build build/fuzz
+//   build/fuzz/FuzzHarness src/terminal/parser/ft_fuzzharness/corpus
+
+#include "precomp.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+
+#include <til/u8u16convert.h>
+
+#include "recordingDispatch.hpp"
+#include "../stateMachine.hpp"
+#include "../OutputStateMachineEngine.hpp"
+
+#ifdef _WIN32
+#define FUZZER_EXPORT extern "C" __declspec(dllexport)
+#else
+#define FUZZER_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
+using namespace Microsoft::Console::VirtualTerminal;
+
+namespace
+{
+    // The number of random chunkings each input is tested with.
+    constexpr size_t CHUNKINGS = 3;
+
+    // A small deterministic PRNG (splitmix64). It's seeded from the input
+    // itself, so that a crashing input always reproduces the same chunking.
+    class Random
+    {
+    public:
+        explicit Random(const std::string_view data) noexcept
+        {
+            // FNV-1a
+            _state = 0xcbf29ce484222325;
+            for (const auto ch : data)
+            {
+                _state = (_state ^ static_cast<uint8_t>(ch)) * 0x100000001b3;
+            }
+        }
+
+        uint64_t Next() noexcept
+        {
+            auto z = (_state += 0x9e3779b97f4a7c15);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+            return z ^ (z >> 31);
+        }
+
+        // Returns the size of the next chunk. Mostly tiny chunks, which split
+        // sequences in the most places, with the occasional large one.
+        size_t ChunkSize() noexcept
+        {
+            const auto r = Next();
+            switch (r & 3)
+            {
+            case 0:
+                return 1;
+            case 1:
+            case 2:
+                return 1 + ((r >> 2) & 15);
+            default:
+                return 1 + ((r >> 2) & 1023);
+            }
+        }
+
+    private:
+        uint64_t _state;
+    };
+
+    // Runs the input through a fresh state machine, so that no state leaks from
+    // one run into the next, and returns the trace of the dispatched functions.
+    template<typename T>
+    std::wstring trace(const T feed)
+    {
+        auto dispatch = std::make_unique<RecordingDispatch>();
+        const auto& recorder = *dispatch;
+        StateMachine machine{ std::make_unique<OutputStateMachineEngine>(std::move(dispatch)) };
+        feed(machine);
+        return recorder.Trace();
+    }
+
+    // Feeds the input into the state machine in chunks of random sizes.
+    template<typename T>
+    void processChunked(StateMachine& machine, const T string, Random& random, void (StateMachine::*process)(T))
+    {
+        for (size_t offset = 0; offset < string.size();)
+        {
+            const auto count = std::min(random.ChunkSize(), string.size() - offset);
+            (machine.*process)(string.substr(offset, count));
+            offset += count;
+        }
+    }
+
+    void checkTraces(const char* mode, const std::wstring& expected, const std::wstring& actual)
+    {
+        if (expected == actual)
+        {
+            return;
+        }
+
+        const auto mismatch = std::mismatch(expected.begin(), expected.end(), actual.begin(), actual.end());
+        const auto offset = mismatch.first - expected.begin();
+        const auto context = std::max<ptrdiff_t>(offset - 200, 0);
+        fprintf(stderr, "%s trace differs from ProcessString at offset %td\n", mode, offset);
+        fprintf(stderr, "--- expected\n%s\n", til::u16u8(std::wstring_view{ expected }.substr(context, 400)).c_str());
+        fprintf(stderr, "--- actual\n%s\n", til::u16u8(std::wstring_view{ actual }.substr(context, 400)).c_str());
+        std::abort();
+    }
+}
+
+FUZZER_EXPORT int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    const std::string_view bytes{ reinterpret_cast<const char*>(data), size };
+    const auto string = til::u8u16(bytes);
+    Random random{ bytes };
+
+    const auto expected = trace([&](StateMachine& machine) {
+        machine.ProcessString(string);
+    });
+    for (size_t i = 0; i < CHUNKINGS; i++)
+    {
+        checkTraces("ProcessString (chunked)", expected, trace([&](StateMachine& machine) {
+                        processChunked<std::wstring_view>(machine, string, random, &StateMachine::ProcessString);
+                    }));
+    }
+
+    // Invalid UTF-8 may be replaced differently depending on where it's cut
+    // off, so the ProcessUtf8 comparison is limited to valid input.
+    if (til::u16u8(string) == bytes)
+    {
+        checkTraces("ProcessUtf8 (chunked)", expected, trace([&](StateMachine& machine) {
+                        processChunked<std::string_view>(machine, bytes, random, &StateMachine::ProcessUtf8);
+                    }));
+    }
+    return 0;
+}
+
+#ifndef FUZZING_BUILD
+namespace
+{
+    std::vector<std::string> readInputs(const std::filesystem::path& path)
+    {
+        std::vector<std::string> inputs;
+        const auto read = [&](const std::filesystem::path& file) {
+            std::ifstream stream{ file, std::ios::binary };
+            inputs.emplace_back(std::istreambuf_iterator<char>{ stream }, std::istreambuf_iterator<char>{});
+        };
+
+        if (std::filesystem::is_directory(path))
+        {
+            for (const auto& entry : std::filesystem::recursive_directory_iterator{ path })
+            {
+                if (entry.is_regular_file())
+                {
+                    read(entry.path());
+                }
+            }
+        }
+        else
+        {
+            read(path);
+        }
+        return inputs;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <file or directory>...\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<std::string> inputs;
+    for (auto i = 1; i < argc; i++)
+    {
+        auto more = readInputs(argv[i]);
+        inputs.insert(inputs.end(), std::make_move_iterator(more.begin()), std::make_move_iterator(more.end()));
+    }
+    if (inputs.empty())
+    {
+        fprintf(stderr, "no inputs found\n");
+        return 1;
+    }
+
+    // Replay the inputs until at least a second has passed, so that the
+    // exec/s figure is meaningful even for a handful of small inputs.
+    using clock = std::chrono::steady_clock;
+    const auto start = clock::now();
+    size_t execs = 0;
+    size_t bytes = 0;
+    std::chrono::duration<double> elapsed{};
+    do
+    {
+        for (const auto& input : inputs)
+        {
+            LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(input.data()), input.size());
+            bytes += input.size();
+        }
+        execs += inputs.size();
+        elapsed = clock::now() - start;
+    } while (elapsed.count() < 1.0);
+
+    printf("%zu inputs, %zu execs in %.2fs: %.0f exec/s, %.2f MB/s\n",
+           inputs.size(),
+           execs,
+           elapsed.count(),
+           execs / elapsed.count(),
+           bytes / elapsed.count() / 1e6);
+    return 0;
+}
+#endif
@@ -0,0 +1,32 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// There's no ETW outside of Windows: Providers are dummies and events vanish.
+
+#pragma once
+
+struct _TlgProvider_t
+{
+};
+typedef const _TlgProvider_t* TraceLoggingHProvider;
+
+#define TRACELOGGING_DECLARE_PROVIDER(handle) extern const TraceLoggingHProvider handle
+#define TRACELOGGING_DEFINE_PROVIDER(handle, name, guid, ...) \
+    static const _TlgProvider_t handle##_Storage{};           \
+    extern const TraceLoggingHProvider handle = &handle##_Storage
+
+inline HRESULT TraceLoggingRegister(TraceLoggingHProvider) noexcept
+{
+    return S_OK;
+}
+
+inline void TraceLoggingUnregister(TraceLoggingHProvider) noexcept
+{
+}
+
+inline bool TraceLoggingProviderEnabled(TraceLoggingHProvider, unsigned char, unsigned long long) noexcept
+{
+    return false;
+}
+
+#define TraceLoggingWrite(...) ((void)0)
@@ -0,0 +1,6 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// The intsafe.h functions aren't used by the code in the portable harness build.
+
+#pragma once
@@ -0,0 +1,14 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// Declares the variable the MSVC CRT uses to record the CPU's SIMD support.
+// It's defined (and initialized using cpuid) in portable.cpp.
+
+#pragma once
+
+#define __ISA_AVAILABLE_X86 0
+#define __ISA_AVAILABLE_SSE2 1
+#define __ISA_AVAILABLE_SSE42 2
+#define __ISA_AVAILABLE_AVX 3
+#define __ISA_AVAILABLE_ENFSTRG 4
+#define __ISA_AVAILABLE_AVX2 5
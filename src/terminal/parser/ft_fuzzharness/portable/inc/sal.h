@@ -0,0 +1,30 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// SAL annotations carry no meaning outside of MSVC's code analysis.
+
+#pragma once
+
+#define _In_
+#define _In_opt_
+#define _In_z_
+#define _In_reads_(x)
+#define _In_reads_bytes_(x)
+#define _Inout_
+#define _Inout_opt_
+#define _Out_
+#define _Out_opt_
+#define _Out_writes_(x)
+#define _Out_writes_bytes_(x)
+#define _Outptr_
+#define _Ret_maybenull_
+#define _Success_(x)
+#define _Check_return_
+#define _Must_inspect_result_
+#define _Null_terminated_
+#define _Printf_format_string_
+#define _Analysis_assume_(x)
+#define _Pre_satisfies_(x)
+#define _Post_satisfies_(x)
+#define _When_(x, y)
+#define _Use_decl_annotations_
@@ -0,0 +1,8 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// Everything the portable harness build needs from WIL lives in result.h.
+
+#pragma once
+
+#include "result.h"
@@ -0,0 +1,243 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+/*
+Module Name:
+- result.h
+
+Abstract:
+- The subset of WIL's error handling helpers used by the parser, for the
+    portable build of the fuzzing harness.
+- THROW_* macros throw a wil::ResultException, RETURN_* macros return the
+    HRESULT and LOG_* macros evaluate to it without logging anything.
+    FAIL_FAST_* macros abort, which libFuzzer reports as a crash.
+*/
+
+#pragma once
+
+#include <cstdlib>
+#include <exception>
+#include <new>
+#include <string_view>
+#include <utility>
+
+namespace wil
+{
+    class ResultException : public std::exception
+    {
+    public:
+        explicit ResultException(const HRESULT hr) noexcept :
+            _hr{ hr }
+        {
+        }
+
+        HRESULT GetErrorCode() const noexcept
+        {
+            return _hr;
+        }
+
+        const char* what() const noexcept override
+        {
+            return "wil::ResultException";
+        }
+
+    private:
+        HRESULT _hr;
+    };
+
+    inline HRESULT ResultFromCaughtException() noexcept
+    {
+        try
+        {
+            throw;
+        }
+        catch (const ResultException& e)
+        {
+            return e.GetErrorCode();
+        }
+        catch (const std::bad_alloc&)
+        {
+            return E_OUTOFMEMORY;
+        }
+        catch (...)
+        {
+            return HRESULT_FROM_WIN32(ERROR_UNHANDLED_EXCEPTION);
+        }
+    }
+
+    // Only used by the to_string() debugging helpers in til, which the harness
+    // never calls. It's therefore only declared.
+    template<typename T, typename... Args>
+    T str_printf(const wchar_t* format, Args&&... args);
+
+    template<typename T>
+    constexpr bool verify_bool(const T value) noexcept
+    {
+        return static_cast<bool>(value);
+    }
+
+    template<typename T>
+    class scope_exit_t
+    {
+    public:
+        explicit scope_exit_t(T&& fn) noexcept :
+            _fn{ std::move(fn) }
+        {
+        }
+
+        scope_exit_t(scope_exit_t&& other) noexcept :
+            _fn{ std::move(other._fn) },
+            _active{ std::exchange(other._active, false) }
+        {
+        }
+
+        scope_exit_t(const scope_exit_t&) = delete;
+        scope_exit_t& operator=(const scope_exit_t&) = delete;
+        scope_exit_t& operator=(scope_exit_t&&) = delete;
+
+        ~scope_exit_t()
+        {
+            reset();
+        }
+
+        void reset() noexcept
+        {
+            if (std::exchange(_active, false))
+            {
+                _fn();
+            }
+        }
+
+        void release() noexcept
+        {
+            _active = false;
+        }
+
+    private:
+        T _fn;
+        bool _active = true;
+    };
+
+    template<typename T>
+    [[nodiscard]] scope_exit_t<T> scope_exit(T&& fn) noexcept
+    {
+        return scope_exit_t<T>{ std::forward<T>(fn) };
+    }
+
+    // A std::wstring_view that's known to be null-terminated.
+    class zwstring_view : public std::wstring_view
+    {
+    public:
+        constexpr zwstring_view() noexcept = default;
+        constexpr zwstring_view(const wchar_t* str) noexcept :
+            std::wstring_view{ str }
+        {
+        }
+        template<typename Traits, typename Alloc>
+        zwstring_view(const std::basic_string<wchar_t, Traits, Alloc>& str) noexcept :
+            std::wstring_view{ str }
+        {
+        }
+
+        constexpr const wchar_t* c_str() const noexcept
+        {
+            return data();
+        }
+    };
+}
+
+#define WI_NOEXCEPT noexcept
+#define WI_IsFlagSet(val, flag) (((val) & (flag)) == (flag))
+#define WI_IsFlagClear(val, flag) (((val) & (flag)) == 0)
+#define WI_IsAnyFlagSet(val, flags) (((val) & (flags)) != 0)
+#define WI_SetFlag(val, flag) ((val) |= (flag))
+#define WI_ClearFlag(val, flag) ((val) &= ~(flag))
+
+#define THROW_HR(hr) throw ::wil::ResultException(hr)
+#define THROW_HR_MSG(hr, ...) THROW_HR(hr)
+#define THROW_HR_IF(hr, condition) \
+    do                             \
+    {                              \
+        if (condition)             \
+        {                          \
+            THROW_HR(hr);          \
+        }                          \
+    } while (0)
+#define THROW_HR_IF_NULL(hr, ptr) THROW_HR_IF(hr, (ptr) == nullptr)
+#define THROW_IF_FAILED(hr)                   \
+    do                                        \
+    {                                         \
+        const HRESULT __hrRet = (hr);         \
+        if (FAILED(__hrRet))                  \
+        {                                     \
+            THROW_HR(__hrRet);                \
+        }                                     \
+    } while (0)
+#define THROW_IF_FAILED_MSG(hr, ...) THROW_IF_FAILED(hr)
+#define THROW_WIN32(err) THROW_HR(HRESULT_FROM_WIN32(err))
+#define THROW_WIN32_IF(err, condition) THROW_HR_IF(HRESULT_FROM_WIN32(err), condition)
+#define THROW_IF_NULL_ALLOC(ptr) THROW_HR_IF_NULL(E_OUTOFMEMORY, ptr)
+#define THROW_LAST_ERROR() THROW_HR(E_FAIL)
+#define THROW_LAST_ERROR_IF(condition) THROW_HR_IF(E_FAIL, condition)
+#define THROW_IF_NTSTATUS_FAILED(status) THROW_HR_IF(E_FAIL, (status) < 0)
+
+#define RETURN_HR(hr) return (hr)
+#define RETURN_HR_IF(hr, condition) \
+    do                              \
+    {                               \
+        if (condition)              \
+        {                           \
+            return (hr);            \
+        }                           \
+    } while (0)
+#define RETURN_HR_IF_EXPECTED(hr, condition) RETURN_HR_IF(hr, condition)
+#define RETURN_HR_IF_NULL(hr, ptr) RETURN_HR_IF(hr, (ptr) == nullptr)
+#define RETURN_IF_FAILED(hr)          \
+    do                                \
+    {                                 \
+        const HRESULT __hrRet = (hr); \
+        if (FAILED(__hrRet))          \
+        {                             \
+            return __hrRet;           \
+        }                             \
+    } while (0)
+#define RETURN_IF_FAILED_EXPECTED(hr) RETURN_IF_FAILED(hr)
+#define RETURN_WIN32(err) return HRESULT_FROM_WIN32(err)
+#define RETURN_LAST_ERROR() return E_FAIL
+#define RETURN_LAST_ERROR_IF(condition) RETURN_HR_IF(E_FAIL, condition)
+#define RETURN_IF_WIN32_BOOL_FALSE(b) RETURN_HR_IF(E_FAIL, !(b))
+
+#define LOG_HR(hr) (hr)
+#define LOG_HR_MSG(hr, ...) (hr)
+#define LOG_IF_FAILED(hr) (hr)
+#define LOG_HR_IF(hr, condition) (condition)
+#define LOG_LAST_ERROR() ((void)0)
+#define LOG_LAST_ERROR_IF(condition) (condition)
+#define SUCCEEDED_LOG(hr) SUCCEEDED(hr)
+#define LOG_CAUGHT_EXCEPTION() ::wil::ResultFromCaughtException()
+
+#define CATCH_RETURN()                             \
+    catch (...)                                    \
+    {                                              \
+        return ::wil::ResultFromCaughtException(); \
+    }
+#define CATCH_LOG() \
+    catch (...)     \
+    {               \
+        LOG_CAUGHT_EXCEPTION(); \
+    }
+
+#define FAIL_FAST() std::abort()
+#define FAIL_FAST_HR(hr) std::abort()
+#define FAIL_FAST_IF(condition) \
+    do                          \
+    {                           \
+        if (condition)          \
+        {                       \
+            std::abort();       \
+        }                       \
+    } while (0)
+#define FAIL_FAST_IF_FAILED(hr) FAIL_FAST_IF(FAILED(hr))
+#define FAIL_FAST_IF_NULL(ptr) FAIL_FAST_IF((ptr) == nullptr)
+#define FAIL_FAST_HR_IF(hr, condition) FAIL_FAST_IF(condition)
+#define FAIL_FAST_CAUGHT_EXCEPTION() std::abort()
@@ -0,0 +1,238 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+/*
+Module Name:
+- windows.h
+
+Abstract:
+- The subset of the Win32 API that the parser, the adapter headers and til.h
+    depend on, for the portable build of the fuzzing harness.
+- MultiByteToWideChar and WideCharToMultiByte only support CP_UTF8 and are
+    implemented in portable.cpp. Everything else is either a type, a constant
+    or declared without a definition, because it's never called by the code
+    that's compiled into the harness.
+*/
+
+#pragma once
+
+// til/color.h checks for this to provide conversions to and from COLORREF.
+#define _WINDEF_
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cwchar>
+#include <type_traits>
+
+#include <sal.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+typedef unsigned char BYTE;
+typedef unsigned short WORD;
+typedef unsigned int DWORD;
+typedef int BOOL;
+typedef unsigned char BOOLEAN;
+typedef char CHAR;
+typedef wchar_t WCHAR;
+typedef short SHORT;
+typedef unsigned short USHORT;
+typedef int INT;
+typedef unsigned int UINT;
+typedef int LONG;
+typedef unsigned int ULONG;
+typedef int64_t LONGLONG;
+typedef uint64_t ULONGLONG;
+typedef int16_t INT16;
+typedef uint16_t UINT16;
+typedef int32_t INT32;
+typedef uint32_t UINT32;
+typedef int64_t INT64;
+typedef uint64_t UINT64;
+typedef intptr_t INT_PTR;
+typedef uintptr_t UINT_PTR;
+typedef intptr_t LONG_PTR;
+typedef uintptr_t ULONG_PTR;
+typedef size_t SIZE_T;
+typedef void* PVOID;
+typedef void* LPVOID;
+typedef void* HANDLE;
+typedef void* HMODULE;
+typedef HANDLE HINSTANCE;
+typedef HANDLE HWND;
+typedef CHAR* LPSTR;
+typedef const CHAR* LPCSTR;
+typedef WCHAR* LPWSTR;
+typedef WCHAR* PWSTR;
+typedef const WCHAR* LPCWSTR;
+typedef const WCHAR* PCWSTR;
+typedef BOOL* LPBOOL;
+typedef LONG HRESULT;
+typedef LONG NTSTATUS;
+typedef DWORD COLORREF;
+typedef DWORD LCID;
+
+#define TRUE 1
+#define FALSE 0
+#define CONST const
+#define VOID void
+#define WINAPI
+
+#define S_OK ((HRESULT)0L)
+#define S_FALSE ((HRESULT)1L)
+#define E_NOTIMPL ((HRESULT)0x80004001L)
+#define E_POINTER ((HRESULT)0x80004003L)
+#define E_ABORT ((HRESULT)0x80004004L)
+#define E_FAIL ((HRESULT)0x80004005L)
+#define E_UNEXPECTED ((HRESULT)0x8000FFFFL)
+#define E_OUTOFMEMORY ((HRESULT)0x8007000EL)
+#define E_INVALIDARG ((HRESULT)0x80070057L)
+#define E_BOUNDS ((HRESULT)0x8000000BL)
+
+#define ERROR_SUCCESS 0L
+#define ERROR_INVALID_DATA 13L
+#define ERROR_INVALID_PARAMETER 87L
+#define ERROR_INSUFFICIENT_BUFFER 122L
+#define ERROR_MORE_DATA 234L
+#define ERROR_NO_UNICODE_TRANSLATION 1113L
+#define ERROR_INVALID_FLAGS 1004L
+#define ERROR_UNHANDLED_EXCEPTION 574L
+#define ERROR_ENVVAR_NOT_FOUND 203L
+
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
+
+constexpr HRESULT HRESULT_FROM_WIN32(const unsigned long x) noexcept
+{
+    return static_cast<HRESULT>(x) <= 0 ? static_cast<HRESULT>(x) : static_cast<HRESULT>((x & 0x0000FFFF) | (7 << 16) | 0x80000000);
+}
+
+#define LOBYTE(w) ((BYTE)(((ULONG_PTR)(w)) & 0xff))
+#define HIBYTE(w) ((BYTE)((((ULONG_PTR)(w)) >> 8) & 0xff))
+#define LOWORD(l) ((WORD)(((ULONG_PTR)(l)) & 0xffff))
+#define HIWORD(l) ((WORD)((((ULONG_PTR)(l)) >> 16) & 0xffff))
+#define RGB(r, g, b) ((COLORREF)(((BYTE)(r) | ((WORD)((BYTE)(g)) << 8)) | (((DWORD)(BYTE)(b)) << 16)))
+#define GetRValue(rgb) (LOBYTE(rgb))
+#define GetGValue(rgb) (LOBYTE(((WORD)(rgb)) >> 8))
+#define GetBValue(rgb) (LOBYTE((rgb) >> 16))
+
+#define UNREFERENCED_PARAMETER(P) (void)(P)
+#define ARRAYSIZE(a) (sizeof(a) / sizeof((a)[0]))
+#define UNICODE_NULL ((WCHAR)0)
+#define ANYSIZE_ARRAY 1
+
+#define DEFINE_ENUM_FLAG_OPERATORS(ENUMTYPE)                                                                                                                                                              \
+    inline constexpr ENUMTYPE operator|(ENUMTYPE a, ENUMTYPE b) noexcept { return ENUMTYPE(((std::underlying_type_t<ENUMTYPE>)a) | ((std::underlying_type_t<ENUMTYPE>)b)); }                           \
+    inline ENUMTYPE& operator|=(ENUMTYPE& a, ENUMTYPE b) noexcept { return (ENUMTYPE&)(((std::underlying_type_t<ENUMTYPE>&)a) |= ((std::underlying_type_t<ENUMTYPE>)b)); }                                \
+    inline constexpr ENUMTYPE operator&(ENUMTYPE a, ENUMTYPE b) noexcept { return ENUMTYPE(((std::underlying_type_t<ENUMTYPE>)a) & ((std::underlying_type_t<ENUMTYPE>)b)); }                           \
+    inline ENUMTYPE& operator&=(ENUMTYPE& a, ENUMTYPE b) noexcept { return (ENUMTYPE&)(((std::underlying_type_t<ENUMTYPE>&)a) &= ((std::underlying_type_t<ENUMTYPE>)b)); }                                \
+    inline constexpr ENUMTYPE operator~(ENUMTYPE a) noexcept { return ENUMTYPE(~((std::underlying_type_t<ENUMTYPE>)a)); }                                                                              \
+    inline constexpr ENUMTYPE operator^(ENUMTYPE a, ENUMTYPE b) noexcept { return ENUMTYPE(((std::underlying_type_t<ENUMTYPE>)a) ^ ((std::underlying_type_t<ENUMTYPE>)b)); }                           \
+    inline ENUMTYPE& operator^=(ENUMTYPE& a, ENUMTYPE b) noexcept { return (ENUMTYPE&)(((std::underlying_type_t<ENUMTYPE>&)a) ^= ((std::underlying_type_t<ENUMTYPE>)b)); }
+
+typedef struct _COORD
+{
+    SHORT X;
+    SHORT Y;
+} COORD, *PCOORD;
+
+typedef struct _SMALL_RECT
+{
+    SHORT Left;
+    SHORT Top;
+    SHORT Right;
+    SHORT Bottom;
+} SMALL_RECT, *PSMALL_RECT;
+
+typedef struct tagRECT
+{
+    LONG left;
+    LONG top;
+    LONG right;
+    LONG bottom;
+} RECT;
+
+typedef struct tagPOINT
+{
+    LONG x;
+    LONG y;
+} POINT;
+
+typedef struct tagSIZE
+{
+    LONG cx;
+    LONG cy;
+} SIZE;
+
+typedef struct _GUID
+{
+    uint32_t Data1;
+    uint16_t Data2;
+    uint16_t Data3;
+    uint8_t Data4[8];
+} GUID;
+
+#define FOREGROUND_BLUE 0x0001
+#define FOREGROUND_GREEN 0x0002
+#define FOREGROUND_RED 0x0004
+#define FOREGROUND_INTENSITY 0x0008
+#define BACKGROUND_BLUE 0x0010
+#define BACKGROUND_GREEN 0x0020
+#define BACKGROUND_RED 0x0040
+#define BACKGROUND_INTENSITY 0x0080
+#define COMMON_LVB_LEADING_BYTE 0x0100
+#define COMMON_LVB_TRAILING_BYTE 0x0200
+#define COMMON_LVB_GRID_HORIZONTAL 0x0400
+#define COMMON_LVB_GRID_LVERTICAL 0x0800
+#define COMMON_LVB_GRID_RVERTICAL 0x1000
+#define COMMON_LVB_REVERSE_VIDEO 0x4000
+#define COMMON_LVB_UNDERSCORE 0x8000
+#define COMMON_LVB_SBCSDBCS 0x0300
+
+#define CP_ACP 0
+#define CP_UTF8 65001
+#define MB_ERR_INVALID_CHARS 0x00000008
+
+#define LOCALE_NAME_USER_DEFAULT nullptr
+#define LINGUISTIC_IGNORECASE 0x00000010
+
+inline unsigned char _BitScanForward(unsigned long* index, const unsigned long mask) noexcept
+{
+    if (!mask)
+    {
+        return 0;
+    }
+    *index = static_cast<unsigned long>(__builtin_ctzl(mask));
+    return 1;
+}
+
+inline unsigned char _BitScanForward64(unsigned long* index, const unsigned long long mask) noexcept
+{
+    if (!mask)
+    {
+        return 0;
+    }
+    *index = static_cast<unsigned long>(__builtin_ctzll(mask));
+    return 1;
+}
+
+inline unsigned char _BitScanReverse(unsigned long* index, const unsigned long mask) noexcept
+{
+    if (!mask)
+    {
+        return 0;
+    }
+    *index = static_cast<unsigned long>(sizeof(mask) * CHAR_BIT - 1 - __builtin_clzl(mask));
+    return 1;
+}
+
+int MultiByteToWideChar(UINT codePage, DWORD flags, LPCSTR str, int len, LPWSTR out, int capacity) noexcept;
+int WideCharToMultiByte(UINT codePage, DWORD flags, LPCWSTR str, int len, LPSTR out, int capacity, LPCSTR defaultChar, LPBOOL usedDefaultChar) noexcept;
+DWORD GetLastError() noexcept;
+void SetLastError(DWORD error) noexcept;
+int CompareStringOrdinal(LPCWSTR lhs, int lhsLen, LPCWSTR rhs, int rhsLen, BOOL ignoreCase) noexcept;
+int CompareStringEx(LPCWSTR locale, DWORD flags, LPCWSTR lhs, int lhsLen, LPCWSTR rhs, int rhsLen, void* version, void* reserved, LONG_PTR param) noexcept;
+int FindNLSStringEx(LPCWSTR locale, DWORD flags, LPCWSTR source, int sourceLen, LPCWSTR value, int valueLen, int* found, void* version, void* reserved, LONG_PTR param) noexcept;
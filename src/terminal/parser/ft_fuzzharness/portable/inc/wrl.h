@@ -0,0 +1,6 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// Intentionally empty: Nothing from this header is used by the portable harness build.
+
+#pragma once
@@ -0,0 +1,232 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// Definitions for the parts of the Win32 API and the MSVC CRT that the
+// portable (clang/gcc) build of the fuzzing harness can't do without.
+
+#include <windows.h>
+#include <isa_availability.h>
+
+#include <cstring>
+
+extern "C" int __isa_available;
+
+// stateMachine.cpp picks its SIMD code path based on this.
+extern "C" int __isa_available = []() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return __ISA_AVAILABLE_AVX2;
+    }
+    return __ISA_AVAILABLE_SSE2;
+#else
+    return __ISA_AVAILABLE_X86;
+#endif
+}();
+
+static thread_local DWORD lastError = ERROR_SUCCESS;
+
+DWORD GetLastError() noexcept
+{
+    return lastError;
+}
+
+void SetLastError(const DWORD error) noexcept
+{
+    lastError = error;
+}
+
+namespace
+{
+    constexpr wchar_t replacementChar = 0xFFFD;
+
+    // Appends code units to the caller's buffer, or only counts them if
+    // capacity is 0, just like the Win32 conversion functions do.
+    template<typename T>
+    class Sink
+    {
+    public:
+        Sink(T* const out, const int capacity) noexcept :
+            _out{ capacity ? out : nullptr },
+            _capacity{ capacity }
+        {
+        }
+
+        void push(const T ch) noexcept
+        {
+            if (_out && _length < _capacity)
+            {
+                _out[_length] = ch;
+            }
+            _length++;
+        }
+
+        int result() const noexcept
+        {
+            if (_out && _length > _capacity)
+            {
+                SetLastError(ERROR_INSUFFICIENT_BUFFER);
+                return 0;
+            }
+            return _length;
+        }
+
+    private:
+        T* _out;
+        int _capacity;
+        int _length = 0;
+    };
+
+    bool validateArguments(const UINT codePage, const void* str, int& len, const int capacity) noexcept
+    {
+        if (codePage != CP_UTF8 || !str || len == 0 || len < -1 || capacity < 0)
+        {
+            SetLastError(ERROR_INVALID_PARAMETER);
+            return false;
+        }
+        return true;
+    }
+}
+
+// Decodes UTF-8 into UTF-16. Like on Windows, each maximal subpart of an
+// ill-formed sequence is replaced with a single U+FFFD.
+int MultiByteToWideChar(const UINT codePage, const DWORD /*flags*/, const LPCSTR str, int len, const LPWSTR out, const int capacity) noexcept
+{
+    if (!validateArguments(codePage, str, len, capacity))
+    {
+        return 0;
+    }
+    if (len == -1)
+    {
+        len = static_cast<int>(strlen(str)) + 1;
+    }
+
+    const auto bytes = reinterpret_cast<const uint8_t*>(str);
+    Sink<wchar_t> sink{ out, capacity };
+
+    for (auto i = 0; i < len;)
+    {
+        const auto lead = bytes[i++];
+        if (lead < 0x80)
+        {
+            sink.push(lead);
+            continue;
+        }
+
+        auto trail = 0;
+        uint8_t lo = 0x80;
+        uint8_t hi = 0xBF;
+        char32_t cp = 0;
+        if (lead >= 0xC2 && lead <= 0xDF)
+        {
+            trail = 1;
+            cp = lead & 0x1F;
+        }
+        else if (lead >= 0xE0 && lead <= 0xEF)
+        {
+            trail = 2;
+            cp = lead & 0x0F;
+            lo = lead == 0xE0 ? 0xA0 : 0x80;
+            hi = lead == 0xED ? 0x9F : 0xBF;
+        }
+        else if (lead >= 0xF0 && lead <= 0xF4)
+        {
+            trail = 3;
+            cp = lead & 0x07;
+            lo = lead == 0xF0 ? 0x90 : 0x80;
+            hi = lead == 0xF4 ? 0x8F : 0xBF;
+        }
+        else
+        {
+            sink.push(replacementChar);
+            continue;
+        }
+
+        for (; trail; trail--)
+        {
+            if (i >= len || bytes[i] < lo || bytes[i] > hi)
+            {
+                break;
+            }
+            cp = (cp << 6) | (bytes[i++] & 0x3F);
+            lo = 0x80;
+            hi = 0xBF;
+        }
+
+        if (trail)
+        {
+            sink.push(replacementChar);
+        }
+        else if (cp > 0xFFFF)
+        {
+            cp -= 0x10000;
+            sink.push(static_cast<wchar_t>(0xD800 | (cp >> 10)));
+            sink.push(static_cast<wchar_t>(0xDC00 | (cp & 0x3FF)));
+        }
+        else
+        {
+            sink.push(static_cast<wchar_t>(cp));
+        }
+    }
+
+    return sink.result();
+}
+
+// Encodes UTF-16 into UTF-8. Unpaired surrogates are replaced with U+FFFD.
+int WideCharToMultiByte(const UINT codePage, const DWORD /*flags*/, const LPCWSTR str, int len, const LPSTR out, const int capacity, const LPCSTR /*defaultChar*/, const LPBOOL /*usedDefaultChar*/) noexcept
+{
+    if (!validateArguments(codePage, str, len, capacity))
+    {
+        return 0;
+    }
+    if (len == -1)
+    {
+        len = static_cast<int>(wcslen(str)) + 1;
+    }
+
+    Sink<char> sink{ out, capacity };
+
+    for (auto i = 0; i < len;)
+    {
+        char32_t cp = static_cast<char16_t>(str[i++]);
+        if (cp >= 0xD800 && cp <= 0xDFFF)
+        {
+            const auto next = i < len ? static_cast<char16_t>(str[i]) : char16_t{};
+            if (cp <= 0xDBFF && next >= 0xDC00 && next <= 0xDFFF)
+            {
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (next - 0xDC00);
+                i++;
+            }
+            else
+            {
+                cp = replacementChar;
+            }
+        }
+
+        if (cp < 0x80)
+        {
+            sink.push(static_cast<char>(cp));
+        }
+        else if (cp < 0x800)
+        {
+            sink.push(static_cast<char>(0xC0 | (cp >> 6)));
+            sink.push(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+        else if (cp < 0x10000)
+        {
+            sink.push(static_cast<char>(0xE0 | (cp >> 12)));
+            sink.push(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            sink.push(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+        else
+        {
+            sink.push(static_cast<char>(0xF0 | (cp >> 18)));
+            sink.push(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+            sink.push(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            sink.push(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+    }
+
+    return sink.result();
+}
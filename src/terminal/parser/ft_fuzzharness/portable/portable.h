@@ -0,0 +1,37 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+/*
+Module Name:
+- portable.h
+
+Abstract:
+- Force-included into every translation unit of the portable (clang/gcc)
+    build of the fuzzing harness, see CMakeLists.txt next to fuzzmain.cpp.
+- Maps the MSVC keywords used by the parser onto their standard equivalents
+    and pulls in the windows.h shim, since some headers (like til.h) use
+    Win32 types before precomp.h gets around to including windows.h.
+*/
+
+#pragma once
+
+#if !defined(__GNUC__)
+#error "portable.h is only meant for clang and gcc builds"
+#endif
+
+#if __WCHAR_MAX__ > 0xffff
+#error "The parser works on UTF-16. Compile with -fshort-wchar."
+#endif
+
+#define __declspec(x)
+#define __forceinline inline __attribute__((always_inline))
+#define __fastcall
+#define __cdecl
+#define __stdcall
+#define sealed final
+#define __pragma(x)
+
+#define _DDK_INCLUDED
+#define _ITERATOR_DEBUG_LEVEL 0
+
+#include <windows.h>
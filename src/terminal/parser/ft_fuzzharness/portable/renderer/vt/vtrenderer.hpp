@@ -0,0 +1,29 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+/*
+Module Name:
+- vtrenderer.hpp
+
+Abstract:
+- Stands in for src/renderer/vt/vtrenderer.hpp in the portable build of the
+    fuzzing harness. OutputStateMachineEngine includes it as
+    "../renderer/vt/vtrenderer.hpp", which resolves to this file relative to
+    the portable/inc include directory.
+- The harness never connects a VtEngine, so only the one method the engine
+    calls is declared. Like the real header it provides conattrs.hpp.
+*/
+
+#pragma once
+
+#include "conattrs.hpp"
+
+namespace Microsoft::Console::Render
+{
+    class VtEngine
+    {
+    public:
+        virtual ~VtEngine() = default;
+        [[nodiscard]] virtual HRESULT WriteTerminalW(const std::wstring_view str, const bool flush = false) noexcept = 0;
+    };
+}
@@ -0,0 +1,65 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// The portable build compiles with -fshort-wchar, but the C library's wide
+// string functions assume a 32-bit wchar_t. These replace the ones that the
+// STL's std::wstring calls into. Their definitions in the executable take
+// precedence over those in the C library.
+//
+// Intentionally doesn't include <cwchar>, whose C++ overloads of wmemchr
+// would conflict with the definition below.
+
+using size_t = decltype(sizeof(0));
+
+extern "C" size_t wcslen(const wchar_t* str) noexcept
+{
+    auto it = str;
+    while (*it)
+    {
+        ++it;
+    }
+    return static_cast<size_t>(it - str);
+}
+
+extern "C" wchar_t* wmemchr(const wchar_t* str, const wchar_t ch, size_t count) noexcept
+{
+    for (; count; --count, ++str)
+    {
+        if (*str == ch)
+        {
+            return const_cast<wchar_t*>(str);
+        }
+    }
+    return nullptr;
+}
+
+extern "C" int wmemcmp(const wchar_t* lhs, const wchar_t* rhs, size_t count) noexcept
+{
+    for (; count; --count, ++lhs, ++rhs)
+    {
+        if (*lhs != *rhs)
+        {
+            return *lhs < *rhs ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+extern "C" wchar_t* wmemcpy(wchar_t* dst, const wchar_t* src, const size_t count) noexcept
+{
+    return static_cast<wchar_t*>(__builtin_memcpy(dst, src, count * sizeof(wchar_t)));
+}
+
+extern "C" wchar_t* wmemmove(wchar_t* dst, const wchar_t* src, const size_t count) noexcept
+{
+    return static_cast<wchar_t*>(__builtin_memmove(dst, src, count * sizeof(wchar_t)));
+}
+
+extern "C" wchar_t* wmemset(wchar_t* dst, const wchar_t ch, const size_t count) noexcept
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        dst[i] = ch;
+    }
+    return dst;
+}
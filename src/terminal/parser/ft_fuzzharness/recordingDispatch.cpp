@@ -0,0 +1,119 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "recordingDispatch.hpp"
+
+using namespace Microsoft::Console::VirtualTerminal;
+
+const std::wstring& RecordingDispatch::Trace() const noexcept
+{
+    return _trace;
+}
+
+void RecordingDispatch::ClearTrace() noexcept
+{
+    _trace.clear();
+    _textKind = 0;
+}
+
+void RecordingDispatch::Print(const wchar_t wchPrintable)
+{
+    _appendText(L'P', { &wchPrintable, 1 });
+}
+
+void RecordingDispatch::PrintString(const std::wstring_view string)
+{
+    _appendText(L'P', string);
+}
+
+void RecordingDispatch::_appendArgument(const VTParameter parameter)
+{
+    _trace.push_back(L' ');
+    if (parameter.has_value())
+    {
+        fmt::format_to(std::back_inserter(_trace), FMT_COMPILE(L"{}"), parameter.value());
+    }
+    else
+    {
+        _trace.push_back(L'-');
+    }
+}
+
+void RecordingDispatch::_appendArgument(const VTParameters parameters)
+{
+    for (size_t i = 0; i < parameters.size(); i++)
+    {
+        _appendArgument(parameters.at(i));
+        const auto subParameters = parameters.subParamsFor(i);
+        for (size_t j = 0; j < subParameters.size(); j++)
+        {
+            _trace.push_back(L':');
+            _appendArgument(subParameters.at(j));
+        }
+    }
+}
+
+void RecordingDispatch::_appendArgument(const VTID id)
+{
+    _trace.push_back(L' ');
+    for (const auto ch : id.ToString())
+    {
+        _trace.push_back(ch);
+    }
+}
+
+void RecordingDispatch::_appendArgument(const std::wstring_view string)
+{
+    _trace.append(L" \"");
+    _trace.append(string);
+    _trace.push_back(L'"');
+}
+
+// Routine Description:
+// - Starts a new line in the trace, terminating any text that was being coalesced.
+// Arguments:
+// - name - The name of the dispatched function
+// Return Value:
+// - <none>
+void RecordingDispatch::_beginEvent(const std::wstring_view name)
+{
+    if (_textKind)
+    {
+        _trace.push_back(L'\n');
+        _textKind = 0;
+    }
+    _trace.append(name);
+}
+
+// Routine Description:
+// - Appends printed text or DCS data to the trace. Text of the same kind is
+//   appended to the current line, so the trace is the same no matter how the
+//   text was split up by the state machine.
+// Arguments:
+// - kind - 'P' for printed text, 'D' for DCS data
+// - text - The text to append
+// Return Value:
+// - <none>
+void RecordingDispatch::_appendText(const wchar_t kind, const std::wstring_view text)
+{
+    if (_textKind != kind)
+    {
+        if (_textKind)
+        {
+            _trace.push_back(L'\n');
+        }
+        _trace.push_back(kind);
+        _trace.push_back(L' ');
+        _textKind = kind;
+    }
+    _trace.append(text);
+}
+
+ITermDispatch::StringHandler RecordingDispatch::_dataHandler()
+{
+    return [this](const std::wstring_view data) {
+        _appendText(L'D', data);
+        return true;
+    };
+}
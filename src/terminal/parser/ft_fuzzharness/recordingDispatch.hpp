@@ -0,0 +1,214 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+/*
+Module Name:
+- recordingDispatch.hpp
+
+Abstract:
+- A TermDispatch that records every call it receives as a line of text.
+    Consecutive Print/PrintString calls, and consecutive chunks of a DCS data
+    string, are coalesced so that the trace doesn't depend on how the input
+    was split into ProcessString calls.
+*/
+#pragma once
+
+#include "../../adapter/termDispatch.hpp"
+
+namespace Microsoft::Console::VirtualTerminal
+{
+    class RecordingDispatch;
+};
+
+class Microsoft::Console::VirtualTerminal::RecordingDispatch : public Microsoft::Console::VirtualTerminal::TermDispatch
+{
+public:
+    const std::wstring& Trace() const noexcept;
+    void ClearTrace() noexcept;
+
+    void Print(const wchar_t wchPrintable) override;
+    void PrintString(const std::wstring_view string) override;
+
+    bool CursorUp(const VTInt distance) override { return _record(L"CUU", distance); }
+    bool CursorDown(const VTInt distance) override { return _record(L"CUD", distance); }
+    bool CursorForward(const VTInt distance) override { return _record(L"CUF", distance); }
+    bool CursorBackward(const VTInt distance) override { return _record(L"CUB", distance); }
+    bool CursorNextLine(const VTInt distance) override { return _record(L"CNL", distance); }
+    bool CursorPrevLine(const VTInt distance) override { return _record(L"CPL", distance); }
+    bool CursorHorizontalPositionAbsolute(const VTInt column) override { return _record(L"CHA", column); }
+    bool VerticalLinePositionAbsolute(const VTInt line) override { return _record(L"VPA", line); }
+    bool HorizontalPositionRelative(const VTInt distance) override { return _record(L"HPR", distance); }
+    bool VerticalPositionRelative(const VTInt distance) override { return _record(L"VPR", distance); }
+    bool CursorPosition(const VTInt line, const VTInt column) override { return _record(L"CUP", line, column); }
+    bool CursorSaveState() override { return _record(L"DECSC"); }
+    bool CursorRestoreState() override { return _record(L"DECRC"); }
+    bool InsertCharacter(const VTInt count) override { return _record(L"ICH", count); }
+    bool DeleteCharacter(const VTInt count) override { return _record(L"DCH", count); }
+    bool ScrollUp(const VTInt distance) override { return _record(L"SU", distance); }
+    bool ScrollDown(const VTInt distance) override { return _record(L"SD", distance); }
+    bool InsertLine(const VTInt distance) override { return _record(L"IL", distance); }
+    bool DeleteLine(const VTInt distance) override { return _record(L"DL", distance); }
+    bool InsertColumn(const VTInt distance) override { return _record(L"DECIC", distance); }
+    bool DeleteColumn(const VTInt distance) override { return _record(L"DECDC", distance); }
+    bool SetKeypadMode(const bool applicationMode) override { return _record(L"DECKPAM", applicationMode); }
+    bool SetAnsiMode(const bool ansiMode) override { return _record(L"DECANM", ansiMode); }
+    bool SetTopBottomScrollingMargins(const VTInt topMargin, const VTInt bottomMargin) override { return _record(L"DECSTBM", topMargin, bottomMargin); }
+    bool SetLeftRightScrollingMargins(const VTInt leftMargin, const VTInt rightMargin) override { return _record(L"DECSLRM", leftMargin, rightMargin); }
+    bool WarningBell() override { return _record(L"BEL"); }
+    bool CarriageReturn() override { return _record(L"CR"); }
+    bool LineFeed(const DispatchTypes::LineFeedType lineFeedType) override { return _record(L"LF", lineFeedType); }
+    bool ReverseLineFeed() override { return _record(L"RI"); }
+    bool BackIndex() override { return _record(L"DECBI"); }
+    bool ForwardIndex() override { return _record(L"DECFI"); }
+    bool SetWindowTitle(std::wstring_view title) override { return _record(L"OSCWindowTitle", title); }
+    bool HorizontalTabSet() override { return _record(L"HTS"); }
+    bool ForwardTab(const VTInt numTabs) override { return _record(L"CHT", numTabs); }
+    bool BackwardsTab(const VTInt numTabs) override { return _record(L"CBT", numTabs); }
+    bool TabClear(const DispatchTypes::TabClearType clearType) override { return _record(L"TBC", clearType); }
+    bool TabSet(const VTParameter setType) override { return _record(L"DECST8C", setType); }
+    bool SetColorTableEntry(const size_t tableIndex, const DWORD color) override { return _record(L"OSCColorTable", tableIndex, color); }
+    bool SetDefaultForeground(const DWORD color) override { return _record(L"OSCDefaultForeground", color); }
+    bool SetDefaultBackground(const DWORD color) override { return _record(L"OSCDefaultBackground", color); }
+    bool AssignColor(const DispatchTypes::ColorItem item, const VTInt fgIndex, const VTInt bgIndex) override { return _record(L"DECAC", item, fgIndex, bgIndex); }
+
+    bool EraseInDisplay(const DispatchTypes::EraseType eraseType) override { return _record(L"ED", eraseType); }
+    bool EraseInLine(const DispatchTypes::EraseType eraseType) override { return _record(L"EL", eraseType); }
+    bool EraseCharacters(const VTInt numChars) override { return _record(L"ECH", numChars); }
+    bool SelectiveEraseInDisplay(const DispatchTypes::EraseType eraseType) override { return _record(L"DECSED", eraseType); }
+    bool SelectiveEraseInLine(const DispatchTypes::EraseType eraseType) override { return _record(L"DECSEL", eraseType); }
+
+    bool FillRectangularArea(const VTParameter ch, const VTInt top, const VTInt left, const VTInt bottom, const VTInt right) override { return _record(L"DECFRA", ch, top, left, bottom, right); }
+    bool EraseRectangularArea(const VTInt top, const VTInt left, const VTInt bottom, const VTInt right) override { return _record(L"DECERA", top, left, bottom, right); }
+
+    bool SetGraphicsRendition(const VTParameters options) override { return _record(L"SGR", options); }
+    bool SetLineRendition(const LineRendition rendition) override { return _record(L"DECDHL", rendition); }
+    bool SetCharacterProtectionAttribute(const VTParameters options) override { return _record(L"DECSCA", options); }
+    bool PushGraphicsRendition(const VTParameters options) override { return _record(L"XTPUSHSGR", options); }
+    bool PopGraphicsRendition() override { return _record(L"XTPOPSGR"); }
+
+    bool SetMode(const DispatchTypes::ModeParams param) override { return _record(L"SM", param); }
+    bool ResetMode(const DispatchTypes::ModeParams param) override { return _record(L"RM", param); }
+    bool RequestMode(const DispatchTypes::ModeParams param) override { return _record(L"DECRQM", param); }
+
+    bool DeviceStatusReport(const DispatchTypes::StatusType statusType, const VTParameter id) override { return _record(L"DSR", statusType, id); }
+    bool DeviceAttributes() override { return _record(L"DA1"); }
+    bool SecondaryDeviceAttributes() override { return _record(L"DA2"); }
+    bool TertiaryDeviceAttributes() override { return _record(L"DA3"); }
+    bool Vt52DeviceAttributes() override { return _record(L"VT52Identify"); }
+
+    bool DesignateCodingSystem(const VTID codingSystem) override { return _record(L"DOCS", codingSystem); }
+    bool Designate94Charset(const VTInt gsetNumber, const VTID charset) override { return _record(L"SCS94", gsetNumber, charset); }
+    bool Designate96Charset(const VTInt gsetNumber, const VTID charset) override { return _record(L"SCS96", gsetNumber, charset); }
+    bool LockingShift(const VTInt gsetNumber) override { return _record(L"LS", gsetNumber); }
+    bool LockingShiftRight(const VTInt gsetNumber) override { return _record(L"LSR", gsetNumber); }
+    bool SingleShift(const VTInt gsetNumber) override { return _record(L"SS", gsetNumber); }
+    bool AcceptC1Controls(const bool enabled) override { return _record(L"DECAC1", enabled); }
+
+    bool SoftReset() override { return _record(L"DECSTR"); }
+    bool HardReset() override { return _record(L"RIS"); }
+    bool ScreenAlignmentPattern() override { return _record(L"DECALN"); }
+
+    bool SetCursorStyle(const DispatchTypes::CursorStyle cursorStyle) override { return _record(L"DECSCUSR", cursorStyle); }
+    bool SetCursorColor(const COLORREF color) override { return _record(L"OSCSetCursorColor", color); }
+    bool SetClipboard(wil::zwstring_view content) override { return _record(L"OSCSetClipboard", std::wstring_view{ content }); }
+
+    bool WindowManipulation(const DispatchTypes::WindowManipulationType function,
+                            const VTParameter parameter1,
+                            const VTParameter parameter2) override { return _record(L"DTTERM_WM", function, parameter1, parameter2); }
+
+    bool AddHyperlink(const std::wstring_view uri, const std::wstring_view params) override { return _record(L"OSCHyperlink", uri, params); }
+    bool EndHyperlink() override { return _record(L"OSCEndHyperlink"); }
+
+    bool DoConEmuAction(const std::wstring_view string) override { return _record(L"OSCConEmu", string); }
+    bool DoITerm2Action(const std::wstring_view string) override { return _record(L"OSCITerm2", string); }
+    bool DoFinalTermAction(const std::wstring_view string) override { return _record(L"OSCFinalTerm", string); }
+    bool DoVsCodeAction(const std::wstring_view string) override { return _record(L"OSCVsCode", string); }
+
+    StringHandler DownloadDRCS(const VTInt fontNumber,
+                               const VTParameter startChar,
+                               const DispatchTypes::DrcsEraseControl eraseControl,
+                               const DispatchTypes::DrcsCellMatrix cellMatrix,
+                               const DispatchTypes::DrcsFontSet fontSet,
+                               const DispatchTypes::DrcsFontUsage fontUsage,
+                               const VTParameter cellHeight,
+                               const DispatchTypes::CharsetSize charsetSize) override
+    {
+        _record(L"DECDLD", fontNumber, startChar, eraseControl, cellMatrix, fontSet, fontUsage, cellHeight, charsetSize);
+        return _dataHandler();
+    }
+    StringHandler AssignUserPreferenceCharset(const DispatchTypes::CharsetSize charsetSize) override
+    {
+        _record(L"DECAUPSS", charsetSize);
+        return _dataHandler();
+    }
+    StringHandler DefineMacro(const VTInt macroId,
+                              const DispatchTypes::MacroDeleteControl deleteControl,
+                              const DispatchTypes::MacroEncoding encoding) override
+    {
+        _record(L"DECDMAC", macroId, deleteControl, encoding);
+        return _dataHandler();
+    }
+    bool InvokeMacro(const VTInt macroId) override { return _record(L"DECINVM", macroId); }
+    StringHandler DefineSixelImage(const VTParameter aspectRatio,
+                                   const DispatchTypes::SixelBackground backgroundSelect,
+                                   const VTParameter gridSize) override
+    {
+        _record(L"SIXEL", aspectRatio, backgroundSelect, gridSize);
+        return _dataHandler();
+    }
+    StringHandler RestoreTerminalState(const DispatchTypes::ReportFormat format) override
+    {
+        _record(L"DECRSTS", format);
+        return _dataHandler();
+    }
+    StringHandler RequestSetting() override
+    {
+        _record(L"DECRQSS");
+        return _dataHandler();
+    }
+    StringHandler RestorePresentationState(const DispatchTypes::PresentationReportFormat format) override
+    {
+        _record(L"DECRSPS", format);
+        return _dataHandler();
+    }
+
+    bool PlaySounds(const VTParameters parameters) override { return _record(L"DECPS", parameters); }
+
+private:
+    template<typename... Args>
+    bool _record(const std::wstring_view name, const Args&... args)
+    {
+        _beginEvent(name);
+        (_appendArgument(args), ...);
+        _trace.push_back(L'\n');
+        return true;
+    }
+
+    template<typename T>
+    void _appendArgument(const T value)
+    {
+        // fmt rather than std::to_wstring, because the latter is built on
+        // the C library's swprintf, which doesn't work with -fshort-wchar.
+        if constexpr (std::is_enum_v<T>)
+        {
+            fmt::format_to(std::back_inserter(_trace), FMT_COMPILE(L" {}"), static_cast<std::underlying_type_t<T>>(value));
+        }
+        else
+        {
+            // The + promotes bools to ints, so that they're recorded as 0/1.
+            fmt::format_to(std::back_inserter(_trace), FMT_COMPILE(L" {}"), +value);
+        }
+    }
+
+    void _appendArgument(const VTParameter parameter);
+    void _appendArgument(const VTParameters parameters);
+    void _appendArgument(const VTID id);
+    void _appendArgument(const std::wstring_view string);
+
+    void _beginEvent(const std::wstring_view name);
+    void _appendText(const wchar_t kind, const std::wstring_view text);
+    StringHandler _dataHandler();
+
+    std::wstring _trace;
+    wchar_t _textKind = 0;
+};
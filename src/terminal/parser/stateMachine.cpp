@@ -5,7 +5,12 @@
 
 #include "stateMachine.hpp"
 
+#include <isa_availability.h>
+
 #include "ascii.hpp"
+#include "../../inc/unicode.hpp"
+
+extern "C" int __isa_available;
 
 using namespace Microsoft::Console::VirtualTerminal;
 
@@ -370,6 +375,429 @@ static constexpr bool _isApcIndicator(const wchar_t wch) noexcept
 
 #pragma warning(pop)
 
+// The character classes of the table-driven engine. All characters in a class
+// are handled identically by every state, so that the transition table only
+// needs a column per class rather than one per character.
+enum class CharClass : uint8_t
+{
+    C0, // C0 controls other than the ones below
+    Bel,
+    CanSub,
+    Esc,
+    Intermediate, // 0x20 - 0x2F
+    Digit, // 0x30 - 0x39
+    Colon,
+    Semicolon,
+    PrivateMarker, // 0x3C - 0x3F
+    Ss3Indicator,
+    DcsIndicator,
+    SosIndicator,
+    Vt52CursorAddress,
+    CsiIndicator,
+    StringTerminatorIndicator,
+    OscIndicator,
+    PmIndicator,
+    ApcIndicator,
+    Final, // all other characters from 0x40 - 0x7E
+    Delete,
+    Other, // everything above DEL (C1 controls never reach the table)
+    Count
+};
+
+// A character from each class, which the transition table is computed from.
+static constexpr std::array<wchar_t, static_cast<size_t>(CharClass::Count)> s_charClassRepresentatives{
+    L'\x00', L'\x07', L'\x18', L'\x1b', L' ', L'0', L':', L';', L'<', L'O', L'P',
+    L'X', L'Y', L'[', L'\\', L']', L'^', L'_', L'@', L'\x7f', L'\xa0'
+};
+
+static constexpr CharClass _classifyCharacter(const wchar_t wch) noexcept
+{
+    if (wch > AsciiChars::DEL)
+    {
+        return CharClass::Other;
+    }
+    if (wch == AsciiChars::BEL)
+    {
+        return CharClass::Bel;
+    }
+    if (_isC0Code(wch))
+    {
+        return CharClass::C0;
+    }
+    if (wch < AsciiChars::SPC)
+    {
+        return _isEscape(wch) ? CharClass::Esc : CharClass::CanSub;
+    }
+    if (_isIntermediate(wch))
+    {
+        return CharClass::Intermediate;
+    }
+    if (_isNumericParamValue(wch))
+    {
+        return CharClass::Digit;
+    }
+    if (_isCsiPrivateMarker(wch))
+    {
+        return CharClass::PrivateMarker;
+    }
+
+    switch (wch)
+    {
+    case L':':
+        return CharClass::Colon;
+    case L';':
+        return CharClass::Semicolon;
+    case L'O':
+        return CharClass::Ss3Indicator;
+    case L'P':
+        return CharClass::DcsIndicator;
+    case L'X':
+        return CharClass::SosIndicator;
+    case L'Y':
+        return CharClass::Vt52CursorAddress;
+    case L'[':
+        return CharClass::CsiIndicator;
+    case L'\\':
+        return CharClass::StringTerminatorIndicator;
+    case L']':
+        return CharClass::OscIndicator;
+    case L'^':
+        return CharClass::PmIndicator;
+    case L'_':
+        return CharClass::ApcIndicator;
+    case AsciiChars::DEL:
+        return CharClass::Delete;
+    default:
+        return CharClass::Final;
+    }
+}
+
+static constexpr auto s_charClasses = [] {
+    std::array<CharClass, 0x81> classes{};
+    for (size_t i = 0; i < classes.size(); ++i)
+    {
+        classes[i] = _classifyCharacter(gsl::narrow_cast<wchar_t>(i));
+    }
+    return classes;
+}();
+
+// Routine Description:
+// - Computes the transition of the table-driven engine for the given state and
+//   character. This mirrors the corresponding _Event* function exactly.
+// Arguments:
+// - state - The current state.
+// - wch - Character that triggered the event.
+// - isEngineForInput - Whether the state machine belongs to an InputStateMachineEngine.
+// - ansi - Whether the ANSI mode is set (as opposed to VT52).
+// Return Value:
+// - The action to perform and the state to enter, if any.
+constexpr StateMachine::Transition StateMachine::_ComputeTransition(const VTStates state, const wchar_t wch, const bool isEngineForInput, const bool ansi) noexcept
+{
+    using Action = TransitionAction;
+    constexpr auto stay = [](const Action action) {
+        return Transition{ action };
+    };
+    constexpr auto enter = [](const Action action, const VTStates next) {
+        return Transition{ action, true, next };
+    };
+
+    switch (state)
+    {
+    case VTStates::Ground:
+        return stay(_isC0Code(wch) || _isDelete(wch) ? Action::Execute : Action::Print);
+    case VTStates::Escape:
+        if (_isC0Code(wch))
+        {
+            return isEngineForInput ? enter(Action::ExecuteFromEscape, VTStates::Ground) : stay(Action::Execute);
+        }
+        if (_isDelete(wch))
+        {
+            return stay(Action::Ignore);
+        }
+        if (_isIntermediate(wch))
+        {
+            return isEngineForInput ? enter(Action::EscDispatch, VTStates::Ground) : enter(Action::Collect, VTStates::EscapeIntermediate);
+        }
+        if (ansi)
+        {
+            if (_isCsiIndicator(wch))
+            {
+                return enter(Action::None, VTStates::CsiEntry);
+            }
+            if (_isOscIndicator(wch))
+            {
+                return enter(Action::None, VTStates::OscParam);
+            }
+            if (_isSs3Indicator(wch) && isEngineForInput)
+            {
+                return enter(Action::None, VTStates::Ss3Entry);
+            }
+            if (_isDcsIndicator(wch))
+            {
+                return enter(Action::None, VTStates::DcsEntry);
+            }
+            if (_isSosIndicator(wch) || _isPmIndicator(wch) || _isApcIndicator(wch))
+            {
+                return enter(Action::None, VTStates::SosPmApcString);
+            }
+            return enter(Action::EscDispatch, VTStates::Ground);
+        }
+        return _isVt52CursorAddress(wch) ? enter(Action::None, VTStates::Vt52Param) : enter(Action::Vt52EscDispatch, VTStates::Ground);
+    case VTStates::EscapeIntermediate:
+        if (_isC0Code(wch))
+        {
+            return stay(Action::Execute);
+        }
+        if (_isIntermediate(wch))
+        {
+            return stay(Action::Collect);
+        }
+        if (_isDelete(wch))
+        {
+            return stay(Action::Ignore);
+        }
+        if (ansi)
+        {
+            return enter(Action::EscDispatch, VTStates::Ground);
+        }
+        return _isVt52CursorAddress(wch) ? enter(Action::None, VTStates::Vt52Param) : enter(Action::Vt52EscDispatch, VTStates::Ground);
+    case VTStates::CsiEntry:
+        if (_isC0Code(wch))
+        {
+            return stay(Action::Execute);
+        }
+        if (_isDelete(wch))
+        {
+            return stay(Action::Ignore);
+        }
+        if (_isIntermediate(wch))
+        {
+            return enter(Action::Collect, VTStates::CsiIntermediate);
+        }
+        if (_isNumericParamValue(wch) || _isParameterDelimiter(wch))
+        {
+            return enter(Action::Param, VTStates::CsiParam);
+        }
+        if (_isSubParameterDelimiter(wch))
+        {
+            return enter(Action::SubParam, VTStates::CsiSubParam);
+        }
+        if (_isCsiPrivateMarker(wch))
+        {
+            return enter(Action::Collect, VTStates::CsiParam);
+        }
+        return enter(Action::CsiDispatch, VTStates::Ground);
+    case VTStates::CsiIntermediate:
+        if (_isC0Code(wch))
+        {
+            return stay(Action::Execute);
+        }
+        if (_isIntermediate(wch))
+        {
+            return stay(Action::Collect);
+        }
+        if (_isDelete(wch))
+        {
+            return stay(Action::Ignore);
+        }
+        if (_isIntermediateInvalid(wch))
+        {
+            return enter(Action::None, VTStates::CsiIgnore);
+        }
+        return enter(Action::CsiDispatch, VTStates::Ground);
+    case VTStates::CsiIgnore:
+        if (_isC0Code(wch))
+        {
+            return stay(Action::Execute);
+        }
+        if (_isDelete(wch) || _isIntermediate(wch) || _isIntermediateInvalid(wch))
+        {
+            return stay(Action::Ignore);
+        }
+        return enter(Action::None, VTStates::Ground);
+    case VTStates::CsiParam:
+        if (_isC0Code(wch))
+        {
+            return stay(Action::Execute);
+        }
+        if (_isDelete(wch))
+        {
+            return stay(Action::Ignore);
+        }
+        if (_isNumericParamValue(wch) || _isParameterDelimiter(wch))
+        {
+            return stay(Action::Param);
+        }
+        if (_isSubParameterDelimiter(wch))
+        {
+            return enter(Action::SubParam, VTStates::CsiSubParam);
+        }
+        if (_isIntermediate(wch))
+        {
+            return enter(Action::Collect, VTStates::CsiIntermediate);
+        }
+        if (_isParameterInvalid(wch))
+        {
+            return enter(Action::None, VTStates::CsiIgnore);
+        }
+        return enter(Action::CsiDispatch, VTStates::Ground);
+    case VTStates::CsiSubParam:
+        if (_isC0Code(wch))
+        {
+            return stay(Action::Execute);
+        }
+        if (_isDelete(wch))
+        {
+            return stay(Action::Ignore);
+        }
+        if (_isNumericParamValue(wch) || _isSubParameterDelimiter(wch))
+        {
+            return stay(Action::SubParam);
+        }
+        if (_isParameterDelimiter(wch))
+        {
+            return enter(Action::Param, VTStates::CsiParam);
+        }
+        if (_isIntermediate(wch))
+        {
+            return enter(Action::Collect, VTStates::CsiIntermediate);
+        }
+        if (_isParameterInvalid(wch))
+        {
+            return enter(Action::None, VTStates::CsiIgnore);
+        }
+        return enter(Action::CsiDispatch, VTStates::Ground);
+    case VTStates::OscParam:
+        if (_isOscTerminator(wch))
+        {
+            return enter(Action::OscDispatch, VTStates::Ground);
+        }
+        if (_isEscape(wch))
+        {
+            return enter(Action::None, VTStates::OscTermination);
+        }
+        if (_isNumericParamValue(wch))
+        {
+            return stay(Action::OscParam);
+        }
+        if (_isOscDelimiter(wch))
+        {
+            return enter(Action::None, VTStates::OscString);
+        }
+        return stay(Action::Ignore);
+    case VTStates::OscString:
+        if (_isOscTerminator(wch))
+        {
+            return enter(Action::OscDispatch, VTStates::Ground);
+        }
+        if (_isEscape(wch))
+        {
+            return enter(Action::None, VTStates::OscTermination);
+        }
+        return stay(_isOscInvalid(wch) ? Action::Ignore : Action::OscPut);
+    case VTStates::OscTermination:
+        if (_isStringTerminatorIndicator(wch))
+        {
+            return enter(Action::OscDispatch, VTStates::Ground);
+        }
+        return enter(Action::EscapeEvent, VTStates::Escape);
+    case VTStates::Ss3Entry:
+        if (_isC0Code(wch))
+        {
+            return stay(Action::Execute);
+        }
+        if (_isDelete(wch))
+        {
+            return stay(Action::Ignore);
+        }
+        if (_isSubParameterDelimiter(wch))
+        {
+            return enter(Action::None, VTStates::CsiIgnore);
+        }
+        if (_isNumericParamValue(wch) || _isParameterDelimiter(wch))
+        {
+            return enter(Action::Param, VTStates::Ss3Param);
+        }
+        return enter(Action::Ss3Dispatch, VTStates::Ground);
+    case VTStates::Ss3Param:
+        if (_isC0Code(wch))
+        {
+            return stay(Action::Execute);
+        }
+        if (_isDelete(wch))
+        {
+            return stay(Action::Ignore);
+        }
+        if (_isNumericParamValue(wch) || _isParameterDelimiter(wch))
+        {
+            return stay(Action::Param);
+        }
+        if (_isParameterInvalid(wch) || _isSubParameterDelimiter(wch))
+        {
+            return enter(Action::None, VTStates::CsiIgnore);
+        }
+        return enter(Action::Ss3Dispatch, VTStates::Ground);
+    case VTStates::Vt52Param:
+        if (_isC0Code(wch))
+        {
+            return stay(Action::Execute);
+        }
+        return stay(_isDelete(wch) ? Action::Ignore : Action::Vt52Param);
+    case VTStates::DcsEntry:
+        if (_isC0Code(wch) || _isDelete(wch))
+        {
+            return stay(Action::Ignore);
+        }
+        if (_isSubParameterDelimiter(wch))
+        {
+            return enter(Action::None, VTStates::DcsIgnore);
+        }
+        if (_isNumericParamValue(wch) || _isParameterDelimiter(wch))
+        {
+            return enter(Action::Param, VTStates::DcsParam);
+        }
+        if (_isIntermediate(wch))
+        {
+            return enter(Action::Collect, VTStates::DcsIntermediate);
+        }
+        return stay(Action::DcsDispatch);
+    case VTStates::DcsIntermediate:
+        if (_isC0Code(wch) || _isDelete(wch))
+        {
+            return stay(Action::Ignore);
+        }
+        if (_isIntermediate(wch))
+        {
+            return stay(Action::Collect);
+        }
+        if (_isIntermediateInvalid(wch))
+        {
+            return enter(Action::None, VTStates::DcsIgnore);
+        }
+        return stay(Action::DcsDispatch);
+    case VTStates::DcsParam:
+        if (_isNumericParamValue(wch) || _isParameterDelimiter(wch))
+        {
+            return stay(Action::Param);
+        }
+        if (_isIntermediate(wch))
+        {
+            return enter(Action::Collect, VTStates::DcsIntermediate);
+        }
+        if (_isParameterInvalid(wch) || _isSubParameterDelimiter(wch))
+        {
+            return enter(Action::None, VTStates::DcsIgnore);
+        }
+        return stay(Action::DcsDispatch);
+    case VTStates::DcsPassThrough:
+        return stay(_isC0Code(wch) || _isDcsPassThroughValid(wch) ? Action::DcsPassThrough : Action::Ignore);
+    case VTStates::DcsIgnore:
+    case VTStates::SosPmApcString:
+    default:
+        return stay(Action::Ignore);
+    }
+}
+
 // Routine Description:
 // - Triggers the Execute action to indicate that the listener should immediately respond to a C0 control character.
 // Arguments:
@@ -418,12 +846,13 @@ void StateMachine::_ActionPrint(const wchar_t wch)
 // - Triggers the PrintString action to indicate that the listener should render the characters given.
 // Arguments:
 // - string - Characters to dispatch.
+// - ascii - Whether the string is known to consist of printable ASCII characters only.
 // Return Value:
 // - <none>
-void StateMachine::_ActionPrintString(const std::wstring_view string)
+void StateMachine::_ActionPrintString(const std::wstring_view string, const bool ascii)
 {
     _SafeExecute([=]() {
-        return _engine->ActionPrintString(string);
+        return ascii ? _engine->ActionPrintAsciiString(string) : _engine->ActionPrintString(string);
     });
     _trace.DispatchPrintRunTrace(string);
 }
@@ -653,7 +1082,7 @@ void StateMachine::_ActionInterrupt()
     if (_state == VTStates::DcsPassThrough)
     {
         // The ESC signals the end of the data string.
-        _dcsStringHandler(AsciiChars::ESC);
+        _dcsStringHandler(L"\x1b");
         _dcsStringHandler = nullptr;
     }
 }
@@ -1802,7 +2231,7 @@ void StateMachine::_EventDcsPassThrough(const wchar_t wch)
     _trace.TraceOnEvent(L"DcsPassThrough");
     if (_isC0Code(wch) || _isDcsPassThroughValid(wch))
     {
-        if (!_dcsStringHandler(wch))
+        if (!_dcsStringHandler({ &wch, 1 }))
         {
             _EnterDcsIgnore();
         }
@@ -1813,6 +2242,36 @@ void StateMachine::_EventDcsPassThrough(const wchar_t wch)
     }
 }
 
+// Routine Description:
+// - The bulk equivalent of _EventDcsPassThrough. Hands the longest prefix of
+//   the given string that consists of valid data string characters to the
+//   string handler at once. Everything else (the terminators in particular)
+//   is left for ProcessCharacter.
+// Arguments:
+// - string - Characters to operate upon
+// - endOfInput - True if the string extends to the end of the current input
+// Return Value:
+// - The number of characters that were passed to the string handler.
+size_t StateMachine::_EventDcsPassThroughString(const std::wstring_view string, const bool endOfInput)
+{
+    const auto end = std::find_if_not(string.begin(), string.end(), [](const auto wch) {
+        return _isC0Code(wch) || _isDcsPassThroughValid(wch);
+    });
+    const auto count = gsl::narrow_cast<size_t>(end - string.begin());
+
+    if (count)
+    {
+        _trace.TraceOnEvent(L"DcsPassThrough");
+        _processingLastCharacter = endOfInput && count == string.size();
+        if (!_dcsStringHandler(string.substr(0, count)))
+        {
+            _EnterDcsIgnore();
+        }
+    }
+
+    return count;
+}
+
 // Routine Description:
 // - Handle SOS/PM/APC string.
 //   In this state the entire string is ignored.
@@ -1827,6 +2286,184 @@ void StateMachine::_EventSosPmApcString(const wchar_t /*wch*/) noexcept
     _ActionIgnore();
 }
 
+// Routine Description:
+// - The table-driven equivalent of the _Event* functions. The character is
+//   mapped to its class, which together with the current state indexes into
+//   a transition table that's generated at compile time from _ComputeTransition.
+//   This replaces the chains of character tests with two table lookups.
+// Arguments:
+// - wch - Character that triggered the event
+// Return Value:
+// - <none>
+void StateMachine::_EventFromTable(const wchar_t wch)
+{
+    static constexpr auto stateCount = static_cast<size_t>(VTStates::SosPmApcString) + 1;
+    static constexpr auto classCount = static_cast<size_t>(CharClass::Count);
+    using TransitionTable = std::array<std::array<Transition, classCount>, stateCount>;
+
+    // There's a table for each combination of the engine type and the ANSI mode,
+    // indexed by (isEngineForInput << 1 | ansi).
+    static constexpr auto tables = [] {
+        std::array<TransitionTable, 4> tables{};
+        for (size_t variant = 0; variant < tables.size(); ++variant)
+        {
+            for (size_t state = 0; state < stateCount; ++state)
+            {
+                for (size_t cls = 0; cls < classCount; ++cls)
+                {
+                    tables[variant][state][cls] = _ComputeTransition(static_cast<VTStates>(state), s_charClassRepresentatives[cls], (variant & 2) != 0, (variant & 1) != 0);
+                }
+            }
+        }
+        return tables;
+    }();
+    static constexpr std::array<const wchar_t*, stateCount> stateNames{
+        L"Ground", L"Escape", L"EscapeIntermediate", L"CsiEntry", L"CsiIntermediate",
+        L"CsiIgnore", L"CsiParam", L"CsiSubParam", L"OscParam", L"OscString",
+        L"OscTermination", L"Ss3Entry", L"Ss3Param", L"Vt52Param", L"DcsEntry",
+        L"DcsIgnore", L"DcsIntermediate", L"DcsParam", L"DcsPassThrough", L"SosPmApcString"
+    };
+
+    const auto state = static_cast<size_t>(_state);
+    const auto variant = (_isEngineForInput ? 2 : 0) | (_parserMode.test(Mode::Ansi) ? 1 : 0);
+    const auto cls = static_cast<size_t>(til::at(s_charClasses, std::min<size_t>(wch, s_charClasses.size() - 1)));
+    const auto transition = til::at(til::at(til::at(tables, variant), state), cls);
+
+    _trace.TraceOnEvent(til::at(stateNames, state));
+
+    switch (transition.action)
+    {
+    case TransitionAction::None:
+        break;
+    case TransitionAction::Execute:
+        _ActionExecute(wch);
+        break;
+    case TransitionAction::ExecuteFromEscape:
+        _ActionExecuteFromEscape(wch);
+        break;
+    case TransitionAction::Print:
+        _ActionPrint(wch);
+        break;
+    case TransitionAction::Ignore:
+        _ActionIgnore();
+        break;
+    case TransitionAction::Collect:
+        _ActionCollect(wch);
+        break;
+    case TransitionAction::Param:
+        _ActionParam(wch);
+        break;
+    case TransitionAction::SubParam:
+        _ActionSubParam(wch);
+        break;
+    case TransitionAction::EscDispatch:
+        _ActionEscDispatch(wch);
+        break;
+    case TransitionAction::Vt52EscDispatch:
+        _ActionVt52EscDispatch(wch);
+        break;
+    case TransitionAction::CsiDispatch:
+        _ActionCsiDispatch(wch);
+        _EnterGround();
+        _ExecuteCsiCompleteCallback();
+        return;
+    case TransitionAction::Ss3Dispatch:
+        _ActionSs3Dispatch(wch);
+        break;
+    case TransitionAction::DcsDispatch:
+        _ActionDcsDispatch(wch);
+        break;
+    case TransitionAction::OscParam:
+        _ActionOscParam(wch);
+        break;
+    case TransitionAction::OscPut:
+        _ActionOscPut(wch);
+        break;
+    case TransitionAction::OscDispatch:
+        _ActionOscDispatch();
+        break;
+    case TransitionAction::Vt52Param:
+        _parameters.push_back(wch);
+        if (_parameters.size() == 2)
+        {
+            // The command character is processed before the parameter values,
+            // but it will always be 'Y', the Direct Cursor Address command.
+            _ActionVt52EscDispatch(L'Y');
+            _EnterGround();
+        }
+        break;
+    case TransitionAction::DcsPassThrough:
+        if (!_dcsStringHandler({ &wch, 1 }))
+        {
+            _EnterDcsIgnore();
+        }
+        break;
+    case TransitionAction::EscapeEvent:
+        _EnterEscape();
+        return _EventFromTable(wch);
+    }
+
+    if (transition.enter)
+    {
+        _EnterState(transition.state);
+    }
+}
+
+// Routine Description:
+// - Calls the _Enter* function of the given state.
+// Arguments:
+// - state - The state to enter.
+// Return Value:
+// - <none>
+void StateMachine::_EnterState(const VTStates state)
+{
+    switch (state)
+    {
+    case VTStates::Ground:
+        return _EnterGround();
+    case VTStates::Escape:
+        return _EnterEscape();
+    case VTStates::EscapeIntermediate:
+        return _EnterEscapeIntermediate();
+    case VTStates::CsiEntry:
+        return _EnterCsiEntry();
+    case VTStates::CsiIntermediate:
+        return _EnterCsiIntermediate();
+    case VTStates::CsiIgnore:
+        return _EnterCsiIgnore();
+    case VTStates::CsiParam:
+        return _EnterCsiParam();
+    case VTStates::CsiSubParam:
+        return _EnterCsiSubParam();
+    case VTStates::OscParam:
+        return _EnterOscParam();
+    case VTStates::OscString:
+        return _EnterOscString();
+    case VTStates::OscTermination:
+        return _EnterOscTermination();
+    case VTStates::Ss3Entry:
+        return _EnterSs3Entry();
+    case VTStates::Ss3Param:
+        return _EnterSs3Param();
+    case VTStates::Vt52Param:
+        return _EnterVt52Param();
+    case VTStates::DcsEntry:
+        return _EnterDcsEntry();
+    case VTStates::DcsIgnore:
+        return _EnterDcsIgnore();
+    case VTStates::DcsIntermediate:
+        return _EnterDcsIntermediate();
+    case VTStates::DcsParam:
+        return _EnterDcsParam();
+    case VTStates::DcsPassThrough:
+        return _EnterDcsPassThrough();
+    case VTStates::SosPmApcString:
+        return _EnterSosPmApcString();
+    default:
+        return;
+    }
+}
+
 // Routine Description:
 // - Entry to the state machine. Takes characters one by one and processes them according to the state machine rules.
 // Arguments:
@@ -1870,6 +2507,10 @@ void StateMachine::ProcessCharacter(const wchar_t wch)
         _ActionInterrupt();
         _EnterEscape();
     }
+    else if (_parserMode.test(Mode::TableDriven)) [[unlikely]]
+    {
+        _EventFromTable(wch);
+    }
     else
     {
         // Then pass to the current state as an event
@@ -1980,29 +2621,80 @@ constexpr bool isActionableFromGround(const wchar_t wch) noexcept
     return (wch <= 0x1f) | (static_cast<wchar_t>(wch - 0x7f) <= 0x20);
 }
 
-[[msvc::forceinline]] static size_t findActionableFromGroundPlain(const wchar_t* beg, const wchar_t* end, const wchar_t* it) noexcept
+[[msvc::forceinline]] static size_t findActionableFromGroundPlain(const wchar_t* beg, const wchar_t* end, const wchar_t* it, bool& ascii) noexcept
 {
+    // All printable characters are >= 0x20 and so OR'ing them together is < 0x80 if and only if they're all ASCII.
+    wchar_t bits = 0;
 #pragma loop(no_vector)
     for (; it < end && !isActionableFromGround(*it); ++it)
     {
+        bits |= *it;
     }
+    ascii = ascii && bits < 0x80;
     return it - beg;
 }
 
-static size_t findActionableFromGround(const wchar_t* data, size_t count) noexcept
+// Returns the length of the run of printable characters at the start of the given string.
+// `ascii` is set to true if that run consists only of ASCII characters, in which case
+// the dispatcher can skip the glyph width lookup. See ActionPrintAsciiString().
+static size_t findActionableFromGround(const wchar_t* data, size_t count, bool& ascii) noexcept
 {
     // The following vectorized code replicates isActionableFromGround which is equivalent to:
     //   (wch <= 0x1f) || (wch >= 0x7f && wch <= 0x9f)
     // or rather its more machine friendly equivalent:
     //   (wch <= 0x1f) | ((wch - 0x7f) <= 0x20)
+    // At the same time it accumulates all printable characters with OR to check whether they're all < 0x80.
 #if defined(TIL_SSE_INTRINSICS)
 
     auto it = data;
+    ascii = true;
+
+    if (__isa_available >= __ISA_AVAILABLE_AVX2)
+    {
+        const auto z = _mm256_setzero_si256();
+        auto bits = z;
+
+        for (const auto end = data + (count & ~size_t{ 15 }); it < end; it += 16)
+        {
+            const auto wch = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(it));
+
+            // See the SSE2 variant below for an explanation.
+            auto a = _mm256_subs_epu16(wch, _mm256_set1_epi16(0x1f));
+            auto b = _mm256_subs_epu16(_mm256_add_epi16(wch, _mm256_set1_epi16(static_cast<short>(0xff81))), _mm256_set1_epi16(0x20));
+            a = _mm256_cmpeq_epi16(a, z);
+            b = _mm256_cmpeq_epi16(b, z);
+
+            const auto c = _mm256_or_si256(a, b);
+            const auto mask = static_cast<unsigned long>(_mm256_movemask_epi8(c));
+
+            if (mask)
+            {
+                unsigned long offset;
+                _BitScanForward(&offset, mask);
+
+                // Only the characters in front of the actionable one are part of the run.
+                const auto asciiMask = static_cast<unsigned long>(_mm256_movemask_epi8(_mm256_cmpeq_epi16(_mm256_subs_epu16(wch, _mm256_set1_epi16(0x7f)), z)));
+                const auto prefixMask = (1ul << offset) - 1;
+                const auto over = _mm256_subs_epu16(bits, _mm256_set1_epi16(0x7f));
+                ascii = (asciiMask & prefixMask) == prefixMask && _mm256_testz_si256(over, over);
+
+                it += offset / 2;
+                return it - data;
+            }
+
+            bits = _mm256_or_si256(bits, wch);
+        }
+
+        const auto over = _mm256_subs_epu16(bits, _mm256_set1_epi16(0x7f));
+        ascii = _mm256_testz_si256(over, over);
+    }
+
+    const auto z = _mm_setzero_si128();
+    auto bits = z;
 
     for (const auto end = data + (count & ~size_t{ 7 }); it < end; it += 8)
     {
         const auto wch = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
-        const auto z = _mm_setzero_si128();
 
         // Dealing with unsigned numbers in SSE2 is annoying because it has poor support for that.
         // We'll use subtractions with saturation ("SubS") to work around that. A check like
@@ -2024,16 +2716,28 @@ static size_t findActionableFromGround(const wchar_t* data, size_t count) noexce
         {
             unsigned long offset;
             _BitScanForward(&offset, mask);
+
+            // Only the characters in front of the actionable one are part of the run. Just like above,
+            // "max(0, wch - 0x7f) == 0" is true for all ASCII characters (and for 0x7f, which is actionable).
+            const auto asciiMask = _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_subs_epu16(wch, _mm_set1_epi16(0x7f)), z));
+            const auto prefixMask = (1 << offset) - 1;
+            const auto bitsMask = _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_subs_epu16(bits, _mm_set1_epi16(0x7f)), z));
+            ascii = ascii && (asciiMask & prefixMask) == prefixMask && bitsMask == 0xffff;
+
             it += offset / 2;
             return it - data;
         }
+
+        bits = _mm_or_si128(bits, wch);
     }
 
-    return findActionableFromGroundPlain(data, data + count, it);
+    ascii = ascii && _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_subs_epu16(bits, _mm_set1_epi16(0x7f)), z)) == 0xffff;
+    return findActionableFromGroundPlain(data, data + count, it, ascii);
 
 #elif defined(TIL_ARM_NEON_INTRINSICS)
 
     auto it = data;
+    auto bits = vdupq_n_u16(0);
     uint64_t mask;
 
     for (const auto end = data + (count & ~size_t{ 7 }); it < end;)
@@ -2056,21 +2760,110 @@ static size_t findActionableFromGround(const wchar_t* data, size_t count) noexce
             goto exitWithMask;
         }
         it += 4;
+
+        bits = vorrq_u16(bits, wch);
     }
 
-    return findActionableFromGroundPlain(data, data + count, it);
+    ascii = vmaxvq_u16(bits) < 0x80;
+    return findActionableFromGroundPlain(data, data + count, it, ascii);
 
 exitWithMask:
     unsigned long offset;
     _BitScanForward64(&offset, mask);
     it += offset / 16;
+
+    // The block with the actionable character wasn't accumulated into `bits` yet.
+    ascii = vmaxvq_u16(bits) < 0x80;
+    for (auto p = it - (it - data) % 8; p < it; ++p)
+    {
+        ascii = ascii && *p < 0x80;
+    }
     return it - data;
 
 #else
 
-    return findActionableFromGroundPlain(data, data + count, p);
+    ascii = true;
+    return findActionableFromGroundPlain(data, data + count, data, ascii);
+
+#endif
+}
+
+// Returns true for C0 characters, DEL and the UTF-8 encoding of C1 characters (0xC2 0x80-0x9F).
+// A 0xC2 at the end of the input is treated as actionable, because we can't know what follows it yet.
+constexpr bool isActionableFromGroundUtf8(const char* it, const char* end) noexcept
+{
+    const auto ch = static_cast<uint8_t>(*it);
+    if (ch <= 0x1f || ch == 0x7f)
+    {
+        return true;
+    }
+    return ch == 0xc2 && (it + 1 == end || static_cast<uint8_t>(it[1]) <= 0x9f);
+}
+
+// The UTF-8 counterpart to findActionableFromGround(). Returns a pointer past the end of the
+// printable run starting at `it` and sets `ascii` to true if the run consists only of ASCII.
+static const char* findActionableFromGroundUtf8(const char* it, const char* end, bool& ascii) noexcept
+{
+    // All printable bytes are >= 0x20 and so OR'ing them together is < 0x80 if and only if they're all ASCII.
+    uint8_t bits = 0;
+
+#if defined(TIL_SSE_INTRINSICS)
+
+    auto bitsVec = _mm_setzero_si128();
+
+    while (end - it >= 16)
+    {
+        const auto ch = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+        // SSE2 lacks unsigned byte comparisons, but "min(ch, 0x1f) == ch" is the same as "ch <= 0x1f".
+        const auto a = _mm_cmpeq_epi8(_mm_min_epu8(ch, _mm_set1_epi8(0x1f)), ch);
+        const auto b = _mm_cmpeq_epi8(ch, _mm_set1_epi8(0x7f));
+        const auto c = _mm_cmpeq_epi8(ch, _mm_set1_epi8(static_cast<char>(0xc2)));
+        const auto mask = _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(a, b), c));
+
+        if (!mask)
+        {
+            bitsVec = _mm_or_si128(bitsVec, ch);
+            it += 16;
+            continue;
+        }
+
+        unsigned long offset;
+        _BitScanForward(&offset, mask);
+
+        // The movemask of the bytes themselves is their high bit, which is set for all non-ASCII bytes.
+        const auto prefixMask = (1 << offset) - 1;
+        if (_mm_movemask_epi8(ch) & prefixMask)
+        {
+            bits |= 0x80;
+        }
+
+        it += offset;
+        if (isActionableFromGroundUtf8(it, end))
+        {
+            ascii = bits < 0x80 && _mm_movemask_epi8(bitsVec) == 0;
+            return it;
+        }
+
+        // A 0xC2 lead byte of a printable character (U+00A0-U+00BF).
+        bits |= 0x80;
+        ++it;
+    }
+
+    if (_mm_movemask_epi8(bitsVec))
+    {
+        bits |= 0x80;
+    }
 
 #endif
+
+#pragma loop(no_vector)
+    for (; it < end && !isActionableFromGroundUtf8(it, end); ++it)
+    {
+        bits |= static_cast<uint8_t>(*it);
+    }
+
+    ascii = bits < 0x80;
+    return it;
 }
 
 #pragma warning(pop)
@@ -2102,13 +2895,14 @@ void StateMachine::ProcessString(const std::wstring_view string)
     {
         {
             _runOffset = i;
+            auto ascii = false;
             // Pointer arithmetic is perfectly fine for our hot path.
 #pragma warning(suppress : 26481) // Don't use pointer arithmetic. Use span instead (bounds.1).)
-            _runSize = findActionableFromGround(string.data() + i, string.size() - i);
+            _runSize = findActionableFromGround(string.data() + i, string.size() - i, ascii);
 
             if (_runSize)
             {
-                _ActionPrintString(_CurrentRun());
+                _ActionPrintString(_CurrentRun(), ascii);
 
                 i += _runSize;
                 _runOffset = i;
@@ -2124,6 +2918,18 @@ void StateMachine::ProcessString(const std::wstring_view string)
 
         do
         {
+            // Data strings can be long (soft fonts, macros), so we hand them over in bulk.
+            if (_state == VTStates::DcsPassThrough)
+            {
+                const auto count = _EventDcsPassThroughString(string.substr(i), true);
+                if (count)
+                {
+                    _runSize += count;
+                    i += count;
+                    continue;
+                }
+            }
+
             _runSize++;
             _processingLastCharacter = i + 1 >= string.size();
             // If we're processing characters individually, send it to the state machine.
@@ -2132,6 +2938,182 @@ void StateMachine::ProcessString(const std::wstring_view string)
         } while (i < string.size() && _state != VTStates::Ground);
     }
 
+    _ProcessIncompleteSequence();
+}
+
+// Routine Description:
+// - The UTF-8 counterpart to ProcessString. Escape sequences are recognized on
+//     the bytes directly and only printable runs are transcoded to UTF-16 in bulk.
+//     Sequences are transcoded one code point at a time as they're being parsed.
+//     Code points split across calls are carried over to the next call.
+// Arguments:
+// - string - UTF-8 bytes to operate upon
+// Return Value:
+// - <none>
+void StateMachine::ProcessUtf8(const std::string_view string)
+{
+#pragma warning(suppress : 26481) // Don't use pointer arithmetic. Use span instead (bounds.1).
+    const auto end = string.data() + string.size();
+    auto it = string.data();
+
+    _utf8Run.clear();
+    _currentString = _utf8Run;
+    _runOffset = 0;
+    _runSize = 0;
+
+    while (it < end)
+    {
+        // A partial 0xC2 from the previous call may turn out to be a C1 control, which the scanner
+        // wouldn't notice. Any other partial code point is completed by til::u8u16 below.
+        if (_state == VTStates::Ground && !(_utf8State.have == 1 && static_cast<uint8_t>(_utf8State.partials[0]) == 0xc2))
+        {
+            auto ascii = false;
+            const auto runEnd = findActionableFromGroundUtf8(it, end, ascii);
+
+            if (runEnd != it)
+            {
+                const std::string_view run{ it, gsl::narrow_cast<size_t>(runEnd - it) };
+
+                // A pending partial code point turns the start of the run into U+FFFD or a non-ASCII character.
+                ascii = ascii && !_utf8State.have;
+
+                if (ascii)
+                {
+                    _utf8Buffer.assign(run.begin(), run.end());
+                }
+                else
+                {
+                    THROW_IF_FAILED(til::u8u16(run, _utf8Buffer, _utf8State));
+
+                    // A code point cut short by a control character is invalid and we
+                    // can't carry it over to the next call like one at the end of the input.
+                    if (_utf8State.have && runEnd != end)
+                    {
+                        _utf8Buffer.push_back(UNICODE_REPLACEMENT);
+                        _utf8State.reset();
+                    }
+                }
+
+                if (!_utf8Buffer.empty())
+                {
+                    _ActionPrintString(_utf8Buffer, ascii);
+                }
+
+                it = runEnd;
+                continue;
+            }
+        }
+
+        // Data strings consist of ASCII only and so they can be widened and handed over in bulk.
+        if (_state == VTStates::DcsPassThrough && !_utf8State.have)
+        {
+            const auto dataEnd = std::find_if_not(it, end, [](const auto ch) {
+                return _isC0Code(static_cast<uint8_t>(ch)) || _isDcsPassThroughValid(static_cast<uint8_t>(ch));
+            });
+
+            if (dataEnd != it)
+            {
+                _utf8Buffer.assign(it, dataEnd);
+                _EventDcsPassThroughString(_utf8Buffer, dataEnd == end);
+                it = dataEnd;
+                continue;
+            }
+        }
+
+        it = _ProcessUtf8CodePoint(it, end);
+    }
+
+    _ProcessIncompleteSequence();
+}
+
+// Routine Description:
+// - Transcodes the code point at the given position and feeds the resulting
+//     characters into the state machine one at a time. Incomplete code points
+//     at the end of the input are stored in _utf8State for the next call.
+// Arguments:
+// - it - Start of the code point (or the continuation of a stored partial one)
+// - end - End of the input
+// Return Value:
+// - A pointer past the consumed bytes.
+const char* StateMachine::_ProcessUtf8CodePoint(const char* it, const char* end)
+{
+    // The same table that til::u8u16 uses to determine the length of a code point from its lead byte.
+    static constexpr uint8_t lengths[]{ 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 2, 3, 3, 4, 0 };
+
+    const auto lead = static_cast<uint8_t>(*it);
+    size_t length = _utf8State.have ? _utf8State.want : std::max<size_t>(1, til::at(lengths, lead >> 3));
+    length = std::min(length, gsl::narrow_cast<size_t>(end - it));
+
+    const std::string_view bytes{ it, length };
+#pragma warning(suppress : 26481) // Don't use pointer arithmetic. Use span instead (bounds.1).
+    it += length;
+
+    if (lead < 0x80 && !_utf8State.have)
+    {
+        _ProcessUtf8Character(lead, it == end);
+        return it;
+    }
+
+    // Malformed input is handled by til::u8u16 the same way ProcessString's callers would see it.
+    THROW_IF_FAILED(til::u8u16(bytes, _utf8Buffer, _utf8State));
+
+    const std::wstring_view chars{ _utf8Buffer };
+
+    // Just like in ProcessString, printable characters in the ground state are printed as a string.
+    // This also keeps surrogate pairs together.
+    if (_state == VTStates::Ground && std::none_of(chars.begin(), chars.end(), isActionableFromGround))
+    {
+        if (!chars.empty())
+        {
+            _ActionPrintString(chars, false);
+        }
+        return it;
+    }
+
+    for (size_t i = 0; i < chars.size(); ++i)
+    {
+        _ProcessUtf8Character(til::at(chars, i), it == end && i + 1 == chars.size());
+    }
+
+    return it;
+}
+
+// Routine Description:
+// - Feeds a single transcoded character from ProcessUtf8 into the state machine.
+//     The characters of the current sequence are accumulated in _utf8Run so that
+//     _CurrentRun() can be flushed or cached just like in ProcessString.
+// Arguments:
+// - wch - Character to process
+// - last - True if this is the last character of the input
+// Return Value:
+// - <none>
+void StateMachine::_ProcessUtf8Character(const wchar_t wch, const bool last)
+{
+    _utf8Run.push_back(wch);
+    _currentString = _utf8Run;
+    _runOffset = 0;
+    _runSize = _utf8Run.size();
+    _processingLastCharacter = last;
+
+    ProcessCharacter(wch);
+
+    if (_state == VTStates::Ground)
+    {
+        _utf8Run.clear();
+        _currentString = _utf8Run;
+        _runSize = 0;
+    }
+}
+
+// Routine Description:
+// - Deals with a sequence that's still incomplete at the end of the input
+//     given to ProcessString or ProcessUtf8.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void StateMachine::_ProcessIncompleteSequence()
+{
     // If we're at the end of the string and have remaining un-printed characters,
     if (_state != VTStates::Ground)
     {
@@ -2160,7 +3142,7 @@ void StateMachine::ProcessString(const std::wstring_view string)
         if (_isEngineForInput)
         {
             const auto win32 = _engine->EncounteredWin32InputModeSequence();
-            if (!win32 && run.size() <= 2 && run.front() == L'\x1b')
+            if (!win32 && !run.empty() && run.size() <= 2 && run.front() == L'\x1b')
             {
                 _EnterGround();
                 if (run.size() == 1)
@@ -2290,3 +3272,363 @@ void StateMachine::_ExecuteCsiCompleteCallback()
         _runSize = savedRunSize;
     }
 }
+
+// The engine that Record() runs a string through. Instead of dispatching the
+// actions, it stores them in the recording, together with the parts of the
+// parser state that the real engine could observe while handling them.
+class StateMachine::_RecordingEngine final : public IStateMachineEngine
+{
+public:
+    _RecordingEngine(Recording& recording) noexcept :
+        _recording{ recording }
+    {
+    }
+
+    void Attach(const StateMachine& machine) noexcept
+    {
+        _machine = &machine;
+    }
+
+    bool EncounteredWin32InputModeSequence() const noexcept override
+    {
+        return false;
+    }
+
+    bool ActionExecute(const wchar_t wch) override
+    {
+        _record(Recording::Kind::Execute).wch = wch;
+        return true;
+    }
+
+    bool ActionExecuteFromEscape(const wchar_t wch) override
+    {
+        _record(Recording::Kind::ExecuteFromEscape).wch = wch;
+        return true;
+    }
+
+    bool ActionPrint(const wchar_t wch) override
+    {
+        _record(Recording::Kind::Print).wch = wch;
+        return true;
+    }
+
+    bool ActionPrintString(const std::wstring_view string) override
+    {
+        _recordText(_record(Recording::Kind::PrintString), string);
+        return true;
+    }
+
+    bool ActionPrintAsciiString(const std::wstring_view string) override
+    {
+        _recordText(_record(Recording::Kind::PrintAsciiString), string);
+        return true;
+    }
+
+    bool ActionPassThroughString(const std::wstring_view /*string*/, const bool /*flush*/) noexcept override
+    {
+        // This is only ever requested by the engine itself, via FlushToTerminal.
+        return true;
+    }
+
+    bool ActionEscDispatch(const VTID id) override
+    {
+        _record(Recording::Kind::EscDispatch).id = id;
+        return true;
+    }
+
+    bool ActionVt52EscDispatch(const VTID id, const VTParameters /*parameters*/) override
+    {
+        auto& action = _record(Recording::Kind::Vt52EscDispatch);
+        action.id = id;
+        _recordParameters(action, false);
+        return true;
+    }
+
+    bool ActionCsiDispatch(const VTID id, const VTParameters /*parameters*/) override
+    {
+        auto& action = _record(Recording::Kind::CsiDispatch);
+        action.id = id;
+        _recordParameters(action, true);
+        return true;
+    }
+
+    StringHandler ActionDcsDispatch(const VTID id, const VTParameters /*parameters*/) override
+    {
+        auto& action = _record(Recording::Kind::DcsDispatch);
+        action.id = id;
+        _recordParameters(action, false);
+        return [this](const std::wstring_view data) {
+            _recordText(_record(Recording::Kind::DcsData), data);
+            return true;
+        };
+    }
+
+    bool ActionClear() override
+    {
+        // The state machine constructor clears its state before we're attached.
+        if (_machine)
+        {
+            _record(Recording::Kind::Clear);
+        }
+        return true;
+    }
+
+    bool ActionIgnore() noexcept override
+    {
+        return true;
+    }
+
+    bool ActionOscDispatch(const size_t parameter, const std::wstring_view string) override
+    {
+        auto& action = _record(Recording::Kind::OscDispatch);
+        action.id = parameter;
+        _recordText(action, string);
+        return true;
+    }
+
+    bool ActionSs3Dispatch(const wchar_t wch, const VTParameters /*parameters*/) override
+    {
+        auto& action = _record(Recording::Kind::Ss3Dispatch);
+        action.wch = wch;
+        _recordParameters(action, false);
+        return true;
+    }
+
+private:
+    Recording::Action& _record(const Recording::Kind kind)
+    {
+        auto& action = _recording._actions.emplace_back();
+        action.kind = kind;
+        action.processingLastCharacter = _machine->_processingLastCharacter;
+        action.runOffset = gsl::narrow_cast<uint32_t>(_machine->_runOffset);
+        action.runSize = gsl::narrow_cast<uint32_t>(_machine->_runSize);
+        return action;
+    }
+
+    void _recordText(Recording::Action& action, const std::wstring_view text)
+    {
+        action.textOffset = gsl::narrow_cast<uint32_t>(_recording._text.size());
+        action.textSize = gsl::narrow_cast<uint32_t>(text.size());
+        _recording._text.append(text);
+    }
+
+    // The parameters are taken from the state machine rather than from the
+    // VTParameters we were given, so that the sub parameter ranges are kept
+    // exactly as the state machine stored them.
+    void _recordParameters(Recording::Action& action, const bool withSubParameters)
+    {
+        const auto append = [](auto& storage, const auto& values, uint32_t& offset, uint32_t& count) {
+            offset = gsl::narrow_cast<uint32_t>(storage.size());
+            count = gsl::narrow_cast<uint32_t>(values.size());
+            storage.insert(storage.end(), values.begin(), values.end());
+        };
+        append(_recording._parameters, _machine->_parameters, action.parameterOffset, action.parameterCount);
+        if (withSubParameters)
+        {
+            append(_recording._subParameters, _machine->_subParameters, action.subParameterOffset, action.subParameterCount);
+            append(_recording._subParameterRanges, _machine->_subParameterRanges, action.subParameterRangeOffset, action.subParameterRangeCount);
+        }
+    }
+
+    Recording& _recording;
+    const StateMachine* _machine = nullptr;
+};
+
+bool StateMachine::Recording::IsValid() const noexcept
+{
+    return _valid;
+}
+
+// Routine Description:
+// - Marks the recording as out of date, e.g. because the string it was made
+//   from has changed. This is safe to call while the recording is replayed:
+//   the replay will stop using it after the action that is being dispatched.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void StateMachine::Recording::Invalidate() noexcept
+{
+    _valid = false;
+}
+
+// Routine Description:
+// - Parses the given string with the current parser modes and records the
+//   resulting engine actions, without dispatching any of them.
+// Arguments:
+// - string - Characters to record
+// Return Value:
+// - The recording, which can be passed to Replay along with the same string.
+StateMachine::Recording StateMachine::Record(const std::wstring_view string) const
+{
+    Recording recording;
+    recording._parserMode = _parserMode;
+    recording._length = string.size();
+    recording._valid = true;
+
+    // The recorded offsets are 32-bit. A longer string is left incomplete,
+    // so that Replay will always process it directly.
+    if (string.size() > UINT32_MAX)
+    {
+        return recording;
+    }
+
+    auto engine = std::make_unique<_RecordingEngine>(recording);
+    auto& recorder = *engine;
+    StateMachine machine{ std::move(engine), _isEngineForInput };
+    machine._parserMode = _parserMode;
+    machine._processingLastCharacter = false;
+    recorder.Attach(machine);
+    machine.ProcessString(string);
+
+    recording._complete = machine._state == VTStates::Ground;
+    return recording;
+}
+
+// Routine Description:
+// - Determines whether the given recording still matches this state machine,
+//   i.e. it hasn't been invalidated and was made with the same parser modes.
+// Arguments:
+// - recording - The recording to check
+// Return Value:
+// - True if the recording can be replayed.
+bool StateMachine::CanReplay(const Recording& recording) const noexcept
+{
+    return recording._valid && !_isEngineForInput && recording._parserMode.bits() == _parserMode.bits();
+}
+
+// Routine Description:
+// - Hands the recorded actions of a string to the engine, with the same
+//   results as passing the string to ProcessString, but without parsing it.
+//   If the recording can't be used, the string is simply processed instead.
+// Arguments:
+// - recording - The actions recorded for the string by Record
+// - string - The string the recording was made from
+// Return Value:
+// - <none>
+void StateMachine::Replay(const Recording& recording, const std::wstring_view string)
+{
+    // The recorded actions are only correct if we start from the ground state,
+    // and if the string also ended there, since otherwise the incomplete
+    // sequence would have to carry over into the input that follows.
+    if (!CanReplay(recording) || !recording._complete || recording._length != string.size() || _state != VTStates::Ground)
+    {
+        ProcessString(string);
+        return;
+    }
+
+    _currentString = string;
+    IStateMachineEngine::StringHandler dcsStringHandler;
+
+    for (const auto& action : recording._actions)
+    {
+        const auto text = std::wstring_view{ recording._text }.substr(action.textOffset, action.textSize);
+        const auto parameters = VTParameters{
+            std::span{ recording._parameters }.subspan(action.parameterOffset, action.parameterCount),
+            std::span{ recording._subParameters }.subspan(action.subParameterOffset, action.subParameterCount),
+            std::span{ recording._subParameterRanges }.subspan(action.subParameterRangeOffset, action.subParameterRangeCount)
+        };
+
+        _runOffset = action.runOffset;
+        _runSize = action.runSize;
+        // ProcessString only updates this flag for characters that are
+        // processed individually, which excludes the bulk printable runs.
+        if (action.kind != Recording::Kind::PrintString && action.kind != Recording::Kind::PrintAsciiString)
+        {
+            _processingLastCharacter = action.processingLastCharacter;
+        }
+
+        auto dispatched = false;
+        switch (action.kind)
+        {
+        case Recording::Kind::Execute:
+            _ActionExecute(action.wch);
+            break;
+        case Recording::Kind::ExecuteFromEscape:
+            _ActionExecuteFromEscape(action.wch);
+            break;
+        case Recording::Kind::Print:
+            _ActionPrint(action.wch);
+            break;
+        case Recording::Kind::PrintString:
+            _ActionPrintString(text, false);
+            break;
+        case Recording::Kind::PrintAsciiString:
+            _ActionPrintString(text, true);
+            break;
+        case Recording::Kind::EscDispatch:
+            _trace.TraceOnAction(L"EscDispatch");
+            _trace.DispatchSequenceTrace(_SafeExecute([&]() {
+                return _engine->ActionEscDispatch(action.id);
+            }));
+            dispatched = true;
+            break;
+        case Recording::Kind::Vt52EscDispatch:
+            _trace.TraceOnAction(L"Vt52EscDispatch");
+            _trace.DispatchSequenceTrace(_SafeExecute([&]() {
+                return _engine->ActionVt52EscDispatch(action.id, parameters);
+            }));
+            dispatched = true;
+            break;
+        case Recording::Kind::CsiDispatch:
+            _trace.TraceOnAction(L"CsiDispatch");
+            _trace.DispatchSequenceTrace(_SafeExecute([&]() {
+                return _engine->ActionCsiDispatch(action.id, parameters);
+            }));
+            _ExecuteCsiCompleteCallback();
+            dispatched = true;
+            break;
+        case Recording::Kind::OscDispatch:
+            _trace.TraceOnAction(L"OscDispatch");
+            _trace.DispatchSequenceTrace(_SafeExecute([&]() {
+                return _engine->ActionOscDispatch(gsl::narrow_cast<size_t>(action.id), text);
+            }));
+            break;
+        case Recording::Kind::Ss3Dispatch:
+            _trace.TraceOnAction(L"Ss3Dispatch");
+            _trace.DispatchSequenceTrace(_SafeExecute([&]() {
+                return _engine->ActionSs3Dispatch(action.wch, parameters);
+            }));
+            break;
+        case Recording::Kind::DcsDispatch:
+        {
+            _trace.TraceOnAction(L"DcsDispatch");
+            const auto success = _SafeExecute([&]() {
+                dcsStringHandler = _engine->ActionDcsDispatch(action.id, parameters);
+                return dcsStringHandler != nullptr;
+            });
+            _trace.DispatchSequenceTrace(success);
+            // If the sequence isn't supported, the data string is ignored.
+            if (!success)
+            {
+                dcsStringHandler = nullptr;
+            }
+            break;
+        }
+        case Recording::Kind::DcsData:
+            // Once the handler has rejected the data, the rest is ignored.
+            if (dcsStringHandler && !dcsStringHandler(text))
+            {
+                dcsStringHandler = nullptr;
+            }
+            break;
+        case Recording::Kind::Clear:
+            _trace.TraceOnAction(L"Clear");
+            dcsStringHandler = nullptr;
+            _engine->ActionClear();
+            break;
+        }
+
+        // A dispatched sequence may have changed the parser modes (DECANM,
+        // DECAC1, DOCS, RIS), which would change how the rest of the string is
+        // parsed, or it may have invalidated the recording (RIS clearing the
+        // macros). ESC, CSI, and VT52 sequences are the only ones that can do
+        // that, and they always end in the ground state, so we can just parse
+        // the rest of the string from there.
+        if (dispatched && !CanReplay(recording))
+        {
+            ProcessString(string.substr(action.runOffset + action.runSize));
+            return;
+        }
+    }
+}
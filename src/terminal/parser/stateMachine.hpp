@@ -57,6 +57,9 @@ namespace Microsoft::Console::VirtualTerminal
             AcceptC1,
             AlwaysAcceptC1,
             Ansi,
+            // Dispatches events through a precomputed transition table instead of
+            // the _Event* functions. Both produce identical results.
+            TableDriven,
         };
 
         void SetParserMode(const Mode mode, const bool enabled) noexcept;
@@ -64,12 +67,84 @@ namespace Microsoft::Console::VirtualTerminal
 
         void ProcessCharacter(const wchar_t wch);
         void ProcessString(const std::wstring_view string);
+        void ProcessUtf8(const std::string_view string);
         bool IsProcessingLastCharacter() const noexcept;
 
         void OnCsiComplete(const std::function<void()> callback);
 
         void ResetState() noexcept;
 
+        // The engine actions that a string produces, recorded once by Record()
+        // so that Replay() can hand them to the engine again without having to
+        // parse the string every time. This is used for DECINVM macros.
+        class Recording
+        {
+        public:
+            bool IsValid() const noexcept;
+            void Invalidate() noexcept;
+
+        private:
+            friend class StateMachine;
+
+            enum class Kind : uint8_t
+            {
+                Execute,
+                ExecuteFromEscape,
+                Print,
+                PrintString,
+                PrintAsciiString,
+                EscDispatch,
+                Vt52EscDispatch,
+                CsiDispatch,
+                OscDispatch,
+                Ss3Dispatch,
+                DcsDispatch,
+                DcsData,
+                Clear,
+            };
+
+            // Offsets are stored as 32-bit values to keep long recordings
+            // compact. Longer strings aren't recorded (see Record).
+            struct Action
+            {
+                Kind kind;
+                bool processingLastCharacter;
+                wchar_t wch;
+                // The VTID of a sequence, or the parameter of an OSC.
+                uint64_t id;
+                // The run of the source string that was being processed,
+                // which is what FlushToTerminal() would pass through.
+                uint32_t runOffset;
+                uint32_t runSize;
+                // Ranges in the text and parameter storage below.
+                uint32_t textOffset;
+                uint32_t textSize;
+                uint32_t parameterOffset;
+                uint32_t parameterCount;
+                uint32_t subParameterOffset;
+                uint32_t subParameterCount;
+                uint32_t subParameterRangeOffset;
+                uint32_t subParameterRangeCount;
+            };
+
+            std::vector<Action> _actions;
+            std::wstring _text;
+            std::vector<VTParameter> _parameters;
+            std::vector<VTParameter> _subParameters;
+            std::vector<std::pair<BYTE, BYTE>> _subParameterRanges;
+            til::enumset<Mode> _parserMode;
+            size_t _length{ 0 };
+            // Whether the string ended in the ground state. If it didn't,
+            // the parser state has to carry over to whatever comes next,
+            // so the string can't be replayed.
+            bool _complete{ false };
+            bool _valid{ false };
+        };
+
+        Recording Record(const std::wstring_view string) const;
+        bool CanReplay(const Recording& recording) const noexcept;
+        void Replay(const Recording& recording, const std::wstring_view string);
+
         bool FlushToTerminal();
 
         const IStateMachineEngine& Engine() const noexcept;
@@ -83,10 +158,12 @@ namespace Microsoft::Console::VirtualTerminal
         };
 
     private:
+        class _RecordingEngine;
+
         void _ActionExecute(const wchar_t wch);
         void _ActionExecuteFromEscape(const wchar_t wch);
         void _ActionPrint(const wchar_t wch);
-        void _ActionPrintString(const std::wstring_view string);
+        void _ActionPrintString(const std::wstring_view string, const bool ascii);
         void _ActionEscDispatch(const wchar_t wch);
         void _ActionVt52EscDispatch(const wchar_t wch);
         void _ActionCollect(const wchar_t wch) noexcept;
@@ -143,8 +220,11 @@ namespace Microsoft::Console::VirtualTerminal
         void _EventDcsIntermediate(const wchar_t wch);
         void _EventDcsParam(const wchar_t wch);
         void _EventDcsPassThrough(const wchar_t wch);
+        size_t _EventDcsPassThroughString(const std::wstring_view string, const bool endOfInput);
         void _EventSosPmApcString(const wchar_t wch) noexcept;
 
+        void _EventFromTable(const wchar_t wch);
+
         void _AccumulateTo(const wchar_t wch, VTInt& value) noexcept;
 
         template<typename TLambda>
@@ -152,6 +232,10 @@ namespace Microsoft::Console::VirtualTerminal
 
         void _ExecuteCsiCompleteCallback();
 
+        void _ProcessIncompleteSequence();
+        const char* _ProcessUtf8CodePoint(const char* it, const char* end);
+        void _ProcessUtf8Character(const wchar_t wch, const bool last);
+
         enum class VTStates
         {
             Ground,
@@ -176,6 +260,42 @@ namespace Microsoft::Console::VirtualTerminal
             SosPmApcString
         };
 
+        // The actions of the table-driven engine. Each corresponds to what an
+        // _Event* function does for a given character, before the state change.
+        enum class TransitionAction : uint8_t
+        {
+            None,
+            Execute,
+            ExecuteFromEscape,
+            Print,
+            Ignore,
+            Collect,
+            Param,
+            SubParam,
+            EscDispatch,
+            Vt52EscDispatch,
+            CsiDispatch,
+            Ss3Dispatch,
+            DcsDispatch,
+            OscParam,
+            OscPut,
+            OscDispatch,
+            Vt52Param,
+            DcsPassThrough,
+            // Enters the Escape state first and then handles the character there.
+            EscapeEvent,
+        };
+
+        struct Transition
+        {
+            TransitionAction action = TransitionAction::None;
+            bool enter = false;
+            VTStates state = VTStates::Ground;
+        };
+
+        static constexpr Transition _ComputeTransition(const VTStates state, const wchar_t wch, const bool isEngineForInput, const bool ansi) noexcept;
+        void _EnterState(const VTStates state);
+
         Microsoft::Console::VirtualTerminal::ParserTracing _trace;
 
         std::unique_ptr<IStateMachineEngine> _engine;
@@ -213,6 +333,12 @@ namespace Microsoft::Console::VirtualTerminal
 
         std::optional<std::wstring> _cachedSequence;
 
+        // State for ProcessUtf8: the partial code point at the end of the previous call,
+        // the transcoded printable run and the transcoded part of the current sequence.
+        til::u8state _utf8State;
+        std::wstring _utf8Buffer;
+        std::wstring _utf8Run;
+
         // This is tracked per state machine instance so that separate calls to Process*
         //   can start and finish a sequence.
         bool _processingLastCharacter;
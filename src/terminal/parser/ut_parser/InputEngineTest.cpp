@@ -37,6 +37,14 @@ namespace Microsoft
 };
 using namespace Microsoft::Console::VirtualTerminal;
 
+// InputEngineTest runs once for each of the StateMachine's engines. See its "Data:tableDriven" property.
+static void SelectParserEngine(StateMachine& machine)
+{
+    size_t tableDriven = 0;
+    TestData::TryGetValue(L"tableDriven", tableDriven);
+    machine.SetParserMode(StateMachine::Mode::TableDriven, tableDriven != 0);
+}
+
 bool IsShiftPressed(const DWORD modifierState)
 {
     return WI_IsFlagSet(modifierState, SHIFT_PRESSED);
@@ -202,7 +210,9 @@ public:
 
 class Microsoft::Console::VirtualTerminal::InputEngineTest
 {
-    TEST_CLASS(InputEngineTest);
+    BEGIN_TEST_CLASS(InputEngineTest)
+        TEST_CLASS_PROPERTY(L"Data:tableDriven", L"{0,1}")
+    END_TEST_CLASS()
 
     TestState testState;
 
@@ -405,6 +415,7 @@ void InputEngineTest::C0Test()
     auto dispatch = std::make_unique<TestInteractDispatch>(pfn, &testState);
     auto inputEngine = std::make_unique<InputStateMachineEngine>(std::move(dispatch));
     auto _stateMachine = std::make_unique<StateMachine>(std::move(inputEngine));
+    SelectParserEngine(*_stateMachine);
     VERIFY_IS_NOT_NULL(_stateMachine);
     testState._stateMachine = _stateMachine.get();
 
@@ -505,6 +516,7 @@ void InputEngineTest::AlphanumericTest()
     auto dispatch = std::make_unique<TestInteractDispatch>(pfn, &testState);
     auto inputEngine = std::make_unique<InputStateMachineEngine>(std::move(dispatch));
     auto _stateMachine = std::make_unique<StateMachine>(std::move(inputEngine));
+    SelectParserEngine(*_stateMachine);
     VERIFY_IS_NOT_NULL(_stateMachine);
     testState._stateMachine = _stateMachine.get();
 
@@ -555,6 +567,7 @@ void InputEngineTest::RoundTripTest()
     auto dispatch = std::make_unique<TestInteractDispatch>(pfn, &testState);
     auto inputEngine = std::make_unique<InputStateMachineEngine>(std::move(dispatch));
     auto _stateMachine = std::make_unique<StateMachine>(std::move(inputEngine));
+    SelectParserEngine(*_stateMachine);
     VERIFY_IS_NOT_NULL(_stateMachine);
     testState._stateMachine = _stateMachine.get();
 
@@ -618,6 +631,7 @@ void InputEngineTest::WindowManipulationTest()
     auto dispatch = std::make_unique<TestInteractDispatch>(pfn, &testState);
     auto inputEngine = std::make_unique<InputStateMachineEngine>(std::move(dispatch));
     auto _stateMachine = std::make_unique<StateMachine>(std::move(inputEngine));
+    SelectParserEngine(*_stateMachine);
     VERIFY_IS_NOT_NULL(_stateMachine.get());
     testState._stateMachine = _stateMachine.get();
 
@@ -672,6 +686,7 @@ void InputEngineTest::NonAsciiTest()
     auto dispatch = std::make_unique<TestInteractDispatch>(pfn, &testState);
     auto inputEngine = std::make_unique<InputStateMachineEngine>(std::move(dispatch));
     auto _stateMachine = std::make_unique<StateMachine>(std::move(inputEngine));
+    SelectParserEngine(*_stateMachine);
     VERIFY_IS_NOT_NULL(_stateMachine.get());
     testState._stateMachine = _stateMachine.get();
     Log::Comment(L"Sending various non-ascii strings, and seeing what we get out");
@@ -729,6 +744,7 @@ void InputEngineTest::CursorPositioningTest()
     auto inputEngine = std::make_unique<InputStateMachineEngine>(std::move(dispatch), true);
     VERIFY_IS_NOT_NULL(inputEngine.get());
     auto _stateMachine = std::make_unique<StateMachine>(std::move(inputEngine));
+    SelectParserEngine(*_stateMachine);
     VERIFY_IS_NOT_NULL(_stateMachine);
     testState._stateMachine = _stateMachine.get();
 
@@ -770,6 +786,7 @@ void InputEngineTest::CSICursorBackTabTest()
     auto dispatch = std::make_unique<TestInteractDispatch>(pfn, &testState);
     auto inputEngine = std::make_unique<InputStateMachineEngine>(std::move(dispatch));
     auto _stateMachine = std::make_unique<StateMachine>(std::move(inputEngine));
+    SelectParserEngine(*_stateMachine);
     VERIFY_IS_NOT_NULL(_stateMachine);
     testState._stateMachine = _stateMachine.get();
 
@@ -798,6 +815,7 @@ void InputEngineTest::EnhancedKeysTest()
     auto dispatch = std::make_unique<TestInteractDispatch>(pfn, &testState);
     auto inputEngine = std::make_unique<InputStateMachineEngine>(std::move(dispatch));
     auto _stateMachine = std::make_unique<StateMachine>(std::move(inputEngine));
+    SelectParserEngine(*_stateMachine);
     VERIFY_IS_NOT_NULL(_stateMachine);
     testState._stateMachine = _stateMachine.get();
 
@@ -848,6 +866,7 @@ void InputEngineTest::SS3CursorKeyTest()
     auto dispatch = std::make_unique<TestInteractDispatch>(pfn, &testState);
     auto inputEngine = std::make_unique<InputStateMachineEngine>(std::move(dispatch));
     auto _stateMachine = std::make_unique<StateMachine>(std::move(inputEngine));
+    SelectParserEngine(*_stateMachine);
     VERIFY_IS_NOT_NULL(_stateMachine);
     testState._stateMachine = _stateMachine.get();
 
@@ -892,6 +911,7 @@ void InputEngineTest::AltBackspaceTest()
     auto dispatch = std::make_unique<TestInteractDispatch>(pfn, &testState);
     auto inputEngine = std::make_unique<InputStateMachineEngine>(std::move(dispatch));
     auto _stateMachine = std::make_unique<StateMachine>(std::move(inputEngine));
+    SelectParserEngine(*_stateMachine);
     VERIFY_IS_NOT_NULL(_stateMachine);
     testState._stateMachine = _stateMachine.get();
 
@@ -920,6 +940,7 @@ void InputEngineTest::AltCtrlDTest()
     auto dispatch = std::make_unique<TestInteractDispatch>(pfn, &testState);
     auto inputEngine = std::make_unique<InputStateMachineEngine>(std::move(dispatch));
     auto _stateMachine = std::make_unique<StateMachine>(std::move(inputEngine));
+    SelectParserEngine(*_stateMachine);
     VERIFY_IS_NOT_NULL(_stateMachine);
     testState._stateMachine = _stateMachine.get();
 
@@ -969,6 +990,7 @@ void InputEngineTest::AltIntermediateTest()
     auto dispatch = std::make_unique<TestInteractDispatch>(pfnInputStateMachineCallback, &testState);
     auto inputEngine = std::make_unique<InputStateMachineEngine>(std::move(dispatch));
     auto stateMachine = std::make_unique<StateMachine>(std::move(inputEngine));
+    SelectParserEngine(*stateMachine);
     VERIFY_IS_NOT_NULL(stateMachine);
     testState._stateMachine = stateMachine.get();
 
@@ -1001,6 +1023,7 @@ void InputEngineTest::AltBackspaceEnterTest()
     auto dispatch = std::make_unique<TestInteractDispatch>(pfn, &testState);
     auto inputEngine = std::make_unique<InputStateMachineEngine>(std::move(dispatch));
     auto _stateMachine = std::make_unique<StateMachine>(std::move(inputEngine));
+    SelectParserEngine(*_stateMachine);
     VERIFY_IS_NOT_NULL(_stateMachine);
     testState._stateMachine = _stateMachine.get();
 
@@ -1051,6 +1074,7 @@ void InputEngineTest::ChunkedSequence()
     auto dispatch = std::make_unique<TestInteractDispatch>(nullptr, nullptr);
     auto inputEngine = std::make_unique<InputStateMachineEngine>(std::move(dispatch));
     StateMachine stateMachine{ std::move(inputEngine) };
+    SelectParserEngine(stateMachine);
     stateMachine.ProcessString(L"\x1b[1");
     VERIFY_ARE_EQUAL(StateMachine::VTStates::CsiParam, stateMachine._state);
 }
@@ -1097,6 +1121,7 @@ void InputEngineTest::VerifySGRMouseData(const std::vector<std::tuple<SGR_PARAMS
     // Let's force it to a high value to make the double click tests pass.
     inputEngine->_doubleClickTime = std::chrono::milliseconds(1000);
     auto _stateMachine = std::make_unique<StateMachine>(std::move(inputEngine));
+    SelectParserEngine(*_stateMachine);
     VERIFY_IS_NOT_NULL(_stateMachine);
     testState._stateMachine = _stateMachine.get();
 
@@ -1328,6 +1353,7 @@ void InputEngineTest::CtrlAltZCtrlAltXTest()
     auto dispatch = std::make_unique<TestInteractDispatch>(pfn, &testState);
     auto inputEngine = std::make_unique<InputStateMachineEngine>(std::move(dispatch));
     auto _stateMachine = std::make_unique<StateMachine>(std::move(inputEngine));
+    SelectParserEngine(*_stateMachine);
     VERIFY_IS_NOT_NULL(_stateMachine);
     testState._stateMachine = _stateMachine.get();
 
@@ -1392,6 +1418,7 @@ void InputEngineTest::TestSs3Entry()
     auto dispatch = std::make_unique<TestInteractDispatch>(pfn, &testState);
     auto engine = std::make_unique<InputStateMachineEngine>(std::move(dispatch));
     StateMachine mach(std::move(engine));
+    SelectParserEngine(mach);
 
     VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::Ground);
     mach.ProcessCharacter(AsciiChars::ESC);
@@ -1409,6 +1436,7 @@ void InputEngineTest::TestSs3Immediate()
     auto dispatch = std::make_unique<TestInteractDispatch>(pfn, &testState);
     auto engine = std::make_unique<InputStateMachineEngine>(std::move(dispatch));
     StateMachine mach(std::move(engine));
+    SelectParserEngine(mach);
 
     VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::Ground);
     mach.ProcessCharacter(AsciiChars::ESC);
@@ -1446,6 +1474,7 @@ void InputEngineTest::TestSs3Param()
     auto dispatch = std::make_unique<TestInteractDispatch>(pfn, &testState);
     auto engine = std::make_unique<InputStateMachineEngine>(std::move(dispatch));
     StateMachine mach(std::move(engine));
+    SelectParserEngine(mach);
 
     VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::Ground);
     mach.ProcessCharacter(AsciiChars::ESC);
@@ -33,6 +33,15 @@ namespace Microsoft
 // 32767-32768 is our boundary SHORT_MAX for the Windows console
 #define PARAM_VALUES L"{0, 1, 2, 1000, 9999, 10000, 16383, 16384, 32767, 32768, 50000, 999999999}"
 
+// Both test classes in this file run every test once with the hand-written _Event* functions
+// and once with the transition table. The latter is selected by their "Data:tableDriven" property.
+static void SelectParserEngine(StateMachine& machine)
+{
+    size_t tableDriven = 0;
+    TestData::TryGetValue(L"tableDriven", tableDriven);
+    machine.SetParserMode(StateMachine::Mode::TableDriven, tableDriven != 0);
+}
+
 class DummyDispatch final : public TermDispatch
 {
 public:
@@ -47,7 +56,9 @@ public:
 
 class Microsoft::Console::VirtualTerminal::OutputEngineTest final
 {
-    TEST_CLASS(OutputEngineTest);
+    BEGIN_TEST_CLASS(OutputEngineTest)
+        TEST_CLASS_PROPERTY(L"Data:tableDriven", L"{0,1}")
+    END_TEST_CLASS()
 
     TEST_METHOD(TestEscapePath)
     {
@@ -60,6 +71,7 @@ class Microsoft::Console::VirtualTerminal::OutputEngineTest final
         auto dispatch = std::make_unique<DummyDispatch>();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         auto expectedEscapeState = StateMachine::VTStates::Escape;
 
@@ -190,6 +202,7 @@ class Microsoft::Console::VirtualTerminal::OutputEngineTest final
         auto dispatch = std::make_unique<DummyDispatch>();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::Ground);
         mach.ProcessCharacter(AsciiChars::ESC);
@@ -211,6 +224,7 @@ class Microsoft::Console::VirtualTerminal::OutputEngineTest final
         auto dispatch = std::make_unique<DummyDispatch>();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::Ground);
         mach.ProcessCharacter(AsciiChars::ESC);
@@ -235,6 +249,7 @@ class Microsoft::Console::VirtualTerminal::OutputEngineTest final
         auto dispatch = std::make_unique<DummyDispatch>();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::Ground);
         mach.ProcessCharacter(L'a');
@@ -246,6 +261,7 @@ class Microsoft::Console::VirtualTerminal::OutputEngineTest final
         auto dispatch = std::make_unique<DummyDispatch>();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::Ground);
         mach.ProcessCharacter(AsciiChars::ESC);
@@ -261,6 +277,7 @@ class Microsoft::Console::VirtualTerminal::OutputEngineTest final
         auto dispatch = std::make_unique<DummyDispatch>();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         // Enable the acceptance of C1 control codes in the state machine.
         mach.SetParserMode(StateMachine::Mode::AcceptC1, true);
@@ -277,6 +294,7 @@ class Microsoft::Console::VirtualTerminal::OutputEngineTest final
         auto dispatch = std::make_unique<DummyDispatch>();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::Ground);
         mach.ProcessCharacter(AsciiChars::ESC);
@@ -298,6 +316,7 @@ class Microsoft::Console::VirtualTerminal::OutputEngineTest final
         auto dispatch = std::make_unique<DummyDispatch>();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::Ground);
         mach.ProcessCharacter(AsciiChars::ESC);
@@ -333,6 +352,7 @@ class Microsoft::Console::VirtualTerminal::OutputEngineTest final
         auto dispatch = std::make_unique<DummyDispatch>();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         Log::Comment(L"Output a sequence with 100 parameters");
         VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::Ground);
@@ -367,6 +387,7 @@ class Microsoft::Console::VirtualTerminal::OutputEngineTest final
         auto dispatch = std::make_unique<DummyDispatch>();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::Ground);
         mach.ProcessCharacter(AsciiChars::ESC);
@@ -393,6 +414,7 @@ class Microsoft::Console::VirtualTerminal::OutputEngineTest final
         auto dispatch = std::make_unique<DummyDispatch>();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         // "\e[:3;9:5::8J"
         VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::Ground);
@@ -448,6 +470,7 @@ class Microsoft::Console::VirtualTerminal::OutputEngineTest final
         auto dispatch = std::make_unique<DummyDispatch>();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         Log::Comment(L"Output two parameters with 100 sub parameters each");
         VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::Ground);
@@ -499,6 +522,7 @@ class Microsoft::Console::VirtualTerminal::OutputEngineTest final
         auto dispatch = std::make_unique<DummyDispatch>();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::Ground);
         mach.ProcessCharacter(AsciiChars::ESC);
@@ -529,6 +553,7 @@ class Microsoft::Console::VirtualTerminal::OutputEngineTest final
         auto dispatch = std::make_unique<DummyDispatch>();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         mach.ProcessCharacter(AsciiChars::ESC);
         VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::Escape);
@@ -566,6 +591,7 @@ class Microsoft::Console::VirtualTerminal::OutputEngineTest final
         auto dispatch = std::make_unique<DummyDispatch>();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         // Enable the acceptance of C1 control codes in the state machine.
         mach.SetParserMode(StateMachine::Mode::AcceptC1, true);
@@ -582,6 +608,7 @@ class Microsoft::Console::VirtualTerminal::OutputEngineTest final
         auto dispatch = std::make_unique<DummyDispatch>();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::Ground);
         mach.ProcessCharacter(AsciiChars::ESC);
@@ -650,6 +677,7 @@ class Microsoft::Console::VirtualTerminal::OutputEngineTest final
         auto dispatch = std::make_unique<DummyDispatch>();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::Ground);
         mach.ProcessCharacter(AsciiChars::ESC);
@@ -674,6 +702,7 @@ class Microsoft::Console::VirtualTerminal::OutputEngineTest final
         auto dispatch = std::make_unique<DummyDispatch>();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::Ground);
         mach.ProcessCharacter(AsciiChars::ESC);
@@ -699,6 +728,7 @@ class Microsoft::Console::VirtualTerminal::OutputEngineTest final
         auto dispatch = std::make_unique<DummyDispatch>();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::Ground);
         mach.ProcessCharacter(AsciiChars::ESC);
@@ -729,6 +759,7 @@ class Microsoft::Console::VirtualTerminal::OutputEngineTest final
         auto dispatch = std::make_unique<DummyDispatch>();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::Ground);
         mach.ProcessCharacter(AsciiChars::ESC);
@@ -773,6 +804,7 @@ class Microsoft::Console::VirtualTerminal::OutputEngineTest final
         auto dispatch = std::make_unique<DummyDispatch>();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::Ground);
         mach.ProcessCharacter(AsciiChars::ESC);
@@ -802,6 +834,7 @@ class Microsoft::Console::VirtualTerminal::OutputEngineTest final
         auto dispatch = std::make_unique<DummyDispatch>();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::Ground);
         mach.ProcessCharacter(AsciiChars::ESC);
@@ -818,6 +851,7 @@ class Microsoft::Console::VirtualTerminal::OutputEngineTest final
         auto dispatch = std::make_unique<DummyDispatch>();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         // Enable the acceptance of C1 control codes in the state machine.
         mach.SetParserMode(StateMachine::Mode::AcceptC1, true);
@@ -835,6 +869,7 @@ class Microsoft::Console::VirtualTerminal::OutputEngineTest final
         auto dispatch = std::make_unique<DummyDispatch>();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::Ground);
         mach.ProcessCharacter(AsciiChars::ESC);
@@ -857,6 +892,7 @@ class Microsoft::Console::VirtualTerminal::OutputEngineTest final
         auto dispatch = std::make_unique<DummyDispatch>();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::Ground);
         mach.ProcessCharacter(AsciiChars::ESC);
@@ -875,6 +911,7 @@ class Microsoft::Console::VirtualTerminal::OutputEngineTest final
         auto dispatch = std::make_unique<DummyDispatch>();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::Ground);
         mach.ProcessCharacter(AsciiChars::ESC);
@@ -912,6 +949,7 @@ class Microsoft::Console::VirtualTerminal::OutputEngineTest final
         auto dispatch = std::make_unique<DummyDispatch>();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::Ground);
         mach.ProcessCharacter(AsciiChars::ESC);
@@ -934,6 +972,7 @@ class Microsoft::Console::VirtualTerminal::OutputEngineTest final
         auto dispatch = std::make_unique<DummyDispatch>();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::Ground);
         mach.ProcessCharacter(AsciiChars::ESC);
@@ -964,6 +1003,7 @@ class Microsoft::Console::VirtualTerminal::OutputEngineTest final
         auto dispatch = std::make_unique<DummyDispatch>();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::Ground);
         mach.ProcessCharacter(AsciiChars::ESC);
@@ -991,6 +1031,7 @@ class Microsoft::Console::VirtualTerminal::OutputEngineTest final
         auto dispatch = std::make_unique<DummyDispatch>();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::Ground);
         mach.ProcessCharacter(AsciiChars::ESC);
@@ -1038,6 +1079,7 @@ class Microsoft::Console::VirtualTerminal::OutputEngineTest final
         auto dispatch = std::make_unique<DummyDispatch>();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         // Enable the acceptance of C1 control codes in the state machine.
         mach.SetParserMode(StateMachine::Mode::AcceptC1, true);
@@ -1550,7 +1592,9 @@ public:
 
 class StateMachineExternalTest final
 {
-    TEST_CLASS(StateMachineExternalTest);
+    BEGIN_TEST_CLASS(StateMachineExternalTest)
+        TEST_CLASS_PROPERTY(L"Data:tableDriven", L"{0,1}")
+    END_TEST_CLASS()
 
     TEST_METHOD_SETUP(SetupState)
     {
@@ -1645,6 +1689,7 @@ class StateMachineExternalTest final
         auto pDispatch = dispatch.get();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         TestCsiCursorMovement(L'A', uiDistance, true, fExtra, &pDispatch->_cursorUp, mach, *pDispatch);
         pDispatch->ClearState();
@@ -1679,6 +1724,7 @@ class StateMachineExternalTest final
         auto pDispatch = dispatch.get();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         size_t uiDistance = 9999; // this value should be ignored with the false below.
         TestCsiCursorMovement(L'A', uiDistance, false, false, &pDispatch->_cursorUp, mach, *pDispatch);
@@ -1724,6 +1770,7 @@ class StateMachineExternalTest final
         auto pDispatch = dispatch.get();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         mach.ProcessCharacter(AsciiChars::ESC);
         mach.ProcessCharacter(L'[');
@@ -1755,6 +1802,7 @@ class StateMachineExternalTest final
         auto pDispatch = dispatch.get();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         mach.ProcessCharacter(AsciiChars::ESC);
         mach.ProcessCharacter(L'[');
@@ -1776,6 +1824,7 @@ class StateMachineExternalTest final
         auto pDispatch = dispatch.get();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         mach.ProcessCharacter(AsciiChars::ESC);
         mach.ProcessCharacter(L'7');
@@ -1808,6 +1857,7 @@ class StateMachineExternalTest final
         auto pDispatch = dispatch.get();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         pDispatch->_modeEnabled = true;
         mach.ProcessString(L"\x1b[?2l");
@@ -1841,6 +1891,7 @@ class StateMachineExternalTest final
         auto pDispatch = dispatch.get();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         mach.ProcessString(setModeSequence);
         VERIFY_ARE_EQUAL(modeType, pDispatch->_modeType);
@@ -1862,6 +1913,7 @@ class StateMachineExternalTest final
         auto pDispatch = dispatch.get();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         const auto expectedModes = std::vector{ DispatchTypes::DECSCNM_ScreenMode, DispatchTypes::DECCKM_CursorKeysMode, DispatchTypes::DECOM_OriginMode };
 
@@ -1898,6 +1950,7 @@ class StateMachineExternalTest final
         auto pDispatch = dispatch.get();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         switch (uiEraseOperation)
         {
@@ -1953,6 +2006,7 @@ class StateMachineExternalTest final
         auto pDispatch = dispatch.get();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         mach.ProcessString(L"\x1b[3;2J");
         auto expectedEraseTypes = std::vector{ DispatchTypes::EraseType::Scrollback, DispatchTypes::EraseType::All };
@@ -2002,6 +2056,7 @@ class StateMachineExternalTest final
         auto pDispatch = dispatch.get();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         DispatchTypes::GraphicsOptions rgExpected[17];
 
@@ -2166,6 +2221,7 @@ class StateMachineExternalTest final
         auto pDispatch = dispatch.get();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         Log::Comment(L"Test 1: Check operating status (case 5). Should succeed.");
         mach.ProcessCharacter(AsciiChars::ESC);
@@ -2325,6 +2381,7 @@ class StateMachineExternalTest final
         auto pDispatch = dispatch.get();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         Log::Comment(L"Test 1: Check default case, no params.");
         mach.ProcessCharacter(AsciiChars::ESC);
@@ -2362,6 +2419,7 @@ class StateMachineExternalTest final
         auto pDispatch = dispatch.get();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         Log::Comment(L"Test 1: Check default case, no params.");
         mach.ProcessCharacter(AsciiChars::ESC);
@@ -2402,6 +2460,7 @@ class StateMachineExternalTest final
         auto pDispatch = dispatch.get();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         Log::Comment(L"Test 1: Check default case, no params.");
         mach.ProcessCharacter(AsciiChars::ESC);
@@ -2442,6 +2501,7 @@ class StateMachineExternalTest final
         auto pDispatch = dispatch.get();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         Log::Comment(L"Test 1: Check default case, no params.");
         mach.ProcessCharacter(AsciiChars::ESC);
@@ -2480,6 +2540,7 @@ class StateMachineExternalTest final
         auto pDispatch = dispatch.get();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         DispatchTypes::GraphicsOptions rgExpected[16];
         DispatchTypes::EraseType expectedDispatchTypes;
@@ -2590,6 +2651,7 @@ class StateMachineExternalTest final
         auto pDispatch = dispatch.get();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         Log::Comment(L"IND (Index) escape sequence");
         mach.ProcessCharacter(AsciiChars::ESC);
@@ -2640,6 +2702,7 @@ class StateMachineExternalTest final
         auto pDispatch = dispatch.get();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         Log::Comment(L"BEL (Warning Bell) control character");
         mach.ProcessCharacter(AsciiChars::BEL);
@@ -2678,6 +2741,7 @@ class StateMachineExternalTest final
         auto pDispatch = dispatch.get();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         mach.ProcessString(L"\x1b[g");
         auto expectedClearTypes = std::vector{ DispatchTypes::TabClearType::ClearCurrentColumn };
@@ -2707,6 +2771,7 @@ class StateMachineExternalTest final
         auto pDispatch = dispatch.get();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         // ANSI mode must be reset for VT52 sequences to be recognized.
         mach.SetParserMode(StateMachine::Mode::Ansi, false);
@@ -2793,6 +2858,7 @@ class StateMachineExternalTest final
         auto pDispatch = dispatch.get();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         Log::Comment(L"Identify Device in VT52 mode.");
         mach.SetParserMode(StateMachine::Mode::Ansi, false);
@@ -2819,6 +2885,7 @@ class StateMachineExternalTest final
         auto pDispatch = dispatch.get();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         // Single param
         mach.ProcessString(L"\033]10;rgb:1/1/1\033\\");
@@ -2931,6 +2998,7 @@ class StateMachineExternalTest final
         auto pDispatch = dispatch.get();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         mach.ProcessString(L"\033]11;rgb:1/1/1\033\\");
         VERIFY_IS_TRUE(pDispatch->_setDefaultBackground);
@@ -3037,6 +3105,7 @@ class StateMachineExternalTest final
         auto pDispatch = dispatch.get();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         mach.ProcessString(L"\033]4;0;rgb:1/1/1\033\\");
         VERIFY_IS_TRUE(pDispatch->_setColorTableEntry);
@@ -3194,6 +3263,7 @@ class StateMachineExternalTest final
         auto pDispatch = dispatch.get();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         mach.ProcessString(oscPrefix);
         mach.ProcessString(L";Title Text");
@@ -3227,6 +3297,7 @@ class StateMachineExternalTest final
         auto pDispatch = dispatch.get();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         // Passing an empty `Pc` param and a base64-encoded simple text `Pd` param works.
         mach.ProcessString(L"\x1b]52;;Zm9v\x07");
@@ -3310,6 +3381,7 @@ class StateMachineExternalTest final
         auto pDispatch = dispatch.get();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         // First we test with no custom id
         // Process the opening osc 8 sequence
@@ -3392,6 +3464,7 @@ class StateMachineExternalTest final
         auto pDispatch = dispatch.get();
         auto engine = std::make_unique<OutputStateMachineEngine>(std::move(dispatch));
         StateMachine mach(std::move(engine));
+        SelectParserEngine(mach);
 
         Log::Comment(L"C1 parsing disabled: CSI control ignored and rest of sequence printed");
         mach.SetParserMode(StateMachine::Mode::AcceptC1, false);
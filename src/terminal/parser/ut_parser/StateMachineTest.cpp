@@ -31,6 +31,7 @@ public:
     void ResetTestState()
     {
         printed.clear();
+        printedAscii.clear();
         passedThrough.clear();
         executed.clear();
         csiId = 0;
@@ -38,6 +39,8 @@ public:
         dcsId = 0;
         dcsParams.clear();
         dcsDataString.clear();
+        dcsDataChunks.clear();
+        events.clear();
     }
 
     bool EncounteredWin32InputModeSequence() const noexcept override
@@ -48,33 +51,58 @@ public:
     bool ActionExecute(const wchar_t wch) override
     {
         executed += wch;
+        _logEvent(L"execute", { &wch, 1 });
         return true;
     };
 
-    bool ActionExecuteFromEscape(const wchar_t /* wch */) override { return true; };
-    bool ActionPrint(const wchar_t /* wch */) override { return true; };
+    bool ActionExecuteFromEscape(const wchar_t wch) override
+    {
+        _logEvent(L"executeFromEscape", { &wch, 1 });
+        return true;
+    };
+    bool ActionPrint(const wchar_t wch) override
+    {
+        _logEvent(L"print", { &wch, 1 });
+        return true;
+    };
     bool ActionPrintString(const std::wstring_view string) override
     {
         printed += string;
+        _logEvent(L"print", string);
         return true;
     };
 
+    bool ActionPrintAsciiString(const std::wstring_view string) override
+    {
+        printedAscii += string;
+        return ActionPrintString(string);
+    };
+
     bool ActionPassThroughString(const std::wstring_view string, const bool /*flush*/) override
     {
         passedThrough += string;
         return true;
     };
 
-    bool ActionEscDispatch(const VTID /* id */) override { return true; };
+    bool ActionEscDispatch(const VTID id) override
+    {
+        _logEvent(L"esc", {}, id);
+        return true;
+    };
 
-    bool ActionVt52EscDispatch(const VTID /*id*/, const VTParameters /*parameters*/) override { return true; };
+    bool ActionVt52EscDispatch(const VTID id, const VTParameters parameters) override
+    {
+        _logEvent(L"vt52", {}, id, parameters);
+        return true;
+    };
 
     bool ActionClear() override { return true; };
 
     bool ActionIgnore() override { return true; };
 
-    bool ActionOscDispatch(const size_t /* parameter */, const std::wstring_view /* string */) override
+    bool ActionOscDispatch(const size_t parameter, const std::wstring_view string) override
     {
+        _logEvent(L"osc", string, parameter);
         if (pfnFlushToTerminal)
         {
             pfnFlushToTerminal();
@@ -83,11 +111,16 @@ public:
         return true;
     };
 
-    bool ActionSs3Dispatch(const wchar_t /* wch */, const VTParameters /* parameters */) override { return true; };
+    bool ActionSs3Dispatch(const wchar_t wch, const VTParameters parameters) override
+    {
+        _logEvent(L"ss3", { &wch, 1 }, 0, parameters);
+        return true;
+    };
 
     // ActionCsiDispatch is the only method that's actually implemented.
     bool ActionCsiDispatch(const VTID id, const VTParameters parameters) override
     {
+        _logEvent(L"csi", {}, id, parameters);
         // If flush to terminal is registered for a test, then use it.
         if (pfnFlushToTerminal)
         {
@@ -107,13 +140,20 @@ public:
 
     IStateMachineEngine::StringHandler ActionDcsDispatch(const VTID id, const VTParameters parameters) override
     {
+        _logEvent(L"dcs", {}, id, parameters);
         dcsId = id;
         for (size_t i = 0; i < parameters.size(); i++)
         {
             dcsParams.push_back(parameters.at(i).value_or(0));
         }
         dcsDataString.clear();
-        return [=](const auto ch) { dcsDataString += ch; return true; };
+        dcsDataChunks.clear();
+        return [=](const auto str) {
+            dcsDataString += str;
+            dcsDataChunks.emplace_back(str);
+            _logEvent(L"data", str);
+            return true;
+        };
     }
 
     // These will only be populated if ActionCsiDispatch is called.
@@ -128,6 +168,8 @@ public:
 
     // Printed string.
     std::wstring printed;
+    // The part of the printed string that was printed via ActionPrintAsciiString.
+    std::wstring printedAscii;
 
     // Executed string.
     std::wstring executed;
@@ -136,6 +178,26 @@ public:
     uint64_t dcsId = 0;
     std::vector<size_t> dcsParams;
     std::wstring dcsDataString;
+    std::vector<std::wstring> dcsDataChunks;
+
+    // A log of all dispatched actions, one per line.
+    std::wstring events;
+
+private:
+    void _logEvent(const std::wstring_view action, const std::wstring_view string, const uint64_t id = 0, const VTParameters parameters = {})
+    {
+        events.append(action);
+        events.append(L" ");
+        events.append(std::to_wstring(id));
+        for (size_t i = 0; i < parameters.size(); i++)
+        {
+            events.append(L";");
+            events.append(std::to_wstring(parameters.at(i).value_or(-1)));
+        }
+        events.append(L" ");
+        events.append(string);
+        events.append(L"\n");
+    }
 };
 
 class Microsoft::Console::VirtualTerminal::StateMachineTest
@@ -157,9 +219,15 @@ class Microsoft::Console::VirtualTerminal::StateMachineTest
     TEST_METHOD(PassThroughUnhandled);
     TEST_METHOD(RunStorageBeforeEscape);
     TEST_METHOD(BulkTextPrint);
+    TEST_METHOD(BulkTextPrintClassifiesAscii);
     TEST_METHOD(PassThroughUnhandledSplitAcrossWrites);
+    TEST_METHOD(ProcessUtf8MatchesProcessString);
 
     TEST_METHOD(DcsDataStringsReceivedByHandler);
+    TEST_METHOD(DcsDataStringsReceivedInBulk);
+
+    TEST_METHOD(TableDrivenMatchesEventFunctions);
+    TEST_METHOD(ReplayMatchesProcessString);
 
     TEST_METHOD(VtParameterSubspanTest);
 };
@@ -234,6 +302,37 @@ void StateMachineTest::BulkTextPrint()
     VERIFY_ARE_EQUAL(String(L"12345 Hello World"), String(engine.printed.c_str()));
 }
 
+void StateMachineTest::BulkTextPrintClassifiesAscii()
+{
+    auto enginePtr{ std::make_unique<TestStateMachineEngine>() };
+    // this dance is required because StateMachine presumes to take ownership of its engine.
+    auto& engine{ *enginePtr.get() };
+    StateMachine machine{ std::move(enginePtr) };
+
+    // The ground state scanner processes 16 and 8 characters at a time, followed by a scalar tail.
+    // These lengths cover all of those, with a non-ASCII character in every possible position.
+    // The trailing BEL and non-ASCII character must not affect the classification of the run before them.
+    for (size_t length = 1; length <= 40; ++length)
+    {
+        for (size_t position = 0; position <= length; ++position)
+        {
+            std::wstring run(length, L'a');
+            if (position < length)
+            {
+                run[position] = L'\u00e4';
+            }
+
+            engine.ResetTestState();
+            machine.ProcessString(run + L"\a\u00e4");
+
+            NoThrowString message;
+            message.Format(L"length %zu, position %zu", length, position);
+            VERIFY_ARE_EQUAL(run + L"\u00e4", engine.printed, message);
+            VERIFY_ARE_EQUAL(position < length ? std::wstring{} : run, engine.printedAscii, message);
+        }
+    }
+}
+
 void StateMachineTest::PassThroughUnhandledSplitAcrossWrites()
 {
     auto enginePtr{ std::make_unique<TestStateMachineEngine>() };
@@ -280,6 +379,90 @@ void StateMachineTest::PassThroughUnhandledSplitAcrossWrites()
     VERIFY_ARE_EQUAL(L"", engine.printed);
 }
 
+void StateMachineTest::ProcessUtf8MatchesProcessString()
+{
+    // Mixed ASCII/CJK/emoji text with SGR sequences, a C1 CSI and U+00A0 (whose
+    // lead byte 0xC2 is shared with the C1 controls), controls and a DCS string.
+    std::wstring text;
+    for (size_t y = 0; y < 4096; ++y)
+    {
+        text.append(L"\x1b[38;5;");
+        text.append(std::to_wstring(y % 256));
+        text.append(L"mlorem ipsum dolor sit amet");
+        if (y % 3 == 0)
+        {
+            text.append(L" \u732B\u732B \U0001F600\u00e4\u00a0");
+        }
+        if (y % 5 == 0)
+        {
+            text.append(L"\u009b1;2H\a");
+        }
+        if (y % 11 == 0)
+        {
+            text.append(L"\x1bP1;2|\u732B\U0001F600\x1b\\");
+        }
+        text.append(L"\x1b[m\r\n");
+    }
+    const auto utf8 = til::u16u8(text);
+
+    // Splitting the input at every possible boundary makes sure that
+    // code points and sequences are correctly carried over between calls.
+    for (const size_t chunkSize : { 1, 2, 3, 7, 16, 17, 4093, 0 })
+    {
+        auto expectedEnginePtr{ std::make_unique<TestStateMachineEngine>() };
+        auto& expectedEngine{ *expectedEnginePtr.get() };
+        StateMachine expectedMachine{ std::move(expectedEnginePtr) };
+
+        auto actualEnginePtr{ std::make_unique<TestStateMachineEngine>() };
+        auto& actualEngine{ *actualEnginePtr.get() };
+        StateMachine actualMachine{ std::move(actualEnginePtr) };
+
+        const auto step = chunkSize ? chunkSize : utf8.size();
+        til::u8state state;
+        std::wstring wide;
+
+        const auto transcodeBeg = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < utf8.size(); i += step)
+        {
+            const auto chunk = std::string_view{ utf8 }.substr(i, step);
+            THROW_IF_FAILED(til::u8u16(chunk, wide, state));
+            expectedMachine.ProcessString(wide);
+        }
+        const auto transcodeEnd = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < utf8.size(); i += step)
+        {
+            actualMachine.ProcessUtf8(std::string_view{ utf8 }.substr(i, step));
+        }
+        const auto utf8End = std::chrono::steady_clock::now();
+
+        Log::Comment(NoThrowString().Format(
+            L"%zu bytes in chunks of %zu: u8u16 + ProcessString %lldus, ProcessUtf8 %lldus",
+            utf8.size(),
+            step,
+            std::chrono::duration_cast<std::chrono::microseconds>(transcodeEnd - transcodeBeg).count(),
+            std::chrono::duration_cast<std::chrono::microseconds>(utf8End - transcodeEnd).count()));
+
+        VERIFY_ARE_EQUAL(expectedEngine.printed, actualEngine.printed);
+        VERIFY_ARE_EQUAL(expectedEngine.executed, actualEngine.executed);
+        VERIFY_ARE_EQUAL(expectedEngine.csiParams, actualEngine.csiParams);
+        VERIFY_ARE_EQUAL(expectedEngine.dcsDataString, actualEngine.dcsDataString);
+    }
+
+    // Partial sequences must still be cached for the pass-through, just like in ProcessString.
+    auto enginePtr{ std::make_unique<TestStateMachineEngine>() };
+    auto& engine{ *enginePtr.get() };
+    StateMachine machine{ std::move(enginePtr) };
+    engine.pfnFlushToTerminal = std::bind(&StateMachine::FlushToTerminal, &machine);
+
+    machine.ProcessUtf8("\x1b[?12");
+    VERIFY_ARE_EQUAL(L"", engine.passedThrough);
+    machine.ProcessUtf8("34h\xe7\x8c");
+    VERIFY_ARE_EQUAL(L"\x1b[?1234h", engine.passedThrough);
+    VERIFY_ARE_EQUAL(L"", engine.printed);
+    machine.ProcessUtf8("\xab");
+    VERIFY_ARE_EQUAL(L"\u732B", engine.printed);
+}
+
 void StateMachineTest::DcsDataStringsReceivedByHandler()
 {
     BEGIN_TEST_METHOD_PROPERTIES()
@@ -343,6 +526,169 @@ void StateMachineTest::DcsDataStringsReceivedByHandler()
     VERIFY_ARE_EQUAL(expectedExecuted, engine.executed);
 }
 
+void StateMachineTest::DcsDataStringsReceivedInBulk()
+{
+    auto enginePtr{ std::make_unique<TestStateMachineEngine>() };
+    // this dance is required because StateMachine presumes to take ownership of its engine.
+    auto& engine{ *enginePtr.get() };
+    StateMachine machine{ std::move(enginePtr) };
+
+    // C0 controls are part of the data string, but a DEL is ignored and splits it up.
+    const auto data = std::wstring(4096, L'x') + L"\r\n" + std::wstring(4096, L'y');
+    const auto expectedChunks = std::vector<std::wstring>{ data, L"z", L"\033" };
+
+    machine.ProcessString(L"\033P1;2;3|" + data + L"\x7fz\033\\");
+    VERIFY_ARE_EQUAL(data + L"z\033", engine.dcsDataString);
+    VERIFY_ARE_EQUAL(expectedChunks.size(), engine.dcsDataChunks.size());
+    for (size_t i = 0; i < expectedChunks.size(); ++i)
+    {
+        VERIFY_ARE_EQUAL(expectedChunks[i], engine.dcsDataChunks[i]);
+    }
+
+    machine.ProcessUtf8("\033P1;2;3|" + til::u16u8(data) + "\x7fz\033\\");
+    VERIFY_ARE_EQUAL(data + L"z\033", engine.dcsDataString);
+    VERIFY_ARE_EQUAL(expectedChunks.size(), engine.dcsDataChunks.size());
+    for (size_t i = 0; i < expectedChunks.size(); ++i)
+    {
+        VERIFY_ARE_EQUAL(expectedChunks[i], engine.dcsDataChunks[i]);
+    }
+}
+
+void StateMachineTest::TableDrivenMatchesEventFunctions()
+{
+    // Escape-dense output, similar to what htop or a vim redraw produce:
+    // cursor positioning, SGR sequences, erasures, charset designations,
+    // window titles, DECRQSS queries, SS3 keys and VT52 cursor addressing.
+    std::wstring realistic;
+    for (auto y = 0; y < 2000; ++y)
+    {
+        realistic.append(L"\x1b[" + std::to_wstring(y % 50 + 1) + L";1H\x1b[K");
+        realistic.append(L"\x1b[1;38;2;" + std::to_wstring(y % 256) + L";0;255;48:5:" + std::to_wstring(y % 16) + L"m");
+        realistic.append(L"  PID USER      PRI  NI  VIRT   RES\x1b[0m\x1b[?25l\x1b(B\x1b[30;42m 1.5%\x1b[m\r\n");
+        if (y % 7 == 0)
+        {
+            realistic.append(L"\x1b]0;vim - file" + std::to_wstring(y) + L".txt\a\x1b]8;;https://example.com\x1b\\");
+        }
+        if (y % 13 == 0)
+        {
+            realistic.append(L"\x1bP$qm\x1b\\\x1bOA\x1bY!!\x1b[?1049h\x1b[2J\x1b[1;24r");
+        }
+    }
+
+    // Random input over an alphabet with a character from every class, so
+    // that every state sees every class, including the invalid combinations.
+    static constexpr std::wstring_view alphabet{ L"\x01\x07\x18\x1a\x1b\x1b\x1b\x1b\r !$(0123456789:;;<=>?@HOPXY[[[[\\]]^_muz\x7f\x9b\x9c\x9d\x90\xa0\u732B" };
+    std::wstring random;
+    uint32_t seed = 0x12345678;
+    for (auto i = 0; i < 200000; ++i)
+    {
+        seed = seed * 1664525 + 1013904223;
+        random.push_back(alphabet[(seed >> 16) % alphabet.size()]);
+    }
+
+    const auto run = [](const std::wstring_view text, const bool tableDriven, const bool isEngineForInput, const bool ansi, const bool acceptC1) {
+        auto enginePtr{ std::make_unique<TestStateMachineEngine>() };
+        auto& engine{ *enginePtr.get() };
+        StateMachine machine{ std::unique_ptr<IStateMachineEngine>{ std::move(enginePtr) }, isEngineForInput };
+        machine.SetParserMode(StateMachine::Mode::TableDriven, tableDriven);
+        machine.SetParserMode(StateMachine::Mode::Ansi, ansi);
+        machine.SetParserMode(StateMachine::Mode::AcceptC1, acceptC1);
+
+        const auto beg = std::chrono::steady_clock::now();
+        // Splitting the input also covers the handling of incomplete sequences.
+        for (size_t i = 0; i < text.size(); i += 4093)
+        {
+            machine.ProcessString(text.substr(i, 4093));
+        }
+        const auto end = std::chrono::steady_clock::now();
+
+        return std::pair{ std::move(engine.events), std::chrono::duration_cast<std::chrono::microseconds>(end - beg).count() };
+    };
+
+    for (const auto isEngineForInput : { false, true })
+    {
+        for (const auto ansi : { true, false })
+        {
+            for (const auto acceptC1 : { false, true })
+            {
+                for (const auto text : { std::wstring_view{ realistic }, std::wstring_view{ random } })
+                {
+                    const auto [expected, expectedTime] = run(text, false, isEngineForInput, ansi, acceptC1);
+                    const auto [actual, actualTime] = run(text, true, isEngineForInput, ansi, acceptC1);
+
+                    Log::Comment(NoThrowString().Format(
+                        L"%s input=%d ansi=%d c1=%d: _Event* functions %lldus, transition table %lldus",
+                        text.data() == realistic.data() ? L"realistic" : L"random",
+                        isEngineForInput,
+                        ansi,
+                        acceptC1,
+                        expectedTime,
+                        actualTime));
+
+                    VERIFY_IS_FALSE(expected.empty());
+                    VERIFY_IS_TRUE(expected == actual);
+                }
+            }
+        }
+    }
+}
+
+void StateMachineTest::ReplayMatchesProcessString()
+{
+    // Text and controls, and every kind of sequence, including sub parameters,
+    // DCS data, C1 controls, and an unhandled sequence that is passed through.
+    // The last one ends in the middle of a sequence, so it can't be replayed.
+    static constexpr std::wstring_view strings[] = {
+        L"Hello\r\nWorld\a",
+        L"\x1b[1;38;2;255;0;0;48:5:12mRed\x1b[m\x1b[?999h",
+        L"\x1b]0;Title\a\x1b]8;;https://example.com\x1b\\",
+        L"\x1bP1;2;3|data\r\nmore\x7f data\x1b\\\x1bP$qm\x9c",
+        L"\x1bOA\x1b(B\x1b#8\x9b" L"2J\x1bY!!\u732b",
+        L"text\x1b[?999",
+    };
+
+    const auto run = [](const std::wstring_view text, const bool replay, const bool ansi, const bool acceptC1) {
+        auto enginePtr{ std::make_unique<TestStateMachineEngine>() };
+        auto& engine{ *enginePtr.get() };
+        StateMachine machine{ std::move(enginePtr) };
+        engine.pfnFlushToTerminal = std::bind(&StateMachine::FlushToTerminal, &machine);
+        machine.SetParserMode(StateMachine::Mode::Ansi, ansi);
+        machine.SetParserMode(StateMachine::Mode::AcceptC1, acceptC1);
+
+        // Replaying the same recording twice must give the same results twice.
+        const auto recording = machine.Record(text);
+        for (auto i = 0; i < 2; ++i)
+        {
+            if (replay)
+            {
+                machine.Replay(recording, text);
+            }
+            else
+            {
+                machine.ProcessString(text);
+            }
+            // Anything that follows must continue from the same parser state.
+            machine.ProcessString(L"1mtail\r\n");
+        }
+        return std::pair{ std::move(engine.events), std::move(engine.passedThrough) };
+    };
+
+    for (const auto ansi : { true, false })
+    {
+        for (const auto acceptC1 : { false, true })
+        {
+            for (const auto text : strings)
+            {
+                const auto [expected, expectedPassedThrough] = run(text, false, ansi, acceptC1);
+                const auto [actual, actualPassedThrough] = run(text, true, ansi, acceptC1);
+                VERIFY_IS_FALSE(expected.empty());
+                VERIFY_ARE_EQUAL(expected, actual);
+                VERIFY_ARE_EQUAL(expectedPassedThrough, actualPassedThrough);
+            }
+        }
+    }
+}
+
 void StateMachineTest::VtParameterSubspanTest()
 {
     const auto parameterList = std::vector<VTParameter>{ 12, 34, 56, 78 };
@@ -21,6 +21,17 @@ struct BenchmarkContext
     std::string_view utf8_128Ki;
     std::wstring_view utf16_4Ki;
     std::wstring_view utf16_128Ki;
+    std::wstring_view utf16_sgr_128Ki;
+    std::wstring_view utf16_cat_128Ki;
+    std::wstring_view utf16_htop_128Ki;
+    std::wstring_view utf16_ls_128Ki;
+    std::wstring_view utf16_diff_128Ki;
+    std::wstring_view utf16_decdmac_128Ki;
+    std::wstring_view utf16_decdmac_4Ki;
+    std::wstring_view utf16_decinvm_10k;
+    std::wstring_view utf16_reports_4Ki;
+    std::wstring_view utf16_rect_ops;
+    std::wstring_view utf16_sixel_800x600;
 };
 
 struct Benchmark
@@ -111,6 +122,247 @@ static constexpr Benchmark s_benchmarks[]{
             }
         },
     },
+    Benchmark{
+        // Mimics `cat`ing a source file: Short lines of plain ASCII, separated by CRLFs.
+        // The payload size is fixed and so this doubles as a measure of the parser's throughput.
+        .title = "WriteConsoleW cat 128Ki",
+        .exec = [](const BenchmarkContext& ctx, Measurements measurements) {
+            for (auto& d : measurements)
+            {
+                const auto beg = query_perf_counter();
+                WriteConsoleW(ctx.output, ctx.utf16_cat_128Ki.data(), static_cast<DWORD>(ctx.utf16_cat_128Ki.size()), nullptr, nullptr);
+                const auto end = query_perf_counter();
+                d = perf_delta(beg, end);
+
+                if (end >= ctx.time_limit)
+                {
+                    break;
+                }
+            }
+        },
+    },
+    Benchmark{
+        // A single DCS sequence with a large data string (a macro definition),
+        // which measures how fast the parser hands over data strings.
+        .title = "WriteConsoleW DECDMAC 128Ki",
+        .exec = [](const BenchmarkContext& ctx, Measurements measurements) {
+            for (auto& d : measurements)
+            {
+                const auto beg = query_perf_counter();
+                WriteConsoleW(ctx.output, ctx.utf16_decdmac_128Ki.data(), static_cast<DWORD>(ctx.utf16_decdmac_128Ki.size()), nullptr, nullptr);
+                const auto end = query_perf_counter();
+                d = perf_delta(beg, end);
+
+                if (end >= ctx.time_limit)
+                {
+                    break;
+                }
+            }
+        },
+    },
+    Benchmark{
+        // Invokes a 4Ki macro 10k times in a single write. After the first invocation
+        // the parser replays its recording of the macro instead of parsing it again.
+        .title = "WriteConsoleW DECINVM 4Ki x 10k",
+        .exec = [](const BenchmarkContext& ctx, Measurements measurements) {
+            WriteConsoleW(ctx.output, ctx.utf16_decdmac_4Ki.data(), static_cast<DWORD>(ctx.utf16_decdmac_4Ki.size()), nullptr, nullptr);
+
+            for (auto& d : measurements)
+            {
+                const auto beg = query_perf_counter();
+                WriteConsoleW(ctx.output, ctx.utf16_decinvm_10k.data(), static_cast<DWORD>(ctx.utf16_decinvm_10k.size()), nullptr, nullptr);
+                const auto end = query_perf_counter();
+                d = perf_delta(beg, end);
+
+                if (end >= ctx.time_limit)
+                {
+                    break;
+                }
+            }
+        },
+    },
+    Benchmark{
+        // CPR, DECXCPR and DECRQM queries, like a TUI framework polling the terminal.
+        // This measures how fast reports are generated and queued as input.
+        .title = "WriteConsoleW CPR/DECRQM 4Ki",
+        .exec = [](const BenchmarkContext& ctx, Measurements measurements) {
+            for (auto& d : measurements)
+            {
+                const auto beg = query_perf_counter();
+                WriteConsoleW(ctx.output, ctx.utf16_reports_4Ki.data(), static_cast<DWORD>(ctx.utf16_reports_4Ki.size()), nullptr, nullptr);
+                const auto end = query_perf_counter();
+                d = perf_delta(beg, end);
+
+                FlushConsoleInputBuffer(ctx.input);
+
+                if (end >= ctx.time_limit)
+                {
+                    break;
+                }
+            }
+        },
+    },
+    Benchmark{
+        // A 800x600 Sixel image with 4 colors per band, without any repeat
+        // compression, which measures the decoder and the image layer.
+        .title = "WriteConsoleW Sixel 800x600",
+        .exec = [](const BenchmarkContext& ctx, Measurements measurements) {
+            for (auto& d : measurements)
+            {
+                const auto beg = query_perf_counter();
+                WriteConsoleW(ctx.output, ctx.utf16_sixel_800x600.data(), static_cast<DWORD>(ctx.utf16_sixel_800x600.size()), nullptr, nullptr);
+                const auto end = query_perf_counter();
+                d = perf_delta(beg, end);
+
+                if (end >= ctx.time_limit)
+                {
+                    break;
+                }
+            }
+        },
+    },
+    Benchmark{
+        .title = "WriteConsoleW SGR 128Ki",
+        .exec = [](const BenchmarkContext& ctx, Measurements measurements) {
+            for (auto& d : measurements)
+            {
+                const auto beg = query_perf_counter();
+                WriteConsoleW(ctx.output, ctx.utf16_sgr_128Ki.data(), static_cast<DWORD>(ctx.utf16_sgr_128Ki.size()), nullptr, nullptr);
+                const auto end = query_perf_counter();
+                d = perf_delta(beg, end);
+
+                if (end >= ctx.time_limit)
+                {
+                    break;
+                }
+            }
+        },
+    },
+    Benchmark{
+        // Short runs of text between cursor positioning, SGR and mode sequences,
+        // like htop or a vim redraw. This mostly measures the parser's state transitions.
+        .title = "WriteConsoleW htop 128Ki",
+        .exec = [](const BenchmarkContext& ctx, Measurements measurements) {
+            for (auto& d : measurements)
+            {
+                const auto beg = query_perf_counter();
+                WriteConsoleW(ctx.output, ctx.utf16_htop_128Ki.data(), static_cast<DWORD>(ctx.utf16_htop_128Ki.size()), nullptr, nullptr);
+                const auto end = query_perf_counter();
+                d = perf_delta(beg, end);
+
+                if (end >= ctx.time_limit)
+                {
+                    break;
+                }
+            }
+        },
+    },
+    Benchmark{
+        // Mimics `ls --color`: File names wrapped in the same few SGR sequences over and over.
+        // This mostly measures how fast repeated SGR sequences are applied.
+        .title = "WriteConsoleW ls 128Ki",
+        .exec = [](const BenchmarkContext& ctx, Measurements measurements) {
+            for (auto& d : measurements)
+            {
+                const auto beg = query_perf_counter();
+                WriteConsoleW(ctx.output, ctx.utf16_ls_128Ki.data(), static_cast<DWORD>(ctx.utf16_ls_128Ki.size()), nullptr, nullptr);
+                const auto end = query_perf_counter();
+                d = perf_delta(beg, end);
+
+                if (end >= ctx.time_limit)
+                {
+                    break;
+                }
+            }
+        },
+    },
+    Benchmark{
+        // Mimics `git diff --color`: Whole lines colored by a handful of SGR sequences.
+        .title = "WriteConsoleW diff 128Ki",
+        .exec = [](const BenchmarkContext& ctx, Measurements measurements) {
+            for (auto& d : measurements)
+            {
+                const auto beg = query_perf_counter();
+                WriteConsoleW(ctx.output, ctx.utf16_diff_128Ki.data(), static_cast<DWORD>(ctx.utf16_diff_128Ki.size()), nullptr, nullptr);
+                const auto end = query_perf_counter();
+                d = perf_delta(beg, end);
+
+                if (end >= ctx.time_limit)
+                {
+                    break;
+                }
+            }
+        },
+    },
+    Benchmark{
+        // Fills, copies, inserts, deletes and selectively erases full-width rectangles
+        // (DECFRA, DECIC/DECDC, ICH/DCH, DECCRA, DECSERA) in a 400 column buffer.
+        // This measures the per-row cost of the rectangular area operations.
+        .title = "WriteConsoleW rectangular ops 400 columns",
+        .exec = [](const BenchmarkContext& ctx, Measurements measurements) {
+            SetConsoleScreenBufferSize(ctx.output, { 400, 9001 });
+
+            for (auto& d : measurements)
+            {
+                const auto beg = query_perf_counter();
+                WriteConsoleW(ctx.output, ctx.utf16_rect_ops.data(), static_cast<DWORD>(ctx.utf16_rect_ops.size()), nullptr, nullptr);
+                const auto end = query_perf_counter();
+                d = perf_delta(beg, end);
+
+                if (end >= ctx.time_limit)
+                {
+                    break;
+                }
+            }
+
+            SetConsoleScreenBufferSize(ctx.output, { 120, 9001 });
+        },
+    },
+    Benchmark{
+        .title = "Reflow 9001 rows",
+        .exec = [](const BenchmarkContext& ctx, Measurements measurements) {
+            // Fill the buffer with lines that are 0%, 10%, 50% and 90% full. Reflow has to measure
+            // each row's trailing whitespace, which makes this a good test for ROW::MeasureRight().
+            {
+                const auto scratch = mem::get_scratch_arena(ctx.arena);
+                static constexpr size_t fills[]{ 0, 12, 60, 108 };
+                static constexpr size_t lines = 9001;
+                const auto buf = scratch.arena.push_uninitialized<char>(lines * (108 + 2));
+                auto p = buf;
+
+                for (size_t i = 0; i < lines; ++i)
+                {
+                    const auto fill = fills[i % std::size(fills)];
+                    memset(p, 'x', fill);
+                    p += fill;
+                    *p++ = '\r';
+                    *p++ = '\n';
+                }
+
+                WriteFile(ctx.output, buf, static_cast<DWORD>(p - buf), nullptr, nullptr);
+            }
+
+            SHORT width = 120;
+
+            for (auto& d : measurements)
+            {
+                // The window is 120 columns wide and the buffer can't be narrower than that.
+                width = width == 120 ? 121 : 120;
+
+                const auto beg = query_perf_counter();
+                SetConsoleScreenBufferSize(ctx.output, { width, 9001 });
+                const auto end = query_perf_counter();
+                d = perf_delta(beg, end);
+
+                if (end >= ctx.time_limit)
+                {
+                    break;
+                }
+            }
+
+            SetConsoleScreenBufferSize(ctx.output, { 120, 9001 });
+        },
+    },
     Benchmark{
         .title = "Copy to clipboard 4Ki",
         .exec = [](const BenchmarkContext& ctx, Measurements measurements) {
@@ -188,11 +440,23 @@ static constexpr size_t s_benchmarks_count = _countof(s_benchmarks);
 
 // Each of these strings is 128 columns.
 static constexpr std::string_view payload_utf8{ "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor incididunt ut labor眠い子猫はマグロ狩りの夢を見る" };
+// Many short runs with distinct colors. This stresses the attribute storage of the text buffer.
+static constexpr std::wstring_view payload_sgr_utf16{ L"\x1b[31mLorem \x1b[32mipsum \x1b[1;33mdolor \x1b[22;34msit \x1b[35;4mamet, \x1b[24;36mconsectetur \x1b[38;5;208madipiscing \x1b[38;2;255;128;64melit\x1b[m " };
+static constexpr std::wstring_view payload_cat_utf16{ L"#include <stdio.h>\r\n\r\nint main(int argc, char** argv)\r\n{\r\n    for (int i = 1; i < argc; i++)\r\n    {\r\n        puts(argv[i]);\r\n    }\r\n    return 0;\r\n}\r\n\r\n" };
+static constexpr std::wstring_view payload_htop_utf16{ L"\x1b[?25l\x1b[3;1H\x1b[K\x1b[1;36m  1\x1b[m\x1b[1;37m[\x1b[32m||||\x1b[31m|\x1b[90m   \x1b[37m5.2%\x1b[1;37m]\x1b[4;60H\x1b[30;46mPID\x1b[m \x1b[7m1337\x1b[27m\x1b(B\x1b[?25h" };
+static constexpr std::wstring_view payload_ls_utf16{ L"\x1b[0m\x1b[01;34mbuild\x1b[0m  \x1b[01;32mconfigure\x1b[0m  README.md  \x1b[01;36mlatest\x1b[0m  \x1b[01;31mrelease.tar.gz\x1b[0m  \x1b[01;34msrc\x1b[0m  \x1b[01;32mtest.sh\x1b[0m\r\n" };
+static constexpr std::wstring_view payload_diff_utf16{ L"\x1b[1mdiff --git a/main.c b/main.c\x1b[m\r\n\x1b[36m@@ -1,4 +1,4 @@\x1b[m\r\n int main(void)\r\n\x1b[31m-    return 1;\x1b[m\r\n\x1b[32m+\x1b[m\x1b[32m    return 0;\x1b[m\r\n }\r\n" };
+static constexpr std::wstring_view payload_decinvm_utf16{ L"\x1b[1*z" };
+static constexpr std::wstring_view payload_reports_utf16{ L"\x1b[6n\x1b[?6n\x1b[?1$p\x1b[?2004$p" };
+static constexpr std::wstring_view payload_rect_utf16{ L"\x1b[42;1;1;50;400$x\x1b[1;1H\x1b[8'}\x1b[8'~\x1b[25;1H\x1b[16@\x1b[16P\x1b[1;1;25;400;1;26;3;1$v\x1b[1;1;50;400${" };
 static constexpr std::wstring_view payload_utf16{ L"Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor incididunt ut labor眠い子猫はマグロ狩りの夢を見る" };
 
 static bool print_warning();
 static AccumulatedResults* prepare_results(mem::Arena& arena, std::span<const wchar_t*> paths);
 static std::span<Measurements> run_benchmarks_for_path(mem::Arena& arena, const wchar_t* path);
+static std::wstring_view define_macro(mem::Arena& arena, std::wstring_view in, size_t count);
+static std::wstring_view sixel_image(mem::Arena& arena, size_t width, size_t bands);
+static int64_t private_bytes(HWND hwnd);
 static void generate_html(mem::Arena& arena, const AccumulatedResults* results);
 
 int wmain(int argc, const wchar_t* argv[])
@@ -382,6 +646,17 @@ static std::span<Measurements> run_benchmarks_for_path(mem::Arena& arena, const
         .utf8_128Ki = mem::repeat_string(scratch.arena, payload_utf8, 128 * 1024 / 128),
         .utf16_4Ki = mem::repeat_string(scratch.arena, payload_utf16, 4 * 1024 / 128),
         .utf16_128Ki = mem::repeat_string(scratch.arena, payload_utf16, 128 * 1024 / 128),
+        .utf16_sgr_128Ki = mem::repeat_string(scratch.arena, payload_sgr_utf16, 128 * 1024 / payload_sgr_utf16.size()),
+        .utf16_cat_128Ki = mem::repeat_string(scratch.arena, payload_cat_utf16, 128 * 1024 / payload_cat_utf16.size()),
+        .utf16_htop_128Ki = mem::repeat_string(scratch.arena, payload_htop_utf16, 128 * 1024 / payload_htop_utf16.size()),
+        .utf16_ls_128Ki = mem::repeat_string(scratch.arena, payload_ls_utf16, 128 * 1024 / payload_ls_utf16.size()),
+        .utf16_diff_128Ki = mem::repeat_string(scratch.arena, payload_diff_utf16, 128 * 1024 / payload_diff_utf16.size()),
+        .utf16_decdmac_128Ki = define_macro(scratch.arena, payload_cat_utf16, 128 * 1024 / payload_cat_utf16.size()),
+        .utf16_decdmac_4Ki = define_macro(scratch.arena, payload_cat_utf16, 4 * 1024 / payload_cat_utf16.size()),
+        .utf16_decinvm_10k = mem::repeat_string(scratch.arena, payload_decinvm_utf16, 10000),
+        .utf16_reports_4Ki = mem::repeat_string(scratch.arena, payload_reports_utf16, 4 * 1024 / payload_reports_utf16.size()),
+        .utf16_rect_ops = mem::repeat_string(scratch.arena, payload_rect_utf16, 64),
+        .utf16_sixel_800x600 = sixel_image(scratch.arena, 800, 100),
     };
 
     prepare_conhost(ctx, parent_hwnd);
@@ -420,10 +695,97 @@ static std::span<Measurements> run_benchmarks_for_path(mem::Arena& arena, const
         print_with_parent_connection(", done\r\n");
     }
 
+    // The charts only show timings, so the memory usage is printed instead. It's measured after
+    // filling the entire 9001 rows of the buffer with colorful output, which moves all but
+    // the bottom rows into the cold scrollback tier (if the conhost has one). Since
+    // prepare_conhost() committed the whole buffer already, the delta is the growth
+    // (or shrinkage) caused by the text and its attributes.
+    {
+        print_with_parent_connection("- Private bytes after 9001 rows of SGR");
+
+        WriteConsoleW(ctx.output, L"\033c", 2, nullptr, nullptr);
+        const auto before = private_bytes(ctx.hwnd);
+        // Each write is roughly 470 rows of 120 columns.
+        for (int i = 0; i < 24; ++i)
+        {
+            WriteConsoleW(ctx.output, ctx.utf16_sgr_128Ki.data(), static_cast<DWORD>(ctx.utf16_sgr_128Ki.size()), nullptr, nullptr);
+        }
+        const auto after = private_bytes(ctx.hwnd);
+
+        print_with_parent_connection(": %lld KiB (%+lld KiB)\r\n", after / 1024, (after - before) / 1024);
+    }
+
     set_active_connection(parent_connection);
     return results;
 }
 
+// Returns the private bytes of the process that owns the given console window.
+static int64_t private_bytes(HWND hwnd)
+{
+    DWORD pid = 0;
+    GetWindowThreadProcessId(hwnd, &pid);
+    const wil::unique_handle process{ THROW_LAST_ERROR_IF_NULL(OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid)) };
+
+    PROCESS_MEMORY_COUNTERS_EX counters{};
+    THROW_IF_WIN32_BOOL_FALSE(GetProcessMemoryInfo(process.get(), reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&counters), sizeof(counters)));
+    return static_cast<int64_t>(counters.PrivateUsage);
+}
+
+// Wraps `count` repetitions of `in` into a DECDMAC sequence, defining it as the text of macro 1.
+static std::wstring_view define_macro(mem::Arena& arena, std::wstring_view in, size_t count)
+{
+    static constexpr std::wstring_view prefix{ L"\x1bP1;0;0!z" };
+    static constexpr std::wstring_view suffix{ L"\x1b\\" };
+
+    const auto len = prefix.size() + count * in.size() + suffix.size();
+    const auto buf = arena.push_uninitialized<wchar_t>(len);
+    auto it = buf;
+
+    mem::copy(it, prefix.data(), prefix.size());
+    it += prefix.size();
+    for (size_t i = 0; i < count; ++i)
+    {
+        mem::copy(it, in.data(), in.size());
+        it += in.size();
+    }
+    mem::copy(it, suffix.data(), suffix.size());
+
+    return { buf, len };
+}
+
+// Generates a Sixel image that is `width` pixels wide and `bands` * 6 pixels tall.
+// Each band is drawn in 4 passes (one per color) with a varying bit pattern.
+static std::wstring_view sixel_image(mem::Arena& arena, size_t width, size_t bands)
+{
+    static constexpr std::wstring_view prefix{ L"\x1bP0;1q#0;2;100;0;0#1;2;0;100;0#2;2;0;0;100#3;2;100;100;100" };
+    static constexpr std::wstring_view suffix{ L"\x1b\\" };
+    static constexpr size_t colors = 4;
+
+    // Each pass is "#c", the sixels and a "$" (or a "-" after the last pass).
+    const auto len = prefix.size() + bands * colors * (width + 3) + suffix.size();
+    const auto buf = arena.push_uninitialized<wchar_t>(len);
+    auto it = buf;
+
+    mem::copy(it, prefix.data(), prefix.size());
+    it += prefix.size();
+    for (size_t band = 0; band < bands; ++band)
+    {
+        for (size_t color = 0; color < colors; ++color)
+        {
+            *it++ = L'#';
+            *it++ = static_cast<wchar_t>(L'0' + color);
+            for (size_t x = 0; x < width; ++x)
+            {
+                *it++ = static_cast<wchar_t>(L'?' + ((x + band + color * 16) & 63));
+            }
+            *it++ = color + 1 < colors ? L'$' : L'-';
+        }
+    }
+    mem::copy(it, suffix.data(), suffix.size());
+
+    return { buf, len };
+}
+
 static void generate_html(mem::Arena& arena, const AccumulatedResults* results)
 {
     const auto scratch = mem::get_scratch_arena(arena);
@@ -6,24 +6,11 @@
 
 #include <propsys.h>
 
-#include "inc/colorTable.hpp"
-
 #include <wil/token_helpers.h>
 #include <til/string.h>
 
 using namespace Microsoft::Console;
 
-// Routine Description:
-// - Determines if a character is a valid number character, 0-9.
-// Arguments:
-// - wch - Character to check.
-// Return Value:
-// - True if it is. False if it isn't.
-static constexpr bool _isNumber(const wchar_t wch) noexcept
-{
-    return wch >= L'0' && wch <= L'9'; // 0x30 - 0x39
-}
-
 GSL_SUPPRESS(bounds)
 static std::wstring guidToStringCommon(const GUID& guid, size_t offset, size_t length)
 {
@@ -144,401 +131,6 @@ til::color Utils::ColorFromHexString(const std::string_view str)
     return til::color{ r, g, b, a };
 }
 
-// Routine Description:
-// - Given a color string, attempts to parse the color.
-//   The color are specified by name or RGB specification as per XParseColor.
-// Arguments:
-// - string - The string containing the color spec string to parse.
-// Return Value:
-// - An optional color which contains value if a color was successfully parsed
-std::optional<til::color> Utils::ColorFromXTermColor(const std::wstring_view string) noexcept
-{
-    auto color = ColorFromXParseColorSpec(string);
-    if (!color.has_value())
-    {
-        // Try again, but use the app color name parser
-        color = ColorFromXOrgAppColorName(string);
-    }
-
-    return color;
-}
-
-// Routine Description:
-// - Given a color spec string, attempts to parse the color that's encoded.
-//
-//   Based on the XParseColor documentation, the supported specs currently are the following:
-//      spec1: a color in the following format:
-//          "rgb:<red>/<green>/<blue>"
-//      spec2: a color in the following format:
-//          "#<red><green><blue>"
-//
-//   In both specs, <color> is a value contains up to 4 hex digits, upper or lower case.
-// Arguments:
-// - string - The string containing the color spec string to parse.
-// Return Value:
-// - An optional color which contains value if a color was successfully parsed
-std::optional<til::color> Utils::ColorFromXParseColorSpec(const std::wstring_view string) noexcept
-try
-{
-    auto foundXParseColorSpec = false;
-    auto foundValidColorSpec = false;
-
-    auto isSharpSignFormat = false;
-    size_t rgbHexDigitCount = 0;
-    std::array<unsigned int, 3> colorValues = { 0 };
-    std::array<unsigned int, 3> parameterValues = { 0 };
-    const auto stringSize = string.size();
-
-    // First we look for "rgb:"
-    // Other colorspaces are theoretically possible, but we don't support them.
-    auto curr = string.cbegin();
-    if (stringSize > 4)
-    {
-        auto prefix = std::wstring(string.substr(0, 4));
-
-        // The "rgb:" indicator should be case insensitive. To prevent possible issues under
-        // different locales, transform only ASCII range latin characters.
-        std::transform(prefix.begin(), prefix.end(), prefix.begin(), [](const auto x) {
-            return x >= L'A' && x <= L'Z' ? static_cast<wchar_t>(std::towlower(x)) : x;
-        });
-
-        if (prefix.compare(L"rgb:") == 0)
-        {
-            // If all the components have the same digit count, we can have one of the following formats:
-            // 9 "rgb:h/h/h"
-            // 12 "rgb:hh/hh/hh"
-            // 15 "rgb:hhh/hhh/hhh"
-            // 18 "rgb:hhhh/hhhh/hhhh"
-            // Note that the component sizes aren't required to be the same.
-            // Anything in between is also valid, e.g. "rgb:h/hh/h" and "rgb:h/hh/hhh".
-            // Any fewer cannot be valid, and any more will be too many. Return early in this case.
-            if (stringSize < 9 || stringSize > 18)
-            {
-                return std::nullopt;
-            }
-
-            foundXParseColorSpec = true;
-
-            std::advance(curr, 4);
-        }
-    }
-
-    // Try the sharp sign format.
-    if (!foundXParseColorSpec && stringSize > 1)
-    {
-        if (til::at(string, 0) == L'#')
-        {
-            // We can have one of the following formats:
-            // 4 "#hhh"
-            // 7 "#hhhhhh"
-            // 10 "#hhhhhhhhh"
-            // 13 "#hhhhhhhhhhhh"
-            // Any other cases will be invalid. Return early in this case.
-            if (!(stringSize == 4 || stringSize == 7 || stringSize == 10 || stringSize == 13))
-            {
-                return std::nullopt;
-            }
-
-            isSharpSignFormat = true;
-            foundXParseColorSpec = true;
-            rgbHexDigitCount = (stringSize - 1) / 3;
-
-            std::advance(curr, 1);
-        }
-    }
-
-    // No valid spec is found. Return early.
-    if (!foundXParseColorSpec)
-    {
-        return std::nullopt;
-    }
-
-    // Try to parse the actual color value of each component.
-    for (size_t component = 0; component < 3; component++)
-    {
-        auto foundColor = false;
-        auto& parameterValue = til::at(parameterValues, component);
-        // For "sharp sign" format, the rgbHexDigitCount is known.
-        // For "rgb:" format, colorspecs are up to hhhh/hhhh/hhhh, for 1-4 h's
-        const auto iteration = isSharpSignFormat ? rgbHexDigitCount : 4;
-        for (size_t i = 0; i < iteration && curr < string.cend(); i++)
-        {
-            const auto wch = *curr++;
-
-            parameterValue *= 16;
-            unsigned int intVal = 0;
-            const auto ret = HexToUint(wch, intVal);
-            if (!ret)
-            {
-                // Encountered something weird oh no
-                return std::nullopt;
-            }
-
-            parameterValue += intVal;
-
-            if (isSharpSignFormat)
-            {
-                // If we get this far, any number can be seen as a valid part
-                // of this component.
-                foundColor = true;
-
-                if (i >= rgbHexDigitCount)
-                {
-                    // Successfully parsed this component. Start the next one.
-                    break;
-                }
-            }
-            else
-            {
-                // Record the hex digit count of the current component.
-                rgbHexDigitCount = i + 1;
-
-                // If this is the first 2 component...
-                if (component < 2 && curr < string.cend() && *curr == L'/')
-                {
-                    // ...and we have successfully parsed this component, we need
-                    // to skip the delimiter before starting the next one.
-                    curr++;
-                    foundColor = true;
-                    break;
-                }
-                // Or we have reached the end of the string...
-                else if (curr >= string.cend())
-                {
-                    // ...meaning that this is the last component. We're not going to
-                    // see any delimiter. We can just break out.
-                    foundColor = true;
-                    break;
-                }
-            }
-        }
-
-        if (!foundColor)
-        {
-            // Indicates there was some error parsing color.
-            return std::nullopt;
-        }
-
-        // Calculate the actual color value based on the hex digit count.
-        auto& colorValue = til::at(colorValues, component);
-        const auto scaleMultiplier = isSharpSignFormat ? 0x10 : 0x11;
-        const auto scaleDivisor = scaleMultiplier << 8 >> 4 * (4 - rgbHexDigitCount);
-        colorValue = parameterValue * scaleMultiplier / scaleDivisor;
-    }
-
-    if (curr >= string.cend())
-    {
-        // We're at the end of the string and we have successfully parsed the color.
-        foundValidColorSpec = true;
-    }
-
-    // Only if we find a valid colorspec can we pass it out successfully.
-    if (foundValidColorSpec)
-    {
-        return til::color(LOBYTE(til::at(colorValues, 0)),
-                          LOBYTE(til::at(colorValues, 1)),
-                          LOBYTE(til::at(colorValues, 2)));
-    }
-
-    return std::nullopt;
-}
-catch (...)
-{
-    LOG_CAUGHT_EXCEPTION();
-    return std::nullopt;
-}
-
-// Routine Description:
-// - Constructs a til::color value from RGB percentage components.
-// Arguments:
-// - r - The red component of the color (0-100%).
-// - g - The green component of the color (0-100%).
-// - b - The blue component of the color (0-100%).
-// Return Value:
-// - The color defined by the given components.
-til::color Utils::ColorFromRGB100(const int r, const int g, const int b) noexcept
-{
-    // The color class is expecting components in the range 0 to 255,
-    // so we need to scale our percentage values by 255/100. We can
-    // optimise this conversion with a pre-created lookup table.
-    static constexpr auto scale100To255 = [] {
-        std::array<uint8_t, 101> lut{};
-        for (size_t i = 0; i < std::size(lut); i++)
-        {
-            lut.at(i) = gsl::narrow_cast<uint8_t>((i * 255 + 50) / 100);
-        }
-        return lut;
-    }();
-
-    const auto red = til::at(scale100To255, std::min<unsigned>(r, 100u));
-    const auto green = til::at(scale100To255, std::min<unsigned>(g, 100u));
-    const auto blue = til::at(scale100To255, std::min<unsigned>(b, 100u));
-    return { red, green, blue };
-}
-
-// Routine Description:
-// - Constructs a til::color value from HLS components.
-// Arguments:
-// - h - The hue component of the color (0-360°).
-// - l - The luminosity component of the color (0-100%).
-// - s - The saturation component of the color (0-100%).
-// Return Value:
-// - The color defined by the given components.
-til::color Utils::ColorFromHLS(const int h, const int l, const int s) noexcept
-{
-    const auto hue = h % 360;
-    const auto lum = gsl::narrow_cast<float>(std::min(l, 100));
-    const auto sat = gsl::narrow_cast<float>(std::min(s, 100));
-
-    // This calculation is based on the HSL to RGB algorithm described in
-    // Wikipedia: https://en.wikipedia.org/wiki/HSL_and_HSV#HSL_to_RGB
-    // We start by calculating the chroma value, and the point along the bottom
-    // faces of the RGB cube with the same hue and chroma as our color (x).
-    const auto chroma = (50.f - abs(lum - 50.f)) * sat / 50.f;
-    const auto x = chroma * (60 - abs(hue % 120 - 60)) / 60.f;
-
-    // We'll also need an offset added to each component to match lightness.
-    const auto lightness = lum - chroma / 2.0f;
-
-    // We use the chroma value for the brightest component, x for the second
-    // brightest, and 0 for the last. The values  are scaled by 255/100 to get
-    // them in the range 0 to 255, as required by the color class.
-    constexpr auto scale = 255.f / 100.f;
-    const auto comp1 = gsl::narrow_cast<uint8_t>((chroma + lightness) * scale + 0.5f);
-    const auto comp2 = gsl::narrow_cast<uint8_t>((x + lightness) * scale + 0.5f);
-    const auto comp3 = gsl::narrow_cast<uint8_t>((0 + lightness) * scale + 0.5f);
-
-    // Finally we order the components based on the given hue. But note that the
-    // DEC terminals used a different mapping for hue than is typical for modern
-    // color models. Blue is at 0°, red is at 120°, and green is at 240°.
-    // See DEC STD 070, ReGIS Graphics Extension, § 8.6.2.2.2, Color by Value.
-    if (hue < 60)
-        return { comp2, comp3, comp1 }; // blue to magenta
-    else if (hue < 120)
-        return { comp1, comp3, comp2 }; // magenta to red
-    else if (hue < 180)
-        return { comp1, comp2, comp3 }; // red to yellow
-    else if (hue < 240)
-        return { comp2, comp1, comp3 }; // yellow to green
-    else if (hue < 300)
-        return { comp3, comp1, comp2 }; // green to cyan
-    else
-        return { comp3, comp2, comp1 }; // cyan to blue
-}
-
-// Routine Description:
-// - Converts a hex character to its equivalent integer value.
-// Arguments:
-// - wch - Character to convert.
-// - value - receives the int value of the char
-// Return Value:
-// - true iff the character is a hex character.
-bool Utils::HexToUint(const wchar_t wch,
-                      unsigned int& value) noexcept
-{
-    value = 0;
-    auto success = false;
-    if (wch >= L'0' && wch <= L'9')
-    {
-        value = wch - L'0';
-        success = true;
-    }
-    else if (wch >= L'A' && wch <= L'F')
-    {
-        value = (wch - L'A') + 10;
-        success = true;
-    }
-    else if (wch >= L'a' && wch <= L'f')
-    {
-        value = (wch - L'a') + 10;
-        success = true;
-    }
-    return success;
-}
-
-// Routine Description:
-// - Converts a number string to its equivalent unsigned integer value.
-// Arguments:
-// - wstr - String to convert.
-// - value - receives the int value of the string
-// Return Value:
-// - true iff the string is a unsigned integer string.
-bool Utils::StringToUint(const std::wstring_view wstr,
-                         unsigned int& value)
-{
-    if (wstr.size() < 1)
-    {
-        return false;
-    }
-
-    unsigned int result = 0;
-    size_t current = 0;
-    while (current < wstr.size())
-    {
-        const auto wch = wstr.at(current);
-        if (_isNumber(wch))
-        {
-            result *= 10;
-            result += wch - L'0';
-
-            ++current;
-        }
-        else
-        {
-            return false;
-        }
-    }
-
-    value = result;
-
-    return true;
-}
-
-// Routine Description:
-// - Split a string into different parts using the delimiter provided.
-// Arguments:
-// - wstr - String to split.
-// - delimiter - delimiter to use.
-// Return Value:
-// - a vector containing the result string parts.
-std::vector<std::wstring_view> Utils::SplitString(const std::wstring_view wstr,
-                                                  const wchar_t delimiter) noexcept
-try
-{
-    std::vector<std::wstring_view> result;
-    size_t current = 0;
-    while (current < wstr.size())
-    {
-        const auto nextDelimiter = wstr.find(delimiter, current);
-        if (nextDelimiter == std::wstring::npos)
-        {
-            result.push_back(wstr.substr(current));
-            break;
-        }
-        else
-        {
-            const auto length = nextDelimiter - current;
-            result.push_back(wstr.substr(current, length));
-            // Skip this part and the delimiter. Start the next one
-            current += length + 1;
-            // The next index is larger than string size, which means the string
-            // is in the format of "part1;part2;" (assuming use ';' as delimiter).
-            // Add the last part which is an empty string.
-            if (current >= wstr.size())
-            {
-                result.push_back(L"");
-            }
-        }
-    }
-
-    return result;
-}
-catch (...)
-{
-    LOG_CAUGHT_EXCEPTION();
-    return {};
-}
-
 // Routine Description:
 // - Pre-process text pasted (presumably from the clipboard) with provided option.
 // Arguments: